@@ -0,0 +1,46 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+#include <stdio.h>
+
+/*
+* Function: is_adaptive
+* ---------------------
+*  Checks if the file starts with the adaptive stream's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_adaptive(FILE* file);
+
+/*
+* Function: compress_adaptive
+* ---------------------------
+*  Compresses the input in one pass with adaptive huffman coding (FGK):
+*  encoder and decoder start from the same empty tree and update it after
+*  every symbol, so no table is stored. New symbols are sent as the
+*  escape code followed by 9 raw bits, the stream ends with the escape and
+*  256. The whole bytes are written after every read, so the input can be
+*  an unbounded stream (e.g. a pipe).
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_adaptive(FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_adaptive
+* -----------------------------
+*  Decompresses an adaptive stream. The decoded bytes are written after
+*  every read, so the input can be an unbounded stream (e.g. a pipe).
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_adaptive(FILE* input_file, FILE* output_file);
+#endif
@@ -0,0 +1,113 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+#include "batch.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_NO_TABLE UINT32_MAX
+
+/*
+* Central directory entry of an archive member. Members are stored
+* byte-aligned, so a member is decoded from data_offset with the table
+* at table_offsets[table_index] and nothing else.
+*/
+typedef struct {
+    char* name;
+    uint64_t original_size;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint32_t table_index; // ARCHIVE_NO_TABLE for empty members
+} ArchiveEntry;
+
+typedef struct {
+    FILE* file;
+    uint64_t* table_offsets;
+    uint32_t table_count;
+    ArchiveEntry* entries;
+    uint32_t entry_count;
+} Archive;
+
+/*
+* Function: create_archive
+* ------------------------
+*  Packs every file of the list into one archive. Consecutive small files
+*  share a huffman table built from their combined frequencies.
+*
+*  output_file: Pointer to the archive file
+*  list: Pointer to the PathList object
+*
+*  returns: If failed (0), On success (1)
+*/
+int create_archive(FILE* output_file, PathList* list);
+
+/*
+* Function: open_archive
+* ----------------------
+*  Reads the central directory of an archive.
+*
+*  file: Pointer to the archive file
+*
+*  returns: Pointer to the Archive object. If failed, returns NULL.
+*/
+Archive* open_archive(FILE* file);
+
+/*
+* Function: close_archive
+* -----------------------
+*  Frees the Archive object (The file is not closed).
+*
+*  archive: Pointer to the Archive object
+*/
+void close_archive(Archive* archive);
+
+/*
+* Function: find_archive_entry
+* ----------------------------
+*  Returns the member with the given name.
+*
+*  archive: Pointer to the Archive object
+*  name: Member name
+*
+*  returns: Pointer to the entry. If not found, returns NULL.
+*/
+ArchiveEntry* find_archive_entry(Archive* archive, const char* name);
+
+/*
+* Function: extract_archive_entry
+* -------------------------------
+*  Decodes one member into the output file.
+*
+*  archive: Pointer to the Archive object
+*  entry: Pointer to the member's entry
+*  output_file: Pointer to the output file
+*
+*  returns: If failed (0), On success (1)
+*/
+int extract_archive_entry(Archive* archive, ArchiveEntry* entry, FILE* output_file);
+
+/*
+* Function: extract_archive
+* -------------------------
+*  Extracts the named members (or every member) under a directory and
+*  prints a summary.
+*
+*  archive: Pointer to the Archive object
+*  directory: Output directory (NULL for the current directory)
+*  names: Member names (NULL extracts every member)
+*  name_count: Number of names
+*
+*  returns: Number of failed members
+*/
+size_t extract_archive(Archive* archive, const char* directory, char** names, size_t name_count);
+
+/*
+* Function: list_archive
+* ----------------------
+*  Prints the members of an archive.
+*
+*  archive: Pointer to the Archive object
+*/
+void list_archive(Archive* archive);
+#endif
@@ -0,0 +1,105 @@
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+#include "constants.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#define ASYNC_READ 0
+#define ASYNC_WRITE 1
+
+#define ASYNC_BACKEND_THREAD 1
+#define ASYNC_BACKEND_URING 2
+
+#define SLOT_FREE 0 // Slot is owned by the caller side and can be (re)submitted
+#define SLOT_PENDING 1 // Slot was handed to the backend
+#define SLOT_READY 2 // Backend has finished the request
+
+typedef struct {
+    unsigned char* data;
+    size_t size; // Requested bytes
+    ssize_t result; // Transferred bytes (or -1)
+    off_t offset; // File offset of the request
+    int state;
+} AsyncSlot;
+
+typedef struct uring_queue UringQueue;
+
+typedef struct {
+    FILE* file;
+    int fd;
+    int mode; // ASYNC_READ or ASYNC_WRITE
+    int backend; // ASYNC_BACKEND_THREAD or ASYNC_BACKEND_URING
+    int error;
+    AsyncSlot* slots;
+    size_t depth; // Number of slots in flight
+    size_t current; // Slot being filled/consumed by the caller
+    size_t current_pos; // Byte position inside the current slot
+    off_t position; // File offset of the next byte read/written by the caller
+    off_t next_offset; // File offset of the next request to submit
+    off_t end_offset; // Reader: file size, Writer: end of the submitted data
+    // Helper thread backend
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t io_index; // Next slot processed by the helper thread
+    int stop;
+    // io_uring backend
+    UringQueue* ring;
+} AsyncFile;
+
+/*
+* Function: async_open
+* --------------------
+*  Creates an asynchronous reader or writer on top of a file. The file's
+*  current position is used as the starting offset. Uses io_uring when the
+*  kernel supports it, otherwise falls back to a helper thread.
+*
+*  file: Pointer to the file object
+*  mode: ASYNC_READ or ASYNC_WRITE
+*
+*  returns: An AsyncFile object. If failed, returns NULL.
+*/
+AsyncFile* async_open(FILE* file, int mode);
+
+/*
+* Function: async_read
+* --------------------
+*  Copies the next bytes of the file into the buffer. Later parts of the
+*  file are already being read in the background.
+*
+*  async_file: AsyncFile object opened with ASYNC_READ
+*  buffer: Destination buffer
+*  size: Maximum number of bytes to copy
+*
+*  returns: Number of copied bytes (0 at the end of file). If failed, returns -1.
+*/
+ssize_t async_read(AsyncFile* async_file, void* buffer, size_t size);
+
+/*
+* Function: async_write
+* ---------------------
+*  Queues the bytes to be written to the file. Full slots are submitted
+*  to the backend while the caller keeps working.
+*
+*  async_file: AsyncFile object opened with ASYNC_WRITE
+*  buffer: Source buffer
+*  size: Number of bytes
+*
+*  returns: Number of queued bytes. If failed, returns -1.
+*/
+ssize_t async_write(AsyncFile* async_file, const void* buffer, size_t size);
+
+/*
+* Function: async_close
+* ---------------------
+*  Waits for all requests in flight, moves the file position to the end
+*  of the processed data and frees the object.
+*
+*  async_file: AsyncFile object
+*
+*  returns: If failed (0), On success (1)
+*/
+int async_close(AsyncFile* async_file);
+#endif
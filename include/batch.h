@@ -0,0 +1,128 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <stdio.h>
+
+#define BATCH_COMPRESS 0
+#define BATCH_DECOMPRESS 1
+#define BATCH_TEST 2
+
+struct Dictionary;
+
+typedef struct {
+    char** paths;
+    size_t count;
+    size_t capacity;
+} PathList;
+
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+} BatchInput;
+
+typedef struct {
+    unsigned char* data; // Points into the buffer returned by huff_compress_batch
+    size_t size;
+} BatchOutput;
+
+/*
+* Function: path_list_add
+* -----------------------
+*  Adds a file to the list. Directories are walked recursively; while
+*  compressing '.huf' files are skipped, while decompressing or testing
+*  only '.huf' files are added.
+*
+*  list: Pointer to the PathList object
+*  path: File or directory path
+*  mode: BATCH_COMPRESS, BATCH_DECOMPRESS or BATCH_TEST
+*
+*  returns: If failed (0), On success (1)
+*/
+int path_list_add(PathList* list, const char* path, int mode);
+
+/*
+* Function: path_list_read
+* ------------------------
+*  Adds every path of a file list (one path per line) to the list.
+*
+*  list: Pointer to the PathList object
+*  list_file: Pointer to the file containing the paths (e.g. stdin)
+*  mode: BATCH_COMPRESS, BATCH_DECOMPRESS or BATCH_TEST
+*
+*  returns: If failed (0), On success (1)
+*/
+int path_list_read(PathList* list, FILE* list_file, int mode);
+
+/*
+* Function: path_list_free
+* ------------------------
+*  Frees the paths of the list.
+*
+*  list: Pointer to the PathList object
+*/
+void path_list_free(PathList* list);
+
+/*
+* Function: run_batch
+* -------------------
+*  Compresses, decompresses or tests every file of the list on a thread
+*  pool and prints a summary. Outputs are written next to the inputs
+*  ('.huf' is added while compressing and removed while decompressing),
+*  tested files are only decoded.
+*
+*  list: Pointer to the PathList object
+*  mode: BATCH_COMPRESS, BATCH_DECOMPRESS or BATCH_TEST
+*  thread_count: Number of worker threads (0 uses the number of online CPUs)
+*  sample_size: Bytes sampled for the table of large inputs, 0 counts every
+*               byte (see sample_frequencies)
+*  verify: Check the checksums of seekable files, files without them fail
+*  dictionary: Trained table shared by every file (Can be NULL)
+*
+*  returns: Number of failed files
+*/
+size_t run_batch(PathList* list, int mode, size_t thread_count, size_t sample_size, int verify,
+                 struct Dictionary* dictionary);
+
+/*
+* Function: huff_compress_batch
+* -----------------------------
+*  Compresses many small in-memory messages in one call. Every output is a
+*  complete stream that decompress reads: a compact stream with its own
+*  table, a stream of a shared table or a stored container if coding
+*  doesn't pay off. The messages are split in chunks of BATCH_CHUNK_MESSAGES
+*  that run on a thread pool; a chunk reuses one stack scratch table for
+*  all its messages and counts, builds the codes of and encodes each
+*  message right after the other, while it is still in the cache. No
+*  memory is allocated per message.
+*
+*  inputs: Messages to compress
+*  count: Number of messages
+*  outputs: Filled with the compressed messages (count entries)
+*  thread_count: Number of worker threads (0 uses the number of online CPUs)
+*  dictionary: NULL gives every message its own table. If it points to a
+*              table, the messages are encoded with it; if it points to
+*              NULL, a table is built from the frequencies of the whole
+*              batch and stored there (save it with save_dictionary so the
+*              messages can be decompressed, and free it with free_dictionary).
+*
+*  returns: Buffer holding every output (free it once with free). If failed, returns NULL.
+*/
+unsigned char* huff_compress_batch(const BatchInput* inputs, size_t count, BatchOutput* outputs, size_t thread_count,
+                                   struct Dictionary** dictionary);
+/*
+* Function: huff_decompress_message
+* ---------------------------------
+*  Decompresses one message returned by huff_compress_batch in memory. The
+*  shared table is given directly instead of being loaded by its ID, so a
+*  table built by huff_compress_batch can be used without saving it.
+*
+*  data: Compressed message
+*  size: Number of bytes in the message
+*  dictionary: Table the message was compressed with (Can be NULL for
+*              messages with their own table or stored messages)
+*  output_size: Pointer to store the number of decompressed bytes
+*
+*  returns: Decompressed message (free it with free). If failed, returns NULL.
+*/
+unsigned char* huff_decompress_message(const unsigned char* data, size_t size, const struct Dictionary* dictionary,
+                                       size_t* output_size);
+#endif
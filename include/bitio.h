@@ -1,5 +1,6 @@
 #ifndef BITIO_H
 #define BITIO_H
+#include "asyncio.h"
 #include "constants.h"
 
 #include <stdint.h>
@@ -8,8 +9,11 @@
 typedef struct {
     unsigned char* buffer;
     FILE* file;
-    size_t bit_count;
-    size_t total_bits;
+    AsyncFile* async; // If not NULL, buffers are written through the asynchronous backend
+    size_t bit_count; // Bits in buffer (always whole bytes, the rest is in the accumulator)
+    uint64_t total_bits;
+    uint64_t accumulator; // Bits not yet stored in buffer (the last accumulator_bits bits)
+    int accumulator_bits;
 } BitWriter;
 
 typedef struct {
@@ -17,10 +21,11 @@ typedef struct {
     int bit_pos; // Bit position in current byte (0-7)
     int bit_padding;
     FILE* file;
+    AsyncFile* async; // If not NULL, buffers are read through the asynchronous backend
     size_t buffer_pos; // Current byte position in buffer
     size_t buffer_size; // Bytes in buffer
-    size_t bits_read; // Total bits read
-    size_t total_bits; // Total valid bits BitReader;
+    uint64_t buffer_start; // Bits read before buffer[0] (see get_bits_read)
+    uint64_t total_bits; // Total valid bits BitReader;
 } BitReader;
 
 /*
@@ -34,6 +39,16 @@ typedef struct {
 */
 BitWriter* init_writer(FILE* file);
 
+/*
+* Function: reset_writer
+* ----------------------
+*  Clears the state of a BitWriter so it can be reused for another file.
+*
+*  bit_writer: Initiated BitWriter object
+*  file: A pointer to the new file object
+*/
+void reset_writer(BitWriter* bit_writer, FILE* file);
+
 /*
 * Function: write_bits
 * --------------------
@@ -41,7 +56,7 @@ BitWriter* init_writer(FILE* file);
 *
 *  bit_writer: Initiated BitWriter object
 *  code: The bit code to be written
-*  length: bit counts
+*  length: bit counts (0-32)
 *
 *  returns: The number of written bits. If failed, returns -1.
 */
@@ -58,6 +73,18 @@ ssize_t write_bits(BitWriter* bit_writer, uint32_t code, uint8_t length);
 */
 ssize_t flush_writer(BitWriter* bit_writer);
 
+/*
+* Function: drain_writer
+* ----------------------
+*  Writes the whole bytes of the BitWriter buffer without padding; the
+*  bits of the last partial byte stay in the accumulator.
+*
+*  bit_writer: Initiated BitWriter Object
+*
+*  returns: The number of written bytes. If failed, returns -1.
+*/
+ssize_t drain_writer(BitWriter* bit_writer);
+
 /*
 * Function: init_reader
 * ---------------------
@@ -69,6 +96,16 @@ ssize_t flush_writer(BitWriter* bit_writer);
 */
 BitReader* init_reader(FILE* file);
 
+/*
+* Function: reset_reader
+* ----------------------
+*  Clears the state of a BitReader so it can be reused for another file.
+*
+*  bit_reader: Initiated BitReader object
+*  file: A pointer to the new file object
+*/
+void reset_reader(BitReader* bit_reader, FILE* file);
+
 /*
 * Function: read_bits
 * -------------------
@@ -79,4 +116,42 @@ BitReader* init_reader(FILE* file);
 *  returns: The value of the bit. if failed, returns -1.
 */
 int read_bits(BitReader* bit_reader);
+
+/*
+* Function: get_bits_read
+* -----------------------
+*  Returns the number of bits read so far. It is derived from the buffer
+*  position, so reading a bit does not update a counter.
+*
+*  bit_reader: Initiated BitReader object
+*
+*  returns: Total bits read
+*/
+uint64_t get_bits_read(const BitReader* bit_reader);
+
+/*
+* Function: fill_reader
+* ---------------------
+*  Makes sure at least `bytes` bytes starting with the next bit are in the
+*  buffer (unless the file ends first). The unread bytes are moved to the
+*  front of the buffer before reading more.
+*
+*  bit_reader: Initiated BitReader object
+*  bytes: Number of bytes needed (at most READ_BUFFER_SIZE)
+*  available: Pointer to store the number of buffered bytes from the returned one
+*  bit_offset: Pointer to store the position of the next bit in the returned byte (0-7, MSB first)
+*
+*  returns: Pointer to the buffered byte holding the next bit
+*/
+const unsigned char* fill_reader(BitReader* bit_reader, size_t bytes, size_t* available, int* bit_offset);
+
+/*
+* Function: skip_bits
+* -------------------
+*  Consumes bits already in the buffer (see fill_reader).
+*
+*  bit_reader: Initiated BitReader object
+*  count: Number of bits (at most the available bits of the last fill_reader)
+*/
+void skip_bits(BitReader* bit_reader, size_t count);
 #endif
@@ -0,0 +1,144 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+#include "compressor.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define COMPACT_VERSION 0
+#define COMPACT_FLAG_BITMAP 0x08
+#define COMPACT_PADDING_MASK 0x07
+#define COMPACT_BITMAP_SIZE (FREQUENCY_TABLE_SIZE / 8)
+// magic + flags + largest symbol set + one nibble for every symbol
+#define COMPACT_MAX_HEADER_SIZE (3 + COMPACT_BITMAP_SIZE + FREQUENCY_TABLE_SIZE / 2)
+
+/*
+* Function: is_compact
+* --------------------
+*  Checks if the file starts with the compact header's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_compact(FILE* file);
+
+/*
+* Function: compute_code_lengths
+* ------------------------------
+*  Computes huffman code lengths of a frequency table, limited to
+*  max_length bits.
+*
+*  frequency_table: Pointer to the frequency table
+*  lengths: Code length of every symbol (0 for missing symbols)
+*  max_length: Maximum code length
+*
+*  returns: If failed (0), On success (1)
+*/
+int compute_code_lengths(size_t* frequency_table, uint8_t* lengths, uint8_t max_length);
+
+/*
+* Function: assign_canonical_codes
+* --------------------------------
+*  Assigns canonical codes: shorter codes first, symbols of the same
+*  length in ascending order.
+*
+*  lengths: Code length of every symbol
+*  code_table: Pointer to the code table (FREQUENCY_TABLE_SIZE entries)
+*/
+void assign_canonical_codes(const uint8_t* lengths, Code* code_table);
+
+/*
+* Function: build_code_tree
+* -------------------------
+*  Builds the decoding tree of a code table.
+*
+*  code_table: Pointer to the code table
+*
+*  returns: A pointer to the root of the tree. If failed, returns NULL.
+*/
+Node* build_code_tree(Code* code_table);
+
+/*
+* Function: write_symbol_set
+* --------------------------
+*  Stores the present symbols as (start, length - 1) runs, or as a bitmap
+*  if the runs would be larger.
+*
+*  lengths: Code length of every symbol (0 for missing symbols)
+*  buffer: Output buffer (At least COMPACT_BITMAP_SIZE + 1 bytes)
+*  flags: Pointer to the flags (COMPACT_FLAG_BITMAP is set for bitmaps)
+*
+*  returns: Number of bytes stored
+*/
+size_t write_symbol_set(const uint8_t* lengths, unsigned char* buffer, unsigned char* flags);
+
+/*
+* Function: read_symbol_set
+* -------------------------
+*  Reads a symbol set stored by write_symbol_set.
+*
+*  input_file: Pointer to the compressed file
+*  flags: Flags of the header
+*  present: Set to 1 for every present symbol
+*
+*  returns: Number of present symbols. If failed, returns -1.
+*/
+int read_symbol_set(FILE* input_file, unsigned char flags, uint8_t* present);
+
+/*
+* Function: write_compact_header
+* ------------------------------
+*  Stores the compact header of a set of code lengths.
+*
+*  lengths: Code length of every symbol (0 for missing symbols)
+*  total_bits: Number of encoded bits
+*  header: Output buffer (At least COMPACT_MAX_HEADER_SIZE bytes)
+*
+*  returns: Number of bytes stored
+*/
+size_t write_compact_header(const uint8_t* lengths, uint64_t total_bits, unsigned char* header);
+
+/*
+* Function: read_compact_header
+* -----------------------------
+*  Reads a compact header stored by write_compact_header from a buffer.
+*
+*  header: Stored header (followed by the encoded data)
+*  size: Number of bytes in the buffer
+*  lengths: Code length of every symbol (0 for missing symbols)
+*  flags: Pointer to store the flags (version and padding bits)
+*
+*  returns: Size of the header. If failed, returns 0.
+*/
+size_t read_compact_header(const unsigned char* header, size_t size, uint8_t* lengths, unsigned char* flags);
+
+/*
+* Function: compress_compact
+* --------------------------
+*  Compresses the input file with the compact header: a run-coded or
+*  bitmap symbol set, 4-bit canonical code lengths and the padding bits
+*  folded into the first bytes.
+*
+*  context: Pointer to the context
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_compact(HuffContext* context, FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_compact
+* ----------------------------
+*  Decompresses a file with the compact header.
+*
+*  context: Pointer to the context
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_compact(HuffContext* context, FILE* input_file, FILE* output_file);
+#endif
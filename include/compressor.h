@@ -1,9 +1,19 @@
 #ifndef COMPRESSOR_H
 #define COMPRESSOR_H
+#include "huffman.h"
 #include "minheap.h"
 
 #include <stdio.h>
 
+typedef struct {
+    size_t* frequency_table;
+    Code* code_table;
+    Code* pair_table; // Allocated on the first large input
+    BitWriter* bit_writer;
+    BitReader* bit_reader;
+    size_t sample_size; // Bytes sampled for the table of large inputs, 0 counts every byte (see sample_frequencies)
+    int verify; // Check the checksums of seekable files, files without them fail (-V)
+} HuffContext;
 
 /*
 * Function: fill_minheap
@@ -19,6 +29,105 @@
 */
 ssize_t fill_minheap(size_t* frequency_table, Heap* priority_queue, size_t max_count);
 
+/*
+* Function: create_huffman_tree
+* -----------------------------
+* Builds the huffman tree of a frequency table.
+*
+* frequency_table: Pointer to the frequency table.
+* max_count: If > 0, scales down the frequency
+*
+* returns: A pointer to the root of the tree. If failed, returns NULL.
+*/
+Node* create_huffman_tree(size_t* frequency_table, size_t max_count);
+
+/*
+* Function: fill_code_table
+* -------------------------
+* Builds the huffman tree of a frequency table and generates the code of every symbol.
+*
+* frequency_table: Pointer to the frequency table.
+* code_table: Pointer to the code table (FREQUENCY_TABLE_SIZE entries).
+*
+* returns: If failed (0), On success (1)
+*/
+int fill_code_table(size_t* frequency_table, Code* code_table);
+
+/*
+* Function: create_code_table
+* ---------------------------
+* Builds the huffman tree of a frequency table and generates the code of every symbol.
+*
+* frequency_table: Pointer to the frequency table.
+*
+* returns: Code table (FREQUENCY_TABLE_SIZE entries). If failed, returns NULL.
+*/
+Code* create_code_table(size_t* frequency_table);
+
+/*
+* Function: prepare_pair_table
+* ----------------------------
+* Fills the context's pair table from its code table, if the input is large
+* enough to pay for it and every two codes fit in 32 bits. The table is
+* allocated on first use and kept for the next files.
+*
+* context: Pointer to the context
+* input_size: Size of the input to encode
+*
+* returns: Pointer to the pair table. NULL if symbols should be encoded one at a time.
+*/
+Code* prepare_pair_table(HuffContext* context, size_t input_size);
+
+/*
+* Function: create_context
+* ------------------------
+* Allocates the tables and bit reader/writer used by compress and decompress,
+* so they can be reused for many files.
+*
+* returns: Pointer to the context. If failed, returns NULL.
+*/
+HuffContext* create_context(void);
+
+/*
+* Function: free_context
+* ----------------------
+* Frees the context and everything it owns.
+*
+* context: Pointer to the context
+*/
+void free_context(HuffContext* context);
+
+/*
+* Function: compress_with_context
+* -------------------------------
+* Compresses the input file using huffman coding, reusing the context's buffers.
+* Inputs smaller than COMPACT_MAX_SIZE are stored with the compact header,
+* inputs whose sample is close to 8 bits of entropy per byte are copied
+* into a stored container (see probe_incompressible), skewed histograms with tANS (see prefer_tans) and flat histograms as
+* fixed-width indexes (see prefer_packed). With a sample size in the context
+* the table of large inputs is built from a sample (see sample_frequencies).
+*
+* context: Pointer to the context
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file
+*
+* returns: If failed (0), On success (1)
+*/
+int compress_with_context(HuffContext* context, FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_with_context
+* ---------------------------------
+* Decompresses the input file using huffman coding, reusing the context's buffers
+*
+* context: Pointer to the context
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file (NULL only decodes, e.g. to test the file)
+*
+* returns: If failed (0), On success (1)
+*/
+int decompress_with_context(HuffContext* context, FILE* input_file, FILE* output_file);
+
 /*
 * Function: compress
 * ------------------
@@ -3,3 +3,55 @@
 #define OUTPUT_BUFFER_SIZE 4 * KB
 #define FREQUENCY_TABLE_SIZE 256
 
+#define ASYNC_BUFFER_SIZE 64 * KB
+#define ASYNC_QUEUE_DEPTH 4
+
+#define PIPELINE_CHUNK_SIZE 64 * KB
+#define PIPELINE_CHUNKS 8
+#define PIPELINE_SPIN_COUNT 64 // Ring checks before a stage sleeps
+
+#define MAX_THREAD_COUNT 1024 // Largest -j
+
+#define ARCHIVE_SMALL_FILE_SIZE 64 * KB
+#define ARCHIVE_GROUP_SIZE 1024 * KB
+
+#define SEEKABLE_SEGMENT_SIZE 64 * KB
+#define SEEKABLE_MERGE_COPY_SIZE 1024 * KB
+
+#define RECORD_GROUP_SIZE 64
+
+#define BATCH_CHUNK_MESSAGES 1024
+
+#define DICTIONARY_DIR_ENV "HUFFMAN_TABLES"
+#define DECODE_PORTABLE_ENV "HUFFMAN_PORTABLE_DECODE"
+
+#define COMPACT_MAX_SIZE 64 * KB
+#define COMPACT_MAX_CODE_LENGTH 15
+
+#define DECODE_MULTI_SYMBOL_MAX_LENGTH 7 // 12-bit multi-symbol entries still beat single ones at 6.5 bits/byte
+
+#define PAIR_TABLE_SIZE FREQUENCY_TABLE_SIZE * FREQUENCY_TABLE_SIZE
+#define PAIR_TABLE_MIN_INPUT_SIZE 256 * KB
+
+#define FAST_STATS_SAMPLE_SIZE 4096 * KB
+#define FAST_STATS_BLOCK_SIZE 64 * KB
+
+#define PARALLEL_CHUNK_SIZE 1024 * KB
+#define PARALLEL_WINDOW_CHUNKS 32
+#define PARALLEL_DECODE_CHUNK_SIZE 256 * KB
+#define PARALLEL_SYNC_SYMBOLS 1024
+
+#define PACKED_MAX_OVERHEAD_PERCENT 3
+#define PACKED_BLOCK_GROUPS 512
+
+#define TANS_TABLE_LOG 11
+#define TANS_BLOCK_SIZE 256 * KB
+#define TANS_MIN_GAIN_PERCENT 1
+
+#define STORED_PROBE_SIZE 256 * KB
+#define STORED_MIN_BITS_PER_BYTE 7.9
+#define STORED_COPY_SIZE 64 * KB
+
+#define ADAPTIVE_END_OF_STREAM 256
+#define ADAPTIVE_ESCAPE_BITS 9
+#define ADAPTIVE_MAX_NODES 513
@@ -0,0 +1,40 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+* Function: crc32c_update
+* -----------------------
+*  Updates a CRC32C (Castagnoli) checksum. Uses the SSE4.2 crc32
+*  instruction if the CPU supports it, otherwise a slicing-by-8 table.
+*
+*  crc: Checksum of the previous data (0 for the start)
+*  data: Pointer to the data
+*  size: Number of bytes
+*
+*  returns: Updated checksum
+*/
+uint32_t crc32c_update(uint32_t crc, const unsigned char* data, size_t size);
+
+/*
+* Function: crc32c_backend
+* ------------------------
+*  Returns the name of the selected implementation ("sse4.2" or "table").
+*/
+const char* crc32c_backend(void);
+
+/*
+* Function: crc32c_combine
+* ------------------------
+*  Returns the checksum of two concatenated blocks from the checksums of
+*  the blocks, without reading the data (O(log length2) matrix squarings).
+*
+*  crc1: Checksum of the first block
+*  crc2: Checksum of the second block
+*  length2: Size of the second block in bytes
+*
+*  returns: Checksum of the concatenation
+*/
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t length2);
+#endif
@@ -0,0 +1,129 @@
+#ifndef DECODETABLE_H
+#define DECODETABLE_H
+#include "huffman.h"
+
+#include <stdint.h>
+
+#define DECODE_TABLE_MAX_SYMBOLS 4
+
+#define DECODE_TABLE_AUTO 0
+#define DECODE_TABLE_TREE 1
+#define DECODE_TABLE_SINGLE 2
+#define DECODE_TABLE_MULTI 3
+
+typedef struct {
+    unsigned char symbols[DECODE_TABLE_MAX_SYMBOLS];
+    uint8_t count; // Number of symbols (0: the next code is longer than the table width)
+    uint8_t length; // Total code length of the symbols
+} DecodeEntry;
+
+/*
+* Decodes symbols with table lookups from data (see decode_table_run).
+*/
+typedef size_t (*DecodeRunFunction)(const DecodeEntry* entries, const unsigned char* data, size_t data_size,
+                                    size_t* bit_position, size_t bit_limit, unsigned char* output, size_t symbol_limit);
+
+typedef struct {
+    DecodeEntry* entries; // 2^width entries, indexed by the next width bits
+    int width; // 8, 10, 11 or 12 bits
+    int multi_symbol;
+    DecodeRunFunction decode_run; // Specialized for the width and the CPU
+} DecodeTable;
+
+/*
+* Function: set_decode_table_mode
+* -------------------------------
+*  Selects the lookup table used by decode_symbols.
+*
+*  mode: DECODE_TABLE_AUTO (multi-symbol entries for short average code
+*        lengths), DECODE_TABLE_TREE (walk the tree bit by bit),
+*        DECODE_TABLE_SINGLE or DECODE_TABLE_MULTI
+*/
+void set_decode_table_mode(int mode);
+
+/*
+* Function: get_decode_table_mode
+* -------------------------------
+*  returns: The lookup table mode used by decode_symbols
+*/
+int get_decode_table_mode(void);
+
+/*
+* Function: set_decode_table_portable
+* -----------------------------------
+*  Disables the BMI2 lookup loops, e.g. to compare them with the portable ones.
+*  Builds without optimization use the portable loops unless this is set to 0.
+*
+*  enabled: Portable loops only (1), Select by CPU (0)
+*/
+void set_decode_table_portable(int enabled);
+
+/*
+* Function: decode_table_backend
+* ------------------------------
+*  Returns the name of the lookup loops new tables use ("bmi2" or "portable").
+*/
+const char* decode_table_backend(void);
+
+/*
+* Function: create_decode_table
+* -----------------------------
+*  Builds a lookup table of a huffman tree. Every entry holds the symbols
+*  whose codes fit in the next width bits: one symbol, or with multi-symbol
+*  entries up to DECODE_TABLE_MAX_SYMBOLS. Single-symbol tables are as wide
+*  as the longest code (8, 10, 11 or 12 bits), multi-symbol tables use 12.
+*
+*  root: Pointer to the root node of the huffman tree
+*
+*  returns: Pointer to the table. NULL if the tree should be walked
+*           instead (or if failed).
+*/
+DecodeTable* create_decode_table(Node* root);
+
+/*
+* Function: decode_table_run
+* --------------------------
+*  Decodes symbols from data until a code is longer than the table, the
+*  next symbols would pass bit_limit or symbol_limit, or fewer than 8 bytes
+*  are left in data. The caller continues from there by walking the tree.
+*
+*  table: Pointer to the DecodeTable object
+*  data: Encoded bytes
+*  data_size: Number of bytes in data
+*  bit_position: Position of the next bit in data (MSB first, updated)
+*  bit_limit: Bit position the symbols may not pass
+*  output: Destination buffer (DECODE_TABLE_MAX_SYMBOLS bytes longer than symbol_limit)
+*  symbol_limit: Maximum number of symbols to decode
+*
+*  returns: Number of decoded symbols
+*/
+size_t decode_table_run(const DecodeTable* table, const unsigned char* data, size_t data_size,
+                        size_t* bit_position, size_t bit_limit, unsigned char* output, size_t symbol_limit);
+
+/*
+* Function: decode_block
+* ----------------------
+*  Decodes a byte aligned block of codes in memory with the table, and
+*  with the tree where the table stops (long codes and the last 8 bytes).
+*
+*  root: Pointer to the root node of the huffman tree
+*  table: Pointer to the DecodeTable object (NULL walks the tree only)
+*  data: Encoded bytes
+*  data_size: Number of encoded bytes
+*  output: Destination buffer (DECODE_TABLE_MAX_SYMBOLS bytes longer than symbol_count)
+*  symbol_count: Number of symbols in the block
+*
+*  returns: Number of decoded symbols
+*/
+size_t decode_block(Node* root, const DecodeTable* table, const unsigned char* data, size_t data_size,
+                    unsigned char* output, size_t symbol_count);
+
+/*
+* Function: free_decode_table
+* ---------------------------
+*  Frees the table.
+*
+*  table: Pointer to the DecodeTable object
+*/
+void free_decode_table(DecodeTable* table);
+#endif
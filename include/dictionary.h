@@ -0,0 +1,151 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+#include "batch.h"
+#include "constants.h"
+#include "huffman.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DICTIONARY_VERSION 1
+#define DICTIONARY_STREAM_MAX_HEADER_SIZE 18 // magic + table ID + input size (varint)
+
+/*
+* Trained huffman table. Every symbol has a code, so any input can be
+* encoded with it; streams only store the table's ID.
+*/
+typedef struct Dictionary {
+    uint32_t id; // CRC32C of the stored frequencies
+    size_t frequency_table[FREQUENCY_TABLE_SIZE]; // Scaled frequencies (1-255)
+    Code code_table[FREQUENCY_TABLE_SIZE];
+    Code* pair_table; // Built on the first compression (NULL if the codes are too long)
+    int pair_table_built;
+    pthread_mutex_t pair_table_lock; // Batch workers share the table
+    Node* root;
+} Dictionary;
+
+/*
+* Function: create_dictionary
+* ---------------------------
+*  Builds a table from combined frequencies.
+*
+*  frequency_table: Pointer to the frequency table (Every symbol at least 1)
+*
+*  returns: Pointer to the Dictionary object. If failed, returns NULL.
+*/
+Dictionary* create_dictionary(size_t* frequency_table);
+
+/*
+* Function: train_dictionary
+* --------------------------
+*  Builds a table from the combined frequencies of sample files.
+*
+*  samples: Pointer to the PathList of the sample files
+*
+*  returns: Pointer to the Dictionary object. If failed, returns NULL.
+*/
+Dictionary* train_dictionary(PathList* samples);
+
+/*
+* Function: save_dictionary
+* -------------------------
+*  Writes a table file.
+*
+*  dictionary: Pointer to the Dictionary object
+*  path: Table file path (NULL saves '<id>.hft' in the table directory)
+*
+*  returns: If failed (0), On success (1)
+*/
+int save_dictionary(Dictionary* dictionary, const char* path);
+
+/*
+* Function: load_dictionary
+* -------------------------
+*  Loads a table by path or by ID. An ID (8 hex digits) is looked up as
+*  '<id>.hft' in the directory of the HUFFMAN_TABLES environment variable
+*  (default: the current directory).
+*
+*  name: Table file path or ID
+*
+*  returns: Pointer to the Dictionary object. If failed, returns NULL.
+*/
+Dictionary* load_dictionary(const char* name);
+
+/*
+* Function: free_dictionary
+* -------------------------
+*  Frees the Dictionary object.
+*
+*  dictionary: Pointer to the Dictionary object
+*/
+void free_dictionary(Dictionary* dictionary);
+
+/*
+* Function: is_dictionary_stream
+* ------------------------------
+*  Checks if the file was compressed with a trained table.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it was, otherwise (0)
+*/
+int is_dictionary_stream(FILE* file);
+
+/*
+* Function: write_stream_header
+* -----------------------------
+*  Stores the header of a stream compressed with a trained table.
+*
+*  dictionary: Pointer to the Dictionary object
+*  size: Number of input bytes
+*  header: Output buffer (At least DICTIONARY_STREAM_MAX_HEADER_SIZE bytes)
+*
+*  returns: Number of bytes stored
+*/
+size_t write_stream_header(const Dictionary* dictionary, uint64_t size, unsigned char* header);
+
+/*
+* Function: read_stream_header
+* ----------------------------
+*  Reads a header written by write_stream_header from a buffer.
+*
+*  header: Stored header (followed by the encoded data)
+*  size: Number of bytes in the buffer
+*  id: Pointer to store the ID of the table
+*  original_size: Pointer to store the number of input bytes
+*
+*  returns: Size of the header. If failed, returns 0.
+*/
+size_t read_stream_header(const unsigned char* header, size_t size, uint32_t* id, uint64_t* original_size);
+
+/*
+* Function: compress_with_dictionary
+* ----------------------------------
+*  Compresses the input file with a trained table. No frequencies are
+*  counted and the output only stores the table's ID and the input size.
+*
+*  dictionary: Pointer to the Dictionary object
+*  bit_writer: BitWriter to reuse (NULL creates one)
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_with_dictionary(Dictionary* dictionary, BitWriter* bit_writer, FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_with_dictionary
+* ------------------------------------
+*  Decompresses a file compressed with a trained table.
+*
+*  dictionary: Pointer to the Dictionary object (NULL loads the table by the stream's ID)
+*  bit_reader: BitReader to reuse (NULL creates one)
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_with_dictionary(Dictionary* dictionary, BitReader* bit_reader, FILE* input_file, FILE* output_file);
+#endif
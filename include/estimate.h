@@ -0,0 +1,82 @@
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+#include "compressor.h"
+#include "constants.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define ESTIMATE_LEGACY 0
+#define ESTIMATE_COMPACT 1
+#define ESTIMATE_PACKED 2
+#define ESTIMATE_TANS 3
+#define ESTIMATE_STORED 4
+
+typedef struct {
+    uint64_t input_size;
+    uint64_t output_size; // Size of the file compress writes (estimated for tANS and sampled huffman)
+    uint64_t huffman_size; // Size with huffman codes (compact or legacy header)
+    double entropy_bits; // Order-0 entropy of the input, the bound of any per-symbol coder
+    int format; // One of the ESTIMATE_* formats
+    int sampled; // The histogram is a sample, the bit counts are scaled to the input size
+    uint8_t code_lengths[FREQUENCY_TABLE_SIZE]; // Huffman code length of every symbol (0 for missing symbols)
+} SizeEstimate;
+
+/*
+* Function: estimate_entropy
+* --------------------------
+*  Returns the order-0 entropy of a histogram: the sum of
+*  frequency * log2(total / frequency).
+*
+*  frequency_table: Pointer to the frequency table
+*
+*  returns: Entropy in bits
+*/
+double estimate_entropy(size_t* frequency_table);
+
+/*
+* Function: estimate_size
+* -----------------------
+*  Computes the size compress would write from the histogram alone, with
+*  the same format choice and without encoding anything. The huffman sizes
+*  are exact: the sum of frequency * code length plus the header. A sampled
+*  histogram gives the same table as compress, but its bit counts are
+*  scaled to the input size.
+*
+*  context: Pointer to the context (frequency_table counted or sampled by
+*           the caller, code_table is overwritten)
+*  input_size: Size of the input
+*  estimate: Pointer to the SizeEstimate object to fill
+*
+*  returns: If failed (0), On success (1)
+*/
+int estimate_size(HuffContext* context, uint64_t input_size, SizeEstimate* estimate);
+
+/*
+* Function: estimate_file
+* -----------------------
+*  Counts the frequencies of the input file (or samples them, like
+*  compress_with_context, if the context has a sample size) and estimates
+*  its compressed size.
+*  Inputs the entropy probe of compress finds incompressible are reported
+*  as stored (see probe_incompressible).
+*
+*  context: Pointer to the context
+*  input_file: Pointer to the input_file
+*  estimate: Pointer to the SizeEstimate object to fill
+*
+*  returns: If failed (0), On success (1)
+*/
+int estimate_file(HuffContext* context, FILE* input_file, SizeEstimate* estimate);
+
+/*
+* Function: print_estimate
+* ------------------------
+*  Prints the sizes, the entropy bound and the code length of every present symbol.
+*  Sizes that are not exact (tANS, scaled from a sample) are marked as estimated.
+*
+*  estimate: Pointer to the SizeEstimate object
+*  output: Pointer to the output stream
+*/
+void print_estimate(const SizeEstimate* estimate, FILE* output);
+#endif
@@ -0,0 +1,57 @@
+#ifndef GREP_H
+#define GREP_H
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+* Called for every match: with the original offset of the match and the
+* decoded pattern (seekable files), or with the index and the data of the
+* matching record (record files). Returning 0 stops the search.
+*/
+typedef int (*GrepFunction)(void* argument, uint64_t position, const unsigned char* data, size_t length);
+
+typedef struct {
+    uint64_t regions; // Segments or records
+    uint64_t decoded; // Regions decoded to check a candidate
+    uint64_t matches;
+} GrepStats;
+
+/*
+* Function: huff_grep
+* -------------------
+*  Finds every occurrence of a literal pattern in a seekable or record file.
+*  The pattern is encoded with the file's codes once for each of the 8 bit
+*  alignments, and the encoded bytes of every segment or record are scanned
+*  for these bit strings. Only the regions with a candidate are decoded to
+*  check it, the others are never decoded.
+*
+*  input_file: Pointer to the compressed file
+*  pattern: Bytes to find
+*  pattern_length: Number of bytes (at most the segment size of seekable files)
+*  function: Called for every match
+*  argument: Passed to the function
+*  stats: Pointer to the GrepStats object to fill (Can be NULL)
+*
+*  returns: If failed (0), On success (1)
+*/
+int huff_grep(FILE* input_file, const unsigned char* pattern, size_t pattern_length,
+              GrepFunction function, void* argument, GrepStats* stats);
+
+/*
+* Function: grep_file
+* -------------------
+*  Prints the matches of a pattern like grep: the matching records of a
+*  record file, or the original offset of every match of a seekable file.
+*
+*  input_file: Pointer to the compressed file
+*  pattern: Bytes to find
+*  pattern_length: Number of bytes
+*  output_file: Pointer to the output_file
+*  name: Printed before every match (NULL prints nothing)
+*  stats: Pointer to the GrepStats object to fill (Can be NULL)
+*
+*  returns: If failed (0), On success (1)
+*/
+int grep_file(FILE* input_file, const unsigned char* pattern, size_t pattern_length, FILE* output_file,
+              const char* name, GrepStats* stats);
+#endif
@@ -35,6 +35,49 @@ typedef struct {
 */
 size_t get_list_size(size_t* list, size_t* max_value);
 
+/*
+* Function: count_frequencies
+* ---------------------------
+*  Adds the occurance of every character of the file to the frequency table
+*
+*  file: Pointer to the input file
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
+*
+*  returns: Number of read bytes. If failed, returns -1.
+*/
+ssize_t count_frequencies(FILE* file, size_t* frequency_table);
+
+/*
+* Function: count_frequencies_crc
+* -------------------------------
+*  Adds the occurance of every character of the file to the frequency table
+*  and updates the CRC32C of the data in the same pass.
+*
+*  file: Pointer to the input file
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
+*  checksum: Pointer to the checksum to update (Can be NULL)
+*
+*  returns: Number of read bytes. If failed, returns -1.
+*/
+ssize_t count_frequencies_crc(FILE* file, size_t* frequency_table, uint32_t* checksum);
+
+/*
+* Function: sample_frequencies
+* ----------------------------
+*  Estimates the frequency table from evenly spaced blocks of the file
+*  (FAST_STATS_BLOCK_SIZE bytes each) instead of reading all of it. Every
+*  symbol missing from the sample is counted once, so bytes that only occur
+*  outside the sample still get a (long) code. Files up to sample_size
+*  bytes are counted exactly. The file is always read from its start.
+*
+*  file: Pointer to the input file (must be seekable)
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
+*  sample_size: Number of bytes to read
+*
+*  returns: Size of the file. If failed, returns -1.
+*/
+ssize_t sample_frequencies(FILE* file, size_t* frequency_table, size_t sample_size);
+
 /*
 * Function: count_run
 * -------------------
@@ -138,6 +181,19 @@ size_t scale_down(size_t value, size_t scale);
 
 int write_file_header(FILE* output_file, size_t* frequency_table);
 
+/*
+* Function: read_frequency_table
+* ------------------------------
+*  Reads a frequency table (stored by write_file_header) at the current
+*  position of the file.
+*
+*  input_file: Pointer to the compressed file
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
+*
+*  returns: Number of symbols in the table. If failed, returns 0.
+*/
+size_t read_frequency_table(FILE* input_file, size_t* frequency_table);
+
 /*
 * Function: read_file_header
 * --------------------------
@@ -152,6 +208,18 @@ int write_file_header(FILE* output_file, size_t* frequency_table);
 size_t* read_file_header(FILE* input_file, size_t* list_size, int* bit_padding);
 // size_t* read_file_header(FILE* input_file, size_t* list_size, size_t* bit_count);
 
+/*
+* Function: get_total_bits
+* ------------------------
+*  Returns the number of valid encoded bits.
+*
+*  data_bytes: Number of encoded bytes (without header and the last byte)
+*  bit_padding: Number of encoded bits in the last encoded byte (0 means all 8)
+*
+*  returns: Number of encoded bits
+*/
+uint64_t get_total_bits(uint64_t data_bytes, int bit_padding);
+
 /*
 * Function: generate_huffman_code
 * -------------------------------
@@ -164,6 +232,18 @@ size_t* read_file_header(FILE* input_file, size_t* list_size, int* bit_padding);
 */
 void generate_huffman_code(Code* code_table, uint32_t code, uint8_t depth, Node* node);
 
+/*
+* Function: fill_pair_table
+* -------------------------
+*  Combines the codes of every byte pair, so two symbols are written at once.
+*
+*  code_table: Pointer to the code table
+*  pair_table: Pointer to the pair table (PAIR_TABLE_SIZE entries, indexed by first << 8 | second)
+*
+*  returns: On success (1), (0) if two codes may not fit in 32 bits
+*/
+int fill_pair_table(Code* code_table, Code* pair_table);
+
 /*
 * Function: encode
 * ----------------
@@ -172,17 +252,50 @@ void generate_huffman_code(Code* code_table, uint32_t code, uint8_t depth, Node*
 *  input_file: Pointer to the file to be encoded
 *  bit_writer: Pointer to the BitWriter object
 *  code_table: Pointer to the code table
+*  pair_table: Pointer to the pair table filled by fill_pair_table (NULL encodes one symbol at a time)
 *
 *  returns: If failed (0), On success (1)
 */
-int encode(FILE* input_file, BitWriter* bit_writer, Code* code_table);
+int encode(FILE* input_file, BitWriter* bit_writer, Code* code_table, Code* pair_table);
+
+/*
+* Function: encode_buffer
+* -----------------------
+*  Encodes a buffer into memory (MSB first, the last byte is padded with
+*  zeros like flush_writer does). Codes must be at most 32 bits long.
+*
+*  code_table: Pointer to the code table
+*  input: Bytes to encode
+*  size: Number of bytes
+*  output: Output buffer (At least as large as the encoded bytes)
+*
+*  returns: Number of bytes stored
+*/
+size_t encode_buffer(const Code* code_table, const unsigned char* input, size_t size, unsigned char* output);
+
+/*
+* Function: decode_symbols
+* ------------------------
+*  Decodes the encoded bits at the current position of the reader's file
+*  until total_bits bits or symbol_count symbols are decoded, whichever
+*  comes first.
+*
+*  output_file: Pointer to the output file. (NULL discards the decoded data)
+*  bit_reader: Pointer to a BitReader object.
+*  root: Pointer to the root node of the huffman tree.
+*  total_bits: Maximum number of bits to read
+*  symbol_count: Maximum number of symbols to write (SIZE_MAX for no limit)
+*
+*  returns: If failed (0), on success (1)
+*/
+int decode_symbols(FILE* output_file, BitReader* bit_reader, Node* root, uint64_t total_bits, size_t symbol_count);
 
 /*
 * Function: decode
 * ----------------
 *  Decodes a huffman file and save it to the output file.
 *
-*  output_file: Pointer to the output file.
+*  output_file: Pointer to the output file. (NULL discards the decoded data)
 *  bit_reader: Pointer to a BitReader object.
 *  root: Pointer to the root node of the huffman tree.
 *  bit_padding: Number of encoded bits in the last byte of the file
@@ -0,0 +1,28 @@
+#ifndef MAGIC_H
+#define MAGIC_H
+
+#define MAGIC_MAX_SIZE 4
+
+/*
+* Magic bytes of every file format, kept together so a new one can be
+* checked against the others. decompress tells the formats apart by these
+* bytes, so none may be the start of a legacy file (count - 1, then the
+* symbols in ascending order, each followed by its frequency):
+*  - 0xFF magics: all 256 symbols are present, so a legacy file would
+*    continue with symbol 0x00
+*  - 0x89 magics: the 4th byte is the second symbol, so it must be at most
+*    'H' (the first symbol)
+* Table files ('T') break the rule, they are never decompressed.
+*/
+static const unsigned char compact_magic[] = {0xFF, 'C'};
+static const unsigned char packed_magic[] = {0xFF, 'P'};
+static const unsigned char tans_magic[] = {0xFF, 'A'};
+static const unsigned char adaptive_magic[] = {0xFF, 'F'};
+static const unsigned char stored_magic[] = {0xFF, 'S'};
+static const unsigned char seekable_magic[4] = {0x89, 'H', 'U', 'F'};
+static const unsigned char record_magic[4] = {0x89, 'H', 'U', 'E'};
+static const unsigned char dictionary_stream_magic[4] = {0x89, 'H', 'U', 'D'};
+static const unsigned char archive_magic[4] = {0x89, 'H', 'F', 'A'};
+static const unsigned char dictionary_magic[4] = {0x89, 'H', 'F', 'T'};
+
+#endif
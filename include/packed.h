@@ -0,0 +1,72 @@
+#ifndef PACKED_H
+#define PACKED_H
+#include "compressor.h"
+
+#include <stdio.h>
+
+#define PACKED_VERSION 0
+
+/*
+* Function: is_packed
+* -------------------
+*  Checks if the file starts with the packed header's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_packed(FILE* file);
+
+/*
+* Function: packed_width
+* ----------------------
+*  Returns the number of bits of a symbol index: ceil(log2(symbols)).
+*
+*  frequency_table: Pointer to the frequency table
+*
+*  returns: Width in bits (1-8), 0 if there are less than 2 symbols
+*/
+int packed_width(size_t* frequency_table);
+
+/*
+* Function: prefer_packed
+* -----------------------
+*  Compares the size of the huffman encoded data with fixed-width packing.
+*  Packing is preferred when it is at most PACKED_MAX_OVERHEAD_PERCENT
+*  larger, its decoder does not depend on the code lengths.
+*
+*  frequency_table: Pointer to the frequency table
+*  code_table: Pointer to the code table of the frequency table
+*
+*  returns: (1) if packing is preferred, otherwise (0)
+*/
+int prefer_packed(size_t* frequency_table, Code* code_table);
+
+/*
+* Function: compress_packed
+* -------------------------
+*  Compresses the input file as fixed-width indexes into the sorted set of
+*  present symbols.
+*
+*  context: Pointer to the context (frequency_table counted or sampled by the
+*           caller, every byte of the input must have a frequency)
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_packed(HuffContext* context, FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_packed
+* ---------------------------
+*  Decompresses a file with the packed header.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_packed(FILE* input_file, FILE* output_file);
+#endif
@@ -0,0 +1,73 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include "huffman.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+* Part of the input encoded by one task. The bytes shared with the
+* neighbouring chunks are kept aside and merged after the tasks finish.
+*/
+typedef struct {
+    const unsigned char* input;
+    size_t size;
+    size_t histogram[FREQUENCY_TABLE_SIZE]; // Frequencies of the chunk (first pass)
+    Code* code_table;
+    Code* pair_table; // Can be NULL
+    unsigned char* output; // Output of the window
+    size_t bit_offset; // First bit of the chunk in output
+    unsigned char head; // First byte, if it starts in the middle of a byte
+    unsigned char tail; // Last byte, if it ends in the middle of a byte
+    size_t head_index;
+    size_t tail_index;
+    int has_head;
+    int has_tail;
+} ParallelChunk;
+
+/*
+* Function: encode_chunk
+* ----------------------
+*  Encodes a chunk at its bit offset of the output. Whole bytes are stored
+*  directly, the partial first and last bytes are stored in the chunk.
+*
+*  chunk: Pointer to the ParallelChunk object
+*/
+void encode_chunk(ParallelChunk* chunk);
+
+/*
+* Function: compress_parallel
+* ---------------------------
+*  Compresses the input file on several threads into the same single
+*  stream as compress(). Every chunk's bit length is known from its
+*  histogram, so a prefix sum gives the exact bit offset every thread
+*  writes at.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  thread_count: Number of threads (0 uses the number of online CPUs)
+*  sample_size: Bytes sampled for the table of large inputs, 0 counts every
+*               byte (see sample_frequencies)
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_parallel(FILE* input_file, FILE* output_file, size_t thread_count, size_t sample_size);
+
+/*
+* Function: decompress_parallel
+* -----------------------------
+*  Decompresses a single stream file on several threads. Every chunk of the
+*  encoded data is decoded from an arbitrary bit offset; Huffman codes
+*  resynchronize quickly, so once the previous chunk's last code ends on a
+*  code boundary the chunk found, the rest of its output is valid. Chunks
+*  that do not synchronize are decoded again from the right offset. Other
+*  formats are decompressed by decompress().
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  thread_count: Number of threads (0 uses the number of online CPUs)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_parallel(FILE* input_file, FILE* output_file, size_t thread_count);
+#endif
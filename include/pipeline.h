@@ -0,0 +1,108 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+#include "constants.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+typedef struct {
+    unsigned char* data;
+    size_t size; // Valid bytes (0 marks the end of the stream)
+} Chunk;
+
+/*
+* Lock-free single-producer/single-consumer ring of chunk pointers.
+* Only the producer moves the tail and only the consumer moves the head.
+* A stage that finds the ring full or empty for longer than a short spin
+* sleeps on `moved`, the other side only takes the lock if it has waiters.
+*/
+typedef struct {
+    Chunk** items;
+    size_t capacity; // Power of 2
+    _Atomic size_t head;
+    _Atomic size_t tail;
+    _Atomic int waiters;
+    pthread_mutex_t lock;
+    pthread_cond_t moved;
+} SpscRing;
+
+/*
+* Connection between two stages: full chunks flow forward through `full`,
+* consumed chunks flow back through `free` to be recycled.
+*/
+typedef struct {
+    SpscRing* full;
+    SpscRing* free;
+    Chunk* chunks;
+    size_t chunk_count;
+} PipeLink;
+
+/*
+* Function: spsc_create
+* ---------------------
+*  Creates a single-producer/single-consumer ring.
+*
+*  capacity: Minimum number of items (rounded up to a power of 2)
+*
+*  returns: Pointer to the ring. If failed, returns NULL.
+*/
+SpscRing* spsc_create(size_t capacity);
+
+/*
+* Function: spsc_push
+* -------------------
+*  Adds a chunk at the tail of the ring. Must only be called by the producer.
+*
+*  ring: Pointer to the ring
+*  chunk: Pointer to the chunk
+*
+*  returns: If the ring is full (0), On success (1)
+*/
+int spsc_push(SpscRing* ring, Chunk* chunk);
+
+/*
+* Function: spsc_pop
+* ------------------
+*  Removes the chunk at the head of the ring. Must only be called by the consumer.
+*
+*  ring: Pointer to the ring
+*
+*  returns: Pointer to the chunk. If the ring is empty, returns NULL.
+*/
+Chunk* spsc_pop(SpscRing* ring);
+
+/*
+* Function: spsc_free
+* -------------------
+*  Frees the ring (not the chunks).
+*
+*  ring: Pointer to the ring
+*/
+void spsc_free(SpscRing* ring);
+
+/*
+* Function: compress_pipelined
+* ----------------------------
+* Compresses the input file with separate reader, histogram, encoder and
+* writer threads. The output is identical to compress().
+*
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file
+*
+* returns: If failed (0), On success (1)
+*/
+int compress_pipelined(FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_pipelined
+* ------------------------------
+* Decompresses the input file with separate reader, decoder and writer threads.
+*
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file
+*
+* returns: If failed (0), On success (1)
+*/
+int decompress_pipelined(FILE* input_file, FILE* output_file);
+#endif
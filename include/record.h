@@ -0,0 +1,143 @@
+#ifndef RECORD_H
+#define RECORD_H
+#include "constants.h"
+#include "decodetable.h"
+#include "huffman.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define RECORD_VERSION 1
+#define RECORD_FLAG_LENGTH 1 // Records are prefixed with their length (4 bytes, little-endian) instead of ending with a newline
+#define RECORD_FLAG_NO_FINAL_NEWLINE 2 // The last newline delimited record has no newline
+
+/*
+* Index entry of a group of RECORD_GROUP_SIZE records. The original length
+* and the encoded size of every record of the group are stored as varints
+* at run_offset, so a record is found with one read of its group's run.
+*/
+typedef struct {
+    uint64_t data_offset; // Offset of the first record of the group
+    uint64_t run_offset; // Offset of the group's varints
+} RecordGroup;
+
+typedef struct {
+    FILE* file;
+    int flags;
+    uint64_t record_count;
+    uint64_t original_size; // Size of the records without their delimiters
+    Node* root;
+    DecodeTable* decode_table; // NULL if the tree is walked
+    RecordGroup* groups;
+    uint64_t group_count;
+    uint64_t data_end; // Offset of the first run
+    uint64_t index_offset; // Offset of the group table (end of the last run)
+    uint64_t max_length; // Longest record
+    uint64_t max_size; // Largest encoded record
+    uint64_t cached_group; // Group in the arrays below (group_count if none)
+    uint64_t record_offsets[RECORD_GROUP_SIZE + 1]; // Data offset of every record of the group (and the end)
+    uint64_t record_lengths[RECORD_GROUP_SIZE];
+    unsigned char* data_buffer; // Encoded bytes of one record
+    unsigned char* output_buffer; // Decoded bytes of the last record
+} RecordFile;
+
+/*
+* Function: is_record_file
+* ------------------------
+*  Checks if the file starts with the record format's magic bytes and a
+*  supported version, and ends with the trailer's magic bytes.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_record_file(FILE* file);
+
+/*
+* Function: compress_records
+* --------------------------
+*  Compresses a file of newline or length delimited records. Every record
+*  is encoded byte aligned with one table shared by the file, and an index
+*  of the record offsets is written at the end, so a single record can be
+*  decoded without the others (see huff_get_record).
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  flags: RECORD_FLAG_LENGTH for length prefixed records, 0 for lines
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_records(FILE* input_file, FILE* output_file, int flags);
+
+/*
+* Function: decompress_records
+* ----------------------------
+*  Decompresses a whole record file, with the delimiters of the input.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_records(FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_record
+* ---------------------------
+*  Decodes one record of a record file into the output file (without its delimiter).
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  index: Index of the record
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_record(FILE* input_file, FILE* output_file, uint64_t index);
+
+/*
+* Function: record_open
+* ---------------------
+*  Reads the header, the table and the group index of a record file.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: Pointer to the RecordFile object. If failed, returns NULL.
+*/
+RecordFile* record_open(FILE* file);
+
+/*
+* Function: record_close
+* ----------------------
+*  Frees the RecordFile object (The file is not closed).
+*
+*  records: Pointer to the RecordFile object
+*/
+void record_close(RecordFile* records);
+
+/*
+* Function: record_load_group
+* ---------------------------
+*  Reads the varints of a group into the record offsets and lengths (unless it is cached).
+*
+*  records: Pointer to the RecordFile object
+*  group: Index of the group
+*
+*  returns: If failed (0), On success (1)
+*/
+int record_load_group(RecordFile* records, uint64_t group);
+
+/*
+* Function: huff_get_record
+* -------------------------
+*  Decodes one record (without its delimiter). Only the varints of the
+*  record's group and the encoded bytes of the record are read.
+*
+*  records: Pointer to the RecordFile object
+*  index: Index of the record
+*  length: Pointer to store the length of the record
+*
+*  returns: Pointer to the record, valid until the next call. If failed, returns NULL.
+*/
+const unsigned char* huff_get_record(RecordFile* records, uint64_t index, size_t* length);
+#endif
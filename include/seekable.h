@@ -0,0 +1,198 @@
+#ifndef SEEKABLE_H
+#define SEEKABLE_H
+#include "decodetable.h"
+#include "huffman.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#define SEEKABLE_VERSION 2
+#define SEEKABLE_FLAG_CHECKSUM 1 // CRC32C of every segment and of the whole data
+#define SEEKABLE_FLAG_TABLES 2 // Merged shards with their own tables, every segment stores a table index
+#define SEEKABLE_FLAG_SHARD 4 // Part of a larger input, the header stores the start offset and the input size
+
+/*
+* Sync point at the start of a segment. Segments are byte aligned, so
+* decoding can start at compressed_offset with an empty bit state.
+*/
+typedef struct {
+    uint64_t compressed_offset;
+    uint64_t uncompressed_offset;
+    uint32_t checksum; // CRC32C of the segment's original data
+    uint32_t table; // Index of the segment's table (0 without SEEKABLE_FLAG_TABLES)
+} SyncPoint;
+
+typedef struct {
+    uint64_t offset; // Offset of the stored frequency table
+    Node* root;
+    DecodeTable* decode_table; // NULL if the tree is walked
+} SeekableTable;
+
+typedef struct {
+    FILE* file;
+    uint64_t original_size;
+    uint32_t segment_size; // Uncompressed bytes per segment
+    int flags;
+    uint64_t shard_start; // Offset of the data in the input (0 without SEEKABLE_FLAG_SHARD)
+    uint64_t source_size; // Size of the input (original_size without SEEKABLE_FLAG_SHARD)
+    int verify; // Check the segment checksums while decoding
+    uint32_t checksum; // CRC32C of the whole data
+    SeekableTable* tables; // One table, or one per merged shard with SEEKABLE_FLAG_TABLES
+    uint32_t table_count;
+    SyncPoint* sync_points;
+    uint32_t segment_count;
+    uint64_t data_end; // Offset of the seek table
+    unsigned char* segment_buffer; // Compressed bytes of one segment
+    size_t segment_buffer_size;
+    unsigned char* output_buffer; // Decoded bytes of the cached segment
+    uint32_t cached_segment; // Segment in output_buffer (segment_count if none)
+} SeekableFile;
+
+/*
+* Function: is_seekable
+* ---------------------
+*  Checks if the file starts with the seekable format's magic bytes.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_seekable(FILE* file);
+
+/*
+* Function: compress_seekable
+* ---------------------------
+*  Compresses the input file into the seekable format: the encoded data is
+*  split into byte aligned segments and a seek table of their sync points
+*  is written at the end.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  segment_size: Uncompressed bytes per segment
+*  flags: SEEKABLE_FLAG_CHECKSUM or 0
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_seekable(FILE* input_file, FILE* output_file, uint32_t segment_size, int flags);
+
+/*
+* Function: compress_shard
+* ------------------------
+*  Compresses the byte range [start, end) of the input file into a seekable
+*  file (a shard). The start must be a multiple of the segment size and the
+*  end too unless it is the end of the input, so the shards of a file can be
+*  written by separate processes and joined with merge_shards.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  start: Offset of the first byte
+*  end: Offset after the last byte (clamped to the size of the input)
+*  segment_size: Uncompressed bytes per segment
+*  flags: SEEKABLE_FLAG_CHECKSUM or 0
+*  frequency_table: Global table shared by the shards (every symbol must
+*                   be present), NULL counts a table for the range
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_shard(FILE* input_file, FILE* output_file, uint64_t start, uint64_t end, uint32_t segment_size,
+                   int flags, size_t* frequency_table);
+
+/*
+* Function: merge_shards
+* ----------------------
+*  Joins seekable files into one without decoding them: the segments are
+*  copied and the seek tables are combined with shifted offsets. If every
+*  shard has the same table it is stored once, otherwise the output keeps
+*  the table of every shard (SEEKABLE_FLAG_TABLES). Every shard but the
+*  last must end at a segment boundary and all must have the same segment
+*  size and checksum flag.
+*
+*  shard_files: Pointers to the shards, in the order of their data
+*  shard_count: Number of shards
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int merge_shards(FILE** shard_files, size_t shard_count, FILE* output_file);
+
+/*
+* Function: decompress_seekable
+* -----------------------------
+*  Decompresses a whole seekable file. With verify every segment is
+*  checked against its checksum, and the segment checksums are combined to
+*  check the whole data without hashing it again.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL tests the file: nothing is
+*               written and the checksums are checked if the file has them)
+*  verify: Check the checksums, fails on a file without them (1), Don't check (0)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_seekable(FILE* input_file, FILE* output_file, int verify);
+
+/*
+* Function: seekable_open
+* -----------------------
+*  Reads the header and the seek table of a seekable file.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: Pointer to the SeekableFile object. If failed, returns NULL.
+*/
+SeekableFile* seekable_open(FILE* file);
+
+/*
+* Function: seekable_set_verify
+* -----------------------------
+*  Enables or disables checking the checksums of a seekable file while
+*  decoding its segments.
+*
+*  seekable: Pointer to the SeekableFile object
+*  verify: Verify (1), Don't verify (0)
+*
+*  returns: If the file has no checksums to verify (0), On success (1)
+*/
+int seekable_set_verify(SeekableFile* seekable, int verify);
+
+/*
+* Function: seekable_close
+* ------------------------
+*  Frees the SeekableFile object (The file is not closed).
+*
+*  seekable: Pointer to the SeekableFile object
+*/
+void seekable_close(SeekableFile* seekable);
+
+/*
+* Function: huff_read_range
+* -------------------------
+*  Decodes a range of the original data. Only the segments covering the
+*  range are read and decoded.
+*
+*  seekable: Pointer to the SeekableFile object
+*  offset: Offset in the original data
+*  length: Number of bytes
+*  output: Destination buffer (at least length bytes)
+*
+*  returns: Number of copied bytes (less than length at the end of the data). If failed, returns -1.
+*/
+ssize_t huff_read_range(SeekableFile* seekable, uint64_t offset, size_t length, unsigned char* output);
+
+/*
+* Function: decompress_range
+* --------------------------
+*  Decodes a range of the original data of a seekable file into the output file.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  offset: Offset in the original data
+*  length: Number of bytes (clamped to the end of the data)
+*  verify: Check the checksums of the decoded segments (1), Don't check (0)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_range(FILE* input_file, FILE* output_file, uint64_t offset, uint64_t length, int verify);
+#endif
@@ -0,0 +1,82 @@
+#ifndef STORED_H
+#define STORED_H
+#include <stdint.h>
+#include <stdio.h>
+
+#define STORED_VERSION 0
+#define STORED_HEADER_SIZE 11 // magic + version + size (8 bytes)
+
+/*
+* Function: is_stored
+* -------------------
+*  Checks if the file starts with the stored container's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_stored(FILE* file);
+
+/*
+* Function: probe_incompressible
+* ------------------------------
+*  Estimates the entropy of the input from its first bytes and a few evenly
+*  spaced blocks (STORED_PROBE_SIZE bytes in total), without counting the
+*  whole file. The file position is not changed.
+*
+*  input_file: Pointer to the input_file
+*
+*  returns: (1) if the sample has more than STORED_MIN_BITS_PER_BYTE bits of entropy per byte, otherwise (0)
+*/
+int probe_incompressible(FILE* input_file);
+
+/*
+* Function: write_stored_header
+* -----------------------------
+*  Stores the header of a stored container (the data follows it).
+*
+*  size: Number of stored bytes
+*  header: Output buffer (At least STORED_HEADER_SIZE bytes)
+*
+*  returns: Number of bytes stored
+*/
+size_t write_stored_header(uint64_t size, unsigned char* header);
+
+/*
+* Function: read_stored_header
+* ----------------------------
+*  Reads a stored header written by write_stored_header from a buffer.
+*
+*  header: Stored header (followed by the data)
+*  size: Number of bytes in the buffer
+*  original_size: Pointer to store the number of stored bytes
+*
+*  returns: If failed (0), On success (1)
+*/
+int read_stored_header(const unsigned char* header, size_t size, uint64_t* original_size);
+
+/*
+* Function: compress_stored
+* -------------------------
+*  Copies the input file into a stored container, without any coding.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_stored(FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_stored
+* ---------------------------
+*  Copies the data of a stored container to the output.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only reads the data)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_stored(FILE* input_file, FILE* output_file);
+#endif
@@ -0,0 +1,90 @@
+#ifndef TANS_H
+#define TANS_H
+#include "compressor.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TANS_VERSION 0
+
+/*
+* Function: is_tans
+* -----------------
+*  Checks if the file starts with the tANS header's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_tans(FILE* file);
+
+/*
+* Function: normalize_frequencies
+* -------------------------------
+*  Scales the frequencies to sum to 2^table_log, keeping every present
+*  symbol at least 1.
+*
+*  frequency_table: Pointer to the frequency table
+*  normalized: Normalized frequency of every symbol (0 for missing symbols)
+*  table_log: Log2 of the table size
+*
+*  returns: If there are less than 2 or too many symbols (0), On success (1)
+*/
+int normalize_frequencies(size_t* frequency_table, uint16_t* normalized, int table_log);
+
+/*
+* Function: prefer_tans
+* ---------------------
+*  Estimates the size of the tANS encoded data from the normalized
+*  frequencies and compares it with the huffman encoded data. tANS spends
+*  fractional bits per symbol, which wins on skewed histograms.
+*
+*  frequency_table: Pointer to the frequency table
+*  code_table: Pointer to the code table of the frequency table
+*
+*  returns: (1) if tANS is at least TANS_MIN_GAIN_PERCENT smaller, otherwise (0)
+*/
+int prefer_tans(size_t* frequency_table, Code* code_table);
+
+/*
+* Function: estimate_tans_size
+* ----------------------------
+*  Estimates the size of the file compress_tans writes, from the header and
+*  the cost of every symbol under the normalized frequencies. The encoded
+*  data depends on the states, so it can be off by a few bytes per block.
+*
+*  frequency_table: Pointer to the frequency table (counted or sampled)
+*  input_size: Size of the input (the data bits of a sample are scaled to it)
+*
+*  returns: Estimated size in bytes, 0 if tANS can't encode the histogram
+*/
+size_t estimate_tans_size(size_t* frequency_table, uint64_t input_size);
+
+/*
+* Function: compress_tans
+* -----------------------
+*  Compresses the input file with table-based asymmetric numeral systems
+*  in independent blocks of TANS_BLOCK_SIZE bytes.
+*
+*  context: Pointer to the context (frequency_table counted or sampled by the
+*           caller, every byte of the input must have a frequency)
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_tans(HuffContext* context, FILE* input_file, FILE* output_file);
+
+/*
+* Function: decompress_tans
+* -------------------------
+*  Decompresses a file with the tANS header.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_tans(FILE* input_file, FILE* output_file);
+#endif
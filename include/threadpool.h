@@ -0,0 +1,84 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+typedef struct {
+    void (*function)(void* context, void* arg);
+    void* arg;
+} Task;
+
+/*
+* Per-worker double-ended queue. The owner takes tasks from the bottom,
+* idle workers steal from the top.
+*/
+typedef struct {
+    Task* tasks;
+    size_t top;
+    size_t bottom;
+    size_t capacity;
+    pthread_mutex_t lock;
+} TaskDeque;
+
+typedef struct {
+    TaskDeque* deques;
+    pthread_t* threads;
+    size_t worker_count; // Number of deques
+    size_t thread_count; // Number of started threads
+    size_t next_deque; // Round-robin target of pool_submit
+    void* (*create_context)(void);
+    void (*free_context)(void* context);
+    atomic_size_t queued; // Tasks waiting in the deques
+    atomic_size_t pending; // Tasks submitted but not finished
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    int stop;
+} ThreadPool;
+
+/*
+* Function: pool_create
+* ---------------------
+*  Starts a pool of worker threads. Every worker owns a context that is
+*  passed to all the tasks it runs, so buffers can be reused between tasks.
+*
+*  worker_count: Number of threads (0 uses the number of online CPUs)
+*  create_context: Function creating a worker context (Can be NULL)
+*  free_context: Function freeing a worker context (Can be NULL)
+*
+*  returns: Pointer to the pool. If failed, returns NULL.
+*/
+ThreadPool* pool_create(size_t worker_count, void* (*create_context)(void), void (*free_context)(void* context));
+
+/*
+* Function: pool_submit
+* ---------------------
+*  Queues a task on one of the workers.
+*
+*  pool: Pointer to the pool
+*  function: Task function, called with the worker's context and arg
+*  arg: Task argument
+*
+*  returns: If failed (0), On success (1)
+*/
+int pool_submit(ThreadPool* pool, void (*function)(void* context, void* arg), void* arg);
+
+/*
+* Function: pool_wait
+* -------------------
+*  Waits until every submitted task has finished.
+*
+*  pool: Pointer to the pool
+*/
+void pool_wait(ThreadPool* pool);
+
+/*
+* Function: pool_free
+* -------------------
+*  Stops the workers (after the queued tasks) and frees the pool.
+*
+*  pool: Pointer to the pool
+*/
+void pool_free(ThreadPool* pool);
+#endif
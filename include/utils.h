@@ -1,5 +1,6 @@
 #ifndef UTILS_H
 #define UTILS_H
+#include <stdint.h>
 #include <stdio.h>
 
 /*
@@ -12,6 +13,25 @@
 */
 void err(const char* func_name, const char* message);
 
+/*
+* Function set_log_mode
+* ---------------------
+*  Enables or disables the progress logs (e.g. when many files are
+*  processed at the same time).
+*
+*  enabled: Print logs (1), Quiet (0)
+*/
+void set_log_mode(int enabled);
+
+/*
+* Function print_log
+* ------------------
+*  Prints a progress message to stdout if logs are enabled
+*
+*  format: printf format string
+*/
+void print_log(const char* format, ...);
+
 /*
 * Function open_file
 * ------------------
@@ -40,11 +60,91 @@ int extract_filename_format(const char *filepath, char **filename, char **filefo
 /*
 * Function: get_file_size
 * -----------------------
-*  Returns the size of the file
+*  Returns the size of the file (64-bit offsets, also with a 32-bit long)
 *
 *  file: Pointer to the file
 *
 *  returns: file size
 */
-size_t get_file_size(FILE* file);
+uint64_t get_file_size(FILE* file);
+
+/*
+* Function: has_magic
+* -------------------
+*  Checks if the file starts with the magic bytes (see magic.h).
+*  The file position is not changed.
+*
+*  file: Pointer to the file
+*  magic: Magic bytes
+*  size: Number of magic bytes
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int has_magic(FILE* file, const unsigned char* magic, size_t size);
+
+/*
+* Function: read_at
+* -----------------
+*  Reads size bytes at an absolute offset with pread, without moving the
+*  file position or using the stdio buffer.
+*
+*  file: Pointer to the file
+*  buffer: Buffer of at least size bytes
+*  size: Number of bytes to read
+*  offset: Offset of the first byte
+*
+*  returns: If the file ends first or reading fails (0), On success (1)
+*/
+int read_at(FILE* file, void* buffer, size_t size, uint64_t offset);
+
+/*
+* Function: write_uint
+* --------------------
+*  Writes an unsigned integer in little-endian byte order
+*
+*  file: Pointer to the file
+*  value: Value to write
+*  bytes: Number of bytes (1-8)
+*
+*  returns: If failed (0), On success (1)
+*/
+int write_uint(FILE* file, uint64_t value, int bytes);
+
+/*
+* Function: read_uint
+* -------------------
+*  Reads an unsigned integer stored by write_uint
+*
+*  file: Pointer to the file
+*  value: Pointer to store the value
+*  bytes: Number of bytes (1-8)
+*
+*  returns: If failed (0), On success (1)
+*/
+int read_uint(FILE* file, uint64_t* value, int bytes);
+
+/*
+* Function: write_varint
+* ----------------------
+*  Writes an unsigned integer as a LEB128 varint (7 bits per byte, low
+*  bits first, the high bit marks that more bytes follow)
+*
+*  file: Pointer to the file
+*  value: Value to write
+*
+*  returns: If failed (0), On success (1)
+*/
+int write_varint(FILE* file, uint64_t value);
+
+/*
+* Function: read_varint
+* ---------------------
+*  Reads an unsigned integer stored by write_varint
+*
+*  file: Pointer to the file
+*  value: Pointer to store the value
+*
+*  returns: If failed (0), On success (1)
+*/
+int read_varint(FILE* file, uint64_t* value);
 #endif
@@ -1,23 +1,149 @@
+#include "include/adaptive.h"
+#include "include/archive.h"
+#include "include/batch.h"
 #include "include/constants.h"
+#include "include/decodetable.h"
+#include "include/dictionary.h"
+#include "include/estimate.h"
+#include "include/grep.h"
 #include "include/utils.h"
 #include "include/compressor.h"
+#include "include/parallel.h"
+#include "include/pipeline.h"
+#include "include/record.h"
+#include "include/seekable.h"
 
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+// Long options without a short flag
+#define OPTION_FAST_STATS 256
+#define OPTION_ESTIMATE 257
+#define OPTION_SHARD 258
+#define OPTION_RECORDS 259
+#define OPTION_RECORD 260
+
+static const struct option long_options[] = {
+    {"fast-stats", optional_argument, NULL, OPTION_FAST_STATS},
+    {"estimate", no_argument, NULL, OPTION_ESTIMATE},
+    {"shard", required_argument, NULL, OPTION_SHARD},
+    {"records", optional_argument, NULL, OPTION_RECORDS},
+    {"record", required_argument, NULL, OPTION_RECORD},
+    {NULL, 0, NULL, 0}
+};
+
+/*
+* Function: parse_uint
+* --------------------
+*  Parses a decimal number that fills the first length characters of the text.
+*
+*  text: Option argument
+*  length: Number of characters of the number (digits only)
+*  max_value: Largest accepted value
+*  value: Pointer to store the value
+*
+*  returns: If the number is invalid or larger than max_value (0), On success (1)
+*/
+static int parse_uint(const char* text, size_t length, uint64_t max_value, uint64_t* value) {
+    if (text == NULL || length == 0 || *text < '0' || *text > '9') {
+        return 0;
+    }
+    char* end = NULL;
+    errno = 0;
+    unsigned long long result = strtoull(text, &end, 10);
+    if (errno != 0 || end != text + length || result > max_value) {
+        return 0;
+    }
+    *value = result;
+    return 1;
+}
+
+/*
+* Function: parse_kb
+* ------------------
+*  Parses a size given in KiB.
+*
+*  text: Option argument (digits only)
+*  max_size: Largest accepted size in bytes
+*  size: Pointer to store the size in bytes
+*
+*  returns: If the size is invalid, zero or larger than max_size (0), On success (1)
+*/
+static int parse_kb(const char* text, uint64_t max_size, uint64_t* size) {
+    uint64_t value = 0;
+    if (text == NULL || !parse_uint(text, strlen(text), max_size / KB, &value) || value == 0) {
+        return 0;
+    }
+    *size = value * KB;
+    return 1;
+}
+
 int main(int argc, char* argv[]) {
     int opt;
     int compress_mode = 0;
     int decompress_mode = 0;
     int output_file_mode = 0;
+    int test_mode = 0;
+    int pipeline_mode = 0;
+    int parallel_mode = 0;
+    int adaptive_mode = 0;
+    int estimate_mode = 0;
+    int archive_mode = 0; // 'a' create, 'x' extract, 'l' list
+    size_t thread_count = 0;
+    uint32_t segment_size = 0; // Seekable output if not zero
+    size_t sample_size = 0; // Fast stats if not zero
+    int verify_mode = 0;
+    int seekable_flags = 0;
+    int range_mode = 0;
+    uint64_t range_offset = 0;
+    uint64_t range_length = 0;
+    int shard_mode = 0;
+    int records_mode = 0;
+    int record_flags = 0;
+    int record_mode = 0;
+    uint64_t record_index = 0;
+    uint64_t shard_start = 0;
+    uint64_t shard_end = 0;
     // int verbose_mode = 0;
     char* output_file_path = NULL;
     char* input_file_path = NULL;
+    char* archive_path = NULL;
+    char* table_name = NULL;
+    int train_mode = 0;
+    int merge_mode = 0;
+    int grep_mode = 0;
+
+    // Compare the BMI2 lookup loops with the portable ones
+    // 1 forces the portable lookup loops, 0 the BMI2 ones if the CPU has them
+    const char* portable_decode = getenv(DECODE_PORTABLE_ENV);
+    if (portable_decode != NULL) {
+        set_decode_table_portable(strcmp(portable_decode, "0") != 0);
+    }
+
+    // 'train' subcommand: the options and sample files follow it
+    if (argc > 1 && strcmp(argv[1], "train") == 0) {
+        train_mode = 1;
+        optind = 2;
+    }
+    // 'merge' subcommand: the options and shard files follow it
+    if (argc > 1 && strcmp(argv[1], "merge") == 0) {
+        merge_mode = 1;
+        optind = 2;
+    }
+    // 'grep' subcommand: the options, the pattern and the files follow it
+    if (argc > 1 && strcmp(argv[1], "grep") == 0) {
+        grep_mode = 1;
+        optind = 2;
+    }
 
     // Setting up the CLI
-    while ((opt = getopt(argc, argv, "c:d:o:v")) != -1) {
+    while ((opt = getopt_long(argc, argv, "c:d:o:t:pj:As:r:kVT:va:x:l:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'c':
                 if (decompress_mode) {
@@ -49,6 +175,20 @@ int main(int argc, char* argv[]) {
                 }
                 strcpy(input_file_path, optarg);
                 break;
+            case 't':
+                if (compress_mode || decompress_mode) {
+                    err("main", "Invalid flag combination!"
+                                "\n\tCan't use -t with -c or -d.\n");
+                    return EXIT_FAILURE;
+                }
+                test_mode = 1;
+                input_file_path = malloc(strlen(optarg) + 1);
+                if (input_file_path == NULL) {
+                    err("main", "Unable to allocate memory for input file name!\n");
+                    return EXIT_FAILURE;
+                }
+                strcpy(input_file_path, optarg);
+                break;
             case 'o':
                 output_file_mode = 1;
                 output_file_path = malloc(strlen(optarg) + 1);
@@ -58,19 +198,349 @@ int main(int argc, char* argv[]) {
                 }
                 strcpy(output_file_path, optarg);
                 break;
+            case 'p':
+                pipeline_mode = 1;
+                break;
+            case 'j': {
+                // 0 uses the number of online CPUs
+                uint64_t count = 0;
+                if (!parse_uint(optarg, strlen(optarg), MAX_THREAD_COUNT, &count)) {
+                    err("main", "Invalid thread count! (Use 0 to 1024)\n");
+                    return EXIT_FAILURE;
+                }
+                thread_count = count;
+                parallel_mode = 1;
+                break;
+            }
+            case 'A':
+                adaptive_mode = 1;
+                break;
+            case 's': {
+                // The seekable header stores the segment size in 4 bytes
+                uint64_t size = 0;
+                if (!parse_kb(optarg, UINT32_MAX, &size)) {
+                    err("main", "Invalid segment size! (Use 1 to 4194303 KiB)\n");
+                    return EXIT_FAILURE;
+                }
+                segment_size = (uint32_t) size;
+                break;
+            }
+            case 'r': {
+                const char* separator = strchr(optarg, ':');
+                if (separator == NULL || !parse_uint(optarg, separator - optarg, UINT64_MAX, &range_offset)
+                    || !parse_uint(separator + 1, strlen(separator + 1), UINT64_MAX, &range_length)) {
+                    err("main", "Invalid range! (Use offset:length)\n");
+                    return EXIT_FAILURE;
+                }
+                range_mode = 1;
+                break;
+            }
+            case OPTION_FAST_STATS: {
+                sample_size = optarg != NULL ? strtoul(optarg, NULL, 10) * KB : FAST_STATS_SAMPLE_SIZE;
+                if (sample_size == 0) {
+                    err("main", "Invalid sample size!\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case OPTION_ESTIMATE:
+                estimate_mode = 1;
+                break;
+            case OPTION_SHARD: {
+                // An empty end is the end of the input
+                const char* separator = strchr(optarg, ':');
+                shard_end = UINT64_MAX;
+                if (separator == NULL || !parse_uint(optarg, separator - optarg, UINT64_MAX, &shard_start)
+                    || (separator[1] != '\0' && !parse_uint(separator + 1, strlen(separator + 1), UINT64_MAX, &shard_end))
+                    || shard_start >= shard_end) {
+                    err("main", "Invalid shard range! (Use start:end with start < end)\n");
+                    return EXIT_FAILURE;
+                }
+                shard_mode = 1;
+                break;
+            }
+            case OPTION_RECORDS:
+                if (optarg != NULL && strcmp(optarg, "length") == 0) {
+                    record_flags = RECORD_FLAG_LENGTH;
+                } else if (optarg != NULL && strcmp(optarg, "lines") != 0) {
+                    err("main", "Invalid record delimiter! (Use lines or length)\n");
+                    return EXIT_FAILURE;
+                }
+                records_mode = 1;
+                break;
+            case OPTION_RECORD:
+                if (!parse_uint(optarg, strlen(optarg), UINT64_MAX, &record_index)) {
+                    err("main", "Invalid record index!\n");
+                    return EXIT_FAILURE;
+                }
+                record_mode = 1;
+                break;
+            case 'k':
+                seekable_flags |= SEEKABLE_FLAG_CHECKSUM;
+                break;
+            case 'V':
+                verify_mode = 1;
+                break;
+            case 'T':
+                table_name = optarg;
+                break;
             case 'v':
                 // verbose_mode = 1;
                 break;
+            case 'a':
+            case 'x':
+            case 'l':
+                if (archive_mode && archive_mode != opt) {
+                    err("main", "Invalid flag combination!"
+                                "\n\tCan't use -a, -x and -l at the same time.\n");
+                    return EXIT_FAILURE;
+                }
+                archive_mode = opt;
+                archive_path = optarg;
+                break;
             default:
-                fprintf(stderr, "[USAGE]: %s [-c filename] [-d filename] [-o output_file_name] [-v]"
-                                "\n\t-c: compress file"
-                                "\n\t-d: decompress file"
+                fprintf(stderr, "[USAGE]: %s [-c filename] [-d filename] [-t filename] [-o output_file_name] [-p] [-j threads] [-A] [-s segment_kib] [--fast-stats[=sample_kib]] [--estimate] [--shard start:end] [--records[=lines|length]] [--record index] [-r offset:length] [-k] [-V] [-T table] [-v] [files...]"
+                                "\n\t %s train [-o table_file] samples..."
+                                "\n\t %s merge -o output shards..."
+                                "\n\t %s grep [-o output] pattern files..."
+                                "\n\t %s -a archive files... | -x archive [-o directory] [members...] | -l archive"
+                                "\n\t-c: compress file (a directory, more files or '-' for a list on stdin start a batch)"
+                                "\n\t-d: decompress file (a directory, more files or '-' for a list on stdin start a batch)"
+                                "\n\t-t: test files by decoding them without writing (checks the checksums if present)"
                                 "\n\t-o: output file"
-                                "\n\t-v: print logs\n\r", argv[0]);
+                                "\n\t-p: run reader, coder and writer stages on separate threads"
+                                "\n\t-j: number of threads in batch mode (default: number of CPUs), or of the"
+                                "\n\t    parallel encoder/decoder for a single file (0: number of CPUs)"
+                                "\n\t-A: one-pass adaptive huffman stream without a table (input can be a pipe)"
+                                "\n\t-s: write a seekable file with a sync point every N KiB"
+                                "\n\t--fast-stats: build the table from a sample of large inputs (default: 4096 KiB)"
+                                "\n\t--estimate: print the compressed size, entropy and code lengths of -c's input without compressing"
+                                "\n\t--shard: compress the byte range [start, end) into a seekable shard (with -T: shared table)"
+                                "\n\t--records: compress newline (default) or 4-byte length prefixed records, each decodable alone"
+                                "\n\t--record: decompress only the record with the given index of a record file"
+                                "\n\t-r: decompress only the given byte range of a seekable file"
+                                "\n\t-k: add CRC32C checksums of every segment and of the whole file (seekable format)"
+                                "\n\t-V: verify the checksums while decompressing"
+                                "\n\t-T: compress/decompress with a trained table (table file path or ID)"
+                                "\n\t-v: print logs"
+                                "\n\t-a: pack files and directories into an archive"
+                                "\n\t-x: extract every member (or the given members) of an archive"
+                                "\n\t-l: list the members of an archive"
+                                "\n\tgrep: print the matching records of record files, or the offsets of the matches in seekable files\n\r",
+                                argv[0], argv[0], argv[0], argv[0], argv[0]);
                 return EXIT_FAILURE;
         }
     }
 
+    // Train a table from the sample files
+    if (train_mode) {
+        PathList samples = {NULL, 0, 0};
+        for (int i = optind; i < argc; i++) {
+            path_list_add(&samples, argv[i], BATCH_COMPRESS);
+        }
+        Dictionary* trained = train_dictionary(&samples);
+        int result = trained != NULL && save_dictionary(trained, output_file_path);
+        if (result) {
+            printf("\n--->> Table %08x trained from %zu files!\n", (unsigned) trained->id, samples.count);
+        } else {
+            printf("\n--->> Training failed!\n");
+        }
+        free_dictionary(trained);
+        path_list_free(&samples);
+        free(output_file_path);
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Join shards into one seekable file
+    if (merge_mode) {
+        if (!output_file_mode || optind >= argc) {
+            err("main", "merge needs an output file (-o) and the shard files!");
+            free(output_file_path);
+            return EXIT_FAILURE;
+        }
+        size_t shard_count = argc - optind;
+        FILE** shard_files = calloc(shard_count, sizeof(FILE*));
+        int result = shard_files != NULL;
+        for (size_t i = 0; i < shard_count && result; i++) {
+            result = (shard_files[i] = open_file(argv[optind + i], "rb")) != NULL;
+        }
+        FILE* output_file = result ? open_file(output_file_path, "wb") : NULL;
+        if (output_file != NULL) {
+            result = merge_shards(shard_files, shard_count, output_file);
+            if (fclose(output_file) != 0) {
+                result = 0;
+            }
+            if (!result) {
+                remove(output_file_path);
+            }
+        } else {
+            result = 0;
+        }
+        for (size_t i = 0; shard_files != NULL && i < shard_count; i++) {
+            if (shard_files[i] != NULL) {
+                fclose(shard_files[i]);
+            }
+        }
+        free(shard_files);
+        printf("\n--->> Merge %s!\n", result ? "completed" : "failed");
+        free(output_file_path);
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Search compressed files
+    if (grep_mode) {
+        if (argc - optind < 2) {
+            err("main", "grep needs a pattern and the compressed files!");
+            free(output_file_path);
+            return EXIT_FAILURE;
+        }
+        const char* pattern = argv[optind];
+        FILE* output_file = output_file_mode ? open_file(output_file_path, "wb") : stdout;
+        uint64_t matches = 0;
+        int result = output_file != NULL;
+        for (int i = optind + 1; i < argc && result; i++) {
+            FILE* input_file = open_file(argv[i], "rb");
+            GrepStats stats;
+            // File names are printed before the matches when more files are searched
+            result = input_file != NULL && grep_file(input_file, (const unsigned char*) pattern, strlen(pattern), output_file,
+                                                     argc - optind > 2 ? argv[i] : NULL, &stats);
+            if (result) {
+                matches += stats.matches;
+                fprintf(stderr, "%s: %" PRIu64 " matches, %" PRIu64 "/%" PRIu64 " regions decoded\n", argv[i],
+                        stats.matches, stats.decoded, stats.regions);
+            }
+            if (input_file != NULL) {
+                fclose(input_file);
+            }
+        }
+        if (output_file_mode && output_file != NULL) {
+            fclose(output_file);
+        }
+        free(output_file_path);
+        return result && matches > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    Dictionary* dictionary = NULL;
+    if (table_name != NULL) {
+        // A shard stores the trained table as its seekable table
+        if ((!shard_mode && (segment_size > 0 || seekable_flags != 0)) || pipeline_mode) {
+            err("main", "Invalid flag combination!"
+                        "\n\tCan't use -T with -s, -k or -p (except with --shard).\n");
+            return EXIT_FAILURE;
+        }
+        dictionary = load_dictionary(table_name);
+        if (dictionary == NULL) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Archive mode
+    if (archive_mode) {
+        if (compress_mode || decompress_mode || test_mode) {
+            err("main", "Invalid flag combination!"
+                        "\n\tCan't use -c, -d or -t with an archive.\n");
+            return EXIT_FAILURE;
+        }
+        int result = 0;
+        if (archive_mode == 'a') {
+            PathList list = {NULL, 0, 0};
+            for (int i = optind; i < argc; i++) {
+                path_list_add(&list, argv[i], BATCH_COMPRESS);
+            }
+            FILE* archive_file = list.count > 0 ? open_file(archive_path, "wb") : NULL;
+            if (archive_file != NULL) {
+                result = create_archive(archive_file, &list);
+                if (fclose(archive_file) != 0) {
+                    result = 0;
+                }
+                if (!result) {
+                    remove(archive_path);
+                }
+            } else if (list.count == 0) {
+                err("main", "No input files!");
+            }
+            path_list_free(&list);
+            printf("\n--->> Archive %s!\n", result ? "completed" : "failed");
+        } else {
+            FILE* archive_file = open_file(archive_path, "rb");
+            Archive* archive = archive_file != NULL ? open_archive(archive_file) : NULL;
+            if (archive != NULL && archive_mode == 'l') {
+                list_archive(archive);
+                result = 1;
+            } else if (archive != NULL) {
+                char** names = optind < argc ? argv + optind : NULL;
+                result = extract_archive(archive, output_file_path, names, argc - optind) == 0;
+            }
+            close_archive(archive);
+            if (archive_file != NULL) {
+                fclose(archive_file);
+            }
+        }
+        free(output_file_path);
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Dry run: only the histogram pass
+    if (estimate_mode) {
+        if (!compress_mode || optind < argc) {
+            err("main", "Invalid flag combination!"
+                        "\n\t--estimate needs a single input given with -c.\n");
+            return EXIT_FAILURE;
+        }
+        FILE* input_file = open_file(input_file_path, "rb");
+        HuffContext* context = input_file != NULL ? create_context() : NULL;
+        if (context != NULL) {
+            context->sample_size = sample_size;
+        }
+        SizeEstimate estimate;
+        int result = context != NULL && estimate_file(context, input_file, &estimate);
+        if (result) {
+            print_estimate(&estimate, stdout);
+        }
+        free_context(context);
+        if (input_file != NULL) {
+            fclose(input_file);
+        }
+        free_dictionary(dictionary);
+        free(output_file_path);
+        free(input_file_path);
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Batch mode: more than one input, a directory or a list of files on stdin (tests always run as a batch)
+    struct stat input_stat;
+    int input_is_directory = input_file_path != NULL && stat(input_file_path, &input_stat) == 0
+                             && S_ISDIR(input_stat.st_mode);
+    int input_is_list = input_file_path != NULL && strcmp(input_file_path, "-") == 0;
+    if (test_mode || ((compress_mode || decompress_mode) && (optind < argc || input_is_directory || input_is_list))) {
+        if (output_file_mode) {
+            err("main", "Invalid flag combination!"
+                        "\n\tCan't use -o with more than one input.\n");
+            return EXIT_FAILURE;
+        }
+        if (test_mode && (compress_mode || decompress_mode)) {
+            err("main", "Invalid flag combination!"
+                        "\n\tCan't use -t with -c or -d.\n");
+            return EXIT_FAILURE;
+        }
+        int mode = test_mode ? BATCH_TEST : compress_mode ? BATCH_COMPRESS : BATCH_DECOMPRESS;
+        PathList list = {NULL, 0, 0};
+        if (input_is_list) {
+            path_list_read(&list, stdin, mode);
+        } else {
+            path_list_add(&list, input_file_path, mode);
+        }
+        for (int i = optind; i < argc; i++) {
+            path_list_add(&list, argv[i], mode);
+        }
+        size_t failed = run_batch(&list, mode, thread_count, sample_size, verify_mode, dictionary);
+        free_dictionary(dictionary);
+        path_list_free(&list);
+        free(input_file_path);
+        return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
     // Compression mode:
     if (compress_mode && !decompress_mode) {
         // If user did not specify an output path, add '.huf' at the end of the input file
@@ -88,11 +558,26 @@ int main(int argc, char* argv[]) {
         FILE* input_file = open_file(input_file_path, "rb");
         FILE* output_file = open_file(output_file_path, "wb");
 
-        if (input_file == NULL || output_file == NULL) {
+        HuffContext* context = input_file != NULL && output_file != NULL ? create_context() : NULL;
+        if (context == NULL) {
             return EXIT_FAILURE;
         }
+        context->sample_size = sample_size;
 
-        int result = compress(input_file, output_file);
+        // Checksums and shards are stored in the seekable format
+        if ((seekable_flags != 0 || shard_mode) && segment_size == 0) {
+            segment_size = SEEKABLE_SEGMENT_SIZE;
+        }
+        int result = records_mode ? compress_records(input_file, output_file, record_flags)
+                     : shard_mode ? compress_shard(input_file, output_file, shard_start, shard_end, segment_size, seekable_flags,
+                                                 dictionary != NULL ? dictionary->frequency_table : NULL)
+                     : adaptive_mode ? compress_adaptive(input_file, output_file)
+                     : dictionary != NULL ? compress_with_dictionary(dictionary, NULL, input_file, output_file)
+                     : segment_size > 0 ? compress_seekable(input_file, output_file, segment_size, seekable_flags)
+                     : parallel_mode ? compress_parallel(input_file, output_file, thread_count, sample_size)
+                     : pipeline_mode ? compress_pipelined(input_file, output_file)
+                     : compress_with_context(context, input_file, output_file);
+        free_context(context);
         fclose(input_file);
         fclose(output_file);
         printf("\n--->> Compression ");
@@ -101,6 +586,7 @@ int main(int argc, char* argv[]) {
         } else {
             printf("failed!\n");
             remove(output_file_path);
+            status = EXIT_FAILURE;
         }
 
     } 
@@ -140,11 +626,24 @@ int main(int argc, char* argv[]) {
         FILE* input_file = open_file(input_file_path, "rb");
         FILE* output_file = open_file(output_file_path, "wb");
 
-        if (input_file == NULL || output_file == NULL) {
+        HuffContext* context = input_file != NULL && output_file != NULL ? create_context() : NULL;
+        if (context == NULL) {
             return EXIT_FAILURE;
         }
+        context->verify = verify_mode;
 
-        int result = decompress(input_file, output_file);
+        // Pipes can't be probed for the format, -A reads the stream without seeking.
+        // Only seekable files have checksums, -j and -p would decode them like -d
+        int result = adaptive_mode ? decompress_adaptive(input_file, output_file)
+                     : dictionary != NULL && is_dictionary_stream(input_file)
+                         ? decompress_with_dictionary(dictionary, NULL, input_file, output_file)
+                     : range_mode ? decompress_range(input_file, output_file, range_offset, range_length, verify_mode)
+                     : record_mode ? decompress_record(input_file, output_file, record_index)
+                     : verify_mode ? decompress_with_context(context, input_file, output_file)
+                     : parallel_mode ? decompress_parallel(input_file, output_file, thread_count)
+                     : pipeline_mode ? decompress_pipelined(input_file, output_file)
+                     : decompress_with_context(context, input_file, output_file);
+        free_context(context);
         fclose(input_file);
         fclose(output_file);
         printf("\n--->> Decompression ");
@@ -153,11 +652,13 @@ int main(int argc, char* argv[]) {
         } else {
             printf("failed!\n");
             remove(output_file_path);
+            status = EXIT_FAILURE;
         }
     }
 
+    free_dictionary(dictionary);
     free(output_file_path);
     free(input_file_path);
-    return 0;
+    return status;
 }
 
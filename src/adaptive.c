@@ -0,0 +1,370 @@
+#include "../include/adaptive.h"
+#include "../include/bitio.h"
+#include "../include/constants.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+* Huffman tree updated after every symbol. Nodes are numbered so that the
+* weights never decrease with the number and siblings have consecutive
+* numbers (sibling property); the root has the highest number.
+*/
+typedef struct {
+    Node nodes[ADAPTIVE_MAX_NODES];
+    Node* parents[ADAPTIVE_MAX_NODES]; // Parent of every node (NULL for the root)
+    int numbers[ADAPTIVE_MAX_NODES]; // Number of every node
+    Node* ordered[ADAPTIVE_MAX_NODES]; // Node of every number
+    Node* leaves[FREQUENCY_TABLE_SIZE]; // Leaf of every transmitted symbol
+    Node* root;
+    Node* nyt; // Not yet transmitted: escape code of new symbols (weight 0)
+    size_t node_count;
+} AdaptiveTree;
+
+/*
+* Function: is_adaptive
+* ---------------------
+*  Checks if the file starts with the adaptive stream's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_adaptive(FILE* file) {
+    return has_magic(file, adaptive_magic, sizeof(adaptive_magic));
+}
+
+/*
+* Function: node_index
+* --------------------
+*  Returns the index of a node of the tree.
+*/
+static size_t node_index(AdaptiveTree* tree, Node* node) {
+    return node - tree->nodes;
+}
+
+/*
+* Function: new_node
+* ------------------
+*  Adds a node with the given number to the tree.
+*/
+static Node* new_node(AdaptiveTree* tree, Node* parent, int number) {
+    size_t index = tree->node_count++;
+    Node* node = &tree->nodes[index];
+    memset(node, 0, sizeof(Node));
+    tree->parents[index] = parent;
+    tree->numbers[index] = number;
+    tree->ordered[number] = node;
+    return node;
+}
+
+/*
+* Function: init_tree
+* -------------------
+*  Resets the tree to a single escape node.
+*
+*  tree: Pointer to the AdaptiveTree object
+*/
+static void init_tree(AdaptiveTree* tree) {
+    memset(tree->leaves, 0, sizeof(tree->leaves));
+    memset(tree->ordered, 0, sizeof(tree->ordered));
+    tree->node_count = 0;
+    tree->root = tree->nyt = new_node(tree, NULL, ADAPTIVE_MAX_NODES - 1);
+}
+
+/*
+* Function: swap_nodes
+* --------------------
+*  Swaps two subtrees and their numbers. Neither of them is the root or
+*  an ancestor of the other.
+*/
+static void swap_nodes(AdaptiveTree* tree, Node* first, Node* second) {
+    size_t first_index = node_index(tree, first);
+    size_t second_index = node_index(tree, second);
+    Node* first_parent = tree->parents[first_index];
+    Node* second_parent = tree->parents[second_index];
+    // Siblings have different slots of the same parent
+    Node** first_slot = first_parent->l_node == first ? &first_parent->l_node : &first_parent->r_node;
+    Node** second_slot = second_parent->l_node == second ? &second_parent->l_node : &second_parent->r_node;
+    *first_slot = second;
+    *second_slot = first;
+    tree->parents[first_index] = second_parent;
+    tree->parents[second_index] = first_parent;
+
+    int number = tree->numbers[first_index];
+    tree->numbers[first_index] = tree->numbers[second_index];
+    tree->numbers[second_index] = number;
+    tree->ordered[tree->numbers[first_index]] = first;
+    tree->ordered[tree->numbers[second_index]] = second;
+}
+
+/*
+* Function: update_tree
+* ---------------------
+*  Counts a symbol (FGK). A new symbol splits the escape node into a new
+*  escape node and the symbol's leaf. From the leaf up to the root, every
+*  node is first swapped with the highest numbered node of the same
+*  weight (unless that is its parent), then its weight is incremented, so
+*  the sibling property holds after the update.
+*
+*  tree: Pointer to the AdaptiveTree object
+*  symbol: The symbol
+*/
+static void update_tree(AdaptiveTree* tree, unsigned char symbol) {
+    Node* node = tree->leaves[symbol];
+    if (node == NULL) {
+        Node* parent = tree->nyt;
+        int number = tree->numbers[node_index(tree, parent)];
+        parent->r_node = node = new_node(tree, parent, number - 1);
+        parent->l_node = tree->nyt = new_node(tree, parent, number - 2);
+        node->symbol = symbol;
+        tree->leaves[symbol] = node;
+    }
+    while (node != NULL) {
+        int leader = tree->numbers[node_index(tree, node)];
+        while (leader + 1 < ADAPTIVE_MAX_NODES && tree->ordered[leader + 1]->frequency == node->frequency) {
+            leader++;
+        }
+        Node* leader_node = tree->ordered[leader];
+        if (leader_node != node && leader_node != tree->parents[node_index(tree, node)]) {
+            swap_nodes(tree, node, leader_node);
+        }
+        node->frequency++;
+        node = tree->parents[node_index(tree, node)];
+    }
+}
+
+/*
+* Function: write_path
+* --------------------
+*  Writes the code of a node: the branches from the root to the node.
+*
+*  bit_writer: Pointer to the BitWriter object
+*  tree: Pointer to the AdaptiveTree object
+*  node: The leaf or the escape node
+*
+*  returns: If failed (0), On success (1)
+*/
+static int write_path(BitWriter* bit_writer, AdaptiveTree* tree, Node* node) {
+    unsigned char bits[ADAPTIVE_MAX_NODES];
+    size_t depth = 0;
+    for (Node* parent = tree->parents[node_index(tree, node)]; parent != NULL;
+         node = parent, parent = tree->parents[node_index(tree, node)]) {
+        bits[depth++] = parent->r_node == node;
+    }
+    // Codes can be longer than 32 bits, they are written root first in pieces
+    while (depth > 0) {
+        uint32_t code = 0;
+        uint8_t length = 0;
+        while (depth > 0 && length < 32) {
+            code = code << 1 | bits[--depth];
+            length++;
+        }
+        if (write_bits(bit_writer, code, length) == -1) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: read_available
+* ------------------------
+*  Reads the bytes that are available, waiting only if there are none.
+*
+*  file: Pointer to the file
+*  buffer: Destination buffer
+*  size: Maximum number of bytes
+*
+*  returns: Number of read bytes (0 at the end of the file). If failed, returns -1.
+*/
+static ssize_t read_available(FILE* file, unsigned char* buffer, size_t size) {
+    ssize_t read_bytes = 0;
+    do {
+        read_bytes = read(fileno(file), buffer, size);
+    } while (read_bytes == -1 && errno == EINTR);
+    return read_bytes;
+}
+
+/*
+* Function: compress_adaptive
+* ---------------------------
+*  Compresses the input in one pass with adaptive huffman coding (FGK):
+*  encoder and decoder start from the same empty tree and update it after
+*  every symbol, so no table is stored. New symbols are sent as the
+*  escape code followed by 9 raw bits, the stream ends with the escape and
+*  256. The whole bytes are written after every read, so the input can be
+*  an unbounded stream (e.g. a pipe).
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_adaptive(FILE* input_file, FILE* output_file) {
+    if (input_file == NULL || output_file == NULL) {
+        err("compress_adaptive", "Input/output file is NULL!");
+        return 0;
+    }
+    clock_t start_time = clock();
+    AdaptiveTree* tree = malloc(sizeof(AdaptiveTree));
+    BitWriter* bit_writer = init_writer(output_file);
+    if (tree == NULL || bit_writer == NULL) {
+        err("compress_adaptive", "Unable to allocate memory for the tree!");
+        free(tree);
+        return 0;
+    }
+    init_tree(tree);
+
+    // The input is read with read(2), stdio must not hold buffered bytes of it (seeking fails on pipes)
+    fseeko(input_file, 0, SEEK_SET);
+    fflush(input_file);
+    unsigned char buffer[READ_BUFFER_SIZE];
+    uint64_t input_size = 0;
+    int result = fwrite(adaptive_magic, sizeof(unsigned char), sizeof(adaptive_magic), output_file)
+                 == sizeof(adaptive_magic);
+    while (result) {
+        ssize_t read_bytes = read_available(input_file, buffer, sizeof(buffer));
+        if (read_bytes == -1) {
+            err("compress_adaptive", "Unable to read the input file!");
+            result = 0;
+            break;
+        }
+        for (ssize_t i = 0; result && i < read_bytes; i++) {
+            Node* leaf = tree->leaves[buffer[i]];
+            result = leaf != NULL ? write_path(bit_writer, tree, leaf)
+                     : write_path(bit_writer, tree, tree->nyt)
+                       && write_bits(bit_writer, buffer[i], ADAPTIVE_ESCAPE_BITS) != -1;
+            update_tree(tree, buffer[i]);
+        }
+        if (read_bytes == 0) {
+            result = result && write_path(bit_writer, tree, tree->nyt)
+                     && write_bits(bit_writer, ADAPTIVE_END_OF_STREAM, ADAPTIVE_ESCAPE_BITS) != -1
+                     && flush_writer(bit_writer) != -1;
+            break;
+        }
+        // Latency is bounded by one read: everything but the last partial byte is sent
+        result = result && drain_writer(bit_writer) != -1 && fflush(output_file) == 0;
+        input_size += read_bytes;
+    }
+    if (result == 0) {
+        err("compress_adaptive", "Unable to write the output file!");
+    } else {
+        clock_t end_time = clock();
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished processing (%f s): %" PRIu64 " bytes -> %" PRId64 " bytes\n", time_spent, input_size,
+                  (int64_t) ftello(output_file));
+    }
+    free(bit_writer->buffer);
+    free(bit_writer);
+    free(tree);
+    return result;
+}
+
+/*
+* Function: decompress_adaptive
+* -----------------------------
+*  Decompresses an adaptive stream. The decoded bytes are written after
+*  every read, so the input can be an unbounded stream (e.g. a pipe).
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_adaptive(FILE* input_file, FILE* output_file) {
+    if (input_file == NULL) {
+        err("decompress_adaptive", "Input file is NULL!");
+        return 0;
+    }
+    AdaptiveTree* tree = malloc(sizeof(AdaptiveTree));
+    if (tree == NULL) {
+        err("decompress_adaptive", "Unable to allocate memory for the tree!");
+        return 0;
+    }
+    init_tree(tree);
+
+    fseeko(input_file, 0, SEEK_SET);
+    fflush(input_file);
+    unsigned char buffer[READ_BUFFER_SIZE];
+    unsigned char output[READ_BUFFER_SIZE];
+    size_t magic_bytes = 0;
+    Node* current = tree->root;
+    int escape_bits = ADAPTIVE_ESCAPE_BITS; // The first symbol is new, the escape code is empty
+    int escape_value = 0;
+    int finished = 0;
+    int result = 1;
+    while (result && !finished) {
+        ssize_t read_bytes = read_available(input_file, buffer, sizeof(buffer));
+        if (read_bytes <= 0) {
+            err("decompress_adaptive", read_bytes == 0 ? "Encoded data is truncated!" : "Unable to read the input file!");
+            result = 0;
+            break;
+        }
+        size_t output_size = 0;
+        for (ssize_t i = 0; result && !finished && i < read_bytes; i++) {
+            if (magic_bytes < sizeof(adaptive_magic)) {
+                result = buffer[i] == adaptive_magic[magic_bytes++];
+                continue;
+            }
+            for (int bit_index = 7; bit_index >= 0 && result && !finished; bit_index--) {
+                int bit = (buffer[i] >> bit_index) & 1;
+                int symbol = -1;
+                if (escape_bits > 0) {
+                    escape_value = escape_value << 1 | bit;
+                    if (--escape_bits == 0) {
+                        if (escape_value == ADAPTIVE_END_OF_STREAM) {
+                            finished = 1;
+                        } else if (escape_value > ADAPTIVE_END_OF_STREAM || tree->leaves[escape_value] != NULL) {
+                            result = 0;
+                        } else {
+                            symbol = escape_value;
+                        }
+                    }
+                } else {
+                    current = bit ? current->r_node : current->l_node;
+                    if (current == tree->nyt) {
+                        escape_bits = ADAPTIVE_ESCAPE_BITS;
+                        escape_value = 0;
+                    } else if (current->l_node == NULL && current->r_node == NULL) {
+                        symbol = current->symbol;
+                    }
+                }
+                if (symbol != -1) {
+                    output[output_size++] = (unsigned char) symbol;
+                    update_tree(tree, (unsigned char) symbol);
+                    current = tree->root;
+                    if (output_size == sizeof(output) && output_file != NULL
+                        && fwrite(output, sizeof(unsigned char), output_size, output_file) < output_size) {
+                        err("decompress_adaptive", "Unable to write the output file!");
+                        free(tree);
+                        return 0;
+                    }
+                    output_size %= sizeof(output);
+                }
+            }
+        }
+        if (result == 0) {
+            err("decompress_adaptive", "Encoded data is corrupted!");
+            break;
+        }
+        if (output_file != NULL && output_size > 0
+            && (fwrite(output, sizeof(unsigned char), output_size, output_file) < output_size
+                || fflush(output_file) != 0)) {
+            err("decompress_adaptive", "Unable to write the output file!");
+            result = 0;
+        }
+    }
+    free(tree);
+    return result;
+}
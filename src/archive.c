@@ -0,0 +1,606 @@
+#include "../include/archive.h"
+#include "../include/bitio.h"
+#include "../include/compressor.h"
+#include "../include/constants.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+// Trailer: directory offset (8 bytes) + magic (4 bytes)
+#define ARCHIVE_TRAILER_SIZE 12
+// Smallest directory entry: name length, 1 byte name, sizes, offset and table index
+#define ARCHIVE_MIN_ENTRY_SIZE 31
+
+/*
+* Function: member_name
+* ---------------------
+*  Returns the name a file is stored under (leading '/' and './' are removed).
+*
+*  path: File path
+*
+*  returns: Pointer into the path
+*/
+static const char* member_name(const char* path) {
+    while (path[0] == '/' || (path[0] == '.' && path[1] == '/')) {
+        path += path[0] == '/' ? 1 : 2;
+    }
+    return path;
+}
+
+/*
+* Function: is_safe_name
+* ----------------------
+*  Checks that a member name stays inside the output directory.
+*
+*  name: Member name
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+static int is_safe_name(const char* name) {
+    if (name[0] == '\0' || name[0] == '/') {
+        return 0;
+    }
+    const char* part = name;
+    while (*part != '\0') {
+        size_t length = strcspn(part, "/");
+        if (length == 2 && part[0] == '.' && part[1] == '.') {
+            return 0;
+        }
+        part += length;
+        if (*part == '/') {
+            part++;
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: make_parent_directories
+* ---------------------------------
+*  Creates the missing directories of a file path.
+*
+*  path: File path (Modified temporarily)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int make_parent_directories(char* path) {
+    for (char* p = strchr(path + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        int result = mkdir(path, 0755) == 0 || errno == EEXIST;
+        *p = '/';
+        if (!result) {
+            fprintf(stderr, "\n[ERROR]: make_parent_directories() {} -> Unable to create the directories of '%s'!\n", path);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: write_member
+* ----------------------
+*  Encodes one file at the current position of the archive.
+*
+*  context: HuffContext holding the group's code table
+*  output_file: Pointer to the archive file
+*  path: File path
+*  entry: Pointer to the member's entry (original_size is set)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int write_member(HuffContext* context, FILE* output_file, const char* path, ArchiveEntry* entry) {
+    FILE* input_file = open_file(path, "rb");
+    if (input_file == NULL) {
+        return 0;
+    }
+    entry->data_offset = ftello(output_file);
+    int result = 1;
+    if (entry->original_size > 0) {
+        reset_writer(context->bit_writer, output_file);
+        Code* pair_table = prepare_pair_table(context, entry->original_size);
+        result = encode(input_file, context->bit_writer, context->code_table, pair_table);
+    }
+    fclose(input_file);
+    entry->data_size = ftello(output_file) - entry->data_offset;
+    return result;
+}
+
+/*
+* Function: write_group
+* ---------------------
+*  Encodes a group of files with one shared table and writes the table
+*  after their data.
+*
+*  context: HuffContext used for the tables and the BitWriter
+*  output_file: Pointer to the archive file
+*  paths: File paths of the group
+*  entries: Entries of the group
+*  count: Number of files in the group
+*  table_offsets: Offsets of the written tables
+*  table_count: Pointer to the number of written tables
+*
+*  returns: If failed (0), On success (1)
+*/
+static int write_group(HuffContext* context, FILE* output_file, char** paths, ArchiveEntry* entries, size_t count,
+                       uint64_t* table_offsets, uint32_t* table_count) {
+    memset(context->frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    uint64_t total_size = 0;
+    for (size_t i = 0; i < count; i++) {
+        FILE* input_file = open_file(paths[i], "rb");
+        if (input_file == NULL) {
+            return 0;
+        }
+        ssize_t read_bytes = count_frequencies(input_file, context->frequency_table);
+        fclose(input_file);
+        if (read_bytes == -1) {
+            return 0;
+        }
+        entries[i].original_size = read_bytes;
+        total_size += read_bytes;
+    }
+    if (total_size > 0 && fill_code_table(context->frequency_table, context->code_table) == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        entries[i].table_index = entries[i].original_size > 0 ? *table_count : ARCHIVE_NO_TABLE;
+        // Progress lines of every member are not readable
+        set_log_mode(0);
+        int written = write_member(context, output_file, paths[i], &entries[i]);
+        set_log_mode(1);
+        if (!written) {
+            return 0;
+        }
+        print_log("      added: %s (%" PRIu64 " bytes -> %" PRIu64 " bytes)\n", entries[i].name,
+                  entries[i].original_size, entries[i].data_size);
+    }
+
+    if (total_size > 0) {
+        table_offsets[(*table_count)++] = ftello(output_file);
+        return write_file_header(output_file, context->frequency_table);
+    }
+    return 1;
+}
+
+/*
+* Function: write_directory
+* -------------------------
+*  Writes the central directory and the trailer at the end of the archive.
+*
+*  output_file: Pointer to the archive file
+*  entries: Member entries
+*  entry_count: Number of members
+*  table_offsets: Offsets of the tables
+*  table_count: Number of tables
+*
+*  returns: If failed (0), On success (1)
+*/
+static int write_directory(FILE* output_file, ArchiveEntry* entries, size_t entry_count,
+                           uint64_t* table_offsets, uint32_t table_count) {
+    uint64_t directory_offset = ftello(output_file);
+    int result = write_uint(output_file, table_count, 4);
+    for (uint32_t i = 0; i < table_count && result; i++) {
+        result = write_uint(output_file, table_offsets[i], 8);
+    }
+    result = result && write_uint(output_file, entry_count, 4);
+    for (size_t i = 0; i < entry_count && result; i++) {
+        size_t name_length = strlen(entries[i].name);
+        result = write_uint(output_file, name_length, 2)
+                 && fwrite(entries[i].name, sizeof(char), name_length, output_file) == name_length
+                 && write_uint(output_file, entries[i].original_size, 8)
+                 && write_uint(output_file, entries[i].data_offset, 8)
+                 && write_uint(output_file, entries[i].data_size, 8)
+                 && write_uint(output_file, entries[i].table_index, 4);
+    }
+    result = result && write_uint(output_file, directory_offset, 8)
+             && fwrite(archive_magic, sizeof(unsigned char), sizeof(archive_magic), output_file) == sizeof(archive_magic);
+    if (!result) {
+        err("write_directory", "Unable to write the central directory!");
+    }
+    return result;
+}
+
+/*
+* Function: create_archive
+* ------------------------
+*  Packs every file of the list into one archive. Consecutive small files
+*  share a huffman table built from their combined frequencies.
+*
+*  output_file: Pointer to the archive file
+*  list: Pointer to the PathList object
+*
+*  returns: If failed (0), On success (1)
+*/
+int create_archive(FILE* output_file, PathList* list) {
+    if (output_file == NULL || list == NULL || list->count == 0) {
+        err("create_archive", "No input files!");
+        return 0;
+    }
+    if (list->count > UINT32_MAX - 1) {
+        err("create_archive", "Too many input files!");
+        return 0;
+    }
+    ArchiveEntry* entries = calloc(list->count, sizeof(ArchiveEntry));
+    uint64_t* table_offsets = calloc(list->count, sizeof(uint64_t));
+    HuffContext* context = create_context();
+    if (entries == NULL || table_offsets == NULL || context == NULL) {
+        err("create_archive", "Unable to allocate memory for the archive!");
+        free(entries);
+        free(table_offsets);
+        free_context(context);
+        return 0;
+    }
+
+    // File sizes decide which files share a table
+    int result = 1;
+    for (size_t i = 0; i < list->count; i++) {
+        struct stat file_stat;
+        entries[i].name = (char*) member_name(list->paths[i]);
+        if (stat(list->paths[i], &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+            fprintf(stderr, "\n[ERROR]: create_archive() {} -> '%s' is not a regular file!\n", list->paths[i]);
+            result = 0;
+        } else if (!is_safe_name(entries[i].name) || strlen(entries[i].name) > UINT16_MAX) {
+            fprintf(stderr, "\n[ERROR]: create_archive() {} -> Invalid member name '%s'!\n", list->paths[i]);
+            result = 0;
+        } else {
+            entries[i].original_size = file_stat.st_size;
+        }
+    }
+
+    result = result && fwrite(archive_magic, sizeof(unsigned char), sizeof(archive_magic), output_file) == sizeof(archive_magic)
+             && write_uint(output_file, ARCHIVE_VERSION, 1);
+
+    uint32_t table_count = 0;
+    size_t first = 0;
+    while (result && first < list->count) {
+        size_t last = first + 1;
+        uint64_t group_size = entries[first].original_size;
+        if (group_size < ARCHIVE_SMALL_FILE_SIZE) {
+            while (last < list->count && entries[last].original_size < ARCHIVE_SMALL_FILE_SIZE
+                   && group_size + entries[last].original_size <= ARCHIVE_GROUP_SIZE) {
+                group_size += entries[last++].original_size;
+            }
+        }
+        result = write_group(context, output_file, list->paths + first, entries + first, last - first,
+                             table_offsets, &table_count);
+        first = last;
+    }
+
+    result = result && write_directory(output_file, entries, list->count, table_offsets, table_count);
+    if (result) {
+        uint64_t input_bytes = 0;
+        for (size_t i = 0; i < list->count; i++) {
+            input_bytes += entries[i].original_size;
+        }
+        uint64_t output_bytes = ftello(output_file);
+        print_log("\n--->> Archive: %zu files, %" PRIu32 " tables, %" PRIu64 " bytes -> %" PRIu64 " bytes (%.2f%%)\n",
+                  list->count, table_count, input_bytes, output_bytes,
+                  input_bytes > 0 ? (double) output_bytes / input_bytes * 100 : 0);
+    }
+
+    free(entries);
+    free(table_offsets);
+    free_context(context);
+    return result;
+}
+
+/*
+* Function: read_entry
+* --------------------
+*  Reads one central directory entry.
+*
+*  file: Pointer to the archive file
+*  entry: Pointer to the entry
+*
+*  returns: If failed (0), On success (1)
+*/
+static int read_entry(FILE* file, ArchiveEntry* entry) {
+    uint64_t name_length = 0;
+    uint64_t table_index = 0;
+    if (!read_uint(file, &name_length, 2) || name_length == 0) {
+        return 0;
+    }
+    entry->name = malloc(name_length + 1);
+    if (entry->name == NULL) {
+        return 0;
+    }
+    if (fread(entry->name, sizeof(char), name_length, file) < name_length) {
+        return 0;
+    }
+    entry->name[name_length] = '\0';
+    if (!read_uint(file, &entry->original_size, 8) || !read_uint(file, &entry->data_offset, 8)
+        || !read_uint(file, &entry->data_size, 8) || !read_uint(file, &table_index, 4)) {
+        return 0;
+    }
+    entry->table_index = table_index;
+    return 1;
+}
+
+/*
+* Function: open_archive
+* ----------------------
+*  Reads the central directory of an archive.
+*
+*  file: Pointer to the archive file
+*
+*  returns: Pointer to the Archive object. If failed, returns NULL.
+*/
+Archive* open_archive(FILE* file) {
+    unsigned char magic[sizeof(archive_magic)];
+    uint64_t version = 0;
+    fseeko(file, 0, SEEK_SET);
+    if (fread(magic, sizeof(unsigned char), sizeof(magic), file) < sizeof(magic)
+        || memcmp(magic, archive_magic, sizeof(magic)) != 0 || !read_uint(file, &version, 1)) {
+        err("open_archive", "Not an archive!");
+        return NULL;
+    }
+    if (version != ARCHIVE_VERSION) {
+        err("open_archive", "Unsupported archive version!");
+        return NULL;
+    }
+
+    fseeko(file, 0, SEEK_END);
+    uint64_t file_size = ftello(file);
+    uint64_t directory_offset = 0;
+    if (file_size < sizeof(archive_magic) + 1 + ARCHIVE_TRAILER_SIZE
+        || fseeko(file, -ARCHIVE_TRAILER_SIZE, SEEK_END) != 0 || !read_uint(file, &directory_offset, 8)
+        || fread(magic, sizeof(unsigned char), sizeof(magic), file) < sizeof(magic)
+        || memcmp(magic, archive_magic, sizeof(magic)) != 0
+        || directory_offset > file_size - ARCHIVE_TRAILER_SIZE) {
+        err("open_archive", "Archive trailer is corrupted!");
+        return NULL;
+    }
+    uint64_t directory_size = file_size - ARCHIVE_TRAILER_SIZE - directory_offset;
+
+    Archive* archive = calloc(1, sizeof(Archive));
+    if (archive == NULL) {
+        err("open_archive", "Unable to allocate memory for the archive!");
+        return NULL;
+    }
+    archive->file = file;
+
+    uint64_t table_count = 0;
+    uint64_t entry_count = 0;
+    int result = fseeko(file, directory_offset, SEEK_SET) == 0 && read_uint(file, &table_count, 4)
+                 && table_count * 8 <= directory_size;
+    if (result) {
+        archive->table_offsets = malloc((table_count + 1) * sizeof(uint64_t));
+        result = archive->table_offsets != NULL;
+    }
+    for (uint64_t i = 0; i < table_count && result; i++) {
+        result = read_uint(file, &archive->table_offsets[i], 8) && archive->table_offsets[i] < directory_offset;
+        archive->table_count++;
+    }
+    result = result && read_uint(file, &entry_count, 4) && entry_count * ARCHIVE_MIN_ENTRY_SIZE <= directory_size;
+    if (result) {
+        archive->entries = calloc(entry_count + 1, sizeof(ArchiveEntry));
+        result = archive->entries != NULL;
+    }
+    for (uint64_t i = 0; i < entry_count && result; i++) {
+        ArchiveEntry* entry = &archive->entries[i];
+        archive->entry_count++;
+        result = read_entry(file, entry) && entry->data_offset <= directory_offset
+                 && entry->data_size <= directory_offset - entry->data_offset
+                 && (entry->table_index < archive->table_count
+                     || (entry->table_index == ARCHIVE_NO_TABLE && entry->original_size == 0));
+    }
+    if (!result) {
+        err("open_archive", "Central directory is corrupted!");
+        close_archive(archive);
+        return NULL;
+    }
+    return archive;
+}
+
+/*
+* Function: close_archive
+* -----------------------
+*  Frees the Archive object (The file is not closed).
+*
+*  archive: Pointer to the Archive object
+*/
+void close_archive(Archive* archive) {
+    if (archive == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < archive->entry_count; i++) {
+        free(archive->entries[i].name);
+    }
+    free(archive->entries);
+    free(archive->table_offsets);
+    free(archive);
+}
+
+/*
+* Function: find_archive_entry
+* ----------------------------
+*  Returns the member with the given name.
+*
+*  archive: Pointer to the Archive object
+*  name: Member name
+*
+*  returns: Pointer to the entry. If not found, returns NULL.
+*/
+ArchiveEntry* find_archive_entry(Archive* archive, const char* name) {
+    name = member_name(name);
+    for (uint32_t i = 0; i < archive->entry_count; i++) {
+        if (strcmp(archive->entries[i].name, name) == 0) {
+            return &archive->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+* Function: extract_archive_entry
+* -------------------------------
+*  Decodes one member into the output file.
+*
+*  archive: Pointer to the Archive object
+*  entry: Pointer to the member's entry
+*  output_file: Pointer to the output file
+*
+*  returns: If failed (0), On success (1)
+*/
+int extract_archive_entry(Archive* archive, ArchiveEntry* entry, FILE* output_file) {
+    if (entry->original_size == 0) {
+        return 1;
+    }
+    size_t* frequency_table = malloc(FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    if (frequency_table == NULL) {
+        err("extract_archive_entry", "Unable to allocate memory for frequency table!");
+        return 0;
+    }
+    if (fseeko(archive->file, archive->table_offsets[entry->table_index], SEEK_SET) != 0
+        || read_frequency_table(archive->file, frequency_table) == 0) {
+        free(frequency_table);
+        return 0;
+    }
+    Node* root = create_huffman_tree(frequency_table, 0);
+    free(frequency_table);
+    if (root == NULL) {
+        return 0;
+    }
+
+    // Only the member's own bytes are read
+    fseeko(archive->file, entry->data_offset, SEEK_SET);
+    BitReader* bit_reader = init_reader(archive->file);
+    off_t start_pos = ftello(output_file);
+    int result = bit_reader != NULL
+                 && decode_symbols(output_file, bit_reader, root, entry->data_size * 8, entry->original_size);
+    if (result && start_pos >= 0 && (uint64_t) (ftello(output_file) - start_pos) != entry->original_size) {
+        err("extract_archive_entry", "Member is corrupted!");
+        result = 0;
+    }
+    if (bit_reader != NULL) {
+        free(bit_reader->buffer);
+        free(bit_reader);
+    }
+    free_tree(root);
+    return result;
+}
+
+/*
+* Function: extract_member
+* ------------------------
+*  Extracts one member to its path under the output directory.
+*
+*  archive: Pointer to the Archive object
+*  entry: Pointer to the member's entry
+*  directory: Output directory (NULL for the current directory)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int extract_member(Archive* archive, ArchiveEntry* entry, const char* directory) {
+    if (!is_safe_name(entry->name)) {
+        fprintf(stderr, "\n[ERROR]: extract_member() {} -> Unsafe member name '%s'!\n", entry->name);
+        return 0;
+    }
+    size_t directory_length = directory != NULL ? strlen(directory) : 0;
+    char* output_path = malloc(directory_length + strlen(entry->name) + 2);
+    if (output_path == NULL) {
+        err("extract_member", "Unable to allocate memory for output file name!");
+        return 0;
+    }
+    if (directory != NULL) {
+        int has_slash = directory_length > 0 && directory[directory_length - 1] == '/';
+        sprintf(output_path, has_slash ? "%s%s" : "%s/%s", directory, entry->name);
+    } else {
+        strcpy(output_path, entry->name);
+    }
+
+    FILE* output_file = make_parent_directories(output_path) ? open_file(output_path, "wb") : NULL;
+    if (output_file == NULL) {
+        free(output_path);
+        return 0;
+    }
+    int result = extract_archive_entry(archive, entry, output_file);
+    if (fclose(output_file) != 0) {
+        result = 0;
+    }
+    if (!result) {
+        remove(output_path);
+    }
+    free(output_path);
+    return result;
+}
+
+/*
+* Function: extract_archive
+* -------------------------
+*  Extracts the named members (or every member) under a directory and
+*  prints a summary.
+*
+*  archive: Pointer to the Archive object
+*  directory: Output directory (NULL for the current directory)
+*  names: Member names (NULL extracts every member)
+*  name_count: Number of names
+*
+*  returns: Number of failed members
+*/
+size_t extract_archive(Archive* archive, const char* directory, char** names, size_t name_count) {
+    size_t count = names != NULL ? name_count : archive->entry_count;
+    size_t failed = 0;
+    uint64_t output_bytes = 0;
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    set_log_mode(0);
+    for (size_t i = 0; i < count; i++) {
+        ArchiveEntry* entry = names != NULL ? find_archive_entry(archive, names[i]) : &archive->entries[i];
+        if (entry == NULL) {
+            fprintf(stderr, "\n[ERROR]: extract_archive() {} -> '%s' is not in the archive!\n", names[i]);
+            failed++;
+            continue;
+        }
+        if (extract_member(archive, entry, directory)) {
+            output_bytes += entry->original_size;
+        } else {
+            printf("      [FAILED]: %s\n", entry->name);
+            failed++;
+        }
+    }
+    set_log_mode(1);
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double time_spent = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    printf("\n--->> Extraction: %zu files, %zu succeeded, %zu failed\n", count, count - failed, failed);
+    printf("      %" PRIu64 " bytes in %f s (%.2f MB/s)\n", output_bytes, time_spent,
+           time_spent > 0 ? output_bytes / time_spent / (KB * KB) : 0);
+    return failed;
+}
+
+/*
+* Function: list_archive
+* ----------------------
+*  Prints the members of an archive.
+*
+*  archive: Pointer to the Archive object
+*/
+void list_archive(Archive* archive) {
+    uint64_t original_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    printf("%14s %14s %6s  %s\n", "Size", "Compressed", "Table", "Name");
+    for (uint32_t i = 0; i < archive->entry_count; i++) {
+        ArchiveEntry* entry = &archive->entries[i];
+        char table[16] = "-";
+        if (entry->table_index != ARCHIVE_NO_TABLE) {
+            snprintf(table, sizeof(table), "%" PRIu32, entry->table_index);
+        }
+        printf("%14" PRIu64 " %14" PRIu64 " %6s  %s\n", entry->original_size, entry->data_size, table, entry->name);
+        original_bytes += entry->original_size;
+        compressed_bytes += entry->data_size;
+    }
+    printf("%14" PRIu64 " %14" PRIu64 " %6" PRIu32 "  %" PRIu32 " files\n", original_bytes, compressed_bytes,
+           archive->table_count, archive->entry_count);
+}
@@ -0,0 +1,610 @@
+#define _GNU_SOURCE
+#include "../include/constants.h"
+#include "../include/asyncio.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__) && !defined(NO_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define HAVE_IO_URING 1
+#endif
+
+#ifdef HAVE_IO_URING
+struct uring_queue {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_ptr;
+    void* cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    size_t sqes_size;
+    struct iovec* iovecs;
+};
+
+/*
+* Function: uring_free
+* --------------------
+*  Unmaps the rings and closes the io_uring file descriptor.
+*
+*  ring: Pointer to the UringQueue object
+*/
+static void uring_free(UringQueue* ring) {
+    if (ring == NULL) {
+        return;
+    }
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr != NULL && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_size);
+    }
+    if (ring->sq_ptr != NULL && ring->sq_ptr != MAP_FAILED) munmap(ring->sq_ptr, ring->sq_size);
+    if (ring->fd >= 0) close(ring->fd);
+    free(ring->iovecs);
+    free(ring);
+}
+
+/*
+* Function: uring_init
+* --------------------
+*  Sets up an io_uring instance with raw system calls.
+*
+*  entries: Queue depth
+*
+*  returns: A UringQueue object. If the kernel does not support io_uring, returns NULL.
+*/
+static UringQueue* uring_init(size_t entries) {
+    UringQueue* ring = calloc(1, sizeof(UringQueue));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->iovecs = calloc(entries, sizeof(struct iovec));
+    if (ring->iovecs == NULL) {
+        free(ring);
+        return NULL;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, (unsigned) entries, &params);
+    if (ring->fd < 0) {
+        free(ring->iovecs);
+        free(ring);
+        return NULL;
+    }
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+        ring->cq_size = ring->sq_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        uring_free(ring);
+        return NULL;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            uring_free(ring);
+            return NULL;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        uring_free(ring);
+        return NULL;
+    }
+
+    char* sq = ring->sq_ptr;
+    char* cq = ring->cq_ptr;
+    ring->sq_head = (unsigned*) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned*) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+    return ring;
+}
+
+/*
+* Function: uring_submit
+* ----------------------
+*  Queues a readv/writev request for a slot and submits it to the kernel.
+*  If the kernel doesn't take the request, it is removed from the ring.
+*
+*  async_file: Pointer to the AsyncFile object
+*  index: Slot index
+*
+*  returns: If failed (0), On success (1)
+*/
+static int uring_submit(AsyncFile* async_file, size_t index) {
+    UringQueue* ring = async_file->ring;
+    AsyncSlot* slot = &async_file->slots[index];
+
+    ring->iovecs[index].iov_base = slot->data;
+    ring->iovecs[index].iov_len = slot->size;
+
+    unsigned tail = *ring->sq_tail;
+    unsigned sqe_index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[sqe_index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = async_file->mode == ASYNC_READ ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->fd = async_file->fd;
+    sqe->addr = (unsigned long) &ring->iovecs[index];
+    sqe->len = 1;
+    sqe->off = slot->offset;
+    sqe->user_data = index;
+    ring->sq_array[sqe_index] = sqe_index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    int result;
+    do {
+        result = (int) syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+    } while (result < 0 && errno == EINTR);
+    if (result == 1 || __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) != tail) {
+        // The kernel has taken the entry, its completion arrives as usual
+        return 1;
+    }
+    // Not taken, so it is removed and a later io_uring_enter doesn't submit it again
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+* Function: uring_reap
+* --------------------
+*  Waits for at least one completion and marks the finished slots as ready.
+*
+*  async_file: Pointer to the AsyncFile object
+*
+*  returns: If failed (0), On success (1)
+*/
+static int uring_reap(AsyncFile* async_file) {
+    UringQueue* ring = async_file->ring;
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        int result;
+        do {
+            result = (int) syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        } while (result < 0 && errno == EINTR);
+        if (result < 0) {
+            return 0;
+        }
+    }
+
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        AsyncSlot* slot = &async_file->slots[cqe->user_data];
+        slot->result = cqe->res < 0 ? -1 : cqe->res;
+        slot->state = SLOT_READY;
+        head++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return 1;
+}
+#endif
+
+/*
+* Function: transfer_all
+* ----------------------
+*  Reads or writes a whole slot with pread/pwrite, retrying short transfers.
+*
+*  async_file: Pointer to the AsyncFile object
+*  slot: Pointer to the slot
+*  done: Number of bytes that were already transferred
+*
+*  returns: Total transferred bytes. If failed, returns -1.
+*/
+static ssize_t transfer_all(AsyncFile* async_file, AsyncSlot* slot, size_t done) {
+    while (done < slot->size) {
+        ssize_t result;
+        if (async_file->mode == ASYNC_READ) {
+            result = pread(async_file->fd, slot->data + done, slot->size - done, slot->offset + done);
+        } else {
+            result = pwrite(async_file->fd, slot->data + done, slot->size - done, slot->offset + done);
+        }
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            return -1;
+        }
+        if (result == 0) {
+            break;
+        }
+        done += result;
+    }
+    return done;
+}
+
+/*
+* Function: helper_thread
+* -----------------------
+*  Processes the pending slots in submission order.
+*
+*  arg: Pointer to the AsyncFile object
+*/
+static void* helper_thread(void* arg) {
+    AsyncFile* async_file = arg;
+    pthread_mutex_lock(&async_file->lock);
+    while (1) {
+        AsyncSlot* slot = &async_file->slots[async_file->io_index];
+        if (slot->state == SLOT_PENDING) {
+            pthread_mutex_unlock(&async_file->lock);
+            ssize_t result = transfer_all(async_file, slot, 0);
+            pthread_mutex_lock(&async_file->lock);
+            slot->result = result;
+            slot->state = SLOT_READY;
+            async_file->io_index = (async_file->io_index + 1) % async_file->depth;
+            pthread_cond_broadcast(&async_file->cond);
+            continue;
+        }
+        if (async_file->stop) {
+            break;
+        }
+        pthread_cond_wait(&async_file->cond, &async_file->lock);
+    }
+    pthread_mutex_unlock(&async_file->lock);
+    return NULL;
+}
+
+/*
+* Function: submit_slot
+* ---------------------
+*  Hands a slot to the backend.
+*
+*  async_file: Pointer to the AsyncFile object
+*  index: Slot index
+*  offset: File offset of the request
+*  size: Number of bytes to transfer
+*
+*  returns: If failed (0), On success (1)
+*/
+static int submit_slot(AsyncFile* async_file, size_t index, off_t offset, size_t size) {
+    AsyncSlot* slot = &async_file->slots[index];
+    slot->offset = offset;
+    slot->size = size;
+    slot->result = 0;
+#ifdef HAVE_IO_URING
+    if (async_file->backend == ASYNC_BACKEND_URING) {
+        slot->state = SLOT_PENDING;
+        if (uring_submit(async_file, index) == 0) {
+            // The request never reached the kernel, do it synchronously
+            slot->result = transfer_all(async_file, slot, 0);
+            slot->state = SLOT_READY;
+        }
+        return 1;
+    }
+#endif
+    pthread_mutex_lock(&async_file->lock);
+    slot->state = SLOT_PENDING;
+    pthread_cond_broadcast(&async_file->cond);
+    pthread_mutex_unlock(&async_file->lock);
+    return 1;
+}
+
+/*
+* Function: wait_slot
+* -------------------
+*  Waits until the backend has finished the slot's request and completes
+*  short transfers synchronously.
+*
+*  async_file: Pointer to the AsyncFile object
+*  slot: Pointer to the slot
+*
+*  returns: If failed (0), On success (1)
+*/
+static int wait_slot(AsyncFile* async_file, AsyncSlot* slot) {
+#ifdef HAVE_IO_URING
+    if (async_file->backend == ASYNC_BACKEND_URING) {
+        while (slot->state == SLOT_PENDING) {
+            if (uring_reap(async_file) == 0) {
+                return 0;
+            }
+        }
+        if (slot->result >= 0 && (size_t) slot->result < slot->size) {
+            slot->result = transfer_all(async_file, slot, slot->result);
+        }
+        return slot->result >= 0;
+    }
+#endif
+    pthread_mutex_lock(&async_file->lock);
+    while (slot->state == SLOT_PENDING) {
+        pthread_cond_wait(&async_file->cond, &async_file->lock);
+    }
+    pthread_mutex_unlock(&async_file->lock);
+    return slot->result >= 0;
+}
+
+/*
+* Function: free_async_file
+* -------------------------
+*  Stops the backend and frees the AsyncFile object.
+*
+*  async_file: Pointer to the AsyncFile object
+*/
+static void free_async_file(AsyncFile* async_file) {
+    if (async_file->backend == ASYNC_BACKEND_THREAD) {
+        pthread_mutex_lock(&async_file->lock);
+        async_file->stop = 1;
+        pthread_cond_broadcast(&async_file->cond);
+        pthread_mutex_unlock(&async_file->lock);
+        pthread_join(async_file->thread, NULL);
+        pthread_mutex_destroy(&async_file->lock);
+        pthread_cond_destroy(&async_file->cond);
+    }
+#ifdef HAVE_IO_URING
+    if (async_file->backend == ASYNC_BACKEND_URING) {
+        // Buffers can't be released while the kernel may still write to them
+        for (size_t i = 0; i < async_file->depth; i++) {
+            while (async_file->slots[i].state == SLOT_PENDING && uring_reap(async_file)) {}
+        }
+        uring_free(async_file->ring);
+    }
+#endif
+    for (size_t i = 0; i < async_file->depth; i++) {
+        free(async_file->slots[i].data);
+    }
+    free(async_file->slots);
+    free(async_file);
+}
+
+/*
+* Function: async_open
+* --------------------
+*  Creates an asynchronous reader or writer on top of a file. The file's
+*  current position is used as the starting offset. Uses io_uring when the
+*  kernel supports it, otherwise falls back to a helper thread.
+*
+*  file: Pointer to the file object
+*  mode: ASYNC_READ or ASYNC_WRITE
+*
+*  returns: An AsyncFile object. If failed, returns NULL.
+*/
+AsyncFile* async_open(FILE* file, int mode) {
+    if (file == NULL) {
+        fprintf(stderr, "\n[ERROR]: async_open() {} -> File does not exist!\n");
+        return NULL;
+    }
+    // Positional I/O only makes sense for regular files (not pipes or terminals)
+    struct stat file_stat;
+    int fd = fileno(file);
+    if (fd < 0 || fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+        return NULL;
+    }
+    if (mode == ASYNC_WRITE && fflush(file) != 0) {
+        return NULL;
+    }
+    off_t position = ftello(file);
+    if (position < 0) {
+        return NULL;
+    }
+
+    AsyncFile* async_file = calloc(1, sizeof(AsyncFile));
+    if (async_file == NULL) {
+        fprintf(stderr, "\n[ERROR]: async_open() {} -> Unable to allocate memory for async_file!\n");
+        return NULL;
+    }
+    async_file->file = file;
+    async_file->fd = fd;
+    async_file->mode = mode;
+    async_file->depth = ASYNC_QUEUE_DEPTH;
+    async_file->position = position;
+    async_file->next_offset = position;
+    async_file->end_offset = mode == ASYNC_READ ? file_stat.st_size : position;
+
+    async_file->slots = calloc(async_file->depth, sizeof(AsyncSlot));
+    if (async_file->slots == NULL) {
+        fprintf(stderr, "\n[ERROR]: async_open() {} -> Unable to allocate memory for async_file->slots!\n");
+        free(async_file);
+        return NULL;
+    }
+    for (size_t i = 0; i < async_file->depth; i++) {
+        async_file->slots[i].data = malloc(ASYNC_BUFFER_SIZE);
+        if (async_file->slots[i].data == NULL) {
+            fprintf(stderr, "\n[ERROR]: async_open() {} -> Unable to allocate memory for slot buffers!\n");
+            for (size_t j = 0; j < i; j++) free(async_file->slots[j].data);
+            free(async_file->slots);
+            free(async_file);
+            return NULL;
+        }
+    }
+
+#ifdef HAVE_IO_URING
+    async_file->ring = uring_init(async_file->depth);
+    if (async_file->ring != NULL) {
+        async_file->backend = ASYNC_BACKEND_URING;
+    }
+#endif
+    if (async_file->backend == 0) {
+        pthread_mutex_init(&async_file->lock, NULL);
+        pthread_cond_init(&async_file->cond, NULL);
+        if (pthread_create(&async_file->thread, NULL, helper_thread, async_file) != 0) {
+            pthread_mutex_destroy(&async_file->lock);
+            pthread_cond_destroy(&async_file->cond);
+            for (size_t i = 0; i < async_file->depth; i++) free(async_file->slots[i].data);
+            free(async_file->slots);
+            free(async_file);
+            return NULL;
+        }
+        async_file->backend = ASYNC_BACKEND_THREAD;
+    }
+
+    // Readers start filling every slot right away
+    if (mode == ASYNC_READ) {
+        for (size_t i = 0; i < async_file->depth && async_file->next_offset < async_file->end_offset; i++) {
+            off_t remaining = async_file->end_offset - async_file->next_offset;
+            size_t size = remaining < ASYNC_BUFFER_SIZE ? (size_t) remaining : ASYNC_BUFFER_SIZE;
+            submit_slot(async_file, i, async_file->next_offset, size);
+            async_file->next_offset += size;
+        }
+    }
+    return async_file;
+}
+
+/*
+* Function: async_read
+* --------------------
+*  Copies the next bytes of the file into the buffer. Later parts of the
+*  file are already being read in the background.
+*
+*  async_file: AsyncFile object opened with ASYNC_READ
+*  buffer: Destination buffer
+*  size: Maximum number of bytes to copy
+*
+*  returns: Number of copied bytes (0 at the end of file). If failed, returns -1.
+*/
+ssize_t async_read(AsyncFile* async_file, void* buffer, size_t size) {
+    if (async_file == NULL || async_file->mode != ASYNC_READ || async_file->error) {
+        return -1;
+    }
+    size_t copied = 0;
+    while (copied < size) {
+        AsyncSlot* slot = &async_file->slots[async_file->current];
+        // Nothing was submitted for this slot, so we reached the end of file
+        if (slot->state == SLOT_FREE) {
+            break;
+        }
+        if (wait_slot(async_file, slot) == 0) {
+            fprintf(stderr, "\n[ERROR]: async_read() {} -> Unable to read from the file!\n");
+            async_file->error = 1;
+            return -1;
+        }
+
+        size_t available = slot->result - async_file->current_pos;
+        size_t count = size - copied < available ? size - copied : available;
+        memcpy((unsigned char*) buffer + copied, slot->data + async_file->current_pos, count);
+        copied += count;
+        async_file->current_pos += count;
+        async_file->position += count;
+
+        // Recycle the slot for the next part of the file
+        if (async_file->current_pos >= (size_t) slot->result) {
+            slot->state = SLOT_FREE;
+            if (slot->result > 0 && async_file->next_offset < async_file->end_offset) {
+                off_t remaining = async_file->end_offset - async_file->next_offset;
+                size_t next_size = remaining < ASYNC_BUFFER_SIZE ? (size_t) remaining : ASYNC_BUFFER_SIZE;
+                submit_slot(async_file, async_file->current, async_file->next_offset, next_size);
+                async_file->next_offset += next_size;
+            }
+            async_file->current = (async_file->current + 1) % async_file->depth;
+            async_file->current_pos = 0;
+        }
+    }
+    return copied;
+}
+
+/*
+* Function: async_write
+* ---------------------
+*  Queues the bytes to be written to the file. Full slots are submitted
+*  to the backend while the caller keeps working.
+*
+*  async_file: AsyncFile object opened with ASYNC_WRITE
+*  buffer: Source buffer
+*  size: Number of bytes
+*
+*  returns: Number of queued bytes. If failed, returns -1.
+*/
+ssize_t async_write(AsyncFile* async_file, const void* buffer, size_t size) {
+    if (async_file == NULL || async_file->mode != ASYNC_WRITE || async_file->error) {
+        return -1;
+    }
+    size_t copied = 0;
+    while (copied < size) {
+        AsyncSlot* slot = &async_file->slots[async_file->current];
+        // Wait for the previous request of this slot before reusing it
+        if (async_file->current_pos == 0 && slot->state != SLOT_FREE) {
+            if (wait_slot(async_file, slot) == 0 || (size_t) slot->result < slot->size) {
+                fprintf(stderr, "\n[ERROR]: async_write() {} -> Unable to write to the file!\n");
+                async_file->error = 1;
+                return -1;
+            }
+            slot->state = SLOT_FREE;
+        }
+
+        size_t space = ASYNC_BUFFER_SIZE - async_file->current_pos;
+        size_t count = size - copied < space ? size - copied : space;
+        memcpy(slot->data + async_file->current_pos, (const unsigned char*) buffer + copied, count);
+        copied += count;
+        async_file->current_pos += count;
+        async_file->position += count;
+
+        if (async_file->current_pos == ASYNC_BUFFER_SIZE) {
+            submit_slot(async_file, async_file->current, async_file->next_offset, ASYNC_BUFFER_SIZE);
+            async_file->next_offset += ASYNC_BUFFER_SIZE;
+            async_file->current = (async_file->current + 1) % async_file->depth;
+            async_file->current_pos = 0;
+        }
+    }
+    return copied;
+}
+
+/*
+* Function: async_close
+* ---------------------
+*  Waits for all requests in flight, moves the file position to the end
+*  of the processed data and frees the object.
+*
+*  async_file: AsyncFile object
+*
+*  returns: If failed (0), On success (1)
+*/
+int async_close(AsyncFile* async_file) {
+    if (async_file == NULL) {
+        return 0;
+    }
+    int result = !async_file->error;
+
+    if (async_file->mode == ASYNC_WRITE) {
+        if (result && async_file->current_pos > 0) {
+            submit_slot(async_file, async_file->current, async_file->next_offset, async_file->current_pos);
+            async_file->next_offset += async_file->current_pos;
+        }
+        for (size_t i = 0; i < async_file->depth; i++) {
+            AsyncSlot* slot = &async_file->slots[i];
+            if (slot->state == SLOT_FREE) {
+                continue;
+            }
+            if (wait_slot(async_file, slot) == 0 || (size_t) slot->result < slot->size) {
+                fprintf(stderr, "\n[ERROR]: async_close() {} -> Unable to write to the file!\n");
+                result = 0;
+            }
+        }
+    }
+
+    // Continue with the buffered stdio functions where we stopped
+    if (fseeko(async_file->file, async_file->position, SEEK_SET) != 0) {
+        result = 0;
+    }
+    free_async_file(async_file);
+    return result;
+}
@@ -0,0 +1,802 @@
+#include "../include/batch.h"
+#include "../include/compact.h"
+#include "../include/constants.h"
+#include "../include/compressor.h"
+#include "../include/decodetable.h"
+#include "../include/dictionary.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/stored.h"
+#include "../include/threadpool.h"
+#include "../include/utils.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define LIST_LINE_SIZE 4096
+
+typedef struct {
+    const char* input_path;
+    Dictionary* dictionary;
+    size_t sample_size; // Fast stats of the compressed files (see sample_frequencies)
+    int verify; // Check the checksums of the decompressed and tested files (-V)
+    int mode;
+    int result;
+    uint64_t input_size;
+    uint64_t output_size;
+    double time_spent;
+} BatchJob;
+
+/*
+* Function: has_huf_extension
+* ---------------------------
+*  Checks if the path ends with '.huf'
+*
+*  path: File path
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+static int has_huf_extension(const char* path) {
+    size_t length = strlen(path);
+    return length > 4 && strcasecmp(path + length - 4, ".huf") == 0;
+}
+
+/*
+* Function: append_path
+* ---------------------
+*  Appends a copy of the path to the list.
+*
+*  list: Pointer to the PathList object
+*  path: File path
+*
+*  returns: If failed (0), On success (1)
+*/
+static int append_path(PathList* list, const char* path) {
+    if (list->count >= list->capacity) {
+        size_t new_capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        char** new_paths = realloc(list->paths, new_capacity * sizeof(char*));
+        if (new_paths == NULL) {
+            err("append_path", "Unable to allocate memory for the path list!");
+            return 0;
+        }
+        list->paths = new_paths;
+        list->capacity = new_capacity;
+    }
+    char* copy = malloc(strlen(path) + 1);
+    if (copy == NULL) {
+        err("append_path", "Unable to allocate memory for the path!");
+        return 0;
+    }
+    strcpy(copy, path);
+    list->paths[list->count++] = copy;
+    return 1;
+}
+
+/*
+* Function: add_directory
+* -----------------------
+*  Walks a directory recursively and adds the matching regular files.
+*
+*  list: Pointer to the PathList object
+*  path: Directory path
+*  mode: BATCH_COMPRESS, BATCH_DECOMPRESS or BATCH_TEST
+*
+*  returns: If failed (0), On success (1)
+*/
+static int add_directory(PathList* list, const char* path, int mode) {
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        fprintf(stderr, "\n[ERROR]: add_directory() {} -> Unable to open '%s'!\n", path);
+        return 0;
+    }
+    int result = 1;
+    size_t path_length = strlen(path);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char* child = malloc(path_length + strlen(entry->d_name) + 2);
+        if (child == NULL) {
+            err("add_directory", "Unable to allocate memory for the path!");
+            result = 0;
+            break;
+        }
+        int has_slash = path_length > 0 && path[path_length - 1] == '/';
+        sprintf(child, has_slash ? "%s%s" : "%s/%s", path, entry->d_name);
+
+        struct stat child_stat;
+        if (stat(child, &child_stat) == 0) {
+            if (S_ISDIR(child_stat.st_mode)) {
+                result = add_directory(list, child, mode) && result;
+            } else if (S_ISREG(child_stat.st_mode) && has_huf_extension(child) == (mode != BATCH_COMPRESS)) {
+                result = append_path(list, child) && result;
+            }
+        }
+        free(child);
+    }
+    closedir(dir);
+    return result;
+}
+
+/*
+* Function: path_list_add
+* -----------------------
+*  Adds a file to the list. Directories are walked recursively; while
+*  compressing '.huf' files are skipped, while decompressing or testing
+*  only '.huf' files are added.
+*
+*  list: Pointer to the PathList object
+*  path: File or directory path
+*  mode: BATCH_COMPRESS, BATCH_DECOMPRESS or BATCH_TEST
+*
+*  returns: If failed (0), On success (1)
+*/
+int path_list_add(PathList* list, const char* path, int mode) {
+    struct stat path_stat;
+    if (stat(path, &path_stat) == 0 && S_ISDIR(path_stat.st_mode)) {
+        return add_directory(list, path, mode);
+    }
+    // Missing files are reported as failures in the summary
+    return append_path(list, path);
+}
+
+/*
+* Function: path_list_read
+* ------------------------
+*  Adds every path of a file list (one path per line) to the list.
+*
+*  list: Pointer to the PathList object
+*  list_file: Pointer to the file containing the paths (e.g. stdin)
+*  mode: BATCH_COMPRESS, BATCH_DECOMPRESS or BATCH_TEST
+*
+*  returns: If failed (0), On success (1)
+*/
+int path_list_read(PathList* list, FILE* list_file, int mode) {
+    char line[LIST_LINE_SIZE];
+    int result = 1;
+    while (fgets(line, sizeof(line), list_file) != NULL) {
+        size_t length = strcspn(line, "\r\n");
+        line[length] = '\0';
+        if (length == 0) {
+            continue;
+        }
+        result = path_list_add(list, line, mode) && result;
+    }
+    return result;
+}
+
+/*
+* Function: path_list_free
+* ------------------------
+*  Frees the paths of the list.
+*
+*  list: Pointer to the PathList object
+*/
+void path_list_free(PathList* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    list->paths = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+/*
+* Function: make_output_path
+* --------------------------
+*  Returns the output path of a batch job.
+*
+*  input_path: Input file path
+*  mode: BATCH_COMPRESS or BATCH_DECOMPRESS
+*
+*  returns: Allocated output path. If failed, returns NULL.
+*/
+static char* make_output_path(const char* input_path, int mode) {
+    size_t length = strlen(input_path);
+    char* output_path = malloc(length + strlen(".huf") + 1);
+    if (output_path == NULL) {
+        return NULL;
+    }
+    if (mode == BATCH_COMPRESS) {
+        sprintf(output_path, "%s.huf", input_path);
+    } else {
+        strncpy(output_path, input_path, length - strlen(".huf"));
+        output_path[length - strlen(".huf")] = '\0';
+    }
+    return output_path;
+}
+
+/*
+* Function: test_task
+* -------------------
+*  Decodes one file without writing the output (checksums are checked if
+*  the file has them).
+*
+*  context: Worker's HuffContext
+*  job: Pointer to the BatchJob
+*/
+static void test_task(HuffContext* context, BatchJob* job) {
+    FILE* input_file = open_file(job->input_path, "rb");
+    if (input_file == NULL) {
+        return;
+    }
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    job->input_size = get_file_size(input_file);
+    if (job->dictionary != NULL && is_dictionary_stream(input_file)) {
+        job->result = decompress_with_dictionary(job->dictionary, context->bit_reader, input_file, NULL);
+    } else {
+        context->verify = job->verify;
+        job->result = decompress_with_context(context, input_file, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    job->time_spent = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    fclose(input_file);
+}
+
+/*
+* Function: batch_task
+* --------------------
+*  Compresses, decompresses or tests one file with the worker's context.
+*
+*  context: Worker's HuffContext
+*  arg: Pointer to the BatchJob
+*/
+static void batch_task(void* context, void* arg) {
+    BatchJob* job = arg;
+    job->result = 0;
+    if (context == NULL) {
+        return;
+    }
+    if (job->mode == BATCH_TEST) {
+        test_task(context, job);
+        return;
+    }
+    if (job->mode == BATCH_DECOMPRESS && !has_huf_extension(job->input_path)) {
+        fprintf(stderr, "\n[ERROR]: batch_task() {} -> '%s' is not a .huf file!\n", job->input_path);
+        return;
+    }
+    char* output_path = make_output_path(job->input_path, job->mode);
+    if (output_path == NULL) {
+        err("batch_task", "Unable to allocate memory for output file name!");
+        return;
+    }
+
+    FILE* input_file = open_file(job->input_path, "rb");
+    FILE* output_file = input_file != NULL ? open_file(output_path, "wb") : NULL;
+    if (input_file == NULL || output_file == NULL) {
+        if (input_file != NULL) fclose(input_file);
+        free(output_path);
+        return;
+    }
+
+    job->input_size = get_file_size(input_file);
+    HuffContext* huff_context = context;
+    if (job->mode == BATCH_COMPRESS && job->dictionary != NULL) {
+        job->result = compress_with_dictionary(job->dictionary, huff_context->bit_writer, input_file, output_file);
+    } else if (job->mode == BATCH_COMPRESS) {
+        huff_context->sample_size = job->sample_size;
+        job->result = compress_with_context(huff_context, input_file, output_file);
+    } else if (job->dictionary != NULL && is_dictionary_stream(input_file)) {
+        job->result = decompress_with_dictionary(job->dictionary, huff_context->bit_reader, input_file, output_file);
+    } else {
+        huff_context->verify = job->verify;
+        job->result = decompress_with_context(huff_context, input_file, output_file);
+    }
+    job->output_size = ftello(output_file);
+    fclose(input_file);
+    if (fclose(output_file) != 0) {
+        job->result = 0;
+    }
+    if (!job->result) {
+        remove(output_path);
+    }
+    free(output_path);
+}
+
+/*
+* Function: create_worker_context
+* -------------------------------
+*  Thread pool adapter for create_context()
+*/
+static void* create_worker_context(void) {
+    return create_context();
+}
+
+/*
+* Function: free_worker_context
+* -----------------------------
+*  Thread pool adapter for free_context()
+*/
+static void free_worker_context(void* context) {
+    free_context(context);
+}
+
+/*
+* Function: run_batch
+* -------------------
+*  Compresses, decompresses or tests every file of the list on a thread
+*  pool and prints a summary. Outputs are written next to the inputs
+*  ('.huf' is added while compressing and removed while decompressing),
+*  tested files are only decoded.
+*
+*  list: Pointer to the PathList object
+*  mode: BATCH_COMPRESS, BATCH_DECOMPRESS or BATCH_TEST
+*  thread_count: Number of worker threads (0 uses the number of online CPUs)
+*  sample_size: Bytes sampled for the table of large inputs, 0 counts every
+*               byte (see sample_frequencies)
+*  verify: Check the checksums of seekable files, files without them fail
+*  dictionary: Trained table shared by every file (Can be NULL)
+*
+*  returns: Number of failed files
+*/
+size_t run_batch(PathList* list, int mode, size_t thread_count, size_t sample_size, int verify, Dictionary* dictionary) {
+    if (list->count == 0) {
+        err("run_batch", "No input files!");
+        return 0;
+    }
+    BatchJob* jobs = calloc(list->count, sizeof(BatchJob));
+    if (jobs == NULL) {
+        err("run_batch", "Unable to allocate memory for the jobs!");
+        return list->count;
+    }
+
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    // Progress lines of many files at the same time are not readable
+    set_log_mode(0);
+    ThreadPool* pool = pool_create(thread_count, create_worker_context, free_worker_context);
+    if (pool == NULL) {
+        set_log_mode(1);
+        free(jobs);
+        return list->count;
+    }
+    for (size_t i = 0; i < list->count; i++) {
+        jobs[i].input_path = list->paths[i];
+        jobs[i].mode = mode;
+        jobs[i].dictionary = dictionary;
+        jobs[i].sample_size = sample_size;
+        jobs[i].verify = verify;
+        pool_submit(pool, batch_task, &jobs[i]);
+    }
+    pool_wait(pool);
+    size_t workers = pool->thread_count;
+    pool_free(pool);
+    set_log_mode(1);
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double time_spent = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+
+    size_t failed = 0;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        if (!jobs[i].result) {
+            failed++;
+            continue;
+        }
+        input_bytes += jobs[i].input_size;
+        output_bytes += jobs[i].output_size;
+    }
+
+    const char* mode_name = mode == BATCH_COMPRESS ? "compression" : mode == BATCH_DECOMPRESS ? "decompression" : "test";
+    printf("\n--->> Batch %s: %zu files, %zu succeeded, %zu failed (%zu threads)\n",
+           mode_name, list->count, list->count - failed, failed, workers);
+    if (mode == BATCH_TEST) {
+        printf("      %" PRIu64 " bytes in %f s (%.2f MB/s)\n", input_bytes, time_spent,
+               time_spent > 0 ? input_bytes / time_spent / (KB * KB) : 0);
+    } else {
+        printf("      %" PRIu64 " bytes -> %" PRIu64 " bytes (%.2f%%) in %f s (%.2f MB/s)\n", input_bytes, output_bytes,
+               input_bytes > 0 ? (double) output_bytes / input_bytes * 100 : 0, time_spent,
+               time_spent > 0 ? input_bytes / time_spent / (KB * KB) : 0);
+    }
+    for (size_t i = 0; i < list->count; i++) {
+        if (!jobs[i].result) {
+            printf("      [FAILED]: %s\n", jobs[i].input_path);
+        } else if (mode == BATCH_TEST) {
+            printf("      [PASSED]: %s (%" PRIu64 " bytes, %.2f MB/s)\n", jobs[i].input_path, jobs[i].input_size,
+                   jobs[i].time_spent > 0 ? jobs[i].input_size / jobs[i].time_spent / (KB * KB) : 0);
+        }
+    }
+
+    free(jobs);
+    return failed;
+}
+
+/*
+* Function: store_message
+* -----------------------
+*  Stores a message in a stored container.
+*
+*  input: Pointer to the BatchInput
+*  output: Pointer to the BatchOutput (its buffer has room for the container)
+*/
+static void store_message(const BatchInput* input, BatchOutput* output) {
+    size_t header_size = write_stored_header(input->size, output->data);
+    if (input->size > 0) {
+        memcpy(output->data + header_size, input->data, input->size);
+    }
+    output->size = header_size + input->size;
+}
+
+/*
+* Function: compress_message
+* --------------------------
+*  Compresses a message with its own compact table, or stores it if the
+*  table and the codes would be larger.
+*
+*  input: Pointer to the BatchInput
+*  output: Pointer to the BatchOutput (its buffer has room for the container)
+*  frequency_table: Scratch frequency table
+*  code_table: Scratch code table
+*
+*  returns: If failed (0), On success (1)
+*/
+static int compress_message(const BatchInput* input, BatchOutput* output, size_t* frequency_table, Code* code_table) {
+    memset(frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    for (size_t i = 0; i < input->size; i++) {
+        frequency_table[input->data[i]]++;
+    }
+    uint8_t lengths[FREQUENCY_TABLE_SIZE];
+    if (compute_code_lengths(frequency_table, lengths, COMPACT_MAX_CODE_LENGTH) == 0) {
+        return 0;
+    }
+    uint64_t total_bits = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        total_bits += frequency_table[i] * lengths[i];
+    }
+
+    unsigned char header[COMPACT_MAX_HEADER_SIZE];
+    size_t header_size = write_compact_header(lengths, total_bits, header);
+    if (header_size + (total_bits + 7) / 8 > STORED_HEADER_SIZE + input->size) {
+        store_message(input, output);
+        return 1;
+    }
+    assign_canonical_codes(lengths, code_table);
+    memcpy(output->data, header, header_size);
+    output->size = header_size + encode_buffer(code_table, input->data, input->size, output->data + header_size);
+    return 1;
+}
+
+/*
+* Function: compress_shared_message
+* ---------------------------------
+*  Compresses a message with a shared table, or stores it if the codes
+*  would be larger.
+*
+*  input: Pointer to the BatchInput
+*  output: Pointer to the BatchOutput (its buffer has room for the container)
+*  dictionary: Pointer to the shared table
+*/
+static void compress_shared_message(const BatchInput* input, BatchOutput* output, const Dictionary* dictionary) {
+    uint64_t total_bits = 0;
+    for (size_t i = 0; i < input->size; i++) {
+        total_bits += dictionary->code_table[input->data[i]].length;
+    }
+    unsigned char header[DICTIONARY_STREAM_MAX_HEADER_SIZE];
+    size_t header_size = write_stream_header(dictionary, input->size, header);
+    if (header_size + (total_bits + 7) / 8 > STORED_HEADER_SIZE + input->size) {
+        store_message(input, output);
+        return;
+    }
+    memcpy(output->data, header, header_size);
+    output->size = header_size + encode_buffer(dictionary->code_table, input->data, input->size, output->data + header_size);
+}
+
+typedef struct {
+    const BatchInput* inputs;
+    BatchOutput* outputs;
+    size_t count;
+    const Dictionary* dictionary; // Shared table (NULL while counting, or for own tables)
+    int counting; // Only counts the frequencies of the messages
+    size_t frequency_table[FREQUENCY_TABLE_SIZE];
+    int result;
+} BatchChunk;
+
+/*
+* Function: chunk_task
+* --------------------
+*  Counts the frequencies of the messages of a chunk, or compresses them.
+*
+*  context: Unused (the scratch tables are on the stack)
+*  arg: Pointer to the BatchChunk
+*/
+static void chunk_task(void* context, void* arg) {
+    (void) context;
+    BatchChunk* chunk = arg;
+    chunk->result = 1;
+    if (chunk->counting) {
+        memset(chunk->frequency_table, 0, sizeof(chunk->frequency_table));
+        for (size_t i = 0; i < chunk->count; i++) {
+            for (size_t j = 0; j < chunk->inputs[i].size; j++) {
+                chunk->frequency_table[chunk->inputs[i].data[j]]++;
+            }
+        }
+        return;
+    }
+    size_t frequency_table[FREQUENCY_TABLE_SIZE];
+    Code code_table[FREQUENCY_TABLE_SIZE];
+    for (size_t i = 0; i < chunk->count && chunk->result; i++) {
+        if (chunk->dictionary != NULL) {
+            compress_shared_message(&chunk->inputs[i], &chunk->outputs[i], chunk->dictionary);
+        } else {
+            chunk->result = compress_message(&chunk->inputs[i], &chunk->outputs[i], frequency_table, code_table);
+        }
+    }
+}
+
+/*
+* Function: run_chunks
+* --------------------
+*  Runs every chunk, on a thread pool if there are more than one.
+*
+*  chunks: Pointer to the chunks
+*  chunk_count: Number of chunks
+*  pool: Pointer to the pool (NULL runs the chunks on the calling thread)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int run_chunks(BatchChunk* chunks, size_t chunk_count, ThreadPool* pool) {
+    for (size_t i = 0; i < chunk_count; i++) {
+        if (pool == NULL) {
+            chunk_task(NULL, &chunks[i]);
+        } else if (pool_submit(pool, chunk_task, &chunks[i]) == 0) {
+            chunk_task(NULL, &chunks[i]);
+        }
+    }
+    if (pool != NULL) {
+        pool_wait(pool);
+    }
+    for (size_t i = 0; i < chunk_count; i++) {
+        if (!chunks[i].result) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: huff_compress_batch
+* -----------------------------
+*  Compresses many small in-memory messages in one call. Every output is a
+*  complete stream that decompress reads: a compact stream with its own
+*  table, a stream of a shared table or a stored container if coding
+*  doesn't pay off. The messages are split in chunks of BATCH_CHUNK_MESSAGES
+*  that run on a thread pool; a chunk reuses one stack scratch table for
+*  all its messages and counts, builds the codes of and encodes each
+*  message right after the other, while it is still in the cache. No
+*  memory is allocated per message.
+*
+*  inputs: Messages to compress
+*  count: Number of messages
+*  outputs: Filled with the compressed messages (count entries)
+*  thread_count: Number of worker threads (0 uses the number of online CPUs)
+*  dictionary: NULL gives every message its own table. If it points to a
+*              table, the messages are encoded with it; if it points to
+*              NULL, a table is built from the frequencies of the whole
+*              batch and stored there (save it with save_dictionary so the
+*              messages can be decompressed, and free it with free_dictionary).
+*
+*  returns: Buffer holding every output (free it once with free). If failed, returns NULL.
+*/
+unsigned char* huff_compress_batch(const BatchInput* inputs, size_t count, BatchOutput* outputs, size_t thread_count,
+                                   Dictionary** dictionary) {
+    if (inputs == NULL || outputs == NULL || count == 0) {
+        err("huff_compress_batch", "No input messages!");
+        return NULL;
+    }
+    // A stored container is the largest output, so every message gets room for one
+    size_t buffer_size = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (inputs[i].data == NULL && inputs[i].size > 0) {
+            err("huff_compress_batch", "Message data is NULL!");
+            return NULL;
+        }
+        buffer_size += STORED_HEADER_SIZE + inputs[i].size;
+    }
+    size_t chunk_count = (count + BATCH_CHUNK_MESSAGES - 1) / BATCH_CHUNK_MESSAGES;
+    unsigned char* buffer = malloc(buffer_size);
+    BatchChunk* chunks = calloc(chunk_count, sizeof(BatchChunk));
+    if (buffer == NULL || chunks == NULL) {
+        err("huff_compress_batch", "Unable to allocate memory for the outputs!");
+        free(buffer);
+        free(chunks);
+        return NULL;
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        outputs[i].data = buffer + offset;
+        outputs[i].size = 0;
+        offset += STORED_HEADER_SIZE + inputs[i].size;
+    }
+    for (size_t i = 0; i < chunk_count; i++) {
+        chunks[i].inputs = inputs + i * BATCH_CHUNK_MESSAGES;
+        chunks[i].outputs = outputs + i * BATCH_CHUNK_MESSAGES;
+        chunks[i].count = i + 1 < chunk_count ? BATCH_CHUNK_MESSAGES : count - i * BATCH_CHUNK_MESSAGES;
+    }
+
+    // Starting threads costs more than a single chunk
+    ThreadPool* pool = chunk_count > 1 && thread_count != 1 ? pool_create(thread_count, NULL, NULL) : NULL;
+    int result = 1;
+    if (dictionary != NULL && *dictionary == NULL) {
+        // Every symbol gets a code, so the table can be reused for later batches
+        size_t frequency_table[FREQUENCY_TABLE_SIZE];
+        for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            frequency_table[i] = 1;
+        }
+        for (size_t i = 0; i < chunk_count; i++) {
+            chunks[i].counting = 1;
+        }
+        run_chunks(chunks, chunk_count, pool);
+        for (size_t i = 0; i < chunk_count; i++) {
+            for (size_t j = 0; j < FREQUENCY_TABLE_SIZE; j++) {
+                frequency_table[j] += chunks[i].frequency_table[j];
+            }
+            chunks[i].counting = 0;
+        }
+        *dictionary = create_dictionary(frequency_table);
+        result = *dictionary != NULL;
+    }
+    if (result) {
+        for (size_t i = 0; i < chunk_count; i++) {
+            chunks[i].dictionary = dictionary != NULL ? *dictionary : NULL;
+        }
+        result = run_chunks(chunks, chunk_count, pool);
+    }
+    if (pool != NULL) {
+        pool_free(pool);
+    }
+    free(chunks);
+    if (!result) {
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+/*
+* Function: decode_compact_message
+* --------------------------------
+*  Decodes a message with its own compact table. The tree is walked bit by
+*  bit since the number of symbols isn't stored, only the padding bits.
+*
+*  data: Compressed message
+*  size: Number of bytes in the message
+*  output_size: Pointer to store the number of decompressed bytes
+*
+*  returns: Decompressed message. If failed, returns NULL.
+*/
+static unsigned char* decode_compact_message(const unsigned char* data, size_t size, size_t* output_size) {
+    uint8_t lengths[FREQUENCY_TABLE_SIZE];
+    unsigned char flags = 0;
+    size_t header_size = read_compact_header(data, size, lengths, &flags);
+    if (header_size == 0) {
+        return NULL;
+    }
+    int min_length = COMPACT_MAX_CODE_LENGTH;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (lengths[i] > 0 && lengths[i] < min_length) {
+            min_length = lengths[i];
+        }
+    }
+    const unsigned char* encoded = data + header_size;
+    uint64_t total_bits = get_total_bits(size - header_size, flags & COMPACT_PADDING_MASK);
+    // Every symbol takes at least min_length bits (1 byte for an empty message)
+    unsigned char* output = malloc(total_bits / min_length + 1);
+    if (output == NULL) {
+        err("huff_decompress_message", "Unable to allocate memory for the output!");
+        return NULL;
+    }
+    *output_size = 0;
+    if (total_bits == 0) {
+        return output;
+    }
+
+    Code code_table[FREQUENCY_TABLE_SIZE];
+    assign_canonical_codes(lengths, code_table);
+    Node* root = build_code_tree(code_table);
+    if (root == NULL) {
+        free(output);
+        return NULL;
+    }
+    // A tree with a single symbol has no branches, every bit is one symbol
+    int has_branches = root->l_node != NULL || root->r_node != NULL;
+    Node* current = root;
+    for (uint64_t position = 0; position < total_bits && current != NULL; position++) {
+        if (has_branches) {
+            current = (encoded[position / 8] >> (7 - position % 8)) & 1 ? current->r_node : current->l_node;
+        }
+        if (current != NULL && current->l_node == NULL && current->r_node == NULL) {
+            output[(*output_size)++] = current->symbol;
+            current = root;
+        }
+    }
+    free_tree(root);
+    if (current != root) {
+        err("huff_decompress_message", "Encoded data is corrupted!");
+        free(output);
+        return NULL;
+    }
+    return output;
+}
+
+/*
+* Function: huff_decompress_message
+* ---------------------------------
+*  Decompresses one message returned by huff_compress_batch in memory. The
+*  shared table is given directly instead of being loaded by its ID, so a
+*  table built by huff_compress_batch can be used without saving it.
+*
+*  data: Compressed message
+*  size: Number of bytes in the message
+*  dictionary: Table the message was compressed with (Can be NULL for
+*              messages with their own table or stored messages)
+*  output_size: Pointer to store the number of decompressed bytes
+*
+*  returns: Decompressed message (free it with free). If failed, returns NULL.
+*/
+unsigned char* huff_decompress_message(const unsigned char* data, size_t size, const Dictionary* dictionary,
+                                       size_t* output_size) {
+    if (data == NULL || output_size == NULL) {
+        err("huff_decompress_message", "Message is NULL!");
+        return NULL;
+    }
+    if (size >= sizeof(compact_magic) && memcmp(data, compact_magic, sizeof(compact_magic)) == 0) {
+        return decode_compact_message(data, size, output_size);
+    }
+
+    uint64_t original_size = 0;
+    size_t header_size = 0;
+    int is_stream = size >= sizeof(dictionary_stream_magic)
+                    && memcmp(data, dictionary_stream_magic, sizeof(dictionary_stream_magic)) == 0;
+    if (is_stream) {
+        uint32_t id = 0;
+        header_size = read_stream_header(data, size, &id, &original_size);
+        if (header_size == 0) {
+            return NULL;
+        }
+        if (dictionary == NULL || dictionary->id != id) {
+            fprintf(stderr, "\n[ERROR]: huff_decompress_message() {} -> Message needs table %08x!\n", (unsigned) id);
+            return NULL;
+        }
+    } else {
+        if (!read_stored_header(data, size, &original_size)) {
+            return NULL;
+        }
+        header_size = STORED_HEADER_SIZE;
+        if (original_size != size - header_size) {
+            err("huff_decompress_message", "Data is truncated!");
+            return NULL;
+        }
+    }
+    // Every symbol takes at least one bit
+    if (is_stream && original_size > (uint64_t) (size - header_size) * 8) {
+        err("huff_decompress_message", "Encoded data is truncated!");
+        return NULL;
+    }
+
+    unsigned char* output = malloc(original_size + (is_stream ? DECODE_TABLE_MAX_SYMBOLS : 1));
+    if (output == NULL) {
+        err("huff_decompress_message", "Unable to allocate memory for the output!");
+        return NULL;
+    }
+    if (!is_stream) {
+        memcpy(output, data + header_size, original_size);
+    } else if (original_size > 0 && decode_block(dictionary->root, NULL, data + header_size, size - header_size,
+                                                 output, original_size) != original_size) {
+        err("huff_decompress_message", "Encoded data is truncated!");
+        free(output);
+        return NULL;
+    }
+    *output_size = original_size;
+    return output;
+}
@@ -5,6 +5,44 @@
 #include <string.h>
 #include <stdlib.h>
 
+/*
+* Function: writer_output
+* -----------------------
+*  Writes bytes to the BitWriter's file, through the asynchronous backend if attached.
+*
+*  bit_writer: Initiated BitWriter object
+*  buffer: Bytes to write
+*  size: Number of bytes
+*
+*  returns: Number of written bytes
+*/
+static size_t writer_output(BitWriter* bit_writer, const unsigned char* buffer, size_t size) {
+    if (bit_writer->async != NULL) {
+        ssize_t written_bytes = async_write(bit_writer->async, buffer, size);
+        return written_bytes < 0 ? 0 : (size_t) written_bytes;
+    }
+    return fwrite(buffer, 1, size, bit_writer->file);
+}
+
+/*
+* Function: reader_input
+* ----------------------
+*  Reads bytes from the BitReader's file, through the asynchronous backend if attached.
+*
+*  bit_reader: Initiated BitReader object
+*  buffer: Destination buffer
+*  size: Maximum number of bytes
+*
+*  returns: Number of read bytes
+*/
+static size_t reader_input(BitReader* bit_reader, unsigned char* buffer, size_t size) {
+    if (bit_reader->async != NULL) {
+        ssize_t read_bytes = async_read(bit_reader->async, buffer, size);
+        return read_bytes < 0 ? 0 : (size_t) read_bytes;
+    }
+    return fread(buffer, 1, size, bit_reader->file);
+}
+
 /*
 * Function: init_writer
 * ---------------------
@@ -25,18 +63,38 @@ BitWriter* init_writer(FILE* file) {
         return NULL;
     }
     bit_writer->file = file;
+    bit_writer->async = NULL;
     bit_writer->bit_count = 0;
     bit_writer->total_bits = 0;
-    bit_writer->buffer = malloc(OUTPUT_BUFFER_SIZE * sizeof(unsigned char));
+    bit_writer->accumulator = 0;
+    bit_writer->accumulator_bits = 0;
+    bit_writer->buffer = calloc(OUTPUT_BUFFER_SIZE, sizeof(unsigned char));
     if (bit_writer->buffer == NULL) {
         fprintf(stderr, "\n[ERROR]: init_writer() {} -> Unable to allocate memory for bit_writer->buffer!\n");
+        free(bit_writer);
         return NULL;
     }
-    // memset(bit_writer->buffer, 0, OUTPUT_BUFFER_SIZE);
     return bit_writer;
 
 }
 
+/*
+* Function: reset_writer
+* ----------------------
+*  Clears the state of a BitWriter so it can be reused for another file.
+*
+*  bit_writer: Initiated BitWriter object
+*  file: A pointer to the new file object
+*/
+void reset_writer(BitWriter* bit_writer, FILE* file) {
+    bit_writer->file = file;
+    bit_writer->async = NULL;
+    bit_writer->bit_count = 0;
+    bit_writer->total_bits = 0;
+    bit_writer->accumulator = 0;
+    bit_writer->accumulator_bits = 0;
+}
+
 /*
 * Function: write_bits
 * --------------------
@@ -56,33 +114,26 @@ ssize_t write_bits(BitWriter* bit_writer, uint32_t code, uint8_t length) {
     // if no bits, return 0
     if (length == 0) return 0;
 
-    for (uint8_t i = 0; i < length; i++) {
-        // Find the current byte index
-        size_t byte_idx = bit_writer->bit_count / 8;
-        // Find the current bit index
-        size_t bit_idx = bit_writer->bit_count % 8;
+    // Less than 8 bits are left in the accumulator, so 32 more always fit
+    bit_writer->accumulator = (bit_writer->accumulator << length) | (code & (UINT64_MAX >> (64 - length)));
+    bit_writer->accumulator_bits += length;
+    bit_writer->total_bits += length;
+
+    // Move the whole bytes to the buffer (MSB first)
+    while (bit_writer->accumulator_bits >= 8) {
+        bit_writer->accumulator_bits -= 8;
+        bit_writer->buffer[bit_writer->bit_count / 8] = (unsigned char) (bit_writer->accumulator >> bit_writer->accumulator_bits);
+        bit_writer->bit_count += 8;
 
-        // Flush writer buffer
-        if (byte_idx >= OUTPUT_BUFFER_SIZE) {
-            size_t written_bytes = fwrite(bit_writer->buffer, 1, OUTPUT_BUFFER_SIZE, bit_writer->file);
+        // Flush writer buffer as soon as it is full
+        if (bit_writer->bit_count / 8 == OUTPUT_BUFFER_SIZE) {
+            size_t written_bytes = writer_output(bit_writer, bit_writer->buffer, OUTPUT_BUFFER_SIZE);
             if (written_bytes < OUTPUT_BUFFER_SIZE) {
-                fprintf(stderr, "\n[ERROR]: init_bitwriter() {} -> Unable to flush the bit_writer!\n");
+                fprintf(stderr, "\n[ERROR]: write_bits() {} -> Unable to flush the bit_writer!\n");
                 return -1;
             }
-
-            // Reset the buffer and indexes
-            memset(bit_writer->buffer, 0, OUTPUT_BUFFER_SIZE);
             bit_writer->bit_count = 0;
-            byte_idx = 0;
-            bit_idx = 0;
         }
-
-        // Extract bit from code (MSB first)
-        int bit = (code >> (length - 1 - i)) & 1;
-        // Set bit in buffer
-        bit_writer->buffer[byte_idx] |= (bit << (7 - bit_idx));
-        bit_writer->bit_count++;
-        bit_writer->total_bits++;
     }
 
     return length;
@@ -102,22 +153,53 @@ ssize_t flush_writer(BitWriter* bit_writer) {
         fprintf(stderr, "\n[ERROR]: flush_writer() {} -> Bit writer is NULL!\n");
         return -1;
     }
+    // Pad the remaining bits with zeros (write_bits never leaves the buffer full)
+    if (bit_writer->accumulator_bits > 0) {
+        int padding = 8 - bit_writer->accumulator_bits;
+        bit_writer->buffer[bit_writer->bit_count / 8] = (unsigned char) (bit_writer->accumulator << padding);
+        bit_writer->bit_count += bit_writer->accumulator_bits;
+        bit_writer->accumulator_bits = 0;
+    }
+    bit_writer->accumulator = 0;
     // Calculate the maximum required bytes
     size_t bytes = (bit_writer->bit_count + 7) / 8;
     size_t written_bytes = 0;
     if (bytes > 0) {
-        written_bytes = fwrite(bit_writer->buffer, 1, bytes, bit_writer->file);
+        written_bytes = writer_output(bit_writer, bit_writer->buffer, bytes);
         if (written_bytes == 0) {
             fprintf(stderr, "\n[ERROR]: flush_writer() {} -> Unable to flush the bit_writer!\n");
             return -1;
         }
     }
     // Reset bit_writer
-    memset(bit_writer->buffer, 0, OUTPUT_BUFFER_SIZE);
     bit_writer->bit_count = 0;
     return written_bytes;
 }
 
+/*
+* Function: drain_writer
+* ----------------------
+*  Writes the whole bytes of the BitWriter buffer without padding; the
+*  bits of the last partial byte stay in the accumulator.
+*
+*  bit_writer: Initiated BitWriter Object
+*
+*  returns: The number of written bytes. If failed, returns -1.
+*/
+ssize_t drain_writer(BitWriter* bit_writer) {
+    if (bit_writer == NULL) {
+        fprintf(stderr, "\n[ERROR]: drain_writer() {} -> Bit writer is NULL!\n");
+        return -1;
+    }
+    size_t bytes = bit_writer->bit_count / 8;
+    if (bytes > 0 && writer_output(bit_writer, bit_writer->buffer, bytes) < bytes) {
+        fprintf(stderr, "\n[ERROR]: drain_writer() {} -> Unable to drain the bit_writer!\n");
+        return -1;
+    }
+    bit_writer->bit_count = 0;
+    return bytes;
+}
+
 /*
 * Function: init_reader
 * ---------------------
@@ -138,20 +220,40 @@ BitReader* init_reader(FILE* file) {
         return NULL;
     }
     bit_reader->file = file;
+    bit_reader->async = NULL;
     bit_reader->bit_padding = 0;
     bit_reader->bit_pos = 8;
-    bit_reader->bits_read = 0;
+    bit_reader->buffer_start = 0;
     bit_reader->buffer_pos = 0;
     bit_reader->buffer_size = 0;
     bit_reader->buffer = malloc(READ_BUFFER_SIZE * sizeof(unsigned char));
     if (bit_reader->buffer == NULL) {
         fprintf(stderr, "\n[ERROR]: init_reader() {} -> Unable to allocate memory for bit_reader->buffer!\n");
+        free(bit_reader);
         return NULL;
     }
     // memset(bit_reader->buffer, 0, READ_BUFFER_SIZE);
     return bit_reader;
 }
 
+/*
+* Function: reset_reader
+* ----------------------
+*  Clears the state of a BitReader so it can be reused for another file.
+*
+*  bit_reader: Initiated BitReader object
+*  file: A pointer to the new file object
+*/
+void reset_reader(BitReader* bit_reader, FILE* file) {
+    bit_reader->file = file;
+    bit_reader->async = NULL;
+    bit_reader->bit_padding = 0;
+    bit_reader->bit_pos = 8;
+    bit_reader->buffer_start = 0;
+    bit_reader->buffer_pos = 0;
+    bit_reader->buffer_size = 0;
+}
+
 /*
 * Function: read_bits
 * -------------------
@@ -170,7 +272,8 @@ int read_bits(BitReader* bit_reader) {
     if (bit_reader->bit_pos == 8) {
         // Read new data
         if (bit_reader->buffer_pos >= bit_reader->buffer_size) {
-            bit_reader->buffer_size = fread(bit_reader->buffer, 1, READ_BUFFER_SIZE, bit_reader->file);
+            bit_reader->buffer_start += bit_reader->buffer_size * 8;
+            bit_reader->buffer_size = reader_input(bit_reader, bit_reader->buffer, READ_BUFFER_SIZE);
             if (bit_reader->buffer_size == 0) {
                 return -1;
             }
@@ -181,6 +284,81 @@ int read_bits(BitReader* bit_reader) {
     }
     int bit = (bit_reader->buffer[bit_reader->buffer_pos - 1] >> (7 - bit_reader->bit_pos)) & 1;
     bit_reader->bit_pos++;
-    bit_reader->bits_read++;
     return bit;
 }
+
+/*
+* Function: get_bits_read
+* -----------------------
+*  Returns the number of bits read so far. It is derived from the buffer
+*  position, so reading a bit does not update a counter.
+*
+*  bit_reader: Initiated BitReader object
+*
+*  returns: Total bits read
+*/
+uint64_t get_bits_read(const BitReader* bit_reader) {
+    // bit_pos is 8 before the first byte of the buffer is loaded
+    return bit_reader->buffer_start + bit_reader->buffer_pos * 8 + bit_reader->bit_pos - 8;
+}
+
+/*
+* Function: fill_reader
+* ---------------------
+*  Makes sure at least `bytes` bytes starting with the next bit are in the
+*  buffer (unless the file ends first). The unread bytes are moved to the
+*  front of the buffer before reading more.
+*
+*  bit_reader: Initiated BitReader object
+*  bytes: Number of bytes needed (at most READ_BUFFER_SIZE)
+*  available: Pointer to store the number of buffered bytes from the returned one
+*  bit_offset: Pointer to store the position of the next bit in the returned byte (0-7, MSB first)
+*
+*  returns: Pointer to the buffered byte holding the next bit
+*/
+const unsigned char* fill_reader(BitReader* bit_reader, size_t bytes, size_t* available, int* bit_offset) {
+    // Position of the next bit in the buffer (bit_pos is 8 before the first byte)
+    size_t position = bit_reader->buffer_pos * 8 + bit_reader->bit_pos - 8;
+    size_t first_byte = position / 8;
+
+    if (first_byte + bytes > bit_reader->buffer_size) {
+        size_t remaining = bit_reader->buffer_size > first_byte ? bit_reader->buffer_size - first_byte : 0;
+        memmove(bit_reader->buffer, bit_reader->buffer + first_byte, remaining);
+        bit_reader->buffer_start += first_byte * 8;
+        bit_reader->buffer_pos -= first_byte;
+        bit_reader->buffer_size = remaining;
+        first_byte = 0;
+        while (bit_reader->buffer_size < bytes) {
+            size_t read_bytes = reader_input(bit_reader, bit_reader->buffer + bit_reader->buffer_size,
+                                             READ_BUFFER_SIZE - bit_reader->buffer_size);
+            if (read_bytes == 0) {
+                break;
+            }
+            bit_reader->buffer_size += read_bytes;
+        }
+    }
+
+    *available = bit_reader->buffer_size - first_byte;
+    *bit_offset = position % 8;
+    return bit_reader->buffer + first_byte;
+}
+
+/*
+* Function: skip_bits
+* -------------------
+*  Consumes bits already in the buffer (see fill_reader).
+*
+*  bit_reader: Initiated BitReader object
+*  count: Number of bits (at most the available bits of the last fill_reader)
+*/
+void skip_bits(BitReader* bit_reader, size_t count) {
+    size_t position = bit_reader->buffer_pos * 8 + bit_reader->bit_pos - 8 + count;
+    // The current byte is loaded unless the position is byte aligned
+    if (position % 8 == 0) {
+        bit_reader->buffer_pos = position / 8;
+        bit_reader->bit_pos = 8;
+    } else {
+        bit_reader->buffer_pos = position / 8 + 1;
+        bit_reader->bit_pos = position % 8;
+    }
+}
@@ -0,0 +1,541 @@
+#include "../include/constants.h"
+#include "../include/compact.h"
+#include "../include/compressor.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+* Function: is_compact
+* --------------------
+*  Checks if the file starts with the compact header's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_compact(FILE* file) {
+    return has_magic(file, compact_magic, sizeof(compact_magic));
+}
+
+/*
+* Function: sort_symbols
+* ----------------------
+*  Lists the present symbols by ascending frequency (ties by symbol).
+*
+*  frequency_table: Pointer to the frequency table
+*  frequencies: Frequency of every listed symbol
+*  symbols: Listed symbols
+*
+*  returns: Number of present symbols
+*/
+static int sort_symbols(const size_t* frequency_table, uint64_t* frequencies, int* symbols) {
+    int count = 0;
+    for (int i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (frequency_table[i] == 0) {
+            continue;
+        }
+        // Insertion sort: most inputs have few symbols
+        int j = count++;
+        while (j > 0 && frequencies[j - 1] > frequency_table[i]) {
+            frequencies[j] = frequencies[j - 1];
+            symbols[j] = symbols[j - 1];
+            j--;
+        }
+        frequencies[j] = frequency_table[i];
+        symbols[j] = i;
+    }
+    return count;
+}
+
+/*
+* Function: compute_code_lengths
+* ------------------------------
+*  Computes huffman code lengths of a frequency table, limited to
+*  max_length bits.
+*
+*  frequency_table: Pointer to the frequency table
+*  lengths: Code length of every symbol (0 for missing symbols)
+*  max_length: Maximum code length
+*
+*  returns: If failed (0), On success (1)
+*/
+int compute_code_lengths(size_t* frequency_table, uint8_t* lengths, uint8_t max_length) {
+    memset(lengths, 0, FREQUENCY_TABLE_SIZE * sizeof(uint8_t));
+    uint64_t nodes[FREQUENCY_TABLE_SIZE];
+    int symbols[FREQUENCY_TABLE_SIZE];
+    int count = sort_symbols(frequency_table, nodes, symbols);
+    if (count == 0) {
+        return 1;
+    }
+    if (count == 1) {
+        lengths[symbols[0]] = 1;
+        return 1;
+    }
+
+    /*
+    * Huffman code lengths computed in place (Moffat and Katajainen), without
+    * a heap or tree nodes. The first pass merges the two lightest of the
+    * leaves and the internal nodes and stores the parent of every merged
+    * internal node, the second turns the parents into depths and the third
+    * hands out the leaf depths, the lightest leaves getting the deepest ones.
+    */
+    int root = 0;
+    int leaf = 2;
+    nodes[0] += nodes[1];
+    for (int next = 1; next < count - 1; next++) {
+        if (leaf >= count || nodes[root] < nodes[leaf]) {
+            nodes[next] = nodes[root];
+            nodes[root++] = next;
+        } else {
+            nodes[next] = nodes[leaf++];
+        }
+        if (leaf >= count || (root < next && nodes[root] < nodes[leaf])) {
+            nodes[next] += nodes[root];
+            nodes[root++] = next;
+        } else {
+            nodes[next] += nodes[leaf++];
+        }
+    }
+    nodes[count - 2] = 0;
+    for (int next = count - 3; next >= 0; next--) {
+        nodes[next] = nodes[nodes[next]] + 1;
+    }
+    int available = 1;
+    int used = 0;
+    uint64_t depth = 0;
+    root = count - 2;
+    int next = count - 1;
+    while (available > 0) {
+        while (root >= 0 && nodes[root] == depth) {
+            used++;
+            root--;
+        }
+        while (available > used) {
+            nodes[next--] = depth;
+            available--;
+        }
+        available = 2 * used;
+        depth++;
+        used = 0;
+    }
+
+    // Clamp the long codes and keep the sum of 2^-length (Kraft sum) <= 1
+    uint32_t limit = 1u << max_length;
+    uint32_t kraft_sum = 0;
+    for (int i = 0; i < count; i++) {
+        uint8_t length = nodes[i] > max_length ? max_length : (uint8_t) nodes[i];
+        lengths[symbols[i]] = length;
+        kraft_sum += 1u << (max_length - length);
+    }
+    while (kraft_sum > limit) {
+        // Lengthening the longest code below the limit costs the least bits
+        int longest = -1;
+        for (int i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            if (lengths[i] > 0 && lengths[i] < max_length && (longest == -1 || lengths[i] > lengths[longest])) {
+                longest = i;
+            }
+        }
+        if (longest == -1) {
+            err("compute_code_lengths", "Too many symbols for the code length limit!");
+            return 0;
+        }
+        kraft_sum -= 1u << (max_length - lengths[longest] - 1);
+        lengths[longest]++;
+    }
+    // Give back the unused code space (only clamping leaves some)
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE && kraft_sum < limit; i++) {
+        while (lengths[i] > 1 && kraft_sum + (1u << (max_length - lengths[i])) <= limit) {
+            kraft_sum += 1u << (max_length - lengths[i]);
+            lengths[i]--;
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: assign_canonical_codes
+* --------------------------------
+*  Assigns canonical codes: shorter codes first, symbols of the same
+*  length in ascending order.
+*
+*  lengths: Code length of every symbol
+*  code_table: Pointer to the code table (FREQUENCY_TABLE_SIZE entries)
+*/
+void assign_canonical_codes(const uint8_t* lengths, Code* code_table) {
+    // First code of every length, then the symbols of a length count up from it
+    uint32_t length_count[33] = {0};
+    uint32_t next_code[33];
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        length_count[lengths[i]]++;
+    }
+    length_count[0] = 0;
+    uint32_t code = 0;
+    for (int length = 1; length <= 32; length++) {
+        next_code[length] = code;
+        code = (code + length_count[length]) << 1;
+    }
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        code_table[i].length = lengths[i];
+        code_table[i].code = lengths[i] > 0 ? next_code[lengths[i]]++ : 0;
+    }
+}
+
+/*
+* Function: build_code_tree
+* -------------------------
+*  Builds the decoding tree of a code table.
+*
+*  code_table: Pointer to the code table
+*
+*  returns: A pointer to the root of the tree. If failed, returns NULL.
+*/
+Node* build_code_tree(Code* code_table) {
+    Node* root = calloc(1, sizeof(Node));
+    if (root == NULL) {
+        err("build_code_tree", "Unable to allocate memory for the node!");
+        return NULL;
+    }
+    // Leaves are marked with a non-zero frequency
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        Node* node = root;
+        for (int bit = code_table[i].length - 1; bit >= 0; bit--) {
+            Node** child = (code_table[i].code >> bit) & 1 ? &node->r_node : &node->l_node;
+            if (*child == NULL && (*child = calloc(1, sizeof(Node))) == NULL) {
+                err("build_code_tree", "Unable to allocate memory for the node!");
+                free_tree(root);
+                return NULL;
+            }
+            node = *child;
+            if (node->frequency != 0 || (bit == 0 && (node->l_node != NULL || node->r_node != NULL))) {
+                err("build_code_tree", "Codes are not prefix-free!");
+                free_tree(root);
+                return NULL;
+            }
+        }
+        if (node != root) {
+            node->symbol = (unsigned char) i;
+            node->frequency = 1;
+        }
+    }
+    return root;
+}
+
+/*
+* Function: write_symbol_set
+* --------------------------
+*  Stores the present symbols as (start, length - 1) runs, or as a bitmap
+*  if the runs would be larger.
+*
+*  lengths: Code length of every symbol (0 for missing symbols)
+*  buffer: Output buffer (At least COMPACT_BITMAP_SIZE + 1 bytes)
+*  flags: Pointer to the flags (COMPACT_FLAG_BITMAP is set for bitmaps)
+*
+*  returns: Number of bytes stored
+*/
+size_t write_symbol_set(const uint8_t* lengths, unsigned char* buffer, unsigned char* flags) {
+    size_t run_count = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (lengths[i] > 0 && (i == 0 || lengths[i - 1] == 0)) {
+            run_count++;
+        }
+    }
+
+    if (1 + run_count * 2 > COMPACT_BITMAP_SIZE) {
+        memset(buffer, 0, COMPACT_BITMAP_SIZE);
+        for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            if (lengths[i] > 0) {
+                buffer[i / 8] |= 1 << (i % 8);
+            }
+        }
+        *flags |= COMPACT_FLAG_BITMAP;
+        return COMPACT_BITMAP_SIZE;
+    }
+
+    size_t pos = 0;
+    buffer[pos++] = (unsigned char) run_count;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (lengths[i] > 0 && (i == 0 || lengths[i - 1] == 0)) {
+            size_t end = i;
+            while (end + 1 < FREQUENCY_TABLE_SIZE && lengths[end + 1] > 0) {
+                end++;
+            }
+            buffer[pos++] = (unsigned char) i;
+            buffer[pos++] = (unsigned char) (end - i);
+        }
+    }
+    return pos;
+}
+
+/*
+* Function: parse_symbol_set
+* --------------------------
+*  Reads a symbol set stored by write_symbol_set from a buffer.
+*
+*  buffer: Stored symbol set
+*  size: Number of bytes in the buffer
+*  flags: Flags of the header
+*  present: Set to 1 for every present symbol
+*  used: Pointer to store the number of bytes the set takes
+*
+*  returns: Number of present symbols. If failed, returns -1.
+*/
+static int parse_symbol_set(const unsigned char* buffer, size_t size, unsigned char flags, uint8_t* present, size_t* used) {
+    int symbol_count = 0;
+    memset(present, 0, FREQUENCY_TABLE_SIZE * sizeof(uint8_t));
+
+    if (flags & COMPACT_FLAG_BITMAP) {
+        if (size < COMPACT_BITMAP_SIZE) {
+            return -1;
+        }
+        for (int i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            present[i] = (buffer[i / 8] >> (i % 8)) & 1;
+            symbol_count += present[i];
+        }
+        *used = COMPACT_BITMAP_SIZE;
+        return symbol_count;
+    }
+
+    if (size < 1 || size < 1 + (size_t) buffer[0] * 2) {
+        return -1;
+    }
+    int run_count = buffer[0];
+    int next_start = 0;
+    for (int i = 0; i < run_count; i++) {
+        int start = buffer[1 + i * 2];
+        int length = buffer[2 + i * 2];
+        // Runs are ascending and do not touch each other
+        if (start < next_start || start + length >= FREQUENCY_TABLE_SIZE) {
+            return -1;
+        }
+        memset(present + start, 1, length + 1);
+        symbol_count += length + 1;
+        next_start = start + length + 2;
+    }
+    *used = 1 + run_count * 2;
+    return symbol_count;
+}
+
+/*
+* Function: read_symbol_set
+* -------------------------
+*  Reads a symbol set stored by write_symbol_set.
+*
+*  input_file: Pointer to the compressed file
+*  flags: Flags of the header
+*  present: Set to 1 for every present symbol
+*
+*  returns: Number of present symbols. If failed, returns -1.
+*/
+int read_symbol_set(FILE* input_file, unsigned char flags, uint8_t* present) {
+    // A bitmap, or the run count and up to 255 runs
+    unsigned char buffer[1 + 255 * 2];
+    size_t size = COMPACT_BITMAP_SIZE;
+    if (!(flags & COMPACT_FLAG_BITMAP)) {
+        int run_count = fgetc(input_file);
+        if (run_count == EOF) {
+            return -1;
+        }
+        buffer[0] = (unsigned char) run_count;
+        size = 1 + run_count * 2;
+    }
+    size_t offset = flags & COMPACT_FLAG_BITMAP ? 0 : 1;
+    if (fread(buffer + offset, sizeof(unsigned char), size - offset, input_file) < size - offset) {
+        return -1;
+    }
+    size_t used = 0;
+    return parse_symbol_set(buffer, size, flags, present, &used);
+}
+
+/*
+* Function: write_compact_header
+* ------------------------------
+*  Stores the compact header of a set of code lengths.
+*
+*  lengths: Code length of every symbol (0 for missing symbols)
+*  total_bits: Number of encoded bits
+*  header: Output buffer (At least COMPACT_MAX_HEADER_SIZE bytes)
+*
+*  returns: Number of bytes stored
+*/
+size_t write_compact_header(const uint8_t* lengths, uint64_t total_bits, unsigned char* header) {
+    size_t header_size = 0;
+    memcpy(header, compact_magic, sizeof(compact_magic));
+    header_size += sizeof(compact_magic);
+    unsigned char* flags = &header[header_size++];
+    *flags = (COMPACT_VERSION << 4) | (total_bits % 8);
+    header_size += write_symbol_set(lengths, header + header_size, flags);
+
+    // Two code lengths in every byte, the first one in the high nibble
+    int high_nibble = 1;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (lengths[i] == 0) {
+            continue;
+        }
+        if (high_nibble) {
+            header[header_size++] = lengths[i] << 4;
+        } else {
+            header[header_size - 1] |= lengths[i];
+        }
+        high_nibble = !high_nibble;
+    }
+    return header_size;
+}
+
+/*
+* Function: read_compact_header
+* -----------------------------
+*  Reads a compact header stored by write_compact_header from a buffer.
+*
+*  header: Stored header (followed by the encoded data)
+*  size: Number of bytes in the buffer
+*  lengths: Code length of every symbol (0 for missing symbols)
+*  flags: Pointer to store the flags (version and padding bits)
+*
+*  returns: Size of the header. If failed, returns 0.
+*/
+size_t read_compact_header(const unsigned char* header, size_t size, uint8_t* lengths, unsigned char* flags) {
+    if (size < sizeof(compact_magic) + 1 || memcmp(header, compact_magic, sizeof(compact_magic)) != 0) {
+        err("read_compact_header", "File is corrupted!");
+        return 0;
+    }
+    *flags = header[sizeof(compact_magic)];
+    if ((*flags >> 4) != COMPACT_VERSION) {
+        err("read_compact_header", "Unsupported compact header version!");
+        return 0;
+    }
+    size_t header_size = sizeof(compact_magic) + 1;
+    size_t used = 0;
+    int symbol_count = parse_symbol_set(header + header_size, size - header_size, *flags, lengths, &used);
+    if (symbol_count == -1) {
+        err("read_compact_header", "Symbol set is corrupted!");
+        return 0;
+    }
+    header_size += used;
+    if (size - header_size < (size_t) (symbol_count + 1) / 2) {
+        err("read_compact_header", "Code lengths are truncated!");
+        return 0;
+    }
+
+    // Two code lengths in every byte, the first one in the high nibble
+    int nibble = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (lengths[i] == 0) {
+            continue;
+        }
+        unsigned char byte = header[header_size + nibble / 2];
+        lengths[i] = nibble++ % 2 == 0 ? byte >> 4 : byte & 0x0F;
+        if (lengths[i] == 0) {
+            err("read_compact_header", "Code lengths are corrupted!");
+            return 0;
+        }
+    }
+    return header_size + (symbol_count + 1) / 2;
+}
+
+/*
+* Function: compress_compact
+* --------------------------
+*  Compresses the input file with the compact header: a run-coded or
+*  bitmap symbol set, 4-bit canonical code lengths and the padding bits
+*  folded into the first bytes.
+*
+*  context: Pointer to the context
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_compact(HuffContext* context, FILE* input_file, FILE* output_file) {
+    if (context == NULL || input_file == NULL || output_file == NULL) {
+        err("compress_compact", "Input/output file is NULL!");
+        return 0;
+    }
+    memset(context->frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    if (count_frequencies(input_file, context->frequency_table) == -1) {
+        return 0;
+    }
+
+    uint8_t lengths[FREQUENCY_TABLE_SIZE];
+    if (compute_code_lengths(context->frequency_table, lengths, COMPACT_MAX_CODE_LENGTH) == 0) {
+        return 0;
+    }
+    assign_canonical_codes(lengths, context->code_table);
+
+    // The padding is known before encoding, so it is stored in the header
+    uint64_t total_bits = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        total_bits += context->frequency_table[i] * lengths[i];
+    }
+
+    unsigned char header[COMPACT_MAX_HEADER_SIZE];
+    size_t header_size = write_compact_header(lengths, total_bits, header);
+    if (fwrite(header, sizeof(unsigned char), header_size, output_file) < header_size) {
+        err("compress_compact", "Unable to write the header!");
+        return 0;
+    }
+
+    BitWriter* bit_writer = context->bit_writer;
+    reset_writer(bit_writer, output_file);
+    return encode(input_file, bit_writer, context->code_table, NULL);
+}
+
+/*
+* Function: decompress_compact
+* ----------------------------
+*  Decompresses a file with the compact header.
+*
+*  context: Pointer to the context
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_compact(HuffContext* context, FILE* input_file, FILE* output_file) {
+    if (context == NULL || input_file == NULL) {
+        err("decompress_compact", "Input file is NULL!");
+        return 0;
+    }
+    unsigned char header[COMPACT_MAX_HEADER_SIZE];
+    unsigned char flags = 0;
+    uint8_t lengths[FREQUENCY_TABLE_SIZE];
+    fseeko(input_file, 0, SEEK_SET);
+    size_t read_bytes = fread(header, sizeof(unsigned char), sizeof(header), input_file);
+    size_t header_size = read_compact_header(header, read_bytes, lengths, &flags);
+    if (header_size == 0 || fseeko(input_file, header_size, SEEK_SET) != 0) {
+        return 0;
+    }
+    int symbol_count = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        symbol_count += lengths[i] > 0;
+    }
+
+    uint64_t data_bytes = get_file_size(input_file) - ftello(input_file);
+    if (symbol_count == 0) {
+        // Empty input
+        if (data_bytes != 0) {
+            err("decompress_compact", "Encoded data is corrupted!");
+            return 0;
+        }
+        return 1;
+    }
+
+    assign_canonical_codes(lengths, context->code_table);
+    Node* root = build_code_tree(context->code_table);
+    if (root == NULL) {
+        return 0;
+    }
+
+    BitReader* bit_reader = context->bit_reader;
+    reset_reader(bit_reader, input_file);
+    uint64_t total_bits = get_total_bits(data_bytes, flags & COMPACT_PADDING_MASK);
+    int result = decode_symbols(output_file, bit_reader, root, total_bits, SIZE_MAX);
+    free_tree(root);
+    return result;
+}
@@ -1,13 +1,21 @@
+#include "../include/adaptive.h"
 #include "../include/constants.h"
 #include "../include/minheap.h"
 #include "../include/huffman.h"
 #include "../include/compressor.h"
-#include "../include/resources.h"
+#include "../include/compact.h"
+#include "../include/dictionary.h"
+#include "../include/packed.h"
+#include "../include/record.h"
+#include "../include/seekable.h"
+#include "../include/stored.h"
+#include "../include/tans.h"
 #include "../include/utils.h"
 
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
 * Function: fill_minheap
@@ -54,91 +62,230 @@ ssize_t fill_minheap(size_t* frequency_table, Heap* priority_queue, size_t max_c
 }
 
 /*
-* Function: compress
-* ------------------
-* Compresses the input file using huffman coding
+* Function: create_huffman_tree
+* -----------------------------
+* Builds the huffman tree of a frequency table.
 *
-* input_file: Pointer to the input_file
-* output_file: Pointer to the output_file
+* frequency_table: Pointer to the frequency table.
+* max_count: If > 0, scales down the frequency
 *
-* returns: If failed (0), On success (1)
+* returns: A pointer to the root of the tree. If failed, returns NULL.
 */
-int compress(FILE* input_file, FILE* output_file) {
-    if (input_file == NULL || output_file == NULL) {
-        err("compress", "Input/output file is NULL!\n");
-        return 0;
-    }
-    // Initialize resource management system
-    Resources resource = resources_init(4);
-    // Generate frequency table
-    size_t* frequency_table = count_run(input_file);
-    if (frequency_table == NULL || resources_add(&resource, frequency_table) == 0) {
-        resources_cleanup(&resource);
-        return 0;
-    }
-
-    size_t max_count = 0;
-    size_t heap_capacity = get_list_size(frequency_table, &max_count);
+Node* create_huffman_tree(size_t* frequency_table, size_t max_count) {
+    size_t max_value = 0;
+    size_t heap_capacity = get_list_size(frequency_table, &max_value);
 
     // Create a min-heap structure for nodes
     Heap* priority_queue = create_priority_queue(heap_capacity, &compare_nodes);
     if (priority_queue == NULL) {
-        resources_cleanup(&resource);
-        return 0;
+        return NULL;
     }
 
     size_t heap_size = fill_minheap(frequency_table, priority_queue, max_count);
     if (heap_size < heap_capacity) {
         free_heap_nodes(priority_queue);
         free_heap(priority_queue);
-        resources_cleanup(&resource);
-        return 0;
+        return NULL;
     }
-    
+
     // Create a binary huffman tree
     Node* root = build_tree(priority_queue);
     if (root == NULL) {
         free_heap_nodes(priority_queue);
-        free_heap(priority_queue);
-        resources_cleanup(&resource);
+    }
+    free_heap(priority_queue);
+    return root;
+}
+
+/*
+* Function: fill_code_table
+* -------------------------
+* Builds the huffman tree of a frequency table and generates the code of every symbol.
+*
+* frequency_table: Pointer to the frequency table.
+* code_table: Pointer to the code table (FREQUENCY_TABLE_SIZE entries).
+*
+* returns: If failed (0), On success (1)
+*/
+int fill_code_table(size_t* frequency_table, Code* code_table) {
+    size_t max_count = 0;
+    get_list_size(frequency_table, &max_count);
+
+    Node* root = create_huffman_tree(frequency_table, max_count);
+    if (root == NULL) {
         return 0;
     }
 
+    memset(code_table, 0, FREQUENCY_TABLE_SIZE * sizeof(Code));
+    generate_huffman_code(code_table, 0, 0, root);
+    free_tree(root);
+    return 1;
+}
+
+/*
+* Function: create_code_table
+* ---------------------------
+* Builds the huffman tree of a frequency table and generates the code of every symbol.
+*
+* frequency_table: Pointer to the frequency table.
+*
+* returns: Code table (FREQUENCY_TABLE_SIZE entries). If failed, returns NULL.
+*/
+Code* create_code_table(size_t* frequency_table) {
     // Create a table for the huffman encoded symbols
     Code* code_table = malloc(FREQUENCY_TABLE_SIZE * sizeof(Code));
-    if (code_table == NULL || resources_add(&resource, code_table) == 0) {
-        free_tree(root);
-        free_heap(priority_queue);
-        resources_cleanup(&resource);
+    if (code_table == NULL) {
+        err("create_code_table", "Unable to allocate memory for the code table!");
+        return NULL;
+    }
+    if (fill_code_table(frequency_table, code_table) == 0) {
+        free(code_table);
+        return NULL;
+    }
+    return code_table;
+}
+
+/*
+* Function: prepare_pair_table
+* ----------------------------
+* Fills the context's pair table from its code table, if the input is large
+* enough to pay for it and every two codes fit in 32 bits. The table is
+* allocated on first use and kept for the next files.
+*
+* context: Pointer to the context
+* input_size: Size of the input to encode
+*
+* returns: Pointer to the pair table. NULL if symbols should be encoded one at a time.
+*/
+Code* prepare_pair_table(HuffContext* context, size_t input_size) {
+    if (input_size < PAIR_TABLE_MIN_INPUT_SIZE) {
+        return NULL;
+    }
+    if (context->pair_table == NULL) {
+        context->pair_table = malloc(PAIR_TABLE_SIZE * sizeof(Code));
+        if (context->pair_table == NULL) {
+            return NULL;
+        }
+    }
+    return fill_pair_table(context->code_table, context->pair_table) ? context->pair_table : NULL;
+}
+
+/*
+* Function: create_context
+* ------------------------
+* Allocates the tables and bit reader/writer used by compress and decompress,
+* so they can be reused for many files.
+*
+* returns: Pointer to the context. If failed, returns NULL.
+*/
+HuffContext* create_context(void) {
+    HuffContext* context = calloc(1, sizeof(HuffContext));
+    if (context == NULL) {
+        err("create_context", "Unable to allocate memory for the context!");
+        return NULL;
+    }
+    context->frequency_table = malloc(FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    context->code_table = malloc(FREQUENCY_TABLE_SIZE * sizeof(Code));
+    context->bit_writer = init_writer(stdout);
+    context->bit_reader = init_reader(stdin);
+    if (context->frequency_table == NULL || context->code_table == NULL
+        || context->bit_writer == NULL || context->bit_reader == NULL) {
+        err("create_context", "Unable to allocate memory for the context!");
+        free_context(context);
+        return NULL;
+    }
+    return context;
+}
+
+/*
+* Function: free_context
+* ----------------------
+* Frees the context and everything it owns.
+*
+* context: Pointer to the context
+*/
+void free_context(HuffContext* context) {
+    if (context == NULL) {
+        return;
+    }
+    if (context->bit_writer != NULL) {
+        free(context->bit_writer->buffer);
+        free(context->bit_writer);
+    }
+    if (context->bit_reader != NULL) {
+        free(context->bit_reader->buffer);
+        free(context->bit_reader);
+    }
+    free(context->pair_table);
+    free(context->code_table);
+    free(context->frequency_table);
+    free(context);
+}
+
+/*
+* Function: compress_with_context
+* -------------------------------
+* Compresses the input file using huffman coding, reusing the context's buffers.
+* Inputs smaller than COMPACT_MAX_SIZE are stored with the compact header,
+* inputs whose sample is close to 8 bits of entropy per byte are copied
+* into a stored container (see probe_incompressible), skewed histograms with tANS (see prefer_tans) and flat histograms as
+* fixed-width indexes (see prefer_packed). With a sample size in the context
+* the table of large inputs is built from a sample (see sample_frequencies).
+*
+* context: Pointer to the context
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file
+*
+* returns: If failed (0), On success (1)
+*/
+int compress_with_context(HuffContext* context, FILE* input_file, FILE* output_file) {
+    if (context == NULL || input_file == NULL || output_file == NULL) {
+        err("compress", "Input/output file is NULL!\n");
+        return 0;
+    }
+    // The legacy header would take most of a small output
+    if (get_file_size(input_file) < COMPACT_MAX_SIZE) {
+        return compress_compact(context, input_file, output_file);
+    }
+    // Already compressed inputs skip the count, the tree and the encoding
+    if (probe_incompressible(input_file)) {
+        return compress_stored(input_file, output_file);
+    }
+    // Generate frequency table
+    memset(context->frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    ssize_t input_size = context->sample_size > 0
+                         ? sample_frequencies(input_file, context->frequency_table, context->sample_size)
+                         : count_frequencies(input_file, context->frequency_table);
+    if (input_size == -1) {
         return 0;
     }
-    
-    generate_huffman_code(code_table, 0, 0, root);
 
-    BitWriter* bit_writer = init_writer(output_file);
-    if (bit_writer == NULL || resources_add(&resource, bit_writer->buffer) == 0 
-        || resources_add(&resource, bit_writer) == 0) {
-        free_tree(root);
-        free_heap(priority_queue);
-        resources_cleanup(&resource);
+    // Create a table for the huffman encoded symbols
+    if (fill_code_table(context->frequency_table, context->code_table) == 0) {
         return 0;
     }
+    // Skewed histograms lose up to a bit per symbol to whole-bit codes
+    if (prefer_tans(context->frequency_table, context->code_table)) {
+        return compress_tans(context, input_file, output_file);
+    }
+    // Flat histograms gain almost nothing from variable-length codes
+    if (prefer_packed(context->frequency_table, context->code_table)) {
+        return compress_packed(context, input_file, output_file);
+    }
+
+    BitWriter* bit_writer = context->bit_writer;
+    reset_writer(bit_writer, output_file);
 
     // Write file header (Read the readme file for more information about the compressed file structure)
-    int header_res = write_file_header(output_file, frequency_table);
+    int header_res = write_file_header(output_file, context->frequency_table);
     if (header_res == 0) {
-        free_tree(root);
-        free_heap(priority_queue);
-        resources_cleanup(&resource);
         return 0;
     }
 
     // Encode and compress file
-    int result = encode(input_file, bit_writer, code_table);
+    Code* pair_table = prepare_pair_table(context, input_size);
+    int result = encode(input_file, bit_writer, context->code_table, pair_table);
     if (result == 0) {
-        free_tree(root);
-        free_heap(priority_queue);
-        resources_cleanup(&resource);
         return 0;
     }
 
@@ -147,73 +294,113 @@ int compress(FILE* input_file, FILE* output_file) {
     // size_t res = fwrite(&total_bits, sizeof(size_t), 1, output_file);
     size_t remaining_bits = bit_writer->total_bits % 8;
     size_t res = fwrite(&remaining_bits, sizeof(unsigned char), 1, output_file);
-
-    free_tree(root);
-    free_heap(priority_queue);
-    resources_cleanup(&resource);
     return res;
 }
 
 /*
-* Function: decompress
-* ------------------
-* Decompresses the input file using huffman coding
+* Function: decompress_with_context
+* ---------------------------------
+* Decompresses the input file using huffman coding, reusing the context's buffers
 *
+* context: Pointer to the context
 * input_file: Pointer to the input_file
-* output_file: Pointer to the output_file
+* output_file: Pointer to the output_file (NULL only decodes, e.g. to test the file)
 *
 * returns: If failed (0), On success (1)
 */
-int decompress(FILE* input_file, FILE* output_file) {
-    // Initialize resource management system
-    Resources resource = resources_init(3);
-    if (resource.pointers == NULL) {
+int decompress_with_context(HuffContext* context, FILE* input_file, FILE* output_file) {
+    if (context == NULL || input_file == NULL) {
+        err("decompress", "Input file is NULL!\n");
         return 0;
     }
-
-    BitReader* bit_reader = init_reader(input_file);
-    if (bit_reader == NULL || resources_add(&resource, bit_reader->buffer) == 0
-        || resources_add(&resource, bit_reader) == 0) {
-        resources_cleanup(&resource);
+    if (is_seekable(input_file)) {
+        return decompress_seekable(input_file, output_file, context->verify);
+    }
+    if (context->verify) {
+        err("decompress", "File has no checksums to verify!");
         return 0;
     }
+    if (is_record_file(input_file)) {
+        return decompress_records(input_file, output_file);
+    }
+    if (is_dictionary_stream(input_file)) {
+        return decompress_with_dictionary(NULL, context->bit_reader, input_file, output_file);
+    }
+    if (is_compact(input_file)) {
+        return decompress_compact(context, input_file, output_file);
+    }
+    if (is_packed(input_file)) {
+        return decompress_packed(input_file, output_file);
+    }
+    if (is_tans(input_file)) {
+        return decompress_tans(input_file, output_file);
+    }
+    if (is_adaptive(input_file)) {
+        return decompress_adaptive(input_file, output_file);
+    }
+    if (is_stored(input_file)) {
+        return decompress_stored(input_file, output_file);
+    }
+    BitReader* bit_reader = context->bit_reader;
+    reset_reader(bit_reader, input_file);
 
     // size_t total_bits = 0;
     int bit_padding = 0;
     size_t list_size = 0;
     size_t* frequency_table = read_file_header(input_file, &list_size, &bit_padding);
-    if (frequency_table == NULL || resources_add(&resource, frequency_table) == 0) {
-        resources_cleanup(&resource);
+    if (frequency_table == NULL) {
         return 0;
     }
 
-    Heap* priority_queue = create_priority_queue(list_size, &compare_nodes);
-    if (priority_queue == NULL) {
-        resources_cleanup(&resource);
+    Node* root = create_huffman_tree(frequency_table, 0);
+    free(frequency_table);
+    if (root == NULL) {
         return 0;
     }
 
-    size_t heap_size = fill_minheap(frequency_table, priority_queue, 0);
-    if (heap_size < list_size) {
-        free_heap_nodes(priority_queue);
-        free_heap(priority_queue);
-        resources_cleanup(&resource);
+    int result = decode(output_file, bit_reader, root, bit_padding);
+
+    free_tree(root);
+    return result;
+}
+
+/*
+* Function: compress
+* ------------------
+* Compresses the input file using huffman coding
+*
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file
+*
+* returns: If failed (0), On success (1)
+*/
+int compress(FILE* input_file, FILE* output_file) {
+    HuffContext* context = create_context();
+    if (context == NULL) {
         return 0;
     }
+    int result = compress_with_context(context, input_file, output_file);
+    free_context(context);
+    return result;
+}
 
-    Node* root = build_tree(priority_queue);
-    if (root == NULL) {
-        free_heap_nodes(priority_queue);
-        free_heap(priority_queue);
-        resources_cleanup(&resource);
+/*
+* Function: decompress
+* ------------------
+* Decompresses the input file using huffman coding
+*
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file
+*
+* returns: If failed (0), On success (1)
+*/
+int decompress(FILE* input_file, FILE* output_file) {
+    HuffContext* context = create_context();
+    if (context == NULL) {
         return 0;
     }
-
-    int result = decode(output_file, bit_reader, root, bit_padding);
-
-    free_tree(root);
-    free_heap(priority_queue);
-    resources_cleanup(&resource);
+    int result = decompress_with_context(context, input_file, output_file);
+    free_context(context);
     return result;
 }
 
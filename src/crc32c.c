@@ -0,0 +1,206 @@
+#include "../include/crc32c.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#endif
+
+// Reflected Castagnoli polynomial
+#define CRC32C_POLYNOMIAL 0x82F63B78
+
+static uint32_t crc_table[8][256];
+static uint32_t (*crc_function)(uint32_t crc, const unsigned char* data, size_t size);
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+/*
+* Function: crc32c_table
+* ----------------------
+*  Portable slicing-by-8 implementation (8 bytes per step).
+*/
+static uint32_t crc32c_table(uint32_t crc, const unsigned char* data, size_t size) {
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t low = crc ^ ((uint32_t) data[0] | (uint32_t) data[1] << 8 | (uint32_t) data[2] << 16 | (uint32_t) data[3] << 24);
+        crc = crc_table[7][low & 0xFF] ^ crc_table[6][(low >> 8) & 0xFF]
+              ^ crc_table[5][(low >> 16) & 0xFF] ^ crc_table[4][low >> 24]
+              ^ crc_table[3][data[4]] ^ crc_table[2][data[5]]
+              ^ crc_table[1][data[6]] ^ crc_table[0][data[7]];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = crc_table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#ifdef CRC32C_X86
+/*
+* Function: crc32c_sse42
+* ----------------------
+*  SSE4.2 implementation (crc32 instruction, 8 bytes per step).
+*/
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char* data, size_t size) {
+    crc = ~crc;
+    while (size > 0 && ((uintptr_t) data & 7) != 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+        size--;
+    }
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+        data += 8;
+        size -= 8;
+    }
+    crc = (uint32_t) crc64;
+#endif
+    while (size >= 4) {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        crc = _mm_crc32_u32(crc, value);
+        data += 4;
+        size -= 4;
+    }
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return ~crc;
+}
+#endif
+
+/*
+* Function: crc32c_init
+* ---------------------
+*  Builds the tables and selects the implementation for this CPU.
+*/
+static void crc32c_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        }
+        crc_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int slice = 1; slice < 8; slice++) {
+            crc_table[slice][i] = crc_table[0][crc_table[slice - 1][i] & 0xFF] ^ (crc_table[slice - 1][i] >> 8);
+        }
+    }
+    crc_function = crc32c_table;
+#ifdef CRC32C_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc_function = crc32c_sse42;
+    }
+#endif
+}
+
+/*
+* Function: crc32c_update
+* -----------------------
+*  Updates a CRC32C (Castagnoli) checksum. Uses the SSE4.2 crc32
+*  instruction if the CPU supports it, otherwise a slicing-by-8 table.
+*
+*  crc: Checksum of the previous data (0 for the start)
+*  data: Pointer to the data
+*  size: Number of bytes
+*
+*  returns: Updated checksum
+*/
+uint32_t crc32c_update(uint32_t crc, const unsigned char* data, size_t size) {
+    pthread_once(&crc_once, crc32c_init);
+    return crc_function(crc, data, size);
+}
+
+/*
+* Function: crc32c_backend
+* ------------------------
+*  Returns the name of the selected implementation ("sse4.2" or "table").
+*/
+const char* crc32c_backend(void) {
+    pthread_once(&crc_once, crc32c_init);
+    return crc_function == crc32c_table ? "table" : "sse4.2";
+}
+
+/*
+* Function: gf2_matrix_times
+* --------------------------
+*  Multiplies a 32x32 bit matrix (one column per entry) by a vector over GF(2).
+*/
+static uint32_t gf2_matrix_times(const uint32_t* matrix, uint32_t vector) {
+    uint32_t sum = 0;
+    while (vector != 0) {
+        if (vector & 1) {
+            sum ^= *matrix;
+        }
+        vector >>= 1;
+        matrix++;
+    }
+    return sum;
+}
+
+/*
+* Function: gf2_matrix_square
+* ---------------------------
+*  Squares a 32x32 bit matrix over GF(2).
+*/
+static void gf2_matrix_square(uint32_t* square, const uint32_t* matrix) {
+    for (int n = 0; n < 32; n++) {
+        square[n] = gf2_matrix_times(matrix, matrix[n]);
+    }
+}
+
+/*
+* Function: crc32c_combine
+* ------------------------
+*  Returns the checksum of two concatenated blocks from the checksums of
+*  the blocks, without reading the data (O(log length2) matrix squarings).
+*
+*  crc1: Checksum of the first block
+*  crc2: Checksum of the second block
+*  length2: Size of the second block in bytes
+*
+*  returns: Checksum of the concatenation
+*/
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t length2) {
+    if (length2 == 0) {
+        return crc1;
+    }
+    uint32_t even[32]; // Operator for an even power of two zero bits
+    uint32_t odd[32]; // Operator for an odd power of two zero bits
+    // Operator for one zero bit
+    odd[0] = CRC32C_POLYNOMIAL;
+    uint32_t row = 1;
+    for (int n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    gf2_matrix_square(even, odd); // Two zero bits
+    gf2_matrix_square(odd, even); // Four zero bits
+    // Appends length2 zero bytes to crc1, the first squaring gives one byte
+    while (length2 != 0) {
+        gf2_matrix_square(even, odd);
+        if (length2 & 1) {
+            crc1 = gf2_matrix_times(even, crc1);
+        }
+        length2 >>= 1;
+        if (length2 == 0) {
+            break;
+        }
+        gf2_matrix_square(odd, even);
+        if (length2 & 1) {
+            crc1 = gf2_matrix_times(odd, crc1);
+        }
+        length2 >>= 1;
+    }
+    return crc1 ^ crc2;
+}
@@ -0,0 +1,372 @@
+#include "../include/constants.h"
+#include "../include/decodetable.h"
+#include "../include/huffman.h"
+#include "../include/utils.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define DECODE_TABLE_X86 1
+#endif
+
+static int decode_table_mode = DECODE_TABLE_AUTO;
+// The BMI2 loops only pay off once the intrinsics are inlined, unoptimized builds prefer the portable ones
+#ifdef __OPTIMIZE__
+static int portable_only = 0;
+#else
+static int portable_only = 1;
+#endif
+static int cpu_has_bmi2 = 0;
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+
+/*
+* Function: load_window
+* ---------------------
+*  Loads 8 bytes as a big-endian integer, so the next bit is the most significant.
+*/
+static inline uint64_t load_window(const unsigned char* data) {
+    uint64_t window;
+    memcpy(&window, data, sizeof(window));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    window = __builtin_bswap64(window);
+#endif
+    return window;
+}
+
+/*
+* Defines a decode_run loop for a fixed table width. INDEX extracts the
+* width bits after the offset-th bit of the window.
+*/
+#define DEFINE_DECODE_RUN(name, width, attributes, INDEX)                                                      \
+    attributes static size_t name(const DecodeEntry* entries, const unsigned char* data, size_t data_size,    \
+                                  size_t* bit_position, size_t bit_limit, unsigned char* output,              \
+                                  size_t symbol_limit) {                                                      \
+        size_t position = *bit_position;                                                                      \
+        size_t decoded = 0;                                                                                   \
+        while (position / 8 + 8 <= data_size) {                                                               \
+            uint64_t window = load_window(data + position / 8);                                              \
+            const DecodeEntry* entry = &entries[INDEX(window, position % 8, width)];                          \
+            if (entry->count == 0 || entry->length > bit_limit - position                                     \
+                || entry->count > symbol_limit - decoded) {                                                   \
+                break;                                                                                        \
+            }                                                                                                 \
+            memcpy(output + decoded, entry->symbols, DECODE_TABLE_MAX_SYMBOLS);                               \
+            decoded += entry->count;                                                                          \
+            position += entry->length;                                                                        \
+        }                                                                                                     \
+        *bit_position = position;                                                                             \
+        return decoded;                                                                                       \
+    }
+
+#define PORTABLE_INDEX(window, offset, width) (((window) << (offset)) >> (64 - (width)))
+
+DEFINE_DECODE_RUN(decode_run_8, 8, , PORTABLE_INDEX)
+DEFINE_DECODE_RUN(decode_run_10, 10, , PORTABLE_INDEX)
+DEFINE_DECODE_RUN(decode_run_11, 11, , PORTABLE_INDEX)
+DEFINE_DECODE_RUN(decode_run_12, 12, , PORTABLE_INDEX)
+
+#ifdef DECODE_TABLE_X86
+// SHRX moves the bits down without touching the flags, BZHI clears the bits above the width
+#define BMI2_INDEX(window, offset, width) _bzhi_u64((window) >> (64 - (width) - (offset)), width)
+
+DEFINE_DECODE_RUN(decode_run_bmi2_8, 8, __attribute__((target("bmi2"))), BMI2_INDEX)
+DEFINE_DECODE_RUN(decode_run_bmi2_10, 10, __attribute__((target("bmi2"))), BMI2_INDEX)
+DEFINE_DECODE_RUN(decode_run_bmi2_11, 11, __attribute__((target("bmi2"))), BMI2_INDEX)
+DEFINE_DECODE_RUN(decode_run_bmi2_12, 12, __attribute__((target("bmi2"))), BMI2_INDEX)
+#endif
+
+// Widest last, multi-symbol tables use it
+static const int table_widths[] = {8, 10, 11, 12};
+static const DecodeRunFunction portable_runs[] = {decode_run_8, decode_run_10, decode_run_11, decode_run_12};
+#ifdef DECODE_TABLE_X86
+static const DecodeRunFunction bmi2_runs[] = {decode_run_bmi2_8, decode_run_bmi2_10, decode_run_bmi2_11, decode_run_bmi2_12};
+#endif
+
+/*
+* Function: detect_cpu
+* --------------------
+*  Checks once if the CPU supports BMI2.
+*/
+static void detect_cpu(void) {
+#ifdef DECODE_TABLE_X86
+    __builtin_cpu_init();
+    cpu_has_bmi2 = __builtin_cpu_supports("bmi2");
+#endif
+}
+
+/*
+* Function: select_decode_run
+* ---------------------------
+*  Returns the lookup loop for a table width.
+*
+*  width_index: Index of the width in table_widths
+*/
+static DecodeRunFunction select_decode_run(size_t width_index) {
+    pthread_once(&cpu_once, detect_cpu);
+#ifdef DECODE_TABLE_X86
+    if (cpu_has_bmi2 && !portable_only) {
+        return bmi2_runs[width_index];
+    }
+#endif
+    return portable_runs[width_index];
+}
+
+/*
+* Function: set_decode_table_mode
+* -------------------------------
+*  Selects the lookup table used by decode_symbols.
+*
+*  mode: DECODE_TABLE_AUTO (multi-symbol entries for short average code
+*        lengths), DECODE_TABLE_TREE (walk the tree bit by bit),
+*        DECODE_TABLE_SINGLE or DECODE_TABLE_MULTI
+*/
+void set_decode_table_mode(int mode) {
+    decode_table_mode = mode;
+}
+
+/*
+* Function: get_decode_table_mode
+* -------------------------------
+*  returns: The lookup table mode used by decode_symbols
+*/
+int get_decode_table_mode(void) {
+    return decode_table_mode;
+}
+
+/*
+* Function: set_decode_table_portable
+* -----------------------------------
+*  Disables the BMI2 lookup loops, e.g. to compare them with the portable ones.
+*  Builds without optimization use the portable loops unless this is set to 0.
+*
+*  enabled: Portable loops only (1), Select by CPU (0)
+*/
+void set_decode_table_portable(int enabled) {
+    portable_only = enabled;
+}
+
+/*
+* Function: decode_table_backend
+* ------------------------------
+*  Returns the name of the lookup loops new tables use ("bmi2" or "portable").
+*/
+const char* decode_table_backend(void) {
+    pthread_once(&cpu_once, detect_cpu);
+    return cpu_has_bmi2 && !portable_only ? "bmi2" : "portable";
+}
+
+/*
+* Function: fill_single_entries
+* -----------------------------
+*  Fills the entries of every code that fits in the table.
+*
+*  table: Pointer to the DecodeTable object
+*  code_table: Codes of the tree
+*/
+static void fill_single_entries(DecodeTable* table, Code* code_table) {
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        int length = code_table[i].length;
+        if (length == 0 || length > table->width) {
+            continue;
+        }
+        // Every index starting with the code decodes to the symbol
+        size_t first = (size_t) code_table[i].code << (table->width - length);
+        size_t count = (size_t) 1 << (table->width - length);
+        for (size_t j = first; j < first + count; j++) {
+            table->entries[j].symbols[0] = (unsigned char) i;
+            table->entries[j].count = 1;
+            table->entries[j].length = length;
+        }
+    }
+}
+
+/*
+* Function: fill_multi_entries
+* ----------------------------
+*  Extends the single-symbol entries with the symbols following them
+*  while their codes still fit in the table.
+*
+*  table: Pointer to the DecodeTable object
+*  single: Single-symbol entries
+*/
+static void fill_multi_entries(DecodeTable* table, const DecodeEntry* single) {
+    size_t mask = ((size_t) 1 << table->width) - 1;
+    for (size_t i = 0; i <= mask; i++) {
+        DecodeEntry* entry = &table->entries[i];
+        *entry = single[i];
+        while (entry->count > 0 && entry->count < DECODE_TABLE_MAX_SYMBOLS) {
+            // The bits shifted in from the right are not part of the index
+            const DecodeEntry* next = &single[(i << entry->length) & mask];
+            if (next->count == 0 || entry->length + next->length > table->width) {
+                break;
+            }
+            entry->symbols[entry->count++] = next->symbols[0];
+            entry->length += next->length;
+        }
+    }
+}
+
+/*
+* Function: create_decode_table
+* -----------------------------
+*  Builds a lookup table of a huffman tree. Every entry holds the symbols
+*  whose codes fit in the next width bits: one symbol, or with multi-symbol
+*  entries up to DECODE_TABLE_MAX_SYMBOLS. Single-symbol tables are as wide
+*  as the longest code (8, 10, 11 or 12 bits), multi-symbol tables use 12.
+*
+*  root: Pointer to the root node of the huffman tree
+*
+*  returns: Pointer to the table. NULL if the tree should be walked
+*           instead (or if failed).
+*/
+DecodeTable* create_decode_table(Node* root) {
+    // A tree with a single symbol has no codes, every bit is one symbol
+    if (decode_table_mode == DECODE_TABLE_TREE || root == NULL
+        || (root->l_node == NULL && root->r_node == NULL)) {
+        return NULL;
+    }
+    Code code_table[FREQUENCY_TABLE_SIZE];
+    memset(code_table, 0, sizeof(code_table));
+    generate_huffman_code(code_table, 0, 0, root);
+
+    int multi_symbol = decode_table_mode == DECODE_TABLE_MULTI;
+    if (decode_table_mode == DECODE_TABLE_AUTO) {
+        // Average length if the symbol of a code occurs with probability 2^-length
+        double average_length = 0;
+        for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            if (code_table[i].length > 0) {
+                average_length += code_table[i].length / (double) ((uint64_t) 1 << code_table[i].length);
+            }
+        }
+        multi_symbol = average_length <= DECODE_MULTI_SYMBOL_MAX_LENGTH;
+    }
+
+    // Smaller tables are faster to build and stay in the cache
+    uint8_t max_length = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (code_table[i].length > max_length) {
+            max_length = code_table[i].length;
+        }
+    }
+    size_t width_index = 0;
+    size_t width_count = sizeof(table_widths) / sizeof(table_widths[0]);
+    while (width_index + 1 < width_count && (multi_symbol || table_widths[width_index] < max_length)) {
+        width_index++;
+    }
+
+    DecodeTable* table = malloc(sizeof(DecodeTable));
+    size_t entry_count = (size_t) 1 << table_widths[width_index];
+    DecodeEntry* single = calloc(entry_count, sizeof(DecodeEntry));
+    if (table == NULL || single == NULL) {
+        err("create_decode_table", "Unable to allocate memory for the table!");
+        free(table);
+        free(single);
+        return NULL;
+    }
+    table->width = table_widths[width_index];
+    table->multi_symbol = multi_symbol;
+    table->decode_run = select_decode_run(width_index);
+    table->entries = single;
+    fill_single_entries(table, code_table);
+    if (multi_symbol) {
+        table->entries = malloc(entry_count * sizeof(DecodeEntry));
+        if (table->entries == NULL) {
+            err("create_decode_table", "Unable to allocate memory for the table!");
+            free(single);
+            free(table);
+            return NULL;
+        }
+        fill_multi_entries(table, single);
+        free(single);
+    }
+    return table;
+}
+
+/*
+* Function: decode_table_run
+* --------------------------
+*  Decodes symbols from data until a code is longer than the table, the
+*  next symbols would pass bit_limit or symbol_limit, or fewer than 8 bytes
+*  are left in data. The caller continues from there by walking the tree.
+*
+*  table: Pointer to the DecodeTable object
+*  data: Encoded bytes
+*  data_size: Number of bytes in data
+*  bit_position: Position of the next bit in data (MSB first, updated)
+*  bit_limit: Bit position the symbols may not pass
+*  output: Destination buffer (DECODE_TABLE_MAX_SYMBOLS bytes longer than symbol_limit)
+*  symbol_limit: Maximum number of symbols to decode
+*
+*  returns: Number of decoded symbols
+*/
+size_t decode_table_run(const DecodeTable* table, const unsigned char* data, size_t data_size,
+                        size_t* bit_position, size_t bit_limit, unsigned char* output, size_t symbol_limit) {
+    return table->decode_run(table->entries, data, data_size, bit_position, bit_limit, output, symbol_limit);
+}
+
+/*
+* Function: decode_block
+* ----------------------
+*  Decodes a byte aligned block of codes in memory with the table, and
+*  with the tree where the table stops (long codes and the last 8 bytes).
+*
+*  root: Pointer to the root node of the huffman tree
+*  table: Pointer to the DecodeTable object (NULL walks the tree only)
+*  data: Encoded bytes
+*  data_size: Number of encoded bytes
+*  output: Destination buffer (DECODE_TABLE_MAX_SYMBOLS bytes longer than symbol_count)
+*  symbol_count: Number of symbols in the block
+*
+*  returns: Number of decoded symbols
+*/
+size_t decode_block(Node* root, const DecodeTable* table, const unsigned char* data, size_t data_size,
+                    unsigned char* output, size_t symbol_count) {
+    size_t decoded = 0;
+    size_t position = 0;
+    size_t total_bits = data_size * 8;
+    Node* current = root;
+    // A tree with a single symbol has no branches, every bit is one symbol
+    int has_branches = root->l_node != NULL || root->r_node != NULL;
+    while (position < total_bits && decoded < symbol_count) {
+        // The table stops at long codes and the last 8 bytes, the tree takes over there
+        if (table != NULL && current == root) {
+            size_t table_symbols = decode_table_run(table, data, data_size, &position, total_bits,
+                                                    output + decoded, symbol_count - decoded);
+            decoded += table_symbols;
+            if (table_symbols > 0) {
+                continue;
+            }
+        }
+        if (has_branches) {
+            current = (data[position / 8] >> (7 - position % 8)) & 1 ? current->r_node : current->l_node;
+            if (current == NULL) {
+                break;
+            }
+        }
+        position++;
+        if (current->l_node == NULL && current->r_node == NULL) {
+            output[decoded++] = current->symbol;
+            current = root;
+        }
+    }
+    return decoded;
+}
+
+/*
+* Function: free_decode_table
+* ---------------------------
+*  Frees the table.
+*
+*  table: Pointer to the DecodeTable object
+*/
+void free_decode_table(DecodeTable* table) {
+    if (table == NULL) {
+        return;
+    }
+    free(table->entries);
+    free(table);
+}
@@ -0,0 +1,486 @@
+#include "../include/bitio.h"
+#include "../include/compressor.h"
+#include "../include/constants.h"
+#include "../include/crc32c.h"
+#include "../include/dictionary.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/utils.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Table ID as 8 hex digits + ".hft"
+#define DICTIONARY_NAME_SIZE 13
+
+/*
+* Function: setup_dictionary
+* --------------------------
+*  Computes the ID and builds the tree and the codes of the frequencies.
+*
+*  dictionary: Pointer to the Dictionary object (frequency_table is set)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int setup_dictionary(Dictionary* dictionary) {
+    pthread_mutex_init(&dictionary->pair_table_lock, NULL);
+    unsigned char stored[FREQUENCY_TABLE_SIZE];
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (dictionary->frequency_table[i] == 0 || dictionary->frequency_table[i] > 255) {
+            err("setup_dictionary", "Invalid table frequency!");
+            return 0;
+        }
+        stored[i] = (unsigned char) dictionary->frequency_table[i];
+    }
+    dictionary->id = crc32c_update(0, stored, sizeof(stored));
+    dictionary->root = create_huffman_tree(dictionary->frequency_table, 0);
+    if (dictionary->root == NULL) {
+        return 0;
+    }
+    memset(dictionary->code_table, 0, sizeof(dictionary->code_table));
+    generate_huffman_code(dictionary->code_table, 0, 0, dictionary->root);
+    return 1;
+}
+
+/*
+* Function: create_dictionary
+* ---------------------------
+*  Builds a table from combined frequencies.
+*
+*  frequency_table: Pointer to the frequency table (Every symbol at least 1)
+*
+*  returns: Pointer to the Dictionary object. If failed, returns NULL.
+*/
+Dictionary* create_dictionary(size_t* frequency_table) {
+    Dictionary* dictionary = calloc(1, sizeof(Dictionary));
+    if (dictionary == NULL) {
+        err("create_dictionary", "Unable to allocate memory for the table!");
+        return NULL;
+    }
+    size_t max_count = 0;
+    get_list_size(frequency_table, &max_count);
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        dictionary->frequency_table[i] = scale_down(frequency_table[i], max_count);
+    }
+    if (setup_dictionary(dictionary) == 0) {
+        free_dictionary(dictionary);
+        return NULL;
+    }
+    return dictionary;
+}
+
+/*
+* Function: train_dictionary
+* --------------------------
+*  Builds a table from the combined frequencies of sample files.
+*
+*  samples: Pointer to the PathList of the sample files
+*
+*  returns: Pointer to the Dictionary object. If failed, returns NULL.
+*/
+Dictionary* train_dictionary(PathList* samples) {
+    if (samples == NULL || samples->count == 0) {
+        err("train_dictionary", "No sample files!");
+        return NULL;
+    }
+    // Every symbol gets a code, even if the samples don't contain it
+    size_t frequency_table[FREQUENCY_TABLE_SIZE];
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        frequency_table[i] = 1;
+    }
+    for (size_t i = 0; i < samples->count; i++) {
+        FILE* sample = open_file(samples->paths[i], "rb");
+        if (sample == NULL) {
+            return NULL;
+        }
+        ssize_t read_bytes = count_frequencies(sample, frequency_table);
+        fclose(sample);
+        if (read_bytes == -1) {
+            return NULL;
+        }
+    }
+    return create_dictionary(frequency_table);
+}
+
+/*
+* Function: dictionary_path
+* -------------------------
+*  Returns the path of a table ID in the table directory.
+*
+*  id: Table ID
+*
+*  returns: Allocated path. If failed, returns NULL.
+*/
+static char* dictionary_path(uint32_t id) {
+    const char* directory = getenv(DICTIONARY_DIR_ENV);
+    if (directory == NULL || directory[0] == '\0') {
+        directory = ".";
+    }
+    char* path = malloc(strlen(directory) + DICTIONARY_NAME_SIZE + 2);
+    if (path == NULL) {
+        err("dictionary_path", "Unable to allocate memory for the table path!");
+        return NULL;
+    }
+    sprintf(path, "%s/%08x.hft", directory, (unsigned) id);
+    return path;
+}
+
+/*
+* Function: save_dictionary
+* -------------------------
+*  Writes a table file.
+*
+*  dictionary: Pointer to the Dictionary object
+*  path: Table file path (NULL saves '<id>.hft' in the table directory)
+*
+*  returns: If failed (0), On success (1)
+*/
+int save_dictionary(Dictionary* dictionary, const char* path) {
+    char* default_path = path == NULL ? dictionary_path(dictionary->id) : NULL;
+    if (path == NULL && default_path == NULL) {
+        return 0;
+    }
+    FILE* file = open_file(path != NULL ? path : default_path, "wb");
+    if (file == NULL) {
+        free(default_path);
+        return 0;
+    }
+    unsigned char stored[FREQUENCY_TABLE_SIZE];
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        stored[i] = (unsigned char) dictionary->frequency_table[i];
+    }
+    int result = fwrite(dictionary_magic, sizeof(unsigned char), sizeof(dictionary_magic), file) == sizeof(dictionary_magic)
+                 && write_uint(file, DICTIONARY_VERSION, 1) && write_uint(file, dictionary->id, 4)
+                 && fwrite(stored, sizeof(unsigned char), sizeof(stored), file) == sizeof(stored);
+    if (fclose(file) != 0) {
+        result = 0;
+    }
+    if (!result) {
+        err("save_dictionary", "Unable to write the table file!");
+        remove(path != NULL ? path : default_path);
+    }
+    free(default_path);
+    return result;
+}
+
+/*
+* Function: parse_id
+* ------------------
+*  Parses a table ID (8 hex digits).
+*
+*  name: Text to parse
+*  id: Pointer to store the ID
+*
+*  returns: If it is not an ID (0), On success (1)
+*/
+static int parse_id(const char* name, uint32_t* id) {
+    if (strlen(name) != 8) {
+        return 0;
+    }
+    for (size_t i = 0; i < 8; i++) {
+        if (!isxdigit((unsigned char) name[i])) {
+            return 0;
+        }
+    }
+    *id = (uint32_t) strtoul(name, NULL, 16);
+    return 1;
+}
+
+/*
+* Function: read_dictionary
+* -------------------------
+*  Reads a table file.
+*
+*  path: Table file path
+*
+*  returns: Pointer to the Dictionary object. If failed, returns NULL.
+*/
+static Dictionary* read_dictionary(const char* path) {
+    FILE* file = open_file(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    unsigned char magic[sizeof(dictionary_magic)];
+    unsigned char stored[FREQUENCY_TABLE_SIZE];
+    uint64_t version = 0;
+    uint64_t id = 0;
+    int result = fread(magic, sizeof(unsigned char), sizeof(magic), file) == sizeof(magic)
+                 && memcmp(magic, dictionary_magic, sizeof(magic)) == 0
+                 && read_uint(file, &version, 1) && version == DICTIONARY_VERSION && read_uint(file, &id, 4)
+                 && fread(stored, sizeof(unsigned char), sizeof(stored), file) == sizeof(stored);
+    fclose(file);
+    if (!result) {
+        fprintf(stderr, "\n[ERROR]: read_dictionary() {} -> '%s' is not a table file!\n", path);
+        return NULL;
+    }
+
+    Dictionary* dictionary = calloc(1, sizeof(Dictionary));
+    if (dictionary == NULL) {
+        err("read_dictionary", "Unable to allocate memory for the table!");
+        return NULL;
+    }
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        dictionary->frequency_table[i] = stored[i];
+    }
+    if (setup_dictionary(dictionary) == 0 || dictionary->id != id) {
+        fprintf(stderr, "\n[ERROR]: read_dictionary() {} -> '%s' is corrupted!\n", path);
+        free_dictionary(dictionary);
+        return NULL;
+    }
+    return dictionary;
+}
+
+/*
+* Function: load_dictionary
+* -------------------------
+*  Loads a table by path or by ID. An ID (8 hex digits) is looked up as
+*  '<id>.hft' in the directory of the HUFFMAN_TABLES environment variable
+*  (default: the current directory).
+*
+*  name: Table file path or ID
+*
+*  returns: Pointer to the Dictionary object. If failed, returns NULL.
+*/
+Dictionary* load_dictionary(const char* name) {
+    struct stat path_stat;
+    uint32_t id = 0;
+    if (stat(name, &path_stat) != 0 && parse_id(name, &id)) {
+        char* path = dictionary_path(id);
+        if (path == NULL) {
+            return NULL;
+        }
+        Dictionary* dictionary = read_dictionary(path);
+        free(path);
+        return dictionary;
+    }
+    return read_dictionary(name);
+}
+
+/*
+* Function: free_dictionary
+* -------------------------
+*  Frees the Dictionary object.
+*
+*  dictionary: Pointer to the Dictionary object
+*/
+void free_dictionary(Dictionary* dictionary) {
+    if (dictionary == NULL) {
+        return;
+    }
+    if (dictionary->root != NULL) {
+        free_tree(dictionary->root);
+    }
+    pthread_mutex_destroy(&dictionary->pair_table_lock);
+    free(dictionary->pair_table);
+    free(dictionary);
+}
+
+/*
+* Function: is_dictionary_stream
+* ------------------------------
+*  Checks if the file was compressed with a trained table.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it was, otherwise (0)
+*/
+int is_dictionary_stream(FILE* file) {
+    return has_magic(file, dictionary_stream_magic, sizeof(dictionary_stream_magic));
+}
+
+/*
+* Function: get_pair_table
+* ------------------------
+*  Returns the pair table of the dictionary, built on the first call.
+*  The table pays off even for small inputs, since it is built only once.
+*
+*  dictionary: Pointer to the Dictionary object
+*
+*  returns: Pointer to the pair table. NULL if the codes are too long (or if failed).
+*/
+static Code* get_pair_table(Dictionary* dictionary) {
+    pthread_mutex_lock(&dictionary->pair_table_lock);
+    if (!dictionary->pair_table_built) {
+        dictionary->pair_table_built = 1;
+        dictionary->pair_table = malloc(PAIR_TABLE_SIZE * sizeof(Code));
+        if (dictionary->pair_table != NULL && fill_pair_table(dictionary->code_table, dictionary->pair_table) == 0) {
+            free(dictionary->pair_table);
+            dictionary->pair_table = NULL;
+        }
+    }
+    pthread_mutex_unlock(&dictionary->pair_table_lock);
+    return dictionary->pair_table;
+}
+
+/*
+* Function: write_stream_header
+* -----------------------------
+*  Stores the header of a stream compressed with a trained table.
+*
+*  dictionary: Pointer to the Dictionary object
+*  size: Number of input bytes
+*  header: Output buffer (At least DICTIONARY_STREAM_MAX_HEADER_SIZE bytes)
+*
+*  returns: Number of bytes stored
+*/
+size_t write_stream_header(const Dictionary* dictionary, uint64_t size, unsigned char* header) {
+    size_t header_size = 0;
+    memcpy(header, dictionary_stream_magic, sizeof(dictionary_stream_magic));
+    header_size += sizeof(dictionary_stream_magic);
+    for (int i = 0; i < 4; i++) {
+        header[header_size++] = (unsigned char) (dictionary->id >> (8 * i));
+    }
+    // LEB128 varint (see write_varint)
+    do {
+        header[header_size] = size & 0x7F;
+        size >>= 7;
+        if (size != 0) {
+            header[header_size] |= 0x80;
+        }
+        header_size++;
+    } while (size != 0);
+    return header_size;
+}
+
+/*
+* Function: read_stream_header
+* ----------------------------
+*  Reads a header written by write_stream_header from a buffer.
+*
+*  header: Stored header (followed by the encoded data)
+*  size: Number of bytes in the buffer
+*  id: Pointer to store the ID of the table
+*  original_size: Pointer to store the number of input bytes
+*
+*  returns: Size of the header. If failed, returns 0.
+*/
+size_t read_stream_header(const unsigned char* header, size_t size, uint32_t* id, uint64_t* original_size) {
+    size_t header_size = sizeof(dictionary_stream_magic) + 4;
+    if (size < header_size || memcmp(header, dictionary_stream_magic, sizeof(dictionary_stream_magic)) != 0) {
+        err("read_stream_header", "File is corrupted!");
+        return 0;
+    }
+    *id = 0;
+    for (int i = 0; i < 4; i++) {
+        *id |= (uint32_t) header[sizeof(dictionary_stream_magic) + i] << (8 * i);
+    }
+    // LEB128 varint (see write_varint)
+    *original_size = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (header_size >= size) {
+            break;
+        }
+        unsigned char byte = header[header_size++];
+        *original_size |= (uint64_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return header_size;
+        }
+    }
+    err("read_stream_header", "File is corrupted!");
+    return 0;
+}
+
+/*
+* Function: compress_with_dictionary
+* ----------------------------------
+*  Compresses the input file with a trained table. No frequencies are
+*  counted and the output only stores the table's ID and the input size.
+*
+*  dictionary: Pointer to the Dictionary object
+*  bit_writer: BitWriter to reuse (NULL creates one)
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_with_dictionary(Dictionary* dictionary, BitWriter* bit_writer, FILE* input_file, FILE* output_file) {
+    if (dictionary == NULL || input_file == NULL || output_file == NULL) {
+        err("compress_with_dictionary", "Table or input/output file is NULL!");
+        return 0;
+    }
+    BitWriter* own_writer = bit_writer == NULL ? init_writer(output_file) : NULL;
+    if (bit_writer == NULL && own_writer == NULL) {
+        return 0;
+    }
+    if (bit_writer != NULL) {
+        reset_writer(bit_writer, output_file);
+    } else {
+        bit_writer = own_writer;
+    }
+
+    unsigned char header[DICTIONARY_STREAM_MAX_HEADER_SIZE];
+    size_t header_size = write_stream_header(dictionary, get_file_size(input_file), header);
+    int result = fwrite(header, sizeof(unsigned char), header_size, output_file) == header_size
+                 && encode(input_file, bit_writer, dictionary->code_table, get_pair_table(dictionary));
+
+    if (own_writer != NULL) {
+        free(own_writer->buffer);
+        free(own_writer);
+    }
+    return result;
+}
+
+/*
+* Function: decompress_with_dictionary
+* ------------------------------------
+*  Decompresses a file compressed with a trained table.
+*
+*  dictionary: Pointer to the Dictionary object (NULL loads the table by the stream's ID)
+*  bit_reader: BitReader to reuse (NULL creates one)
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_with_dictionary(Dictionary* dictionary, BitReader* bit_reader, FILE* input_file, FILE* output_file) {
+    unsigned char magic[sizeof(dictionary_stream_magic)];
+    uint64_t id = 0;
+    uint64_t original_size = 0;
+    fseeko(input_file, 0, SEEK_SET);
+    if (fread(magic, sizeof(unsigned char), sizeof(magic), input_file) < sizeof(magic)
+        || memcmp(magic, dictionary_stream_magic, sizeof(magic)) != 0
+        || !read_uint(input_file, &id, 4) || !read_varint(input_file, &original_size)) {
+        err("decompress_with_dictionary", "File is corrupted!");
+        return 0;
+    }
+
+    Dictionary* own_dictionary = NULL;
+    if (dictionary == NULL) {
+        char name[DICTIONARY_NAME_SIZE];
+        sprintf(name, "%08x", (unsigned) id);
+        own_dictionary = dictionary = load_dictionary(name);
+        if (dictionary == NULL) {
+            return 0;
+        }
+    }
+    if (dictionary->id != id) {
+        fprintf(stderr, "\n[ERROR]: decompress_with_dictionary() {} -> File needs table %08x, not %08x!\n",
+                (unsigned) id, (unsigned) dictionary->id);
+        free_dictionary(own_dictionary);
+        return 0;
+    }
+
+    BitReader* own_reader = bit_reader == NULL ? init_reader(input_file) : NULL;
+    int result = 0;
+    if (bit_reader != NULL || own_reader != NULL) {
+        if (bit_reader != NULL) {
+            reset_reader(bit_reader, input_file);
+        } else {
+            bit_reader = own_reader;
+        }
+        uint64_t data_bytes = get_file_size(input_file) - ftello(input_file);
+        result = decode_symbols(output_file, bit_reader, dictionary->root, data_bytes * 8, original_size);
+    }
+
+    if (own_reader != NULL) {
+        free(own_reader->buffer);
+        free(own_reader);
+    }
+    free_dictionary(own_dictionary);
+    return result;
+}
@@ -0,0 +1,208 @@
+#include "../include/compact.h"
+#include "../include/constants.h"
+#include "../include/estimate.h"
+#include "../include/packed.h"
+#include "../include/stored.h"
+#include "../include/tans.h"
+#include "../include/utils.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* format_names[] = {"legacy", "compact", "packed", "tANS", "stored"};
+
+/*
+* Function: symbol_set_size
+* -------------------------
+*  Returns the number of bytes write_symbol_set stores for the present symbols.
+*
+*  lengths: Non-zero for every present symbol
+*/
+static size_t symbol_set_size(const uint8_t* lengths) {
+    unsigned char buffer[COMPACT_BITMAP_SIZE];
+    unsigned char flags = 0;
+    return write_symbol_set(lengths, buffer, &flags);
+}
+
+/*
+* Function: estimate_entropy
+* --------------------------
+*  Returns the order-0 entropy of a histogram: the sum of
+*  frequency * log2(total / frequency).
+*
+*  frequency_table: Pointer to the frequency table
+*
+*  returns: Entropy in bits
+*/
+double estimate_entropy(size_t* frequency_table) {
+    size_t total = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        total += frequency_table[i];
+    }
+    double entropy = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (frequency_table[i] > 0) {
+            entropy += frequency_table[i] * log2((double) total / frequency_table[i]);
+        }
+    }
+    return entropy;
+}
+
+/*
+* Function: estimate_size
+* -----------------------
+*  Computes the size compress would write from the histogram alone, with
+*  the same format choice and without encoding anything. The huffman sizes
+*  are exact: the sum of frequency * code length plus the header. A sampled
+*  histogram gives the same table as compress, but its bit counts are
+*  scaled to the input size.
+*
+*  context: Pointer to the context (frequency_table counted or sampled by
+*           the caller, code_table is overwritten)
+*  input_size: Size of the input
+*  estimate: Pointer to the SizeEstimate object to fill
+*
+*  returns: If failed (0), On success (1)
+*/
+int estimate_size(HuffContext* context, uint64_t input_size, SizeEstimate* estimate) {
+    if (context == NULL || estimate == NULL) {
+        err("estimate_size", "Context and/or estimate is NULL!");
+        return 0;
+    }
+    size_t* frequency_table = context->frequency_table;
+    memset(estimate, 0, sizeof(SizeEstimate));
+    size_t symbol_count = 0;
+    uint64_t counted_size = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        counted_size += frequency_table[i];
+        symbol_count += frequency_table[i] > 0;
+    }
+    estimate->input_size = input_size;
+    estimate->sampled = counted_size != input_size;
+    // A sample covers only part of the input
+    double scale = counted_size > 0 ? (double) input_size / counted_size : 1;
+    estimate->entropy_bits = estimate_entropy(frequency_table) * scale;
+
+    uint64_t total_bits = 0;
+    if (estimate->input_size < COMPACT_MAX_SIZE) {
+        // Magic and flags, the symbol set and two code lengths per byte
+        if (compute_code_lengths(frequency_table, estimate->code_lengths, COMPACT_MAX_CODE_LENGTH) == 0) {
+            return 0;
+        }
+        for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            total_bits += (uint64_t) frequency_table[i] * estimate->code_lengths[i];
+        }
+        estimate->format = ESTIMATE_COMPACT;
+        estimate->huffman_size = 3 + symbol_set_size(estimate->code_lengths) + (symbol_count + 1) / 2
+                                 + (total_bits + 7) / 8;
+        estimate->output_size = estimate->huffman_size;
+        return 1;
+    }
+
+    if (fill_code_table(frequency_table, context->code_table) == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        estimate->code_lengths[i] = context->code_table[i].length;
+        total_bits += (uint64_t) frequency_table[i] * context->code_table[i].length;
+    }
+    if (estimate->sampled) {
+        total_bits = (uint64_t) (total_bits * scale);
+    }
+    // Table size, a symbol and its scaled frequency for every symbol, the data and the remaining bit count
+    estimate->huffman_size = 1 + 2 * symbol_count + (total_bits + 7) / 8 + 1;
+    estimate->format = ESTIMATE_LEGACY;
+    estimate->output_size = estimate->huffman_size;
+
+    if (prefer_tans(frequency_table, context->code_table)) {
+        estimate->format = ESTIMATE_TANS;
+        estimate->output_size = estimate_tans_size(frequency_table, input_size);
+    } else if (prefer_packed(frequency_table, context->code_table)) {
+        // Magic and flags, the symbol set and the indexes
+        uint8_t present[FREQUENCY_TABLE_SIZE];
+        for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            present[i] = frequency_table[i] > 0;
+        }
+        estimate->format = ESTIMATE_PACKED;
+        estimate->output_size = 3 + symbol_set_size(present)
+                                + (estimate->input_size * packed_width(frequency_table) + 7) / 8;
+    }
+    return 1;
+}
+
+/*
+* Function: estimate_file
+* -----------------------
+*  Counts the frequencies of the input file (or samples them, like
+*  compress_with_context, if the context has a sample size) and estimates
+*  its compressed size.
+*  Inputs the entropy probe of compress finds incompressible are reported
+*  as stored (see probe_incompressible).
+*
+*  context: Pointer to the context
+*  input_file: Pointer to the input_file
+*  estimate: Pointer to the SizeEstimate object to fill
+*
+*  returns: If failed (0), On success (1)
+*/
+int estimate_file(HuffContext* context, FILE* input_file, SizeEstimate* estimate) {
+    if (context == NULL || input_file == NULL) {
+        err("estimate_file", "Input file is NULL!");
+        return 0;
+    }
+    // Like compress, inputs that get the compact header are always counted
+    uint64_t input_size = get_file_size(input_file);
+    memset(context->frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    ssize_t result = context->sample_size > 0 && input_size >= COMPACT_MAX_SIZE
+                     ? sample_frequencies(input_file, context->frequency_table, context->sample_size)
+                     : count_frequencies(input_file, context->frequency_table);
+    if (result == -1) {
+        return 0;
+    }
+    if (estimate_size(context, input_size, estimate) == 0) {
+        return 0;
+    }
+    // Magic, flags and the original size
+    if (estimate->input_size >= COMPACT_MAX_SIZE && probe_incompressible(input_file)) {
+        estimate->format = ESTIMATE_STORED;
+        estimate->output_size = 3 + 8 + estimate->input_size;
+    }
+    return 1;
+}
+
+/*
+* Function: print_estimate
+* ------------------------
+*  Prints the sizes, the entropy bound and the code length of every present symbol.
+*  Sizes that are not exact (tANS, scaled from a sample) are marked as estimated.
+*
+*  estimate: Pointer to the SizeEstimate object
+*  output: Pointer to the output stream
+*/
+void print_estimate(const SizeEstimate* estimate, FILE* output) {
+    double input_size = estimate->input_size > 0 ? estimate->input_size : 1;
+    // Packed and stored sizes only depend on the input size
+    int output_estimated = estimate->format == ESTIMATE_TANS
+                           || (estimate->sampled && estimate->format == ESTIMATE_LEGACY);
+    const char* sampled = estimate->sampled ? ", estimated" : "";
+    fprintf(output, "%-10s %14" PRIu64 "\n", "Input", estimate->input_size);
+    fprintf(output, "%-10s %14" PRIu64 " (%.2f%%, %s%s)\n", "Output", estimate->output_size,
+            estimate->output_size * 100.0 / input_size, format_names[estimate->format],
+            output_estimated ? ", estimated" : "");
+    fprintf(output, "%-10s %14" PRIu64 " (%.3f bits/byte%s)\n", "Huffman", estimate->huffman_size,
+            estimate->huffman_size * 8.0 / input_size, sampled);
+    fprintf(output, "%-10s %14.0f (%.3f bits/byte%s)\n", "Entropy", ceil(estimate->entropy_bits / 8),
+            estimate->entropy_bits / input_size, sampled);
+
+    fprintf(output, "\nCode lengths:");
+    size_t column = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (estimate->code_lengths[i] > 0) {
+            fprintf(output, "%s%02zX:%2u", column++ % 8 == 0 ? "\n  " : "  ", i, estimate->code_lengths[i]);
+        }
+    }
+    fprintf(output, "\n");
+}
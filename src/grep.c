@@ -0,0 +1,482 @@
+#define _GNU_SOURCE
+#include "../include/constants.h"
+#include "../include/decodetable.h"
+#include "../include/grep.h"
+#include "../include/huffman.h"
+#include "../include/record.h"
+#include "../include/seekable.h"
+#include "../include/utils.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A code boundary can be at any bit of a byte
+#define BIT_SHIFTS 8
+
+/*
+* Encoded pattern of one table at every bit alignment. Row shift holds
+* the pattern's bits starting at bit shift of the first byte, and the
+* mask marks the bits that belong to the pattern.
+*/
+typedef struct {
+    Code code_table[FREQUENCY_TABLE_SIZE];
+    int present; // Every symbol of the pattern has a code in the table
+    size_t row_size;
+    size_t byte_counts[BIT_SHIFTS]; // Bytes covered by the pattern at every shift
+    int anchors[BIT_SHIFTS]; // A byte made only of pattern bits (-1 if there is none)
+    unsigned char* bytes; // BIT_SHIFTS rows of row_size bytes
+    unsigned char* masks;
+} BitPattern;
+
+typedef struct {
+    FILE* output_file;
+    const char* name;
+    int records; // Print the records (1) or the offsets (0)
+} GrepOutput;
+
+/*
+* Function: build_bit_pattern
+* ---------------------------
+*  Encodes the pattern with the codes of a tree at every bit alignment.
+*
+*  bit_pattern: Pointer to the BitPattern object to fill
+*  root: Pointer to the root node of the huffman tree (NULL for empty files)
+*  pattern: Bytes to find
+*  pattern_length: Number of bytes
+*
+*  returns: If failed (0), On success (1)
+*/
+static int build_bit_pattern(BitPattern* bit_pattern, Node* root, const unsigned char* pattern, size_t pattern_length) {
+    memset(bit_pattern, 0, sizeof(BitPattern));
+    if (root != NULL) {
+        generate_huffman_code(bit_pattern->code_table, 0, 0, root);
+    }
+    uint64_t bit_count = 0;
+    bit_pattern->present = 1;
+    for (size_t i = 0; i < pattern_length; i++) {
+        bit_pattern->present = bit_pattern->present && bit_pattern->code_table[pattern[i]].length > 0;
+        bit_count += bit_pattern->code_table[pattern[i]].length;
+    }
+    if (!bit_pattern->present) {
+        return 1;
+    }
+    bit_pattern->row_size = (bit_count + BIT_SHIFTS - 1 + 7) / 8;
+    bit_pattern->bytes = calloc(BIT_SHIFTS, bit_pattern->row_size);
+    bit_pattern->masks = calloc(BIT_SHIFTS, bit_pattern->row_size);
+    if (bit_pattern->bytes == NULL || bit_pattern->masks == NULL) {
+        err("build_bit_pattern", "Unable to allocate memory for the pattern!");
+        return 0;
+    }
+    for (int shift = 0; shift < BIT_SHIFTS; shift++) {
+        unsigned char* row = bit_pattern->bytes + shift * bit_pattern->row_size;
+        unsigned char* mask = bit_pattern->masks + shift * bit_pattern->row_size;
+        uint64_t position = shift;
+        for (size_t i = 0; i < pattern_length; i++) {
+            Code code = bit_pattern->code_table[pattern[i]];
+            for (int bit = code.length - 1; bit >= 0; bit--, position++) {
+                row[position / 8] |= ((code.code >> bit) & 1) << (7 - position % 8);
+                mask[position / 8] |= 1 << (7 - position % 8);
+            }
+        }
+        bit_pattern->byte_counts[shift] = (position + 7) / 8;
+        bit_pattern->anchors[shift] = -1;
+        for (size_t j = 0; j < bit_pattern->byte_counts[shift] && bit_pattern->anchors[shift] == -1; j++) {
+            if (mask[j] == 0xFF) {
+                bit_pattern->anchors[shift] = j;
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: free_bit_pattern
+* --------------------------
+*  Frees the rows of the BitPattern object.
+*
+*  bit_pattern: Pointer to the BitPattern object
+*/
+static void free_bit_pattern(BitPattern* bit_pattern) {
+    free(bit_pattern->bytes);
+    free(bit_pattern->masks);
+}
+
+/*
+* Function: find_bit_pattern
+* --------------------------
+*  Checks if the encoded pattern occurs at any bit of the data. A hit is
+*  only a candidate: it may start in the middle of a code.
+*
+*  bit_pattern: Pointer to the BitPattern object
+*  data: Encoded bytes
+*  size: Number of bytes
+*
+*  returns: (1) if there is a candidate, otherwise (0)
+*/
+static int find_bit_pattern(const BitPattern* bit_pattern, const unsigned char* data, size_t size) {
+    if (!bit_pattern->present) {
+        return 0;
+    }
+    for (int shift = 0; shift < BIT_SHIFTS; shift++) {
+        size_t byte_count = bit_pattern->byte_counts[shift];
+        if (byte_count > size) {
+            continue;
+        }
+        const unsigned char* row = bit_pattern->bytes + shift * bit_pattern->row_size;
+        const unsigned char* mask = bit_pattern->masks + shift * bit_pattern->row_size;
+        int anchor = bit_pattern->anchors[shift];
+        size_t last = size - byte_count;
+        for (size_t start = 0; start <= last; start++) {
+            // Jump to the next copy of a whole pattern byte
+            if (anchor >= 0) {
+                const unsigned char* hit = memchr(data + start + anchor, row[anchor], last - start + 1);
+                if (hit == NULL) {
+                    break;
+                }
+                start = hit - data - anchor;
+            }
+            size_t j = 0;
+            while (j < byte_count && (data[start + j] & mask[j]) == row[j]) {
+                j++;
+            }
+            if (j == byte_count) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+* Function: starts_with_suffix
+* ----------------------------
+*  Checks if the data starts with the codes of a proper suffix of the
+*  pattern, so a match may continue from the end of the previous segment.
+*  The first bit of a segment is always a code boundary, so this is exact.
+*
+*  bit_pattern: Pointer to the BitPattern object (for the codes)
+*  pattern: Bytes to find
+*  pattern_length: Number of bytes
+*  data: Encoded bytes
+*  size: Number of bytes
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+static int starts_with_suffix(const BitPattern* bit_pattern, const unsigned char* pattern, size_t pattern_length,
+                              const unsigned char* data, size_t size) {
+    for (size_t start = 1; start < pattern_length; start++) {
+        uint64_t position = 0;
+        size_t i = start;
+        for (; i < pattern_length; i++) {
+            Code code = bit_pattern->code_table[pattern[i]];
+            if (code.length == 0 || position + code.length > (uint64_t) size * 8) {
+                break;
+            }
+            int bit = code.length - 1;
+            while (bit >= 0 && ((data[position / 8] >> (7 - position % 8)) & 1) == ((code.code >> bit) & 1)) {
+                bit--;
+                position++;
+            }
+            if (bit >= 0) {
+                break;
+            }
+        }
+        if (i == pattern_length) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+* Function: decode_seekable_segment
+* ---------------------------------
+*  Reads and decodes a segment of a seekable file.
+*
+*  seekable: Pointer to the SeekableFile object
+*  segment: Index of the segment
+*  data: Buffer for the encoded bytes (segment_buffer_size bytes)
+*  output: Destination buffer (DECODE_TABLE_MAX_SYMBOLS bytes longer than the segment)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int decode_seekable_segment(SeekableFile* seekable, uint32_t segment, unsigned char* data, unsigned char* output) {
+    SyncPoint* start = &seekable->sync_points[segment];
+    SyncPoint* end = &seekable->sync_points[segment + 1];
+    size_t data_size = end->compressed_offset - start->compressed_offset;
+    size_t symbol_count = end->uncompressed_offset - start->uncompressed_offset;
+    SeekableTable* table = &seekable->tables[start->table];
+    if (read_at(seekable->file, data, data_size, start->compressed_offset) == 0
+        || decode_block(table->root, table->decode_table, data, data_size, output, symbol_count) < symbol_count) {
+        err("grep", "Segment is corrupted!");
+        return 0;
+    }
+    return 1;
+}
+
+/*
+* Function: report_matches
+* ------------------------
+*  Calls the function for every occurrence of the pattern in decoded data.
+*
+*  data: Decoded bytes
+*  size: Number of bytes
+*  limit: Only occurrences starting before this index are reported
+*  pattern: Bytes to find
+*  pattern_length: Number of bytes
+*  offset: Original offset of data[0]
+*  function: Called for every match
+*  argument: Passed to the function
+*  stats: Pointer to the GrepStats object
+*
+*  returns: (1) to continue, (0) if the function stopped the search
+*/
+static int report_matches(const unsigned char* data, size_t size, size_t limit, const unsigned char* pattern,
+                          size_t pattern_length, uint64_t offset, GrepFunction function, void* argument, GrepStats* stats) {
+    const unsigned char* hit = data;
+    while ((hit = memmem(hit, data + size - hit, pattern, pattern_length)) != NULL && (size_t) (hit - data) < limit) {
+        stats->matches++;
+        if (!function(argument, offset + (hit - data), hit, pattern_length)) {
+            return 0;
+        }
+        hit++;
+    }
+    return 1;
+}
+
+/*
+* Function: grep_seekable
+* -----------------------
+*  Finds the pattern in a seekable file (see huff_grep). A match that
+*  crosses into a segment starts it with a suffix of the pattern, then the
+*  previous segment is decoded too.
+*
+*  returns: If failed (0), On success (1)
+*/
+static int grep_seekable(FILE* input_file, const unsigned char* pattern, size_t pattern_length,
+                         GrepFunction function, void* argument, GrepStats* stats) {
+    SeekableFile* seekable = seekable_open(input_file);
+    if (seekable == NULL) {
+        return 0;
+    }
+    if (pattern_length > seekable->segment_size) {
+        err("grep", "The pattern is longer than a segment!");
+        seekable_close(seekable);
+        return 0;
+    }
+    size_t carry_capacity = pattern_length - 1;
+    BitPattern* patterns = calloc(seekable->table_count + 1, sizeof(BitPattern));
+    unsigned char* data = malloc(seekable->segment_buffer_size + 1);
+    unsigned char* output = malloc(seekable->segment_size + DECODE_TABLE_MAX_SYMBOLS);
+    // Decoded tail of the previous segment followed by the head of the current one
+    unsigned char* window = malloc(2 * carry_capacity + 1);
+    int result = patterns != NULL && data != NULL && output != NULL && window != NULL;
+    if (!result) {
+        err("grep", "Unable to allocate memory for the segments!");
+    }
+    for (uint32_t i = 0; i < seekable->table_count && result; i++) {
+        result = build_bit_pattern(&patterns[i], seekable->tables[i].root, pattern, pattern_length);
+    }
+
+    size_t carry_size = 0; // Bytes of the previous segment in the window (0 if it was not decoded)
+    int searching = 1; // The function did not stop the search
+    for (uint32_t i = 0; i < seekable->segment_count && result && searching; i++) {
+        SyncPoint* start = &seekable->sync_points[i];
+        SyncPoint* end = &seekable->sync_points[i + 1];
+        size_t data_size = end->compressed_offset - start->compressed_offset;
+        size_t symbol_count = end->uncompressed_offset - start->uncompressed_offset;
+        BitPattern* bit_pattern = &patterns[start->table];
+        stats->regions++;
+        if (read_at(seekable->file, data, data_size, start->compressed_offset) == 0) {
+            err("grep", "Unable to read the segment!");
+            result = 0;
+            break;
+        }
+        int inside = find_bit_pattern(bit_pattern, data, data_size);
+        int across = i > 0 && starts_with_suffix(bit_pattern, pattern, pattern_length, data, data_size);
+        if (!inside && !across) {
+            carry_size = 0;
+            continue;
+        }
+        if (across && carry_size == 0) {
+            SyncPoint* previous = &seekable->sync_points[i - 1];
+            size_t previous_count = start->uncompressed_offset - previous->uncompressed_offset;
+            result = decode_seekable_segment(seekable, i - 1, data, output);
+            carry_size = previous_count < carry_capacity ? previous_count : carry_capacity;
+            memcpy(window, output + previous_count - carry_size, carry_size);
+            stats->decoded++;
+            result = result && read_at(seekable->file, data, data_size, start->compressed_offset);
+        }
+        SeekableTable* table = &seekable->tables[start->table];
+        if (result && decode_block(table->root, table->decode_table, data, data_size, output, symbol_count) < symbol_count) {
+            err("grep", "Segment is corrupted!");
+            result = 0;
+        }
+        if (!result) {
+            break;
+        }
+        stats->decoded++;
+        // Matches starting in the previous segment, then the ones in this segment
+        if (across) {
+            size_t head_size = symbol_count < carry_capacity ? symbol_count : carry_capacity;
+            memcpy(window + carry_size, output, head_size);
+            searching = report_matches(window, carry_size + head_size, carry_size, pattern, pattern_length,
+                                       start->uncompressed_offset - carry_size, function, argument, stats);
+        }
+        searching = searching && report_matches(output, symbol_count, symbol_count, pattern, pattern_length,
+                                                start->uncompressed_offset, function, argument, stats);
+        carry_size = symbol_count < carry_capacity ? symbol_count : carry_capacity;
+        memcpy(window, output + symbol_count - carry_size, carry_size);
+    }
+
+    for (uint32_t i = 0; patterns != NULL && i < seekable->table_count; i++) {
+        free_bit_pattern(&patterns[i]);
+    }
+    free(patterns);
+    free(data);
+    free(output);
+    free(window);
+    seekable_close(seekable);
+    return result;
+}
+
+/*
+* Function: grep_records
+* ----------------------
+*  Finds the records with the pattern in a record file (see huff_grep).
+*  The encoded records of a group are read at once.
+*
+*  returns: If failed (0), On success (1)
+*/
+static int grep_records(FILE* input_file, const unsigned char* pattern, size_t pattern_length,
+                        GrepFunction function, void* argument, GrepStats* stats) {
+    RecordFile* records = record_open(input_file);
+    if (records == NULL) {
+        return 0;
+    }
+    BitPattern bit_pattern;
+    unsigned char* data = malloc(RECORD_GROUP_SIZE * records->max_size + 1);
+    int result = build_bit_pattern(&bit_pattern, records->root, pattern, pattern_length);
+    if (result && data == NULL) {
+        err("grep", "Unable to allocate memory for the records!");
+        result = 0;
+    }
+    int searching = 1; // The function did not stop the search
+    for (uint64_t group = 0; group < records->group_count && result && searching; group++) {
+        uint64_t first = group * RECORD_GROUP_SIZE;
+        size_t count = records->record_count - first < RECORD_GROUP_SIZE ? records->record_count - first : RECORD_GROUP_SIZE;
+        stats->regions += count;
+        if (!bit_pattern.present) {
+            continue;
+        }
+        result = record_load_group(records, group);
+        uint64_t group_start = records->record_offsets[0];
+        if (result && read_at(records->file, data, records->record_offsets[count] - group_start, group_start) == 0) {
+            err("grep", "Unable to read the records!");
+            result = 0;
+        }
+        for (size_t i = 0; i < count && result && searching; i++) {
+            size_t length = records->record_lengths[i];
+            const unsigned char* record_data = data + (records->record_offsets[i] - group_start);
+            size_t data_size = records->record_offsets[i + 1] - records->record_offsets[i];
+            if (length < pattern_length || !find_bit_pattern(&bit_pattern, record_data, data_size)) {
+                continue;
+            }
+            stats->decoded++;
+            if (decode_block(records->root, records->decode_table, record_data, data_size,
+                             records->output_buffer, length) < length) {
+                err("grep", "Record is corrupted!");
+                result = 0;
+                break;
+            }
+            if (memmem(records->output_buffer, length, pattern, pattern_length) != NULL) {
+                stats->matches++;
+                searching = function(argument, first + i, records->output_buffer, length);
+            }
+        }
+    }
+    free_bit_pattern(&bit_pattern);
+    free(data);
+    record_close(records);
+    return result;
+}
+
+/*
+* Function: huff_grep
+* -------------------
+*  Finds every occurrence of a literal pattern in a seekable or record file.
+*  The pattern is encoded with the file's codes once for each of the 8 bit
+*  alignments, and the encoded bytes of every segment or record are scanned
+*  for these bit strings. Only the regions with a candidate are decoded to
+*  check it, the others are never decoded.
+*
+*  input_file: Pointer to the compressed file
+*  pattern: Bytes to find
+*  pattern_length: Number of bytes (at most the segment size of seekable files)
+*  function: Called for every match
+*  argument: Passed to the function
+*  stats: Pointer to the GrepStats object to fill (Can be NULL)
+*
+*  returns: If failed (0), On success (1)
+*/
+int huff_grep(FILE* input_file, const unsigned char* pattern, size_t pattern_length,
+              GrepFunction function, void* argument, GrepStats* stats) {
+    if (input_file == NULL || pattern == NULL || pattern_length == 0 || function == NULL) {
+        err("huff_grep", "Input file or pattern is NULL!");
+        return 0;
+    }
+    GrepStats local_stats;
+    if (stats == NULL) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(GrepStats));
+    if (is_record_file(input_file)) {
+        return grep_records(input_file, pattern, pattern_length, function, argument, stats);
+    }
+    if (is_seekable(input_file)) {
+        return grep_seekable(input_file, pattern, pattern_length, function, argument, stats);
+    }
+    err("huff_grep", "Only seekable (-s) and record (--records) files can be searched!");
+    return 0;
+}
+
+/*
+* Function: print_match
+* ---------------------
+*  Prints a matching record or the offset of a match (GrepFunction of grep_file).
+*/
+static int print_match(void* argument, uint64_t position, const unsigned char* data, size_t length) {
+    GrepOutput* output = argument;
+    if (output->name != NULL && fprintf(output->output_file, "%s:", output->name) < 0) {
+        return 0;
+    }
+    if (output->records) {
+        return fwrite(data, sizeof(unsigned char), length, output->output_file) == length
+               && fputc('\n', output->output_file) != EOF;
+    }
+    return fprintf(output->output_file, "%" PRIu64 "\n", position) > 0;
+}
+
+/*
+* Function: grep_file
+* -------------------
+*  Prints the matches of a pattern like grep: the matching records of a
+*  record file, or the original offset of every match of a seekable file.
+*
+*  input_file: Pointer to the compressed file
+*  pattern: Bytes to find
+*  pattern_length: Number of bytes
+*  output_file: Pointer to the output_file
+*  name: Printed before every match (NULL prints nothing)
+*  stats: Pointer to the GrepStats object to fill (Can be NULL)
+*
+*  returns: If failed (0), On success (1)
+*/
+int grep_file(FILE* input_file, const unsigned char* pattern, size_t pattern_length, FILE* output_file,
+              const char* name, GrepStats* stats) {
+    GrepOutput output = {output_file, name, input_file != NULL && is_record_file(input_file)};
+    return huff_grep(input_file, pattern, pattern_length, print_match, &output, stats);
+}
@@ -1,8 +1,12 @@
+#include "../include/asyncio.h"
 #include "../include/constants.h"
+#include "../include/crc32c.h"
+#include "../include/decodetable.h"
 #include "../include/utils.h"
 #include "../include/bitio.h"
 #include "../include/huffman.h"
 
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -10,6 +14,46 @@
 #include <string.h>
 #include <time.h>
 
+/*
+* Function: read_input
+* --------------------
+*  Reads from the asynchronous reader if available, otherwise from the file.
+*
+*  file: Pointer to the input file
+*  async_file: AsyncFile object opened on the same file (Can be NULL)
+*  buffer: Destination buffer
+*  size: Maximum number of bytes
+*
+*  returns: Number of read bytes
+*/
+static size_t read_input(FILE* file, AsyncFile* async_file, unsigned char* buffer, size_t size) {
+    if (async_file != NULL) {
+        ssize_t read_bytes = async_read(async_file, buffer, size);
+        return read_bytes < 0 ? 0 : (size_t) read_bytes;
+    }
+    return fread(buffer, sizeof(unsigned char), size, file);
+}
+
+/*
+* Function: write_output
+* ----------------------
+*  Writes to the asynchronous writer if available, otherwise to the file.
+*
+*  file: Pointer to the output file
+*  async_file: AsyncFile object opened on the same file (Can be NULL)
+*  buffer: Source buffer
+*  size: Number of bytes
+*
+*  returns: Number of written bytes
+*/
+static size_t write_output(FILE* file, AsyncFile* async_file, const unsigned char* buffer, size_t size) {
+    if (async_file != NULL) {
+        ssize_t written_bytes = async_write(async_file, buffer, size);
+        return written_bytes < 0 ? 0 : (size_t) written_bytes;
+    }
+    return fwrite(buffer, sizeof(unsigned char), size, file);
+}
+
 /*
 * Function: get_list_size
 * -----------------------
@@ -35,6 +79,114 @@ size_t get_list_size(size_t* list, size_t* max_value) {
     return list_size;
 }
 
+/*
+* Function: count_frequencies
+* ---------------------------
+*  Adds the occurance of every character of the file to the frequency table
+*
+*  file: Pointer to the input file
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
+*
+*  returns: Number of read bytes. If failed, returns -1.
+*/
+ssize_t count_frequencies(FILE* file, size_t* frequency_table) {
+    return count_frequencies_crc(file, frequency_table, NULL);
+}
+
+/*
+* Function: count_frequencies_crc
+* -------------------------------
+*  Adds the occurance of every character of the file to the frequency table
+*  and updates the CRC32C of the data in the same pass.
+*
+*  file: Pointer to the input file
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
+*  checksum: Pointer to the checksum to update (Can be NULL)
+*
+*  returns: Number of read bytes. If failed, returns -1.
+*/
+ssize_t count_frequencies_crc(FILE* file, size_t* frequency_table, uint32_t* checksum) {
+    unsigned char read_buffer[READ_BUFFER_SIZE];
+    size_t total_bytes = 0;
+    size_t read_bytes = 0;
+    while ( (read_bytes = fread(read_buffer, sizeof(unsigned char), READ_BUFFER_SIZE, file)) != 0) {
+        for (size_t i = 0; i < read_bytes; i++) {
+            frequency_table[read_buffer[i]]++;
+        }
+        if (checksum != NULL) {
+            *checksum = crc32c_update(*checksum, read_buffer, read_bytes);
+        }
+        total_bytes += read_bytes;
+    }
+    if (ferror(file)) {
+        fprintf(stderr, "\n[ERROR]: count_frequencies() {} -> Unable to read the file!\n");
+        return -1;
+    }
+    return total_bytes;
+}
+
+/*
+* Function: sample_frequencies
+* ----------------------------
+*  Estimates the frequency table from evenly spaced blocks of the file
+*  (FAST_STATS_BLOCK_SIZE bytes each) instead of reading all of it. Every
+*  symbol missing from the sample is counted once, so bytes that only occur
+*  outside the sample still get a (long) code. Files up to sample_size
+*  bytes are counted exactly. The file is always read from its start.
+*
+*  file: Pointer to the input file (must be seekable)
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
+*  sample_size: Number of bytes to read
+*
+*  returns: Size of the file. If failed, returns -1.
+*/
+ssize_t sample_frequencies(FILE* file, size_t* frequency_table, size_t sample_size) {
+    uint64_t file_size = get_file_size(file);
+    if (file_size <= sample_size) {
+        // Counted from the start like the sampled blocks, callers may have read the file already
+        if (fseeko(file, 0, SEEK_SET) != 0) {
+            fprintf(stderr, "\n[ERROR]: sample_frequencies() {} -> Unable to seek in the file!\n");
+            return -1;
+        }
+        return count_frequencies(file, frequency_table);
+    }
+    size_t block_count = sample_size / (FAST_STATS_BLOCK_SIZE);
+    if (block_count == 0) {
+        block_count = 1;
+    }
+    uint64_t stride = file_size / block_count;
+
+    unsigned char read_buffer[READ_BUFFER_SIZE];
+    for (size_t block = 0; block < block_count; block++) {
+        if (fseeko(file, block * stride, SEEK_SET) != 0) {
+            fprintf(stderr, "\n[ERROR]: sample_frequencies() {} -> Unable to seek in the file!\n");
+            return -1;
+        }
+        size_t remaining = FAST_STATS_BLOCK_SIZE;
+        size_t read_bytes = 0;
+        while (remaining > 0
+               && (read_bytes = fread(read_buffer, sizeof(unsigned char),
+                                      remaining < READ_BUFFER_SIZE ? remaining : READ_BUFFER_SIZE, file)) != 0) {
+            for (size_t i = 0; i < read_bytes; i++) {
+                frequency_table[read_buffer[i]]++;
+            }
+            remaining -= read_bytes;
+        }
+        if (ferror(file)) {
+            fprintf(stderr, "\n[ERROR]: sample_frequencies() {} -> Unable to read the file!\n");
+            return -1;
+        }
+    }
+
+    // The sample can't prove a symbol is absent
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (frequency_table[i] == 0) {
+            frequency_table[i] = 1;
+        }
+    }
+    return file_size;
+}
+
 /*
 * Function: count_run
 * -------------------
@@ -45,29 +197,17 @@ size_t get_list_size(size_t* list, size_t* max_value) {
 *  returns: Array of frequencies
 */
 size_t* count_run(FILE* file) {
-    size_t* frequency_table = malloc(FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    // set every value to zero, in order to start counting occurance
+    size_t* frequency_table = calloc(FREQUENCY_TABLE_SIZE, sizeof(size_t));
     if (frequency_table == NULL) {
         fprintf(stderr, "\n[ERROR]: count_run() {} -> Unable to allocate memory for frequency table!\n");
         return NULL;
     }
-    // set every value to zero, in order to start counting occurance
-    memset(frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t)); 
 
-    char* read_buffer = malloc(READ_BUFFER_SIZE * sizeof(unsigned char));
-    if (read_buffer == NULL) {
-        fprintf(stderr, "\n[ERROR]: count_run() {} -> Unable to allocate memory for read buffer!\n");
+    if (count_frequencies(file, frequency_table) == -1) {
         free(frequency_table);
         return NULL;
     }
-
-    size_t read_bytes = 0;
-    while ( (read_bytes = fread(read_buffer, sizeof(unsigned char), READ_BUFFER_SIZE, file)) != 0) {
-        for (size_t i = 0; i < read_bytes; i++) {
-            frequency_table[(unsigned char) read_buffer[i]]++;
-        }
-    }
-
-    free(read_buffer);
     return frequency_table;
 }
 
@@ -268,43 +408,33 @@ int write_file_header(FILE* output_file, size_t* frequency_table) {
     return 1;
 }
 /*
-* Function: read_file_header
-* --------------------------
-*  Reads the header information of compressed file.
+* Function: read_frequency_table
+* ------------------------------
+*  Reads a frequency table (stored by write_file_header) at the current
+*  position of the file.
 *
 *  input_file: Pointer to the compressed file
-*  bit_padding: Pointer to the variable storing remaining bit count
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
 *
-*  returns: Frequency table
+*  returns: Number of symbols in the table. If failed, returns 0.
 */
-size_t* read_file_header(FILE* input_file, size_t* list_size, int* bit_padding) {
-    size_t* frequency_table = malloc(FREQUENCY_TABLE_SIZE * sizeof(size_t));
-    if (frequency_table == NULL) {
-        fprintf(stderr, "\n[ERROR]: read_file_header() {} -> Unable to allocate memory for frequency table!\n");
-        return NULL;
-    }
+size_t read_frequency_table(FILE* input_file, size_t* frequency_table) {
     // set every value to zero, in order to start counting occurance
-    memset(frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t)); 
-
-    fseek(input_file, 0, SEEK_SET);
-    size_t read_bytes = fread(list_size, sizeof(unsigned char), 1, input_file);
-    if (read_bytes < 1) {
-        fprintf(stderr, "\n[ERROR]: read_file_header() {} -> File is corrupted!\n");
-        return NULL;
-    }
-    (*list_size)++; // increase list_size by 1, because it was decreased by 1 when it was saved
+    memset(frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
 
-    unsigned char* read_buffer = malloc(*list_size * sizeof(unsigned char) * 2);
-    if (read_buffer == NULL) {
-        fprintf(stderr, "\n[ERROR]: read_file_header() {} -> Unable to allocate memory for buffer!\n");
-        return NULL;
+    unsigned char stored_size;
+    if (fread(&stored_size, sizeof(unsigned char), 1, input_file) < 1) {
+        fprintf(stderr, "\n[ERROR]: read_frequency_table() {} -> File is corrupted!\n");
+        return 0;
     }
+    size_t list_size = (size_t) stored_size + 1; // increase list_size by 1, because it was decreased by 1 when it was saved
 
-    size_t header_frequency_table_size = *list_size * 2;
-    read_bytes = fread(read_buffer, sizeof(unsigned char), header_frequency_table_size, input_file);
+    unsigned char read_buffer[FREQUENCY_TABLE_SIZE * 2];
+    size_t header_frequency_table_size = list_size * 2;
+    size_t read_bytes = fread(read_buffer, sizeof(unsigned char), header_frequency_table_size, input_file);
     if (read_bytes < header_frequency_table_size) {
-        fprintf(stderr, "\n[ERROR]: read_file_header() {} -> File is corrupted!\n");
-        return NULL;
+        fprintf(stderr, "\n[ERROR]: read_frequency_table() {} -> File is corrupted!\n");
+        return 0;
     }
 
     // Read file's frequency table and import it
@@ -313,22 +443,67 @@ size_t* read_file_header(FILE* input_file, size_t* list_size, int* bit_padding)
         unsigned char count = read_buffer[i + 1];
         frequency_table[symbol] = count;
     }
+    return list_size;
+}
 
-    free(read_buffer);
+/*
+* Function: read_file_header
+* --------------------------
+*  Reads the header information of compressed file.
+*
+*  input_file: Pointer to the compressed file
+*  list_size: Pointer to a variable to store frequency table size
+*  bit_padding: Pointer to the variable storing remaining bit count
+*
+*  returns: Frequency table
+*/
+size_t* read_file_header(FILE* input_file, size_t* list_size, int* bit_padding) {
+    size_t* frequency_table = malloc(FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    if (frequency_table == NULL) {
+        fprintf(stderr, "\n[ERROR]: read_file_header() {} -> Unable to allocate memory for frequency table!\n");
+        return NULL;
+    }
+
+    fseeko(input_file, 0, SEEK_SET);
+    *list_size = read_frequency_table(input_file, frequency_table);
+    if (*list_size == 0) {
+        free(frequency_table);
+        return NULL;
+    }
 
     // Read total encoded bits count at the end of the file
-    size_t header_end_pos = ftell(input_file);
-    long remainign_bits_count_pos = sizeof(unsigned char);
-    fseek(input_file, -1 * remainign_bits_count_pos, SEEK_END);
-    if (fread(bit_padding, sizeof(unsigned char), 1, input_file) < 1) {
+    off_t header_end_pos = ftello(input_file);
+    off_t remainign_bits_count_pos = sizeof(unsigned char);
+    fseeko(input_file, -1 * remainign_bits_count_pos, SEEK_END);
+    unsigned char stored_padding;
+    if (fread(&stored_padding, sizeof(unsigned char), 1, input_file) < 1) {
         fprintf(stderr, "\n[ERROR]: read_file_header() {} -> Unable to read total bit_count from file header!\n");
+        free(frequency_table);
         return NULL;
     }
-    fseek(input_file, header_end_pos, SEEK_SET);
+    *bit_padding = stored_padding;
+    fseeko(input_file, header_end_pos, SEEK_SET);
 
     return frequency_table;
 }
 
+/*
+* Function: get_total_bits
+* ------------------------
+*  Returns the number of valid encoded bits.
+*
+*  data_bytes: Number of encoded bytes (without header and the last byte)
+*  bit_padding: Number of encoded bits in the last encoded byte (0 means all 8)
+*
+*  returns: Number of encoded bits
+*/
+uint64_t get_total_bits(uint64_t data_bytes, int bit_padding) {
+    if (data_bytes == 0) {
+        return 0;
+    }
+    return bit_padding == 0 ? data_bytes * 8 : (data_bytes - 1) * 8 + bit_padding;
+}
+
 /*
 * Function: generate_huffman_code
 * -------------------------------
@@ -356,6 +531,36 @@ void generate_huffman_code(Code* code_table, uint32_t code, uint8_t depth, Node*
     }
 }
 
+/*
+* Function: fill_pair_table
+* -------------------------
+*  Combines the codes of every byte pair, so two symbols are written at once.
+*
+*  code_table: Pointer to the code table
+*  pair_table: Pointer to the pair table (PAIR_TABLE_SIZE entries, indexed by first << 8 | second)
+*
+*  returns: On success (1), (0) if two codes may not fit in 32 bits
+*/
+int fill_pair_table(Code* code_table, Code* pair_table) {
+    uint8_t max_length = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (code_table[i].length > max_length) {
+            max_length = code_table[i].length;
+        }
+    }
+    if (max_length * 2 > 32) {
+        return 0;
+    }
+    for (size_t first = 0; first < FREQUENCY_TABLE_SIZE; first++) {
+        Code* pairs = &pair_table[first << 8];
+        for (size_t second = 0; second < FREQUENCY_TABLE_SIZE; second++) {
+            pairs[second].code = (code_table[first].code << code_table[second].length) | code_table[second].code;
+            pairs[second].length = code_table[first].length + code_table[second].length;
+        }
+    }
+    return 1;
+}
+
 /*
 * Function: encode
 * ----------------
@@ -364,125 +569,262 @@ void generate_huffman_code(Code* code_table, uint32_t code, uint8_t depth, Node*
 *  input_file: Pointer to the file to be encoded
 *  bit_writer: Pointer to the BitWriter object
 *  code_table: Pointer to the code table
+*  pair_table: Pointer to the pair table filled by fill_pair_table (NULL encodes one symbol at a time)
 *
 *  returns: If failed (0), On success (1)
 */
-int encode(FILE* input_file, BitWriter* bit_writer, Code* code_table) {
+int encode(FILE* input_file, BitWriter* bit_writer, Code* code_table, Code* pair_table) {
     unsigned char* read_buffer = malloc(READ_BUFFER_SIZE * sizeof(unsigned char));
     if (read_buffer == NULL) {
         fprintf(stderr, "\n[ERROR]: encode() {} -> Unable to allocate memory for buffer!\n");
         return 0;
     }
     size_t bytes_read = 0;
-    size_t file_size = get_file_size(input_file);
-    size_t processed = 0;
+    uint64_t file_size = get_file_size(input_file);
+    uint64_t processed = 0;
     clock_t start_time = clock();
-    fseek(input_file, 0, SEEK_SET);
-
-    while((bytes_read = fread(read_buffer, sizeof(unsigned char), READ_BUFFER_SIZE, input_file)) > 0) {
-        for (size_t i = 0; i < bytes_read; i++) {
+    fseeko(input_file, 0, SEEK_SET);
+
+    // Keep the next reads and the previous writes in flight while encoding.
+    // If the backend is not available (e.g. pipes), stdio is used.
+    AsyncFile* reader = async_open(input_file, ASYNC_READ);
+    bit_writer->async = async_open(bit_writer->file, ASYNC_WRITE);
+
+    while((bytes_read = read_input(input_file, reader, read_buffer, READ_BUFFER_SIZE)) > 0) {
+        size_t i = 0;
+        int result = 1;
+        // Encode two symbols with one lookup (the odd one is encoded alone)
+        if (pair_table != NULL) {
+            for (; i + 1 < bytes_read && result != -1; i += 2) {
+                Code pair = pair_table[read_buffer[i] << 8 | read_buffer[i + 1]];
+                result = write_bits(bit_writer, pair.code, pair.length);
+            }
+        }
+        for (; i < bytes_read && result != -1; i++) {
             unsigned char symbol = read_buffer[i];
             // Encode symbol to huffman bits
-            if (code_table[symbol].length > 0) {
-                int result = write_bits(bit_writer, code_table[symbol].code, code_table[symbol].length);
-                if (result == -1) {
-                    free(read_buffer);
-                    return 0;
-                }
-            }
+            result = write_bits(bit_writer, code_table[symbol].code, code_table[symbol].length);
+        }
+        if (result == -1) {
+            async_close(reader);
+            async_close(bit_writer->async);
+            bit_writer->async = NULL;
+            free(read_buffer);
+            return 0;
         }
         processed += bytes_read;
         if (processed % (100 * KB) == 0) {
-            printf("\rProcessing: %zu/%zu bytes...", processed, file_size);
+            print_log("\rProcessing: %" PRIu64 "/%" PRIu64 " bytes...", processed, file_size);
         }
     }
 
     // Flush the remaining data in writer to the file
     int result = flush_writer(bit_writer);
-    if (result == -1) {
+    int reader_result = reader == NULL || async_close(reader);
+    int writer_result = bit_writer->async == NULL || async_close(bit_writer->async);
+    bit_writer->async = NULL;
+    if (result == -1 || reader_result == 0 || writer_result == 0) {
         free(read_buffer);
         return 0;
     }
 
     clock_t end_time = clock();
-    long compressed_file_size = ftell(bit_writer->file);
-    int size_diff = file_size - compressed_file_size;
-    double compression_rate = (double) abs(size_diff) / file_size * 100;
+    off_t compressed_file_size = ftello(bit_writer->file);
+    int64_t size_diff = (int64_t) file_size - compressed_file_size;
+    double compression_rate = (double) llabs(size_diff) / file_size * 100;
     double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
-    printf("\rFinished processing (%f s): %zu bytes -> %ld bytes (%s%.2f%%)\n", time_spent, file_size, 
-           compressed_file_size, size_diff > 0 ? "-" : "+", compression_rate);
+    print_log("\rFinished processing (%f s): %" PRIu64 " bytes -> %" PRId64 " bytes (%s%.2f%%)\n", time_spent, file_size,
+           (int64_t) compressed_file_size, size_diff > 0 ? "-" : "+", compression_rate);
 
     free(read_buffer);
     return 1;
 }
 
 /*
-* Function: decode
-* ----------------
-*  Decodes a huffman file and save it to the output file.
+* Function: encode_buffer
+* -----------------------
+*  Encodes a buffer into memory (MSB first, the last byte is padded with
+*  zeros like flush_writer does). Codes must be at most 32 bits long.
+*
+*  code_table: Pointer to the code table
+*  input: Bytes to encode
+*  size: Number of bytes
+*  output: Output buffer (At least as large as the encoded bytes)
 *
-*  output_file: Pointer to the output file.
+*  returns: Number of bytes stored
+*/
+size_t encode_buffer(const Code* code_table, const unsigned char* input, size_t size, unsigned char* output) {
+    uint64_t accumulator = 0;
+    int accumulator_bits = 0;
+    size_t output_size = 0;
+    for (size_t i = 0; i < size; i++) {
+        // Less than 8 bits are left in the accumulator, so 32 more always fit
+        Code code = code_table[input[i]];
+        accumulator = (accumulator << code.length) | code.code;
+        accumulator_bits += code.length;
+        while (accumulator_bits >= 8) {
+            accumulator_bits -= 8;
+            output[output_size++] = (unsigned char) (accumulator >> accumulator_bits);
+        }
+    }
+    if (accumulator_bits > 0) {
+        output[output_size++] = (unsigned char) (accumulator << (8 - accumulator_bits));
+    }
+    return output_size;
+}
+
+/*
+* Function: decode_symbols
+* ------------------------
+*  Decodes the encoded bits at the current position of the reader's file
+*  until total_bits bits or symbol_count symbols are decoded, whichever
+*  comes first.
+*
+*  output_file: Pointer to the output file. (NULL discards the decoded data)
 *  bit_reader: Pointer to a BitReader object.
 *  root: Pointer to the root node of the huffman tree.
-*  bit_padding: Number of encoded bits in the last byte of the file
+*  total_bits: Maximum number of bits to read
+*  symbol_count: Maximum number of symbols to write (SIZE_MAX for no limit)
 *
 *  returns: If failed (0), on success (1)
 */
-int decode(FILE *output_file, BitReader *bit_reader, Node* root, int bit_padding) {
+int decode_symbols(FILE* output_file, BitReader* bit_reader, Node* root, uint64_t total_bits, size_t symbol_count) {
     size_t output_buffer_size = READ_BUFFER_SIZE * sizeof(unsigned char);
-    unsigned char* output_buffer = malloc(output_buffer_size);
+    // Table entries are copied whole, so a few bytes may be written past the size
+    unsigned char* output_buffer = malloc(output_buffer_size + DECODE_TABLE_MAX_SYMBOLS);
     if (output_buffer == NULL) {
-        fprintf(stderr, "\n[ERROR]: encode() {} -> Unable to allocate memory for buffer!\n");
+        fprintf(stderr, "\n[ERROR]: decode_symbols() {} -> Unable to allocate memory for buffer!\n");
         return 0;
     }
     size_t output_pos = 0;
-    size_t file_size = get_file_size(bit_reader->file);
-    size_t processed = ftell(bit_reader->file);
-    // whole file - header - last byte (bits_padding) = encoded bits
-    size_t total_bits = (file_size - processed - 1) * 8 - 8 + bit_padding;
+    size_t decoded = 0;
+    uint64_t total_bytes = total_bits / 8;
     Node* current = root;
-    clock_t start_time = clock();
 
-    while (bit_reader->bits_read <= total_bits) {
-        int bit = read_bits(bit_reader);
-        if (bit == -1) {
-            break;
+    // Overlap reading the encoded data and writing the decoded data with decoding
+    bit_reader->async = async_open(bit_reader->file, ASYNC_READ);
+    AsyncFile* writer = output_file != NULL ? async_open(output_file, ASYNC_WRITE) : NULL;
+
+    // Codes that fit in the table are decoded with one lookup, the others bit by bit
+    DecodeTable* table = create_decode_table(root);
+
+    int result = 1;
+    uint64_t bits_read = 0;
+    while ((bits_read = get_bits_read(bit_reader)) < total_bits && decoded < symbol_count) {
+        size_t table_symbols = 0;
+        if (table != NULL && current == root) {
+            // Decode from the buffered bytes until a long code, the end of the buffer or a limit
+            size_t available = 0;
+            int bit_offset = 0;
+            const unsigned char* data = fill_reader(bit_reader, 8, &available, &bit_offset);
+            size_t position = bit_offset;
+            size_t symbol_limit = symbol_count - decoded;
+            if (symbol_limit > output_buffer_size - output_pos) {
+                symbol_limit = output_buffer_size - output_pos;
+            }
+            // The limit only matters within the buffered bytes
+            uint64_t bit_limit = total_bits - bits_read;
+            if (bit_limit > available * 8) {
+                bit_limit = available * 8;
+            }
+            table_symbols = decode_table_run(table, data, available, &position, bit_offset + bit_limit,
+                                             output_buffer + output_pos, symbol_limit);
+            output_pos += table_symbols;
+            decoded += table_symbols;
+            skip_bits(bit_reader, position - bit_offset);
         }
-        current = bit ? current->r_node : current->l_node;
-        // Leaf Node:
-        if (current->l_node == NULL && current->r_node == NULL) { 
-            output_buffer[output_pos++] = current->symbol;
-            // Flush output_buffer
-            if (output_pos >= output_buffer_size) {
-                size_t written_bytes = fwrite(output_buffer, sizeof(unsigned char), output_pos, output_file);
-                if (written_bytes < output_pos) {
-                    free(output_buffer);
-                    return 0;
+        if (table_symbols == 0) {
+            int bit = read_bits(bit_reader);
+            if (bit == -1) {
+                err("decode_symbols", "Encoded data is truncated!");
+                result = 0;
+                break;
+            }
+            // A tree with a single symbol has no branches, every bit is one symbol
+            if (root->l_node != NULL || root->r_node != NULL) {
+                current = bit ? current->r_node : current->l_node;
+                // Incomplete code tables leave some branches unused
+                if (current == NULL) {
+                    err("decode_symbols", "Encoded data is corrupted!");
+                    result = 0;
+                    break;
                 }
-                output_pos = 0;
             }
-            current = root;
+            // Leaf Node:
+            if (current->l_node == NULL && current->r_node == NULL) { 
+                output_buffer[output_pos++] = current->symbol;
+                decoded++;
+                current = root;
+            }
+        }
+        // Flush output_buffer (Without an output file it is only reused)
+        if (output_pos >= output_buffer_size && output_file == NULL) {
+            output_pos = 0;
+        } else if (output_pos >= output_buffer_size) {
+            size_t written_bytes = write_output(output_file, writer, output_buffer, output_pos);
+            if (written_bytes < output_pos) {
+                result = 0;
+                break;
+            }
+            output_pos = 0;
         }
-        size_t read_bytes = bit_reader->bits_read / 8;
+        uint64_t read_bytes = bits_read / 8;
         if (read_bytes % (100 * KB) == 0) {
-            printf("\rProcessing: %ld/%ld bytes...", processed + read_bytes, file_size);
+            print_log("\rProcessing: %" PRIu64 "/%" PRIu64 " bytes...", read_bytes, total_bytes);
         }
     }
+    // Valid data never ends in the middle of a code
+    if (result && (current != root || (symbol_count != SIZE_MAX && decoded < symbol_count))) {
+        err("decode_symbols", "Encoded data is corrupted!");
+        result = 0;
+    }
 
     // Flush the remaining data in writer to the file
-    if (output_pos > 0) {
-        size_t written_bytes = fwrite(output_buffer, sizeof(unsigned char), output_pos, output_file);
+    if (result && output_pos > 0 && output_file != NULL) {
+        size_t written_bytes = write_output(output_file, writer, output_buffer, output_pos);
         if (written_bytes < output_pos) {
-            free(output_buffer);
-            return 0;
+            result = 0;
         }
     }
+    if (bit_reader->async != NULL && async_close(bit_reader->async) == 0) {
+        result = 0;
+    }
+    bit_reader->async = NULL;
+    if (writer != NULL && async_close(writer) == 0) {
+        result = 0;
+    }
+    free_decode_table(table);
+    free(output_buffer);
+    return result;
+}
+
+/*
+* Function: decode
+* ----------------
+*  Decodes a huffman file and save it to the output file.
+*
+*  output_file: Pointer to the output file. (NULL discards the decoded data)
+*  bit_reader: Pointer to a BitReader object.
+*  root: Pointer to the root node of the huffman tree.
+*  bit_padding: Number of encoded bits in the last byte of the file
+*
+*  returns: If failed (0), on success (1)
+*/
+int decode(FILE *output_file, BitReader *bit_reader, Node* root, int bit_padding) {
+    uint64_t file_size = get_file_size(bit_reader->file);
+    off_t processed = ftello(bit_reader->file);
+    // whole file - header - last byte (bits_padding) = encoded bits
+    uint64_t total_bits = get_total_bits(file_size - processed - 1, bit_padding);
+    clock_t start_time = clock();
+
+    if (decode_symbols(output_file, bit_reader, root, total_bits, SIZE_MAX) == 0) {
+        return 0;
+    }
 
     clock_t end_time = clock();
     double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
-    long compressed_file_size = ftell(bit_reader->file);
-    printf("\rFinished Processing (%f s): %zu bytes -> %ld bytes.\n", time_spent, file_size, compressed_file_size);
-
-    free(output_buffer);
+    off_t compressed_file_size = ftello(bit_reader->file);
+    print_log("\rFinished Processing (%f s): %" PRIu64 " bytes -> %" PRId64 " bytes.\n", time_spent, file_size,
+              (int64_t) compressed_file_size);
     return 1;
 }
@@ -0,0 +1,244 @@
+#include "../include/compact.h"
+#include "../include/constants.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/packed.h"
+#include "../include/utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+* Function: is_packed
+* -------------------
+*  Checks if the file starts with the packed header's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_packed(FILE* file) {
+    return has_magic(file, packed_magic, sizeof(packed_magic));
+}
+
+/*
+* Function: width_of
+* ------------------
+*  Returns ceil(log2(symbol_count)) for 2-256 symbols.
+*/
+static int width_of(int symbol_count) {
+    int width = 1;
+    while ((1 << width) < symbol_count) {
+        width++;
+    }
+    return width;
+}
+
+/*
+* Function: packed_width
+* ----------------------
+*  Returns the number of bits of a symbol index: ceil(log2(symbols)).
+*
+*  frequency_table: Pointer to the frequency table
+*
+*  returns: Width in bits (1-8), 0 if there are less than 2 symbols
+*/
+int packed_width(size_t* frequency_table) {
+    int symbol_count = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        symbol_count += frequency_table[i] > 0;
+    }
+    return symbol_count < 2 ? 0 : width_of(symbol_count);
+}
+
+/*
+* Function: prefer_packed
+* -----------------------
+*  Compares the size of the huffman encoded data with fixed-width packing.
+*  Packing is preferred when it is at most PACKED_MAX_OVERHEAD_PERCENT
+*  larger, its decoder does not depend on the code lengths.
+*
+*  frequency_table: Pointer to the frequency table
+*  code_table: Pointer to the code table of the frequency table
+*
+*  returns: (1) if packing is preferred, otherwise (0)
+*/
+int prefer_packed(size_t* frequency_table, Code* code_table) {
+    int width = packed_width(frequency_table);
+    if (width == 0) {
+        return 0;
+    }
+    size_t huffman_bits = 0;
+    size_t packed_bits = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        huffman_bits += frequency_table[i] * code_table[i].length;
+        packed_bits += frequency_table[i] * width;
+    }
+    return packed_bits * 100 <= huffman_bits * (100 + PACKED_MAX_OVERHEAD_PERCENT);
+}
+
+/*
+* Function: compress_packed
+* -------------------------
+*  Compresses the input file as fixed-width indexes into the sorted set of
+*  present symbols.
+*
+*  context: Pointer to the context (frequency_table counted or sampled by the
+*           caller, every byte of the input must have a frequency)
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_packed(HuffContext* context, FILE* input_file, FILE* output_file) {
+    if (context == NULL || input_file == NULL || output_file == NULL) {
+        err("compress_packed", "Input/output file is NULL!");
+        return 0;
+    }
+    int width = packed_width(context->frequency_table);
+    if (width == 0) {
+        err("compress_packed", "At least 2 symbols are needed!");
+        return 0;
+    }
+
+    // The index of a symbol is its code, with the same length for every symbol
+    uint8_t present[FREQUENCY_TABLE_SIZE];
+    uint64_t input_size = get_file_size(input_file); // A sampled table doesn't sum to the input size
+    uint32_t index = 0;
+    memset(context->code_table, 0, FREQUENCY_TABLE_SIZE * sizeof(Code));
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        present[i] = context->frequency_table[i] > 0;
+        if (present[i]) {
+            context->code_table[i].code = index++;
+            context->code_table[i].length = width;
+        }
+    }
+
+    unsigned char header[sizeof(packed_magic) + 1 + COMPACT_BITMAP_SIZE];
+    size_t header_size = 0;
+    memcpy(header, packed_magic, sizeof(packed_magic));
+    header_size += sizeof(packed_magic);
+    unsigned char* flags = &header[header_size++];
+    *flags = (PACKED_VERSION << 4) | (input_size * width % 8);
+    header_size += write_symbol_set(present, header + header_size, flags);
+    if (fwrite(header, sizeof(unsigned char), header_size, output_file) < header_size) {
+        err("compress_packed", "Unable to write the header!");
+        return 0;
+    }
+
+    BitWriter* bit_writer = context->bit_writer;
+    reset_writer(bit_writer, output_file);
+    return encode(input_file, bit_writer, context->code_table, prepare_pair_table(context, input_size));
+}
+
+/*
+* Function: unpack_groups
+* -----------------------
+*  Unpacks groups of 8 symbols: every width bytes hold 8 indexes. The loop
+*  has no branches on the data, so the compiler can vectorize it.
+*
+*  data: Packed data (group_count * width bytes)
+*  group_count: Number of groups
+*  width: Bits of an index
+*  symbols: Symbol of every index (256 entries)
+*  output: Output buffer (group_count * 8 bytes)
+*
+*  returns: The largest index found
+*/
+static unsigned int unpack_groups(const unsigned char* data, size_t group_count, int width,
+                                  const unsigned char* symbols, unsigned char* output) {
+    uint64_t mask = (1u << width) - 1;
+    unsigned int max_index = 0;
+    for (size_t group = 0; group < group_count; group++) {
+        uint64_t bits = 0;
+        for (int i = 0; i < width; i++) {
+            bits = bits << 8 | data[group * width + i];
+        }
+        for (int i = 0; i < 8; i++) {
+            unsigned int index = (bits >> (width * (7 - i))) & mask;
+            max_index = index > max_index ? index : max_index;
+            output[group * 8 + i] = symbols[index];
+        }
+    }
+    return max_index;
+}
+
+/*
+* Function: decompress_packed
+* ---------------------------
+*  Decompresses a file with the packed header.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_packed(FILE* input_file, FILE* output_file) {
+    if (input_file == NULL) {
+        err("decompress_packed", "Input file is NULL!");
+        return 0;
+    }
+    unsigned char header[sizeof(packed_magic) + 1];
+    fseeko(input_file, 0, SEEK_SET);
+    if (fread(header, sizeof(unsigned char), sizeof(header), input_file) < sizeof(header)
+        || memcmp(header, packed_magic, sizeof(packed_magic)) != 0) {
+        err("decompress_packed", "File is corrupted!");
+        return 0;
+    }
+    unsigned char flags = header[sizeof(packed_magic)];
+    if ((flags >> 4) != PACKED_VERSION) {
+        err("decompress_packed", "Unsupported packed header version!");
+        return 0;
+    }
+    uint8_t present[FREQUENCY_TABLE_SIZE];
+    int symbol_count = read_symbol_set(input_file, flags, present);
+    if (symbol_count < 2) {
+        err("decompress_packed", "Symbol set is corrupted!");
+        return 0;
+    }
+    unsigned char symbols[FREQUENCY_TABLE_SIZE] = {0};
+    for (int i = 0, index = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (present[i]) {
+            symbols[index++] = (unsigned char) i;
+        }
+    }
+    int width = width_of(symbol_count);
+
+    uint64_t data_bytes = get_file_size(input_file) - ftello(input_file);
+    uint64_t total_bits = get_total_bits(data_bytes, flags & COMPACT_PADDING_MASK);
+    if (total_bits % width != 0) {
+        err("decompress_packed", "Encoded data is corrupted!");
+        return 0;
+    }
+    uint64_t remaining = total_bits / width;
+
+    unsigned char data[PACKED_BLOCK_GROUPS * 8];
+    unsigned char output[PACKED_BLOCK_GROUPS * 8];
+    unsigned int max_index = 0;
+    while (remaining > 0) {
+        // Every block is a whole number of groups, except the last one
+        size_t block_symbols = remaining < PACKED_BLOCK_GROUPS * 8 ? remaining : PACKED_BLOCK_GROUPS * 8;
+        size_t group_count = (block_symbols + 7) / 8;
+        size_t block_bytes = (block_symbols * width + 7) / 8;
+        memset(data + block_bytes, 0, group_count * width - block_bytes);
+        if (fread(data, sizeof(unsigned char), block_bytes, input_file) < block_bytes) {
+            err("decompress_packed", "Encoded data is truncated!");
+            return 0;
+        }
+        unsigned int block_max = unpack_groups(data, group_count, width, symbols, output);
+        max_index = block_max > max_index ? block_max : max_index;
+        if (output_file != NULL && fwrite(output, sizeof(unsigned char), block_symbols, output_file) < block_symbols) {
+            err("decompress_packed", "Unable to write the output file!");
+            return 0;
+        }
+        remaining -= block_symbols;
+    }
+    if (max_index >= (unsigned int) symbol_count) {
+        err("decompress_packed", "Encoded data is corrupted!");
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,745 @@
+#include "../include/adaptive.h"
+#include "../include/compact.h"
+#include "../include/compressor.h"
+#include "../include/constants.h"
+#include "../include/decodetable.h"
+#include "../include/dictionary.h"
+#include "../include/huffman.h"
+#include "../include/packed.h"
+#include "../include/parallel.h"
+#include "../include/record.h"
+#include "../include/seekable.h"
+#include "../include/stored.h"
+#include "../include/tans.h"
+#include "../include/threadpool.h"
+#include "../include/utils.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PARALLEL_WINDOW_SIZE PARALLEL_CHUNK_SIZE * PARALLEL_WINDOW_CHUNKS
+
+typedef struct {
+    HuffContext* context;
+    ThreadPool* pool;
+    unsigned char* buffer; // Current window of the input
+    ParallelChunk* chunks; // Chunks of the window
+    size_t* histograms; // Histogram of every chunk of the file
+    uint64_t* offsets; // First bit of every chunk
+    size_t chunk_count;
+    unsigned char* output; // Output of the window
+    size_t output_size;
+} ParallelEncoder;
+
+/*
+* Part of the encoded data decoded by one task. Codes starting in
+* [start, end) belong to the chunk; the last one may end past end.
+*/
+typedef struct {
+    const unsigned char* data; // Encoded data of the window
+    size_t data_size;
+    size_t bit_limit; // Number of valid bits of data
+    Node* root;
+    const DecodeTable* table; // Can be NULL
+    size_t start;
+    size_t end;
+    int exact; // start is known to be on a code boundary
+    size_t sync_positions[PARALLEL_SYNC_SYMBOLS]; // Start of the first symbols (speculative chunks)
+    size_t sync_count;
+    unsigned char* output;
+    size_t output_size;
+    size_t decoded;
+    size_t position; // End of the chunk's last code
+    int failed;
+} DecodeChunk;
+
+typedef struct {
+    ThreadPool* pool;
+    Node* root;
+    DecodeTable* table;
+    unsigned char* buffer; // Current window of the encoded data
+    DecodeChunk* chunks; // Chunks of the window
+    unsigned char prefix[PARALLEL_SYNC_SYMBOLS]; // Symbols before a chunk's first valid boundary
+    size_t prefix_size;
+    size_t resynced; // Chunks decoded again
+} ParallelDecoder;
+
+/*
+* Function: encode_chunk
+* ----------------------
+*  Encodes a chunk at its bit offset of the output. Whole bytes are stored
+*  directly, the partial first and last bytes are stored in the chunk.
+*
+*  chunk: Pointer to the ParallelChunk object
+*/
+void encode_chunk(ParallelChunk* chunk) {
+    size_t byte_index = chunk->bit_offset / 8;
+    // The bits of the previous chunk are zeros in the accumulator
+    uint64_t accumulator = 0;
+    int accumulator_bits = chunk->bit_offset % 8;
+    int shared_head = accumulator_bits != 0;
+    chunk->has_head = chunk->has_tail = 0;
+
+    size_t i = 0;
+    while (i < chunk->size) {
+        Code code;
+        // Two symbols with one lookup if the pair table is available
+        if (chunk->pair_table != NULL && i + 1 < chunk->size) {
+            code = chunk->pair_table[chunk->input[i] << 8 | chunk->input[i + 1]];
+            i += 2;
+        } else {
+            code = chunk->code_table[chunk->input[i]];
+            i++;
+        }
+        accumulator = (accumulator << code.length) | code.code;
+        accumulator_bits += code.length;
+        while (accumulator_bits >= 8) {
+            accumulator_bits -= 8;
+            unsigned char byte = (unsigned char) (accumulator >> accumulator_bits);
+            if (shared_head) {
+                chunk->head = byte;
+                chunk->head_index = byte_index;
+                chunk->has_head = 1;
+                shared_head = 0;
+            } else {
+                chunk->output[byte_index] = byte;
+            }
+            byte_index++;
+        }
+    }
+    if (accumulator_bits > 0) {
+        chunk->tail = (unsigned char) (accumulator << (8 - accumulator_bits));
+        chunk->tail_index = byte_index;
+        chunk->has_tail = 1;
+    }
+}
+
+/*
+* Function: histogram_task
+* ------------------------
+*  Counts the frequencies of a chunk (pool task).
+*/
+static void histogram_task(void* context, void* arg) {
+    (void) context;
+    ParallelChunk* chunk = arg;
+    memset(chunk->histogram, 0, sizeof(chunk->histogram));
+    for (size_t i = 0; i < chunk->size; i++) {
+        chunk->histogram[chunk->input[i]]++;
+    }
+}
+
+/*
+* Function: encode_task
+* ---------------------
+*  Encodes a chunk (pool task).
+*/
+static void encode_task(void* context, void* arg) {
+    (void) context;
+    encode_chunk(arg);
+}
+
+/*
+* Function: read_window
+* ---------------------
+*  Reads the next window of the input and splits it into chunks.
+*
+*  input_file: Pointer to the input_file
+*  buffer: Window buffer (PARALLEL_WINDOW_SIZE bytes)
+*  chunks: Chunks of the window (PARALLEL_WINDOW_CHUNKS entries)
+*
+*  returns: Number of chunks (0 at the end of the file)
+*/
+static size_t read_window(FILE* input_file, unsigned char* buffer, ParallelChunk* chunks) {
+    size_t size = fread(buffer, sizeof(unsigned char), PARALLEL_WINDOW_SIZE, input_file);
+    size_t count = 0;
+    for (size_t offset = 0; offset < size; offset += PARALLEL_CHUNK_SIZE) {
+        chunks[count].input = buffer + offset;
+        chunks[count].size = size - offset < PARALLEL_CHUNK_SIZE ? size - offset : PARALLEL_CHUNK_SIZE;
+        count++;
+    }
+    return count;
+}
+
+/*
+* Function: count_chunk_frequencies
+* ---------------------------------
+*  First pass: counts the frequencies of every chunk on the pool and sums
+*  them into the frequency table.
+*
+*  pool: Pointer to the pool
+*  input_file: Pointer to the input_file
+*  buffer: Window buffer
+*  chunks: Chunks of a window
+*  frequency_table: Frequency table to fill
+*  chunk_count: Pointer to store the number of chunks of the file
+*
+*  returns: Histogram of every chunk. If failed, returns NULL.
+*/
+static size_t* count_chunk_frequencies(ThreadPool* pool, FILE* input_file, unsigned char* buffer, ParallelChunk* chunks,
+                                       size_t* frequency_table, size_t* chunk_count) {
+    size_t* histograms = NULL;
+    size_t count = 0;
+    size_t window_chunks = 0;
+    while ((window_chunks = read_window(input_file, buffer, chunks)) > 0) {
+        size_t* resized = realloc(histograms, (count + window_chunks) * FREQUENCY_TABLE_SIZE * sizeof(size_t));
+        if (resized == NULL) {
+            err("compress_parallel", "Unable to allocate memory for the histograms!");
+            free(histograms);
+            return NULL;
+        }
+        histograms = resized;
+        for (size_t i = 0; i < window_chunks; i++) {
+            if (pool_submit(pool, histogram_task, &chunks[i]) == 0) {
+                pool_wait(pool);
+                free(histograms);
+                return NULL;
+            }
+        }
+        pool_wait(pool);
+        for (size_t i = 0; i < window_chunks; i++, count++) {
+            memcpy(&histograms[count * FREQUENCY_TABLE_SIZE], chunks[i].histogram, sizeof(chunks[i].histogram));
+            for (size_t symbol = 0; symbol < FREQUENCY_TABLE_SIZE; symbol++) {
+                frequency_table[symbol] += chunks[i].histogram[symbol];
+            }
+        }
+    }
+    if (ferror(input_file)) {
+        err("compress_parallel", "Unable to read the input file!");
+        free(histograms);
+        return NULL;
+    }
+    *chunk_count = count;
+    return histograms;
+}
+
+/*
+* Function: write_chunks
+* ----------------------
+*  Second pass: encodes every window's chunks at their offsets on the pool,
+*  merges the bytes the chunks share and writes the whole bytes. The last
+*  partial byte of a window is finished by the next one.
+*
+*  encoder: Pointer to the ParallelEncoder object
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  pair_table: Pair table of the code table (Can be NULL)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int write_chunks(ParallelEncoder* encoder, FILE* input_file, FILE* output_file, Code* pair_table) {
+    uint64_t* offsets = encoder->offsets;
+    ParallelChunk* chunks = encoder->chunks;
+    size_t first_chunk = 0;
+    unsigned char carry = 0; // Bits of the last partial byte of the previous window
+    size_t window_chunks = 0;
+    while ((window_chunks = read_window(input_file, encoder->buffer, chunks)) > 0) {
+        if (first_chunk + window_chunks > encoder->chunk_count) {
+            err("compress_parallel", "Input file changed while compressing!");
+            return 0;
+        }
+        uint64_t window_start = offsets[first_chunk] / 8 * 8;
+        uint64_t window_end = offsets[first_chunk + window_chunks];
+        size_t window_bytes = (window_end - window_start + 7) / 8;
+        if (window_bytes > encoder->output_size) {
+            unsigned char* resized = realloc(encoder->output, window_bytes);
+            if (resized == NULL) {
+                err("compress_parallel", "Unable to allocate memory for the output!");
+                return 0;
+            }
+            encoder->output = resized;
+            encoder->output_size = window_bytes;
+        }
+        unsigned char* output = encoder->output;
+        for (size_t i = 0; i < window_chunks; i++) {
+            chunks[i].code_table = encoder->context->code_table;
+            chunks[i].pair_table = pair_table;
+            chunks[i].output = output;
+            chunks[i].bit_offset = offsets[first_chunk + i] - window_start;
+            if (pool_submit(encoder->pool, encode_task, &chunks[i]) == 0) {
+                pool_wait(encoder->pool);
+                return 0;
+            }
+        }
+        pool_wait(encoder->pool);
+
+        // Merge the bytes shared by the chunks (and the previous window)
+        for (size_t i = 0; i < window_chunks; i++) {
+            if (chunks[i].has_head) {
+                output[chunks[i].head_index] = 0;
+            }
+            if (chunks[i].has_tail) {
+                output[chunks[i].tail_index] = 0;
+            }
+        }
+        if (offsets[first_chunk] % 8 != 0) {
+            output[0] = carry;
+        }
+        for (size_t i = 0; i < window_chunks; i++) {
+            if (chunks[i].has_head) {
+                output[chunks[i].head_index] |= chunks[i].head;
+            }
+            if (chunks[i].has_tail) {
+                output[chunks[i].tail_index] |= chunks[i].tail;
+            }
+        }
+
+        size_t whole_bytes = window_end / 8 - window_start / 8;
+        if (fwrite(output, sizeof(unsigned char), whole_bytes, output_file) < whole_bytes) {
+            err("compress_parallel", "Unable to write the output file!");
+            return 0;
+        }
+        carry = window_end % 8 != 0 ? output[whole_bytes] : 0;
+        first_chunk += window_chunks;
+    }
+    if (first_chunk != encoder->chunk_count) {
+        err("compress_parallel", "Input file changed while compressing!");
+        return 0;
+    }
+    unsigned char remaining_bits = offsets[encoder->chunk_count] % 8;
+    if (remaining_bits != 0 && fwrite(&carry, sizeof(unsigned char), 1, output_file) < 1) {
+        err("compress_parallel", "Unable to write the output file!");
+        return 0;
+    }
+    return fwrite(&remaining_bits, sizeof(unsigned char), 1, output_file) == 1;
+}
+
+/*
+* Function: encode_parallel
+* -------------------------
+*  Builds the code table from the chunks' histograms (or from a sample, like
+*  compress_with_context, if the context has a sample size), computes the
+*  bit offset of every chunk with a prefix sum and writes the stream.
+*
+*  encoder: Pointer to the ParallelEncoder object
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  file_size: Size of the input file
+*
+*  returns: If failed (0), On success (1)
+*/
+static int encode_parallel(ParallelEncoder* encoder, FILE* input_file, FILE* output_file, uint64_t file_size) {
+    HuffContext* context = encoder->context;
+    memset(context->frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    fseeko(input_file, 0, SEEK_SET);
+    encoder->histograms = count_chunk_frequencies(encoder->pool, input_file, encoder->buffer, encoder->chunks,
+                                                  context->frequency_table, &encoder->chunk_count);
+    if (encoder->histograms == NULL) {
+        return 0;
+    }
+    // The offsets still need the exact histograms, only the table is sampled
+    if (context->sample_size > 0 && file_size > context->sample_size) {
+        memset(context->frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+        if (sample_frequencies(input_file, context->frequency_table, context->sample_size) == -1) {
+            return 0;
+        }
+    }
+    if (fill_code_table(context->frequency_table, context->code_table) == 0) {
+        return 0;
+    }
+    if (prefer_tans(context->frequency_table, context->code_table)) {
+        return compress_tans(context, input_file, output_file);
+    }
+    if (prefer_packed(context->frequency_table, context->code_table)) {
+        return compress_packed(context, input_file, output_file);
+    }
+
+    // offsets[i] is the first bit of chunk i, offsets[chunk_count] the length of the stream
+    encoder->offsets = malloc((encoder->chunk_count + 1) * sizeof(uint64_t));
+    if (encoder->offsets == NULL) {
+        err("compress_parallel", "Unable to allocate memory for the offsets!");
+        return 0;
+    }
+    encoder->offsets[0] = 0;
+    for (size_t i = 0; i < encoder->chunk_count; i++) {
+        size_t* histogram = &encoder->histograms[i * FREQUENCY_TABLE_SIZE];
+        uint64_t bits = 0;
+        for (size_t symbol = 0; symbol < FREQUENCY_TABLE_SIZE; symbol++) {
+            bits += (uint64_t) histogram[symbol] * context->code_table[symbol].length;
+        }
+        encoder->offsets[i + 1] = encoder->offsets[i] + bits;
+    }
+
+    if (write_file_header(output_file, context->frequency_table) == 0) {
+        return 0;
+    }
+    fseeko(input_file, 0, SEEK_SET);
+    return write_chunks(encoder, input_file, output_file, prepare_pair_table(context, file_size));
+}
+
+/*
+* Function: compress_parallel
+* ---------------------------
+*  Compresses the input file on several threads into the same single
+*  stream as compress(). Every chunk's bit length is known from its
+*  histogram, so a prefix sum gives the exact bit offset every thread
+*  writes at.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  thread_count: Number of threads (0 uses the number of online CPUs)
+*  sample_size: Bytes sampled for the table of large inputs, 0 counts every
+*               byte (see sample_frequencies)
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_parallel(FILE* input_file, FILE* output_file, size_t thread_count, size_t sample_size) {
+    if (input_file == NULL || output_file == NULL) {
+        err("compress_parallel", "Input/output file is NULL!");
+        return 0;
+    }
+    // Small inputs get the compact header and incompressible ones are copied, the threads would not pay off
+    uint64_t file_size = get_file_size(input_file);
+    if (file_size < COMPACT_MAX_SIZE || probe_incompressible(input_file)) {
+        return compress(input_file, output_file);
+    }
+    clock_t start_time = clock();
+
+    ParallelEncoder encoder = {0};
+    encoder.context = create_context();
+    if (encoder.context != NULL) {
+        encoder.context->sample_size = sample_size;
+    }
+    encoder.pool = pool_create(thread_count, NULL, NULL);
+    encoder.buffer = malloc(PARALLEL_WINDOW_SIZE);
+    encoder.chunks = calloc(PARALLEL_WINDOW_CHUNKS, sizeof(ParallelChunk));
+    int result = 0;
+    if (encoder.context == NULL || encoder.pool == NULL || encoder.buffer == NULL || encoder.chunks == NULL) {
+        err("compress_parallel", "Unable to allocate memory for the encoder!");
+    } else {
+        result = encode_parallel(&encoder, input_file, output_file, file_size);
+    }
+
+    if (result) {
+        clock_t end_time = clock();
+        off_t compressed_file_size = ftello(output_file);
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished processing (%f s): %" PRIu64 " bytes -> %" PRId64 " bytes (%.2f%%)\n", time_spent, file_size,
+               (int64_t) compressed_file_size, (double) compressed_file_size / file_size * 100);
+    }
+    free(encoder.output);
+    free(encoder.offsets);
+    free(encoder.histograms);
+    free(encoder.chunks);
+    free(encoder.buffer);
+    pool_free(encoder.pool);
+    free_context(encoder.context);
+    return result;
+}
+
+/*
+* Function: decode_tree_symbol
+* ----------------------------
+*  Decodes one symbol bit by bit.
+*
+*  chunk: Pointer to the DecodeChunk object
+*  position: Pointer to the bit position, moved past the code
+*  symbol: Pointer to store the symbol
+*
+*  returns: If the data ended or the code is unused (0), On success (1)
+*/
+static int decode_tree_symbol(DecodeChunk* chunk, size_t* position, unsigned char* symbol) {
+    Node* current = chunk->root;
+    while (current->l_node != NULL || current->r_node != NULL) {
+        if (*position >= chunk->bit_limit) {
+            return 0;
+        }
+        int bit = (chunk->data[*position / 8] >> (7 - *position % 8)) & 1;
+        current = bit ? current->r_node : current->l_node;
+        (*position)++;
+        if (current == NULL) {
+            return 0;
+        }
+    }
+    *symbol = current->symbol;
+    return 1;
+}
+
+/*
+* Function: decode_chunk
+* ----------------------
+*  Decodes the codes starting in the chunk. A speculative chunk records
+*  where its first symbols start, so the stitching can find the first
+*  code boundary it shares with the previous chunk.
+*
+*  chunk: Pointer to the DecodeChunk object
+*/
+static void decode_chunk(DecodeChunk* chunk) {
+    size_t position = chunk->start;
+    chunk->decoded = 0;
+    chunk->sync_count = 0;
+    chunk->failed = 0;
+
+    // Speculative chunks decode symbol by symbol until every boundary that matters is recorded
+    while (!chunk->exact && chunk->sync_count < PARALLEL_SYNC_SYMBOLS && position < chunk->end) {
+        chunk->sync_positions[chunk->sync_count++] = position;
+        if (decode_tree_symbol(chunk, &position, &chunk->output[chunk->decoded]) == 0) {
+            chunk->failed = 1;
+            return;
+        }
+        chunk->decoded++;
+    }
+    while (position < chunk->end) {
+        size_t table_symbols = 0;
+        if (chunk->table != NULL) {
+            // Only codes ending before the chunk's end, the last one is decoded below
+            table_symbols = decode_table_run(chunk->table, chunk->data, chunk->data_size, &position, chunk->end,
+                                             chunk->output + chunk->decoded, chunk->output_size - chunk->decoded);
+            chunk->decoded += table_symbols;
+        }
+        if (table_symbols == 0) {
+            if (chunk->decoded >= chunk->output_size
+                || decode_tree_symbol(chunk, &position, &chunk->output[chunk->decoded]) == 0) {
+                chunk->failed = 1;
+                return;
+            }
+            chunk->decoded++;
+        }
+    }
+    chunk->position = position;
+}
+
+/*
+* Function: decode_task
+* ---------------------
+*  Decodes a chunk (pool task).
+*/
+static void decode_task(void* context, void* arg) {
+    (void) context;
+    decode_chunk(arg);
+}
+
+/*
+* Function: min_code_length
+* -------------------------
+*  Returns the depth of the shallowest leaf of the tree.
+*/
+static size_t min_code_length(Node* node) {
+    if (node->l_node == NULL || node->r_node == NULL) {
+        return 0;
+    }
+    size_t left = min_code_length(node->l_node);
+    size_t right = min_code_length(node->r_node);
+    return (left < right ? left : right) + 1;
+}
+
+/*
+* Function: stitch_chunk
+* ----------------------
+*  Decodes from the true start of a speculative chunk until a code
+*  boundary the chunk recorded; from there the chunk's output is valid.
+*  Without one, the chunk is decoded again from the true start.
+*
+*  decoder: Pointer to the ParallelDecoder object (the symbols before the
+*           boundary are stored in its prefix)
+*  chunk: Pointer to the DecodeChunk object
+*  start: End of the previous chunk's last code
+*
+*  returns: Number of symbols of the chunk to skip. If the data is corrupted, returns SIZE_MAX.
+*/
+static size_t stitch_chunk(ParallelDecoder* decoder, DecodeChunk* chunk, size_t start) {
+    decoder->prefix_size = 0;
+    if (!chunk->exact && !chunk->failed) {
+        size_t position = start;
+        size_t i = 0;
+        while (decoder->prefix_size < PARALLEL_SYNC_SYMBOLS) {
+            // The positions are increasing
+            while (i < chunk->sync_count && chunk->sync_positions[i] < position) {
+                i++;
+            }
+            if (i == chunk->sync_count) {
+                break;
+            }
+            if (chunk->sync_positions[i] == position) {
+                return i;
+            }
+            if (decode_tree_symbol(chunk, &position, &decoder->prefix[decoder->prefix_size++]) == 0) {
+                break;
+            }
+        }
+        decoder->prefix_size = 0;
+    }
+    if (!chunk->exact || chunk->start != start) {
+        decoder->resynced++;
+        chunk->start = start;
+        chunk->exact = 1;
+        decode_chunk(chunk);
+    }
+    return chunk->failed ? SIZE_MAX : 0;
+}
+
+/*
+* Function: decode_windows
+* ------------------------
+*  Decodes the encoded data window by window. The first chunk of a window
+*  starts where the previous window's last code ended, the others are
+*  decoded speculatively and stitched in order.
+*
+*  decoder: Pointer to the ParallelDecoder object
+*  input_file: Pointer to the input_file (at the start of the encoded data)
+*  output_file: Pointer to the output_file
+*  total_bits: Number of encoded bits
+*
+*  returns: If failed (0), On success (1)
+*/
+static int decode_windows(ParallelDecoder* decoder, FILE* input_file, FILE* output_file, uint64_t total_bits) {
+    const size_t window_size = PARALLEL_DECODE_CHUNK_SIZE * PARALLEL_WINDOW_CHUNKS;
+    const size_t chunk_bits = PARALLEL_DECODE_CHUNK_SIZE * 8;
+    off_t data_start = ftello(input_file);
+    uint64_t data_bytes = (total_bits + 7) / 8;
+    size_t start = 0; // End of the last decoded code, from the window's first bit
+    for (uint64_t window_offset = 0; window_offset < data_bytes; window_offset += window_size) {
+        // The codes starting in the window may end in the next 4 bytes
+        size_t read_size = data_bytes - window_offset < window_size + 8 ? data_bytes - window_offset : window_size + 8;
+        if (read_at(input_file, decoder->buffer, read_size, data_start + window_offset) == 0) {
+            err("decompress_parallel", "Unable to read the input file!");
+            return 0;
+        }
+        uint64_t window_bits = total_bits - window_offset * 8;
+        size_t window_end = window_bits < window_size * 8 ? window_bits : window_size * 8;
+
+        size_t chunk_count = 0;
+        for (size_t chunk_start = 0; chunk_start < window_end; chunk_start += chunk_bits, chunk_count++) {
+            DecodeChunk* chunk = &decoder->chunks[chunk_count];
+            chunk->data = decoder->buffer;
+            chunk->data_size = read_size;
+            chunk->bit_limit = window_bits < read_size * 8 ? window_bits : read_size * 8;
+            chunk->exact = chunk_count == 0;
+            chunk->start = chunk->exact ? start : chunk_start;
+            chunk->end = chunk_start + chunk_bits < window_end ? chunk_start + chunk_bits : window_end;
+            if (pool_submit(decoder->pool, decode_task, chunk) == 0) {
+                pool_wait(decoder->pool);
+                return 0;
+            }
+        }
+        pool_wait(decoder->pool);
+
+        for (size_t i = 0; i < chunk_count; i++) {
+            DecodeChunk* chunk = &decoder->chunks[i];
+            size_t skipped = stitch_chunk(decoder, chunk, start);
+            if (skipped == SIZE_MAX) {
+                err("decompress_parallel", "Encoded data is corrupted!");
+                return 0;
+            }
+            size_t size = chunk->decoded - skipped;
+            if (output_file != NULL
+                && (fwrite(decoder->prefix, sizeof(unsigned char), decoder->prefix_size, output_file) < decoder->prefix_size
+                    || fwrite(chunk->output + skipped, sizeof(unsigned char), size, output_file) < size)) {
+                err("decompress_parallel", "Unable to write the output file!");
+                return 0;
+            }
+            start = chunk->position;
+        }
+        print_log("\rProcessing: %" PRIu64 "/%" PRIu64 " bytes...", window_offset + read_size, data_bytes);
+        // Valid data never ends in the middle of a code
+        if (window_offset + window_size >= data_bytes) {
+            if (start != window_bits) {
+                err("decompress_parallel", "Encoded data is corrupted!");
+                return 0;
+            }
+        } else {
+            // The next window starts window_size bytes later
+            start -= window_size * 8;
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: decompress_parallel
+* -----------------------------
+*  Decompresses a single stream file on several threads. Every chunk of the
+*  encoded data is decoded from an arbitrary bit offset; Huffman codes
+*  resynchronize quickly, so once the previous chunk's last code ends on a
+*  code boundary the chunk found, the rest of its output is valid. Chunks
+*  that do not synchronize are decoded again from the right offset. Other
+*  formats are decompressed by decompress().
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  thread_count: Number of threads (0 uses the number of online CPUs)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_parallel(FILE* input_file, FILE* output_file, size_t thread_count) {
+    if (input_file == NULL) {
+        err("decompress_parallel", "Input file is NULL!");
+        return 0;
+    }
+    if (is_seekable(input_file) || is_dictionary_stream(input_file) || is_compact(input_file)
+        || is_packed(input_file) || is_tans(input_file) || is_adaptive(input_file) || is_stored(input_file)
+        || is_record_file(input_file) || get_file_size(input_file) < 2 * PARALLEL_DECODE_CHUNK_SIZE) {
+        return decompress(input_file, output_file);
+    }
+    clock_t start_time = clock();
+
+    int bit_padding = 0;
+    size_t list_size = 0;
+    fseeko(input_file, 0, SEEK_SET);
+    size_t* frequency_table = read_file_header(input_file, &list_size, &bit_padding);
+    if (frequency_table == NULL) {
+        return 0;
+    }
+    if (bit_padding < 0 || bit_padding > 7) {
+        err("decompress_parallel", "Encoded data is corrupted!");
+        free(frequency_table);
+        return 0;
+    }
+    Node* root = create_huffman_tree(frequency_table, 0);
+    free(frequency_table);
+    if (root == NULL) {
+        return 0;
+    }
+    // Every bit is a symbol of a single symbol tree, nothing to synchronize
+    size_t min_length = min_code_length(root);
+    if (min_length == 0) {
+        free_tree(root);
+        fseeko(input_file, 0, SEEK_SET);
+        return decompress(input_file, output_file);
+    }
+
+    uint64_t file_size = get_file_size(input_file);
+    off_t data_start = ftello(input_file);
+    uint64_t total_bits = get_total_bits(file_size - data_start - 1, bit_padding);
+    // Every code of a chunk starts in its bits, table entries may write a few more bytes
+    size_t output_size = PARALLEL_DECODE_CHUNK_SIZE * 8 / min_length + 1;
+
+    ParallelDecoder decoder = {0};
+    decoder.root = root;
+    decoder.table = create_decode_table(root);
+    decoder.pool = pool_create(thread_count, NULL, NULL);
+    decoder.buffer = malloc(PARALLEL_DECODE_CHUNK_SIZE * PARALLEL_WINDOW_CHUNKS + 8);
+    decoder.chunks = calloc(PARALLEL_WINDOW_CHUNKS, sizeof(DecodeChunk));
+    int result = decoder.pool != NULL && decoder.buffer != NULL && decoder.chunks != NULL;
+    for (size_t i = 0; result && i < PARALLEL_WINDOW_CHUNKS; i++) {
+        decoder.chunks[i].root = root;
+        decoder.chunks[i].table = decoder.table;
+        decoder.chunks[i].output_size = output_size;
+        decoder.chunks[i].output = malloc(output_size + DECODE_TABLE_MAX_SYMBOLS);
+        result = decoder.chunks[i].output != NULL;
+    }
+    if (result == 0) {
+        err("decompress_parallel", "Unable to allocate memory for the decoder!");
+    } else {
+        result = decode_windows(&decoder, input_file, output_file, total_bits);
+    }
+
+    if (result) {
+        clock_t end_time = clock();
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished Processing (%f s): %" PRIu64 " bytes, %zu chunks decoded again.\n", time_spent, file_size,
+                  decoder.resynced);
+    }
+    for (size_t i = 0; decoder.chunks != NULL && i < PARALLEL_WINDOW_CHUNKS; i++) {
+        free(decoder.chunks[i].output);
+    }
+    free(decoder.chunks);
+    free(decoder.buffer);
+    pool_free(decoder.pool);
+    free_decode_table(decoder.table);
+    free_tree(root);
+    return result;
+}
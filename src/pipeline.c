@@ -0,0 +1,682 @@
+#include "../include/adaptive.h"
+#include "../include/constants.h"
+#include "../include/compact.h"
+#include "../include/compressor.h"
+#include "../include/dictionary.h"
+#include "../include/huffman.h"
+#include "../include/packed.h"
+#include "../include/pipeline.h"
+#include "../include/record.h"
+#include "../include/seekable.h"
+#include "../include/stored.h"
+#include "../include/tans.h"
+#include "../include/utils.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    FILE* input_file;
+    FILE* output_file;
+    PipeLink input_link; // reader -> coder
+    PipeLink output_link; // coder -> writer
+    size_t* frequency_table;
+    Code* code_table;
+    Node* root;
+    uint64_t total_bits; // Encoder: produced bits, Decoder: bits to decode
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    atomic_int failed;
+} PipelineState;
+
+/*
+* Function: spsc_create
+* ---------------------
+*  Creates a single-producer/single-consumer ring.
+*
+*  capacity: Minimum number of items (rounded up to a power of 2)
+*
+*  returns: Pointer to the ring. If failed, returns NULL.
+*/
+SpscRing* spsc_create(size_t capacity) {
+    SpscRing* ring = malloc(sizeof(SpscRing));
+    if (ring == NULL) {
+        fprintf(stderr, "\n[ERROR]: spsc_create() {} -> Unable to allocate memory for the ring!\n");
+        return NULL;
+    }
+    ring->capacity = 1;
+    while (ring->capacity < capacity) {
+        ring->capacity <<= 1;
+    }
+    ring->items = malloc(ring->capacity * sizeof(Chunk*));
+    if (ring->items == NULL) {
+        fprintf(stderr, "\n[ERROR]: spsc_create() {} -> Unable to allocate memory for the ring items!\n");
+        free(ring);
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->waiters, 0);
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->moved, NULL);
+    return ring;
+}
+
+/*
+* Function: spsc_push
+* -------------------
+*  Adds a chunk at the tail of the ring. Must only be called by the producer.
+*
+*  ring: Pointer to the ring
+*  chunk: Pointer to the chunk
+*
+*  returns: If the ring is full (0), On success (1)
+*/
+int spsc_push(SpscRing* ring, Chunk* chunk) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head >= ring->capacity) {
+        return 0;
+    }
+    ring->items[tail & (ring->capacity - 1)] = chunk;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+/*
+* Function: spsc_pop
+* ------------------
+*  Removes the chunk at the head of the ring. Must only be called by the consumer.
+*
+*  ring: Pointer to the ring
+*
+*  returns: Pointer to the chunk. If the ring is empty, returns NULL.
+*/
+Chunk* spsc_pop(SpscRing* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+    Chunk* chunk = ring->items[head & (ring->capacity - 1)];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return chunk;
+}
+
+/*
+* Function: spsc_free
+* -------------------
+*  Frees the ring (not the chunks).
+*
+*  ring: Pointer to the ring
+*/
+void spsc_free(SpscRing* ring) {
+    if (ring == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->moved);
+    free(ring->items);
+    free(ring);
+}
+
+/*
+* Function: free_link
+* -------------------
+*  Frees the rings and the chunks of a link.
+*
+*  link: Pointer to the PipeLink object
+*/
+static void free_link(PipeLink* link) {
+    spsc_free(link->full);
+    spsc_free(link->free);
+    if (link->chunks != NULL) {
+        for (size_t i = 0; i < link->chunk_count; i++) {
+            free(link->chunks[i].data);
+        }
+    }
+    free(link->chunks);
+    memset(link, 0, sizeof(PipeLink));
+}
+
+/*
+* Function: init_link
+* -------------------
+*  Allocates the recycled chunks of a link and puts all of them in the free ring.
+*
+*  link: Pointer to the PipeLink object
+*  chunk_count: Number of chunks
+*
+*  returns: If failed (0), On success (1)
+*/
+static int init_link(PipeLink* link, size_t chunk_count) {
+    memset(link, 0, sizeof(PipeLink));
+    link->full = spsc_create(chunk_count);
+    link->free = spsc_create(chunk_count);
+    link->chunks = calloc(chunk_count, sizeof(Chunk));
+    if (link->full == NULL || link->free == NULL || link->chunks == NULL) {
+        free_link(link);
+        return 0;
+    }
+    link->chunk_count = chunk_count;
+    for (size_t i = 0; i < chunk_count; i++) {
+        link->chunks[i].data = malloc(PIPELINE_CHUNK_SIZE);
+        if (link->chunks[i].data == NULL) {
+            err("init_link", "Unable to allocate memory for the chunks!");
+            free_link(link);
+            return 0;
+        }
+        spsc_push(link->free, &link->chunks[i]);
+    }
+    return 1;
+}
+
+/*
+* Function: wake_ring
+* -------------------
+*  Wakes the stages sleeping on the ring after it moved. The lock is only
+*  taken if a stage is waiting.
+*
+*  ring: Pointer to the ring
+*/
+static void wake_ring(SpscRing* ring) {
+    // Orders the head/tail store before the waiters load (see wait_ring)
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&ring->waiters) > 0) {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_broadcast(&ring->moved);
+        pthread_mutex_unlock(&ring->lock);
+    }
+}
+
+/*
+* Function: fail_pipeline
+* -----------------------
+*  Marks the pipeline as failed and wakes every sleeping stage.
+*
+*  state: Pointer to the pipeline state
+*/
+static void fail_pipeline(PipelineState* state) {
+    atomic_store(&state->failed, 1);
+    SpscRing* rings[] = {state->input_link.full, state->input_link.free, state->output_link.full,
+                         state->output_link.free};
+    for (size_t i = 0; i < sizeof(rings) / sizeof(rings[0]); i++) {
+        if (rings[i] != NULL) {
+            pthread_mutex_lock(&rings[i]->lock);
+            pthread_cond_broadcast(&rings[i]->moved);
+            pthread_mutex_unlock(&rings[i]->lock);
+        }
+    }
+}
+
+/*
+* Function: pop_wait
+* ------------------
+*  Waits for a chunk on the ring, spinning briefly before sleeping.
+*  Gives up if another stage failed.
+*
+*  ring: Pointer to the ring
+*  state: Pointer to the pipeline state
+*
+*  returns: Pointer to the chunk. If the pipeline failed, returns NULL.
+*/
+static Chunk* pop_wait(SpscRing* ring, PipelineState* state) {
+    Chunk* chunk = NULL;
+    for (int i = 0; i < PIPELINE_SPIN_COUNT && chunk == NULL; i++) {
+        if (atomic_load(&state->failed)) {
+            return NULL;
+        }
+        chunk = spsc_pop(ring);
+    }
+    if (chunk == NULL) {
+        pthread_mutex_lock(&ring->lock);
+        atomic_fetch_add(&ring->waiters, 1);
+        // Orders the waiters store before the tail load (see wake_ring)
+        atomic_thread_fence(memory_order_seq_cst);
+        while ((chunk = spsc_pop(ring)) == NULL && !atomic_load(&state->failed)) {
+            pthread_cond_wait(&ring->moved, &ring->lock);
+        }
+        atomic_fetch_sub(&ring->waiters, 1);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    if (chunk != NULL) {
+        wake_ring(ring);
+    }
+    return chunk;
+}
+
+/*
+* Function: push_wait
+* -------------------
+*  Waits until the chunk fits in the ring, spinning briefly before sleeping.
+*  Gives up if another stage failed.
+*
+*  ring: Pointer to the ring
+*  chunk: Pointer to the chunk
+*  state: Pointer to the pipeline state
+*
+*  returns: If the pipeline failed (0), On success (1)
+*/
+static int push_wait(SpscRing* ring, Chunk* chunk, PipelineState* state) {
+    int pushed = 0;
+    for (int i = 0; i < PIPELINE_SPIN_COUNT && !pushed; i++) {
+        if (atomic_load(&state->failed)) {
+            return 0;
+        }
+        pushed = spsc_push(ring, chunk);
+    }
+    if (!pushed) {
+        pthread_mutex_lock(&ring->lock);
+        atomic_fetch_add(&ring->waiters, 1);
+        // Orders the waiters store before the head load (see wake_ring)
+        atomic_thread_fence(memory_order_seq_cst);
+        while (!(pushed = spsc_push(ring, chunk)) && !atomic_load(&state->failed)) {
+            pthread_cond_wait(&ring->moved, &ring->lock);
+        }
+        atomic_fetch_sub(&ring->waiters, 1);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    if (pushed) {
+        wake_ring(ring);
+    }
+    return pushed;
+}
+
+/*
+* Function: reader_stage
+* ----------------------
+*  Reads the input file into chunks until the end of file.
+*  An empty chunk marks the end of the stream.
+*/
+static void* reader_stage(void* arg) {
+    PipelineState* state = arg;
+    PipeLink* link = &state->input_link;
+    while (1) {
+        Chunk* chunk = pop_wait(link->free, state);
+        if (chunk == NULL) {
+            break;
+        }
+        chunk->size = fread(chunk->data, 1, PIPELINE_CHUNK_SIZE, state->input_file);
+        if (chunk->size == 0 && ferror(state->input_file)) {
+            err("reader_stage", "Unable to read the input file!");
+            fail_pipeline(state);
+            break;
+        }
+        size_t size = chunk->size;
+        state->bytes_read += size;
+        if (push_wait(link->full, chunk, state) == 0 || size == 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+* Function: histogram_stage
+* -------------------------
+*  Counts the occurance of every byte of the chunks.
+*/
+static void* histogram_stage(void* arg) {
+    PipelineState* state = arg;
+    PipeLink* link = &state->input_link;
+    while (1) {
+        Chunk* chunk = pop_wait(link->full, state);
+        if (chunk == NULL) {
+            break;
+        }
+        size_t size = chunk->size;
+        for (size_t i = 0; i < size; i++) {
+            state->frequency_table[chunk->data[i]]++;
+        }
+        if (push_wait(link->free, chunk, state) == 0 || size == 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+* Function: encoder_stage
+* -----------------------
+*  Encodes the input chunks into output chunks of whole bytes. The last
+*  byte is padded with zero bits.
+*/
+static void* encoder_stage(void* arg) {
+    PipelineState* state = arg;
+    PipeLink* input = &state->input_link;
+    PipeLink* output = &state->output_link;
+    Code* code_table = state->code_table;
+    uint64_t accumulator = 0;
+    int accumulator_bits = 0;
+
+    Chunk* out = pop_wait(output->free, state);
+    if (out == NULL) {
+        return NULL;
+    }
+    out->size = 0;
+
+    while (1) {
+        Chunk* chunk = pop_wait(input->full, state);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        size_t size = chunk->size;
+        for (size_t i = 0; i < size; i++) {
+            Code code = code_table[chunk->data[i]];
+            accumulator = (accumulator << code.length) | code.code;
+            accumulator_bits += code.length;
+            state->total_bits += code.length;
+            while (accumulator_bits >= 8) {
+                accumulator_bits -= 8;
+                out->data[out->size++] = (unsigned char) (accumulator >> accumulator_bits);
+                if (out->size == PIPELINE_CHUNK_SIZE) {
+                    if (push_wait(output->full, out, state) == 0 || (out = pop_wait(output->free, state)) == NULL) {
+                        return NULL;
+                    }
+                    out->size = 0;
+                }
+            }
+        }
+        if (push_wait(input->free, chunk, state) == 0) {
+            return NULL;
+        }
+        if (size == 0) {
+            break;
+        }
+    }
+
+    // Pad the last byte and send the end of stream marker
+    if (accumulator_bits > 0) {
+        out->data[out->size++] = (unsigned char) (accumulator << (8 - accumulator_bits));
+    }
+    if (out->size > 0) {
+        if (push_wait(output->full, out, state) == 0 || (out = pop_wait(output->free, state)) == NULL) {
+            return NULL;
+        }
+        out->size = 0;
+    }
+    push_wait(output->full, out, state);
+    return NULL;
+}
+
+/*
+* Function: decoder_stage
+* -----------------------
+*  Decodes total_bits bits of the input chunks by walking the huffman tree.
+*  The remaining input (e.g. the padding byte) is consumed and ignored.
+*/
+static void* decoder_stage(void* arg) {
+    PipelineState* state = arg;
+    PipeLink* input = &state->input_link;
+    PipeLink* output = &state->output_link;
+    Node* root = state->root;
+    Node* current = root;
+    int single_symbol = root->l_node == NULL && root->r_node == NULL;
+    size_t bits = 0;
+
+    Chunk* out = pop_wait(output->free, state);
+    if (out == NULL) {
+        return NULL;
+    }
+    out->size = 0;
+
+    while (1) {
+        Chunk* chunk = pop_wait(input->full, state);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        size_t size = chunk->size;
+        for (size_t i = 0; i < size && bits < state->total_bits; i++) {
+            unsigned char byte = chunk->data[i];
+            for (int bit_idx = 7; bit_idx >= 0 && bits < state->total_bits; bit_idx--, bits++) {
+                if (!single_symbol) {
+                    current = (byte >> bit_idx) & 1 ? current->r_node : current->l_node;
+                }
+                // Leaf Node:
+                if (current->l_node == NULL && current->r_node == NULL) {
+                    out->data[out->size++] = current->symbol;
+                    current = root;
+                    if (out->size == PIPELINE_CHUNK_SIZE) {
+                        if (push_wait(output->full, out, state) == 0
+                            || (out = pop_wait(output->free, state)) == NULL) {
+                            return NULL;
+                        }
+                        out->size = 0;
+                    }
+                }
+            }
+        }
+        if (push_wait(input->free, chunk, state) == 0) {
+            return NULL;
+        }
+        if (size == 0) {
+            break;
+        }
+    }
+
+    if (out->size > 0) {
+        if (push_wait(output->full, out, state) == 0 || (out = pop_wait(output->free, state)) == NULL) {
+            return NULL;
+        }
+        out->size = 0;
+    }
+    push_wait(output->full, out, state);
+    return NULL;
+}
+
+/*
+* Function: writer_stage
+* ----------------------
+*  Writes the chunks to the output file until the end of stream marker.
+*/
+static void* writer_stage(void* arg) {
+    PipelineState* state = arg;
+    PipeLink* link = &state->output_link;
+    while (1) {
+        Chunk* chunk = pop_wait(link->full, state);
+        if (chunk == NULL) {
+            break;
+        }
+        size_t size = chunk->size;
+        if (size > 0 && fwrite(chunk->data, 1, size, state->output_file) < size) {
+            err("writer_stage", "Unable to write to the output file!");
+            fail_pipeline(state);
+            break;
+        }
+        state->bytes_written += size;
+        if (push_wait(link->free, chunk, state) == 0 || size == 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+* Function: run_stages
+* --------------------
+*  Starts one thread per stage and waits for all of them.
+*
+*  stages: Array of stage functions
+*  count: Number of stages
+*  state: Pointer to the pipeline state
+*
+*  returns: If failed (0), On success (1)
+*/
+static int run_stages(void* (**stages)(void*), size_t count, PipelineState* state) {
+    pthread_t threads[4];
+    size_t started = 0;
+    for (; started < count; started++) {
+        if (pthread_create(&threads[started], NULL, stages[started], state) != 0) {
+            err("run_stages", "Unable to start the pipeline threads!");
+            fail_pipeline(state);
+            break;
+        }
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return !atomic_load(&state->failed);
+}
+
+/*
+* Function: compress_pipelined
+* ----------------------------
+* Compresses the input file with separate reader, histogram, encoder and
+* writer threads. The output is identical to compress().
+*
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file
+*
+* returns: If failed (0), On success (1)
+*/
+int compress_pipelined(FILE* input_file, FILE* output_file) {
+    if (input_file == NULL || output_file == NULL) {
+        err("compress_pipelined", "Input/output file is NULL!");
+        return 0;
+    }
+    // Small inputs get the compact header and incompressible ones are copied, the threads would not pay off
+    if (get_file_size(input_file) < COMPACT_MAX_SIZE || probe_incompressible(input_file)) {
+        return compress(input_file, output_file);
+    }
+    PipelineState state;
+    memset(&state, 0, sizeof(state));
+    atomic_init(&state.failed, 0);
+    state.input_file = input_file;
+    state.output_file = output_file;
+    clock_t start_time = clock();
+
+    state.frequency_table = calloc(FREQUENCY_TABLE_SIZE, sizeof(size_t));
+    if (state.frequency_table == NULL || init_link(&state.input_link, PIPELINE_CHUNKS) == 0) {
+        err("compress_pipelined", "Unable to allocate memory for the pipeline!");
+        free(state.frequency_table);
+        return 0;
+    }
+
+    // First pass: reader -> histogram
+    void* (*histogram_stages[])(void*) = {reader_stage, histogram_stage};
+    if (run_stages(histogram_stages, 2, &state) == 0) {
+        free_link(&state.input_link);
+        free(state.frequency_table);
+        return 0;
+    }
+    uint64_t file_size = state.bytes_read;
+
+    state.code_table = create_code_table(state.frequency_table);
+    // Packed and tANS files have no stages to overlap, compress() stores them the same way
+    if (state.code_table != NULL && (prefer_tans(state.frequency_table, state.code_table)
+                                     || prefer_packed(state.frequency_table, state.code_table))) {
+        free_link(&state.input_link);
+        free(state.code_table);
+        free(state.frequency_table);
+        fseeko(input_file, 0, SEEK_SET);
+        return compress(input_file, output_file);
+    }
+    if (state.code_table == NULL || write_file_header(output_file, state.frequency_table) == 0
+        || init_link(&state.output_link, PIPELINE_CHUNKS) == 0) {
+        free_link(&state.input_link);
+        free(state.code_table);
+        free(state.frequency_table);
+        return 0;
+    }
+
+    // Second pass: reader -> encoder -> writer
+    fseeko(input_file, 0, SEEK_SET);
+    void* (*encoder_stages[])(void*) = {reader_stage, encoder_stage, writer_stage};
+    int result = run_stages(encoder_stages, 3, &state);
+    if (result) {
+        unsigned char remaining_bits = state.total_bits % 8;
+        result = fwrite(&remaining_bits, sizeof(unsigned char), 1, output_file) == 1;
+    }
+
+    if (result) {
+        clock_t end_time = clock();
+        off_t compressed_file_size = ftello(output_file);
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished processing (%f s): %" PRIu64 " bytes -> %" PRId64 " bytes (%.2f%%)\n", time_spent, file_size,
+               (int64_t) compressed_file_size, file_size > 0 ? (double) compressed_file_size / file_size * 100 : 0);
+    }
+
+    free_link(&state.input_link);
+    free_link(&state.output_link);
+    free(state.code_table);
+    free(state.frequency_table);
+    return result;
+}
+
+/*
+* Function: decompress_pipelined
+* ------------------------------
+* Decompresses the input file with separate reader, decoder and writer threads.
+*
+* input_file: Pointer to the input_file
+* output_file: Pointer to the output_file
+*
+* returns: If failed (0), On success (1)
+*/
+int decompress_pipelined(FILE* input_file, FILE* output_file) {
+    if (input_file == NULL || output_file == NULL) {
+        err("decompress_pipelined", "Input/output file is NULL!");
+        return 0;
+    }
+    // Seekable files are decoded segment by segment
+    if (is_seekable(input_file)) {
+        return decompress_seekable(input_file, output_file, 0);
+    }
+    if (is_dictionary_stream(input_file)) {
+        return decompress_with_dictionary(NULL, NULL, input_file, output_file);
+    }
+    if (is_compact(input_file) || is_packed(input_file) || is_tans(input_file) || is_adaptive(input_file)
+        || is_stored(input_file) || is_record_file(input_file)) {
+        return decompress(input_file, output_file);
+    }
+    PipelineState state;
+    memset(&state, 0, sizeof(state));
+    atomic_init(&state.failed, 0);
+    state.input_file = input_file;
+    state.output_file = output_file;
+    clock_t start_time = clock();
+
+    int bit_padding = 0;
+    size_t list_size = 0;
+    state.frequency_table = read_file_header(input_file, &list_size, &bit_padding);
+    if (state.frequency_table == NULL) {
+        return 0;
+    }
+    state.root = create_huffman_tree(state.frequency_table, 0);
+    if (state.root == NULL) {
+        free(state.frequency_table);
+        return 0;
+    }
+    uint64_t file_size = get_file_size(input_file);
+    off_t header_size = ftello(input_file);
+    state.total_bits = get_total_bits(file_size - header_size - 1, bit_padding);
+
+    if (init_link(&state.input_link, PIPELINE_CHUNKS) == 0 || init_link(&state.output_link, PIPELINE_CHUNKS) == 0) {
+        free_link(&state.input_link);
+        free_tree(state.root);
+        free(state.frequency_table);
+        return 0;
+    }
+
+    void* (*decoder_stages[])(void*) = {reader_stage, decoder_stage, writer_stage};
+    int result = run_stages(decoder_stages, 3, &state);
+
+    if (result) {
+        clock_t end_time = clock();
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished Processing (%f s): %" PRIu64 " bytes -> %" PRIu64 " bytes.\n", time_spent, file_size,
+                  state.bytes_written);
+    }
+
+    free_link(&state.input_link);
+    free_link(&state.output_link);
+    free_tree(state.root);
+    free(state.frequency_table);
+    return result;
+}
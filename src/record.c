@@ -0,0 +1,547 @@
+#include "../include/asyncio.h"
+#include "../include/bitio.h"
+#include "../include/compressor.h"
+#include "../include/constants.h"
+#include "../include/decodetable.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/record.h"
+#include "../include/utils.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Group table offset (8 bytes) + magic (4 bytes)
+#define RECORD_TRAILER_SIZE 12
+// Data offset + run offset (8 bytes each)
+#define RECORD_GROUP_ENTRY_SIZE 16
+// Longest record + largest encoded record (8 bytes each), after the group table
+#define RECORD_LIMITS_SIZE 16
+// Two varints of at most 10 bytes for every record of a group
+#define RECORD_MAX_RUN_SIZE (RECORD_GROUP_SIZE * 20)
+#define RECORD_LENGTH_SIZE 4
+
+/*
+* Function: is_record_file
+* ------------------------
+*  Checks if the file starts with the record format's magic bytes and a
+*  supported version, and ends with the trailer's magic bytes.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_record_file(FILE* file) {
+    unsigned char header[sizeof(record_magic) + 1];
+    unsigned char trailer[sizeof(record_magic)];
+    off_t position = ftello(file);
+    int result = fseeko(file, 0, SEEK_SET) == 0
+                 && fread(header, sizeof(unsigned char), sizeof(header), file) == sizeof(header)
+                 && memcmp(header, record_magic, sizeof(record_magic)) == 0 && header[sizeof(record_magic)] == RECORD_VERSION
+                 && fseeko(file, -(off_t) sizeof(trailer), SEEK_END) == 0
+                 && fread(trailer, sizeof(unsigned char), sizeof(trailer), file) == sizeof(trailer)
+                 && memcmp(trailer, record_magic, sizeof(trailer)) == 0;
+    fseeko(file, position, SEEK_SET);
+    return result;
+}
+
+/*
+* Function: read_record
+* ---------------------
+*  Reads the next record of the input without its delimiter.
+*
+*  file: Pointer to the input file
+*  flags: RECORD_FLAG_LENGTH for length prefixed records, 0 for lines
+*  buffer: Pointer to the record buffer (grown if needed)
+*  capacity: Pointer to the size of the buffer
+*  length: Pointer to store the length of the record
+*  has_newline: Pointer to store if the line ended with a newline
+*
+*  returns: (1) if a record was read, (0) at the end of the file, (-1) if failed
+*/
+static int read_record(FILE* file, int flags, unsigned char** buffer, size_t* capacity, size_t* length, int* has_newline) {
+    if (!(flags & RECORD_FLAG_LENGTH)) {
+        ssize_t read_bytes = getline((char**) buffer, capacity, file);
+        if (read_bytes == -1) {
+            return ferror(file) ? -1 : 0;
+        }
+        *has_newline = (*buffer)[read_bytes - 1] == '\n';
+        *length = read_bytes - *has_newline;
+        return 1;
+    }
+    unsigned char prefix[RECORD_LENGTH_SIZE];
+    size_t read_bytes = fread(prefix, sizeof(unsigned char), RECORD_LENGTH_SIZE, file);
+    if (read_bytes == 0 && !ferror(file)) {
+        return 0;
+    }
+    if (read_bytes < RECORD_LENGTH_SIZE) {
+        err("read_record", "Record length is truncated!");
+        return -1;
+    }
+    *length = (size_t) prefix[0] | (size_t) prefix[1] << 8 | (size_t) prefix[2] << 16 | (size_t) prefix[3] << 24;
+    if (*length > *capacity || *buffer == NULL) {
+        unsigned char* grown = realloc(*buffer, *length + 1);
+        if (grown == NULL) {
+            err("read_record", "Unable to allocate memory for the record!");
+            return -1;
+        }
+        *buffer = grown;
+        *capacity = *length + 1;
+    }
+    if (fread(*buffer, sizeof(unsigned char), *length, file) < *length) {
+        err("read_record", "Record is truncated!");
+        return -1;
+    }
+    return 1;
+}
+
+/*
+* Function: put_varint
+* --------------------
+*  Appends a LEB128 varint (see write_varint) to a growing buffer.
+*
+*  buffer: Pointer to the buffer
+*  size: Pointer to the number of used bytes
+*  capacity: Pointer to the size of the buffer
+*  value: Value to append
+*
+*  returns: If failed (0), On success (1)
+*/
+static int put_varint(unsigned char** buffer, size_t* size, size_t* capacity, uint64_t value) {
+    if (*size + 10 > *capacity) {
+        size_t grown_capacity = *capacity > 0 ? *capacity * 2 : 4 * KB;
+        unsigned char* grown = realloc(*buffer, grown_capacity);
+        if (grown == NULL) {
+            return 0;
+        }
+        *buffer = grown;
+        *capacity = grown_capacity;
+    }
+    do {
+        (*buffer)[*size] = value & 0x7F;
+        value >>= 7;
+        if (value != 0) {
+            (*buffer)[*size] |= 0x80;
+        }
+        (*size)++;
+    } while (value != 0);
+    return 1;
+}
+
+/*
+* Function: get_varint
+* --------------------
+*  Reads a LEB128 varint from a buffer.
+*
+*  buffer: Pointer to the buffer
+*  size: Number of bytes in the buffer
+*  position: Pointer to the position of the varint (updated)
+*  value: Pointer to store the value
+*
+*  returns: If failed (0), On success (1)
+*/
+static int get_varint(const unsigned char* buffer, size_t size, size_t* position, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && *position < size; shift += 7) {
+        unsigned char byte = buffer[(*position)++];
+        *value |= (uint64_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+* Function: compress_records
+* --------------------------
+*  Compresses a file of newline or length delimited records. Every record
+*  is encoded byte aligned with one table shared by the file, and an index
+*  of the record offsets is written at the end, so a single record can be
+*  decoded without the others (see huff_get_record).
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  flags: RECORD_FLAG_LENGTH for length prefixed records, 0 for lines
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_records(FILE* input_file, FILE* output_file, int flags) {
+    if (input_file == NULL || output_file == NULL) {
+        err("compress_records", "Input/output file is NULL!");
+        return 0;
+    }
+    HuffContext* context = create_context();
+    if (context == NULL) {
+        return 0;
+    }
+    clock_t start_time = clock();
+
+    // The first pass counts the records and the frequencies of their bytes
+    unsigned char* record = NULL;
+    size_t capacity = 0;
+    size_t length = 0;
+    int has_newline = 1;
+    uint64_t record_count = 0;
+    uint64_t original_size = 0;
+    int status = 0;
+    memset(context->frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    fseeko(input_file, 0, SEEK_SET);
+    while ((status = read_record(input_file, flags, &record, &capacity, &length, &has_newline)) == 1) {
+        for (size_t i = 0; i < length; i++) {
+            context->frequency_table[record[i]]++;
+        }
+        record_count++;
+        original_size += length;
+    }
+    if (!has_newline) {
+        flags |= RECORD_FLAG_NO_FINAL_NEWLINE;
+    }
+    uint64_t group_count = (record_count + RECORD_GROUP_SIZE - 1) / RECORD_GROUP_SIZE;
+    RecordGroup* groups = status == 0 ? malloc((group_count + 1) * sizeof(RecordGroup)) : NULL;
+    if (groups == NULL || (original_size > 0 && fill_code_table(context->frequency_table, context->code_table) == 0)) {
+        if (status == 0 && groups == NULL) {
+            err("compress_records", "Unable to allocate memory for the index!");
+        }
+        free(groups);
+        free(record);
+        free_context(context);
+        return 0;
+    }
+
+    // Header (Read the readme file for more information about the record file structure)
+    int result = fwrite(record_magic, sizeof(unsigned char), sizeof(record_magic), output_file) == sizeof(record_magic)
+                 && write_uint(output_file, RECORD_VERSION, 1) && write_uint(output_file, flags, 1)
+                 && write_uint(output_file, record_count, 8) && write_uint(output_file, original_size, 8);
+    if (result && original_size > 0) {
+        result = write_file_header(output_file, context->frequency_table);
+    }
+
+    // Every record ends with a flush, so the next one starts at a byte boundary
+    unsigned char* run = NULL;
+    size_t run_size = 0;
+    size_t run_capacity = 0;
+    uint64_t max_length = 0;
+    uint64_t max_size = 0;
+    BitWriter* bit_writer = context->bit_writer;
+    reset_writer(bit_writer, output_file);
+    uint64_t compressed_offset = ftello(output_file);
+    bit_writer->async = result ? async_open(output_file, ASYNC_WRITE) : NULL;
+    fseeko(input_file, 0, SEEK_SET);
+    for (uint64_t i = 0; i < record_count && result; i++) {
+        if (read_record(input_file, flags, &record, &capacity, &length, &has_newline) != 1) {
+            err("compress_records", "Unable to read the file!");
+            result = 0;
+            break;
+        }
+        // Run offsets are relative to the first run until the data is written
+        if (i % RECORD_GROUP_SIZE == 0) {
+            groups[i / RECORD_GROUP_SIZE].data_offset = compressed_offset;
+            groups[i / RECORD_GROUP_SIZE].run_offset = run_size;
+        }
+        uint64_t start_bits = bit_writer->total_bits;
+        for (size_t j = 0; j < length && result; j++) {
+            Code code = context->code_table[record[j]];
+            result = write_bits(bit_writer, code.code, code.length) != -1;
+        }
+        result = result && flush_writer(bit_writer) != -1;
+        uint64_t size = (bit_writer->total_bits - start_bits + 7) / 8;
+        compressed_offset += size;
+        max_length = length > max_length ? length : max_length;
+        max_size = size > max_size ? size : max_size;
+        if (result && (!put_varint(&run, &run_size, &run_capacity, length)
+                       || !put_varint(&run, &run_size, &run_capacity, size))) {
+            err("compress_records", "Unable to allocate memory for the index!");
+            result = 0;
+        }
+    }
+    if (bit_writer->async != NULL && async_close(bit_writer->async) == 0) {
+        result = 0;
+    }
+    bit_writer->async = NULL;
+
+    // Index: the runs of every group, the group table, the limits and the trailer
+    uint64_t run_start = ftello(output_file);
+    result = result && (run_size == 0 || fwrite(run, sizeof(unsigned char), run_size, output_file) == run_size);
+    uint64_t table_offset = ftello(output_file);
+    for (uint64_t i = 0; i < group_count && result; i++) {
+        result = write_uint(output_file, groups[i].data_offset, 8) && write_uint(output_file, run_start + groups[i].run_offset, 8);
+    }
+    result = result && write_uint(output_file, max_length, 8) && write_uint(output_file, max_size, 8)
+             && write_uint(output_file, table_offset, 8)
+             && fwrite(record_magic, sizeof(unsigned char), sizeof(record_magic), output_file) == sizeof(record_magic);
+    if (result) {
+        clock_t end_time = clock();
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished processing (%f s): %" PRIu64 " records, %" PRIu64 " bytes -> %" PRId64 " bytes\n", time_spent,
+                  record_count, original_size, (int64_t) ftello(output_file));
+    }
+
+    free(run);
+    free(groups);
+    free(record);
+    free_context(context);
+    return result;
+}
+
+/*
+* Function: record_open
+* ---------------------
+*  Reads the header, the table and the group index of a record file.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: Pointer to the RecordFile object. If failed, returns NULL.
+*/
+RecordFile* record_open(FILE* file) {
+    unsigned char magic[sizeof(record_magic)];
+    uint64_t version = 0;
+    uint64_t flags = 0;
+    if (fseeko(file, 0, SEEK_SET) != 0 || fread(magic, sizeof(unsigned char), sizeof(magic), file) < sizeof(magic)
+        || memcmp(magic, record_magic, sizeof(magic)) != 0 || !read_uint(file, &version, 1)) {
+        err("record_open", "Not a record file!");
+        return NULL;
+    }
+    if (version != RECORD_VERSION || !read_uint(file, &flags, 1)
+        || (flags & ~(RECORD_FLAG_LENGTH | RECORD_FLAG_NO_FINAL_NEWLINE)) != 0) {
+        err("record_open", "Unsupported record file version!");
+        return NULL;
+    }
+    RecordFile* records = calloc(1, sizeof(RecordFile));
+    if (records == NULL) {
+        err("record_open", "Unable to allocate memory for the record file!");
+        return NULL;
+    }
+    records->file = file;
+    records->flags = flags;
+
+    int result = read_uint(file, &records->record_count, 8) && read_uint(file, &records->original_size, 8);
+    if (result && records->original_size > 0) {
+        size_t frequency_table[FREQUENCY_TABLE_SIZE];
+        result = read_frequency_table(file, frequency_table) != 0
+                 && (records->root = create_huffman_tree(frequency_table, 0)) != NULL;
+        records->decode_table = result ? create_decode_table(records->root) : NULL;
+    }
+    uint64_t data_start = ftello(file);
+    uint64_t file_size = get_file_size(file);
+    uint64_t table_offset = 0;
+    records->group_count = (records->record_count + RECORD_GROUP_SIZE - 1) / RECORD_GROUP_SIZE;
+    result = result && file_size >= data_start + RECORD_LIMITS_SIZE + RECORD_TRAILER_SIZE
+             && fseeko(file, -RECORD_TRAILER_SIZE, SEEK_END) == 0 && read_uint(file, &table_offset, 8)
+             && fread(magic, sizeof(unsigned char), sizeof(magic), file) == sizeof(magic)
+             && memcmp(magic, record_magic, sizeof(magic)) == 0
+             && records->group_count <= file_size / RECORD_GROUP_ENTRY_SIZE && table_offset >= data_start
+             && table_offset + records->group_count * RECORD_GROUP_ENTRY_SIZE + RECORD_LIMITS_SIZE
+                == file_size - RECORD_TRAILER_SIZE
+             && (records->groups = malloc((records->group_count + 1) * sizeof(RecordGroup))) != NULL
+             && fseeko(file, table_offset, SEEK_SET) == 0;
+    for (uint64_t i = 0; i < records->group_count && result; i++) {
+        RecordGroup* group = &records->groups[i];
+        result = read_uint(file, &group->data_offset, 8) && read_uint(file, &group->run_offset, 8)
+                 && group->data_offset >= (i > 0 ? group[-1].data_offset : data_start)
+                 && group->run_offset >= (i > 0 ? group[-1].run_offset : data_start) && group->run_offset <= table_offset;
+    }
+    result = result && read_uint(file, &records->max_length, 8) && read_uint(file, &records->max_size, 8)
+             && records->max_length <= records->original_size && records->max_size <= file_size
+             && records->max_length <= records->max_size * 8; // Every code has at least one bit
+    if (result) {
+        records->data_end = records->group_count > 0 ? records->groups[0].run_offset : table_offset;
+        records->index_offset = table_offset;
+        records->cached_group = records->group_count;
+        records->data_buffer = malloc(records->max_size + 1);
+        // Table entries are copied whole, so a few bytes may be written past the record
+        records->output_buffer = malloc(records->max_length + DECODE_TABLE_MAX_SYMBOLS);
+        result = records->data_buffer != NULL && records->output_buffer != NULL;
+    }
+    if (!result) {
+        err("record_open", "Record index is corrupted!");
+        record_close(records);
+        return NULL;
+    }
+    return records;
+}
+
+/*
+* Function: record_close
+* ----------------------
+*  Frees the RecordFile object (The file is not closed).
+*
+*  records: Pointer to the RecordFile object
+*/
+void record_close(RecordFile* records) {
+    if (records == NULL) {
+        return;
+    }
+    if (records->root != NULL) {
+        free_tree(records->root);
+    }
+    free_decode_table(records->decode_table);
+    free(records->groups);
+    free(records->data_buffer);
+    free(records->output_buffer);
+    free(records);
+}
+
+/*
+* Function: record_load_group
+* ---------------------------
+*  Reads the varints of a group into the record offsets and lengths (unless it is cached).
+*
+*  records: Pointer to the RecordFile object
+*  group: Index of the group
+*
+*  returns: If failed (0), On success (1)
+*/
+int record_load_group(RecordFile* records, uint64_t group) {
+    if (records->cached_group == group) {
+        return 1;
+    }
+    unsigned char run[RECORD_MAX_RUN_SIZE];
+    uint64_t run_start = records->groups[group].run_offset;
+    uint64_t run_end = group + 1 < records->group_count ? records->groups[group + 1].run_offset : records->index_offset;
+    if (run_end - run_start > RECORD_MAX_RUN_SIZE || read_at(records->file, run, run_end - run_start, run_start) == 0) {
+        err("record_load_group", "Record index is corrupted!");
+        return 0;
+    }
+    uint64_t first = group * RECORD_GROUP_SIZE;
+    uint64_t count = records->record_count - first < RECORD_GROUP_SIZE ? records->record_count - first : RECORD_GROUP_SIZE;
+    uint64_t offset = records->groups[group].data_offset;
+    size_t position = 0;
+    records->cached_group = records->group_count;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t size = 0;
+        if (!get_varint(run, run_end - run_start, &position, &records->record_lengths[i])
+            || !get_varint(run, run_end - run_start, &position, &size)
+            || records->record_lengths[i] > records->max_length || size > records->max_size) {
+            err("record_load_group", "Record index is corrupted!");
+            return 0;
+        }
+        records->record_offsets[i] = offset;
+        offset += size;
+    }
+    records->record_offsets[count] = offset;
+    if (offset > records->data_end) {
+        err("record_load_group", "Record index is corrupted!");
+        return 0;
+    }
+    records->cached_group = group;
+    return 1;
+}
+
+/*
+* Function: huff_get_record
+* -------------------------
+*  Decodes one record (without its delimiter). Only the varints of the
+*  record's group and the encoded bytes of the record are read.
+*
+*  records: Pointer to the RecordFile object
+*  index: Index of the record
+*  length: Pointer to store the length of the record
+*
+*  returns: Pointer to the record, valid until the next call. If failed, returns NULL.
+*/
+const unsigned char* huff_get_record(RecordFile* records, uint64_t index, size_t* length) {
+    if (records == NULL || length == NULL || index >= records->record_count) {
+        err("huff_get_record", "Record index is out of range!");
+        return NULL;
+    }
+    if (!record_load_group(records, index / RECORD_GROUP_SIZE)) {
+        return NULL;
+    }
+    size_t slot = index % RECORD_GROUP_SIZE;
+    size_t record_length = records->record_lengths[slot];
+    size_t data_size = records->record_offsets[slot + 1] - records->record_offsets[slot];
+    if (record_length > 0) {
+        if (read_at(records->file, records->data_buffer, data_size, records->record_offsets[slot]) == 0
+            || decode_block(records->root, records->decode_table, records->data_buffer, data_size,
+                            records->output_buffer, record_length) < record_length) {
+            err("huff_get_record", "Record is corrupted!");
+            return NULL;
+        }
+    }
+    *length = record_length;
+    return records->output_buffer;
+}
+
+/*
+* Function: decompress_records
+* ----------------------------
+*  Decompresses a whole record file, with the delimiters of the input.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_records(FILE* input_file, FILE* output_file) {
+    RecordFile* records = record_open(input_file);
+    if (records == NULL) {
+        return 0;
+    }
+    clock_t start_time = clock();
+    AsyncFile* writer = output_file != NULL ? async_open(output_file, ASYNC_WRITE) : NULL;
+    int length_prefixed = (records->flags & RECORD_FLAG_LENGTH) != 0;
+    int result = output_file == NULL || writer != NULL;
+    for (uint64_t i = 0; i < records->record_count && result; i++) {
+        size_t length = 0;
+        const unsigned char* record = huff_get_record(records, i, &length);
+        if (record == NULL) {
+            result = 0;
+            break;
+        }
+        if (writer == NULL) {
+            continue;
+        }
+        unsigned char prefix[RECORD_LENGTH_SIZE] = {length & 0xFF, (length >> 8) & 0xFF, (length >> 16) & 0xFF, (length >> 24) & 0xFF};
+        int has_newline = !length_prefixed
+                          && (i + 1 < records->record_count || !(records->flags & RECORD_FLAG_NO_FINAL_NEWLINE));
+        if ((length_prefixed && async_write(writer, prefix, RECORD_LENGTH_SIZE) < RECORD_LENGTH_SIZE)
+            || async_write(writer, record, length) < (ssize_t) length
+            || (has_newline && async_write(writer, "\n", 1) < 1)) {
+            err("decompress_records", "Unable to write to the output file!");
+            result = 0;
+        }
+    }
+    if (writer != NULL && async_close(writer) == 0) {
+        result = 0;
+    }
+    if (result) {
+        clock_t end_time = clock();
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished Processing (%f s): %" PRIu64 " bytes -> %" PRIu64 " records.\n", time_spent,
+                  get_file_size(input_file), records->record_count);
+    }
+    record_close(records);
+    return result;
+}
+
+/*
+* Function: decompress_record
+* ---------------------------
+*  Decodes one record of a record file into the output file (without its delimiter).
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  index: Index of the record
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_record(FILE* input_file, FILE* output_file, uint64_t index) {
+    RecordFile* records = record_open(input_file);
+    if (records == NULL) {
+        return 0;
+    }
+    size_t length = 0;
+    const unsigned char* record = huff_get_record(records, index, &length);
+    int result = record != NULL && fwrite(record, sizeof(unsigned char), length, output_file) == length;
+    if (record != NULL && !result) {
+        err("decompress_record", "Unable to write to the output file!");
+    }
+    record_close(records);
+    return result;
+}
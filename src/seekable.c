@@ -0,0 +1,936 @@
+#include "../include/asyncio.h"
+#include "../include/bitio.h"
+#include "../include/compressor.h"
+#include "../include/constants.h"
+#include "../include/crc32c.h"
+#include "../include/decodetable.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/seekable.h"
+#include "../include/utils.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Seek table offset (8 bytes) + magic (4 bytes)
+#define SEEKABLE_TRAILER_SIZE 12
+// Compressed offset + uncompressed offset (8 bytes each) + checksum (4 bytes, only with SEEKABLE_FLAG_CHECKSUM)
+#define SYNC_POINT_SIZE 16
+#define CHECKSUM_SIZE 4
+// Table offset (8 bytes) of every table and table index (4 bytes) of every segment, only with SEEKABLE_FLAG_TABLES
+#define TABLE_OFFSET_SIZE 8
+#define TABLE_INDEX_SIZE 4
+// Magic (4 bytes) + version + flags (1 byte each) + original size (8 bytes) + segment size (4 bytes)
+#define SEEKABLE_HEADER_SIZE 18
+// Start offset + input size (8 bytes each), only with SEEKABLE_FLAG_SHARD
+#define SEEKABLE_SHARD_SIZE 16
+
+/*
+* Function: is_seekable
+* ---------------------
+*  Checks if the file starts with the seekable format's magic bytes.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_seekable(FILE* file) {
+    return has_magic(file, seekable_magic, sizeof(seekable_magic));
+}
+
+/*
+* Function: write_seek_table
+* --------------------------
+*  Writes the seek table and the trailer at the current position.
+*
+*  output_file: Pointer to the output_file
+*  sync_points: Sync point of every segment
+*  segment_count: Number of segments
+*  table_offsets: Offset of every table (only written with SEEKABLE_FLAG_TABLES)
+*  table_count: Number of tables
+*  flags: Flags of the file
+*  checksum: CRC32C of the whole data
+*
+*  returns: If failed (0), On success (1)
+*/
+static int write_seek_table(FILE* output_file, SyncPoint* sync_points, uint32_t segment_count,
+                            uint64_t* table_offsets, uint32_t table_count, int flags, uint32_t checksum) {
+    uint64_t table_offset = ftello(output_file);
+    int result = write_uint(output_file, segment_count, 4);
+    if (flags & SEEKABLE_FLAG_TABLES) {
+        result = result && write_uint(output_file, table_count, 4);
+        for (uint32_t i = 0; i < table_count && result; i++) {
+            result = write_uint(output_file, table_offsets[i], 8);
+        }
+    }
+    for (uint32_t i = 0; i < segment_count && result; i++) {
+        result = write_uint(output_file, sync_points[i].compressed_offset, 8)
+                 && write_uint(output_file, sync_points[i].uncompressed_offset, 8);
+        if (result && (flags & SEEKABLE_FLAG_CHECKSUM)) {
+            result = write_uint(output_file, sync_points[i].checksum, CHECKSUM_SIZE);
+        }
+        if (result && (flags & SEEKABLE_FLAG_TABLES)) {
+            result = write_uint(output_file, sync_points[i].table, TABLE_INDEX_SIZE);
+        }
+    }
+    if (result && (flags & SEEKABLE_FLAG_CHECKSUM)) {
+        result = write_uint(output_file, checksum, CHECKSUM_SIZE);
+    }
+    return result && write_uint(output_file, table_offset, 8)
+           && fwrite(seekable_magic, sizeof(unsigned char), sizeof(seekable_magic), output_file) == sizeof(seekable_magic);
+}
+
+/*
+* Function: write_seekable_header
+* -------------------------------
+*  Writes the header of a seekable file (without the frequency table).
+*
+*  output_file: Pointer to the output_file
+*  flags: Flags of the file
+*  original_size: Size of the original data
+*  segment_size: Uncompressed bytes per segment
+*  shard_start: Offset of the data in the input (only written with SEEKABLE_FLAG_SHARD)
+*  source_size: Size of the input (only written with SEEKABLE_FLAG_SHARD)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int write_seekable_header(FILE* output_file, int flags, uint64_t original_size, uint32_t segment_size,
+                                 uint64_t shard_start, uint64_t source_size) {
+    int result = fwrite(seekable_magic, sizeof(unsigned char), sizeof(seekable_magic), output_file) == sizeof(seekable_magic)
+                 && write_uint(output_file, SEEKABLE_VERSION, 1) && write_uint(output_file, flags, 1)
+                 && write_uint(output_file, original_size, 8) && write_uint(output_file, segment_size, 4);
+    if (result && (flags & SEEKABLE_FLAG_SHARD)) {
+        result = write_uint(output_file, shard_start, 8) && write_uint(output_file, source_size, 8);
+    }
+    return result;
+}
+
+/*
+* Function: count_range
+* ---------------------
+*  Adds the occurance of every byte of the next length bytes of the file to the frequency table.
+*
+*  file: Pointer to the input file
+*  length: Number of bytes to read
+*  frequency_table: Pointer to the frequency table (FREQUENCY_TABLE_SIZE entries)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int count_range(FILE* file, uint64_t length, size_t* frequency_table) {
+    unsigned char read_buffer[READ_BUFFER_SIZE];
+    while (length > 0) {
+        size_t chunk = length < READ_BUFFER_SIZE ? length : READ_BUFFER_SIZE;
+        size_t read_bytes = fread(read_buffer, sizeof(unsigned char), chunk, file);
+        if (read_bytes < chunk) {
+            err("count_range", "Unable to read the file!");
+            return 0;
+        }
+        for (size_t i = 0; i < read_bytes; i++) {
+            frequency_table[read_buffer[i]]++;
+        }
+        length -= read_bytes;
+    }
+    return 1;
+}
+
+/*
+* Function: compress_seekable
+* ---------------------------
+*  Compresses the input file into the seekable format: the encoded data is
+*  split into byte aligned segments and a seek table of their sync points
+*  is written at the end.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  segment_size: Uncompressed bytes per segment
+*  flags: SEEKABLE_FLAG_CHECKSUM or 0
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_seekable(FILE* input_file, FILE* output_file, uint32_t segment_size, int flags) {
+    return compress_shard(input_file, output_file, 0, UINT64_MAX, segment_size, flags, NULL);
+}
+
+/*
+* Function: compress_shard
+* ------------------------
+*  Compresses the byte range [start, end) of the input file into a seekable
+*  file (a shard). The start must be a multiple of the segment size and the
+*  end too unless it is the end of the input, so the shards of a file can be
+*  written by separate processes and joined with merge_shards. Unless the
+*  range is the whole input, the header stores the start and the input
+*  size (SEEKABLE_FLAG_SHARD), so merge_shards can check the order.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  start: Offset of the first byte
+*  end: Offset after the last byte (clamped to the size of the input)
+*  segment_size: Uncompressed bytes per segment
+*  flags: SEEKABLE_FLAG_CHECKSUM or 0
+*  frequency_table: Global table shared by the shards (every symbol must
+*                   be present), NULL counts a table for the range
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_shard(FILE* input_file, FILE* output_file, uint64_t start, uint64_t end, uint32_t segment_size,
+                   int flags, size_t* frequency_table) {
+    if (input_file == NULL || output_file == NULL || segment_size == 0) {
+        err("compress_shard", "Input/output file is NULL!");
+        return 0;
+    }
+    uint64_t file_size = get_file_size(input_file);
+    if (end > file_size) {
+        end = file_size;
+    }
+    if (start > end || start % segment_size != 0 || (end < file_size && end % segment_size != 0)) {
+        err("compress_shard", "The range must start and end at a segment boundary!");
+        return 0;
+    }
+    if (frequency_table != NULL) {
+        for (int i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            if (frequency_table[i] == 0) {
+                err("compress_shard", "The global table must have a code for every symbol!");
+                return 0;
+            }
+        }
+    }
+    HuffContext* context = create_context();
+    if (context == NULL) {
+        return 0;
+    }
+    clock_t start_time = clock();
+
+    uint64_t original_size = end - start;
+    int result = fseeko(input_file, start, SEEK_SET) == 0;
+    if (frequency_table != NULL) {
+        memcpy(context->frequency_table, frequency_table, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+    } else {
+        memset(context->frequency_table, 0, FREQUENCY_TABLE_SIZE * sizeof(size_t));
+        result = result && count_range(input_file, original_size, context->frequency_table);
+    }
+    if (!result || (original_size > 0 && fill_code_table(context->frequency_table, context->code_table) == 0)) {
+        free_context(context);
+        return 0;
+    }
+    uint64_t segment_count = (original_size + segment_size - 1) / segment_size;
+    if (segment_count > UINT32_MAX) {
+        err("compress_shard", "Segment size is too small for this file!");
+        free_context(context);
+        return 0;
+    }
+    SyncPoint* sync_points = malloc((segment_count + 1) * sizeof(SyncPoint));
+    unsigned char* read_buffer = malloc(segment_size);
+    if (sync_points == NULL || read_buffer == NULL) {
+        err("compress_shard", "Unable to allocate memory for the segments!");
+        free(sync_points);
+        free(read_buffer);
+        free_context(context);
+        return 0;
+    }
+
+    // Header (Read the readme file for more information about the seekable file structure)
+    if (start != 0 || end != file_size) {
+        flags |= SEEKABLE_FLAG_SHARD;
+    }
+    result = write_seekable_header(output_file, flags, original_size, segment_size, start, file_size);
+    if (result && original_size > 0) {
+        result = write_file_header(output_file, context->frequency_table);
+    }
+
+    // Every segment ends with a flush, so the next one starts at a byte boundary
+    BitWriter* bit_writer = context->bit_writer;
+    reset_writer(bit_writer, output_file);
+    uint64_t compressed_offset = ftello(output_file);
+    bit_writer->async = result ? async_open(output_file, ASYNC_WRITE) : NULL;
+    fseeko(input_file, start, SEEK_SET);
+    // The checksum of the whole data is combined from the segment checksums
+    uint32_t checksum = 0;
+    for (uint64_t i = 0; i < segment_count && result; i++) {
+        size_t segment_length = original_size - i * segment_size < segment_size ? original_size - i * segment_size : segment_size;
+        size_t read_bytes = fread(read_buffer, sizeof(unsigned char), segment_length, input_file);
+        if (read_bytes < segment_length) {
+            err("compress_shard", "Unable to read the file!");
+            result = 0;
+            break;
+        }
+        sync_points[i].compressed_offset = compressed_offset;
+        sync_points[i].uncompressed_offset = i * segment_size;
+        sync_points[i].table = 0;
+        // The segment is still in the cache, right after the read
+        if (flags & SEEKABLE_FLAG_CHECKSUM) {
+            sync_points[i].checksum = crc32c_update(0, read_buffer, read_bytes);
+            checksum = crc32c_combine(checksum, sync_points[i].checksum, read_bytes);
+        } else {
+            sync_points[i].checksum = 0;
+        }
+        size_t start_bits = bit_writer->total_bits;
+        for (size_t j = 0; j < read_bytes && result; j++) {
+            Code code = context->code_table[read_buffer[j]];
+            result = write_bits(bit_writer, code.code, code.length) != -1;
+        }
+        result = result && flush_writer(bit_writer) != -1;
+        compressed_offset += (bit_writer->total_bits - start_bits + 7) / 8;
+        print_log("\rProcessing: %zu/%zu segments...", (size_t) i + 1, (size_t) segment_count);
+    }
+    if (bit_writer->async != NULL && async_close(bit_writer->async) == 0) {
+        result = 0;
+    }
+    bit_writer->async = NULL;
+
+    result = result && write_seek_table(output_file, sync_points, segment_count, NULL, 0, flags, checksum);
+    if (result) {
+        clock_t end_time = clock();
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished processing (%f s): %" PRIu64 " bytes -> %" PRId64 " bytes (%u segments)\n", time_spent,
+                  original_size, (int64_t) ftello(output_file), (unsigned) segment_count);
+    }
+
+    free(sync_points);
+    free(read_buffer);
+    free_context(context);
+    return result;
+}
+
+/*
+* Function: load_table
+* --------------------
+*  Reads a frequency table at the current position and builds its tree and decode table.
+*
+*  file: Pointer to the compressed file
+*  table: Pointer to the SeekableTable object to fill
+*
+*  returns: If failed (0), On success (1)
+*/
+static int load_table(FILE* file, SeekableTable* table) {
+    size_t frequency_table[FREQUENCY_TABLE_SIZE];
+    table->offset = ftello(file);
+    if (read_frequency_table(file, frequency_table) == 0
+        || (table->root = create_huffman_tree(frequency_table, 0)) == NULL) {
+        return 0;
+    }
+    table->decode_table = create_decode_table(table->root);
+    return 1;
+}
+
+/*
+* Function: read_seek_table
+* -------------------------
+*  Reads and validates the seek table of a seekable file. The tables of
+*  merged shards (SEEKABLE_FLAG_TABLES) are loaded too.
+*
+*  seekable: Pointer to the SeekableFile object (file and original_size are set)
+*  file_size: Size of the compressed file
+*  data_start: Offset of the first segment
+*
+*  returns: If failed (0), On success (1)
+*/
+static int read_seek_table(SeekableFile* seekable, uint64_t file_size, uint64_t data_start) {
+    FILE* file = seekable->file;
+    unsigned char magic[sizeof(seekable_magic)];
+    uint64_t table_offset = 0;
+    uint64_t segment_count = 0;
+    uint64_t table_count = seekable->table_count;
+    int has_checksums = (seekable->flags & SEEKABLE_FLAG_CHECKSUM) != 0;
+    int has_tables = (seekable->flags & SEEKABLE_FLAG_TABLES) != 0;
+    size_t entry_size = SYNC_POINT_SIZE + (has_checksums ? CHECKSUM_SIZE : 0) + (has_tables ? TABLE_INDEX_SIZE : 0);
+    if (file_size < data_start + SEEKABLE_TRAILER_SIZE || fseeko(file, -SEEKABLE_TRAILER_SIZE, SEEK_END) != 0
+        || !read_uint(file, &table_offset, 8)
+        || fread(magic, sizeof(unsigned char), sizeof(magic), file) < sizeof(magic)
+        || memcmp(magic, seekable_magic, sizeof(magic)) != 0
+        || table_offset < data_start || table_offset > file_size - SEEKABLE_TRAILER_SIZE
+        || fseeko(file, table_offset, SEEK_SET) != 0 || !read_uint(file, &segment_count, 4)
+        || (has_tables && !read_uint(file, &table_count, 4))
+        || segment_count * entry_size + (has_tables ? table_count * TABLE_OFFSET_SIZE : 0)
+           + (has_checksums ? CHECKSUM_SIZE : 0) > file_size - SEEKABLE_TRAILER_SIZE - table_offset
+        || segment_count != (seekable->original_size + seekable->segment_size - 1) / seekable->segment_size
+        || table_count > segment_count || (table_count == 0 && segment_count > 0)) {
+        return 0;
+    }
+
+    if (has_tables) {
+        seekable->tables = calloc(table_count, sizeof(SeekableTable));
+        if (seekable->tables == NULL) {
+            return 0;
+        }
+        seekable->table_count = table_count;
+        for (uint64_t i = 0; i < table_count; i++) {
+            if (!read_uint(file, &seekable->tables[i].offset, TABLE_OFFSET_SIZE)
+                || seekable->tables[i].offset < data_start || seekable->tables[i].offset >= table_offset) {
+                return 0;
+            }
+        }
+    }
+    seekable->data_end = table_offset;
+    seekable->sync_points = malloc((segment_count + 1) * sizeof(SyncPoint));
+    if (seekable->sync_points == NULL) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < segment_count; i++) {
+        SyncPoint* sync_point = &seekable->sync_points[i];
+        uint64_t checksum = 0;
+        uint64_t table = 0;
+        if (!read_uint(file, &sync_point->compressed_offset, 8) || !read_uint(file, &sync_point->uncompressed_offset, 8)
+            || (has_checksums && !read_uint(file, &checksum, CHECKSUM_SIZE))
+            || (has_tables && !read_uint(file, &table, TABLE_INDEX_SIZE)) || table >= table_count) {
+            return 0;
+        }
+        sync_point->checksum = checksum;
+        sync_point->table = table;
+        seekable->segment_count++;
+    }
+    uint64_t checksum = 0;
+    if (has_checksums && !read_uint(file, &checksum, CHECKSUM_SIZE)) {
+        return 0;
+    }
+    seekable->checksum = checksum;
+
+    // The end of the data closes the last segment
+    seekable->sync_points[segment_count].compressed_offset = table_offset;
+    seekable->sync_points[segment_count].uncompressed_offset = seekable->original_size;
+    uint64_t previous_compressed = data_start;
+    uint64_t previous_uncompressed = 0;
+    for (uint64_t i = 0; i <= segment_count; i++) {
+        SyncPoint* sync_point = &seekable->sync_points[i];
+        if (sync_point->compressed_offset < previous_compressed || sync_point->uncompressed_offset < previous_uncompressed
+            || sync_point->uncompressed_offset - previous_uncompressed > seekable->segment_size) {
+            return 0;
+        }
+        if (i > 0 && sync_point->compressed_offset - previous_compressed > seekable->segment_buffer_size) {
+            seekable->segment_buffer_size = sync_point->compressed_offset - previous_compressed;
+        }
+        previous_compressed = sync_point->compressed_offset;
+        previous_uncompressed = sync_point->uncompressed_offset;
+    }
+    if (segment_count > 0 && seekable->sync_points[0].uncompressed_offset != 0) {
+        return 0;
+    }
+
+    // The tables of the shards are stored between their segments
+    for (uint64_t i = 0; has_tables && i < table_count; i++) {
+        if (fseeko(file, seekable->tables[i].offset, SEEK_SET) != 0 || !load_table(file, &seekable->tables[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: seekable_open
+* -----------------------
+*  Reads the header and the seek table of a seekable file.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: Pointer to the SeekableFile object. If failed, returns NULL.
+*/
+SeekableFile* seekable_open(FILE* file) {
+    unsigned char magic[sizeof(seekable_magic)];
+    uint64_t version = 0;
+    uint64_t flags = 0;
+    uint64_t original_size = 0;
+    uint64_t segment_size = 0;
+    if (fseeko(file, 0, SEEK_SET) != 0 || fread(magic, sizeof(unsigned char), sizeof(magic), file) < sizeof(magic)
+        || memcmp(magic, seekable_magic, sizeof(magic)) != 0 || !read_uint(file, &version, 1)) {
+        err("seekable_open", "Not a seekable file!");
+        return NULL;
+    }
+    if (version != SEEKABLE_VERSION || !read_uint(file, &flags, 1)
+        || (flags & ~(SEEKABLE_FLAG_CHECKSUM | SEEKABLE_FLAG_TABLES | SEEKABLE_FLAG_SHARD)) != 0) {
+        err("seekable_open", "Unsupported seekable file version!");
+        return NULL;
+    }
+    uint64_t shard_start = 0;
+    uint64_t source_size = 0;
+    if (!read_uint(file, &original_size, 8) || !read_uint(file, &segment_size, 4) || segment_size == 0
+        || ((flags & SEEKABLE_FLAG_SHARD) && (!read_uint(file, &shard_start, 8) || !read_uint(file, &source_size, 8)
+                                              || shard_start % segment_size != 0 || shard_start > source_size
+                                              || original_size > source_size - shard_start))) {
+        err("seekable_open", "File is corrupted!");
+        return NULL;
+    }
+    if (!(flags & SEEKABLE_FLAG_SHARD)) {
+        source_size = original_size;
+    }
+
+    SeekableFile* seekable = calloc(1, sizeof(SeekableFile));
+    if (seekable == NULL) {
+        err("seekable_open", "Unable to allocate memory for the seekable file!");
+        return NULL;
+    }
+    seekable->file = file;
+    seekable->original_size = original_size;
+    seekable->segment_size = segment_size;
+    seekable->flags = flags;
+    seekable->shard_start = shard_start;
+    seekable->source_size = source_size;
+
+    // Without SEEKABLE_FLAG_TABLES the only table follows the header
+    int result = 1;
+    if (original_size > 0 && !(flags & SEEKABLE_FLAG_TABLES)) {
+        result = (seekable->tables = calloc(1, sizeof(SeekableTable))) != NULL;
+        seekable->table_count = result;
+        result = result && load_table(file, &seekable->tables[0]);
+    }
+    uint64_t data_start = ftello(file);
+    uint64_t file_size = get_file_size(file);
+    result = result && read_seek_table(seekable, file_size, data_start);
+    if (result) {
+        seekable->cached_segment = seekable->segment_count;
+        seekable->segment_buffer = malloc(seekable->segment_buffer_size + 1);
+        // Table entries are copied whole, so a few bytes may be written past the segment
+        seekable->output_buffer = malloc(seekable->segment_size + DECODE_TABLE_MAX_SYMBOLS);
+        if (seekable->segment_buffer == NULL || seekable->output_buffer == NULL) {
+            err("seekable_open", "Unable to allocate memory for the segment buffers!");
+            seekable_close(seekable);
+            return NULL;
+        }
+    }
+    if (!result) {
+        err("seekable_open", "Seek table is corrupted!");
+        seekable_close(seekable);
+        return NULL;
+    }
+    return seekable;
+}
+
+/*
+* Function: seekable_set_verify
+* -----------------------------
+*  Enables or disables checking the checksums of a seekable file while
+*  decoding its segments.
+*
+*  seekable: Pointer to the SeekableFile object
+*  verify: Verify (1), Don't verify (0)
+*
+*  returns: If the file has no checksums to verify (0), On success (1)
+*/
+int seekable_set_verify(SeekableFile* seekable, int verify) {
+    if (verify && !(seekable->flags & SEEKABLE_FLAG_CHECKSUM)) {
+        err("seekable_set_verify", "File has no checksums to verify!");
+        return 0;
+    }
+    seekable->verify = verify;
+    return 1;
+}
+
+/*
+* Function: seekable_close
+* ------------------------
+*  Frees the SeekableFile object (The file is not closed).
+*
+*  seekable: Pointer to the SeekableFile object
+*/
+void seekable_close(SeekableFile* seekable) {
+    if (seekable == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < seekable->table_count; i++) {
+        if (seekable->tables[i].root != NULL) {
+            free_tree(seekable->tables[i].root);
+        }
+        free_decode_table(seekable->tables[i].decode_table);
+    }
+    free(seekable->tables);
+    free(seekable->sync_points);
+    free(seekable->segment_buffer);
+    free(seekable->output_buffer);
+    free(seekable);
+}
+
+/*
+* Function: load_segment
+* ----------------------
+*  Reads and decodes a segment into the output buffer (unless it is cached).
+*
+*  seekable: Pointer to the SeekableFile object
+*  segment: Index of the segment
+*
+*  returns: Number of decoded bytes. If failed, returns 0.
+*/
+static size_t load_segment(SeekableFile* seekable, uint32_t segment) {
+    SyncPoint* start = &seekable->sync_points[segment];
+    SyncPoint* end = &seekable->sync_points[segment + 1];
+    size_t symbol_count = end->uncompressed_offset - start->uncompressed_offset;
+    if (seekable->cached_segment == segment) {
+        return symbol_count;
+    }
+    size_t data_size = end->compressed_offset - start->compressed_offset;
+    if (read_at(seekable->file, seekable->segment_buffer, data_size, start->compressed_offset) == 0) {
+        err("load_segment", "Unable to read the segment!");
+        return 0;
+    }
+    seekable->cached_segment = seekable->segment_count;
+    SeekableTable* table = &seekable->tables[start->table];
+    if (decode_block(table->root, table->decode_table, seekable->segment_buffer, data_size,
+                     seekable->output_buffer, symbol_count) < symbol_count) {
+        err("load_segment", "Segment is corrupted!");
+        return 0;
+    }
+    // Checked while the decoded segment is still in the cache
+    if (seekable->verify && crc32c_update(0, seekable->output_buffer, symbol_count) != start->checksum) {
+        fprintf(stderr, "\n[ERROR]: load_segment() {} -> Checksum mismatch in segment %u!\n", (unsigned) segment);
+        return 0;
+    }
+    seekable->cached_segment = segment;
+    return symbol_count;
+}
+
+/*
+* Function: huff_read_range
+* -------------------------
+*  Decodes a range of the original data. Only the segments covering the
+*  range are read and decoded.
+*
+*  seekable: Pointer to the SeekableFile object
+*  offset: Offset in the original data
+*  length: Number of bytes
+*  output: Destination buffer (at least length bytes)
+*
+*  returns: Number of copied bytes (less than length at the end of the data). If failed, returns -1.
+*/
+ssize_t huff_read_range(SeekableFile* seekable, uint64_t offset, size_t length, unsigned char* output) {
+    if (seekable == NULL || output == NULL) {
+        return -1;
+    }
+    if (offset >= seekable->original_size) {
+        return 0;
+    }
+    if (length > seekable->original_size - offset) {
+        length = seekable->original_size - offset;
+    }
+
+    // Binary search for the last sync point at or before the offset
+    uint32_t low = 0;
+    uint32_t high = seekable->segment_count - 1;
+    while (low < high) {
+        uint32_t middle = low + (high - low + 1) / 2;
+        if (seekable->sync_points[middle].uncompressed_offset <= offset) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    size_t copied = 0;
+    for (uint32_t segment = low; copied < length && segment < seekable->segment_count; segment++) {
+        size_t segment_length = load_segment(seekable, segment);
+        if (segment_length == 0) {
+            return -1;
+        }
+        uint64_t segment_start = seekable->sync_points[segment].uncompressed_offset;
+        size_t start = offset + copied - segment_start;
+        size_t count = segment_length - start < length - copied ? segment_length - start : length - copied;
+        memcpy(output + copied, seekable->output_buffer + start, count);
+        copied += count;
+    }
+    return copied;
+}
+
+/*
+* Function: decompress_seekable
+* -----------------------------
+*  Decompresses a whole seekable file. With verify every segment is
+*  checked against its checksum, and the segment checksums are combined to
+*  check the whole data without hashing it again.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL tests the file: nothing is
+*               written and the checksums are checked if the file has them)
+*  verify: Check the checksums, fails on a file without them (1), Don't check (0)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_seekable(FILE* input_file, FILE* output_file, int verify) {
+    SeekableFile* seekable = seekable_open(input_file);
+    // Without an output the file is only tested, so the checksums are always checked
+    if (seekable == NULL
+        || !seekable_set_verify(seekable, verify || (output_file == NULL && (seekable->flags & SEEKABLE_FLAG_CHECKSUM)))) {
+        seekable_close(seekable);
+        return 0;
+    }
+    clock_t start_time = clock();
+    AsyncFile* writer = output_file != NULL ? async_open(output_file, ASYNC_WRITE) : NULL;
+    uint32_t checksum = 0;
+    int result = 1;
+    for (uint32_t i = 0; i < seekable->segment_count && result; i++) {
+        size_t segment_length = load_segment(seekable, i);
+        if (segment_length == 0) {
+            result = 0;
+            break;
+        }
+        // load_segment checked the segment, so its checksum only has to be combined
+        if (seekable->verify) {
+            checksum = crc32c_combine(checksum, seekable->sync_points[i].checksum, segment_length);
+        }
+        ssize_t written_bytes = writer != NULL ? async_write(writer, seekable->output_buffer, segment_length)
+                                : output_file != NULL ? (ssize_t) fwrite(seekable->output_buffer, 1, segment_length, output_file)
+                                : (ssize_t) segment_length;
+        if (written_bytes < (ssize_t) segment_length) {
+            err("decompress_seekable", "Unable to write to the output file!");
+            result = 0;
+        }
+        print_log("\rProcessing: %u/%u segments...", (unsigned) i + 1, (unsigned) seekable->segment_count);
+    }
+    if (writer != NULL && async_close(writer) == 0) {
+        result = 0;
+    }
+    if (result && seekable->verify && checksum != seekable->checksum) {
+        err("decompress_seekable", "Checksum mismatch!");
+        result = 0;
+    }
+    if (result) {
+        clock_t end_time = clock();
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished Processing (%f s): %" PRIu64 " bytes -> %" PRIu64 " bytes.\n", time_spent,
+                  get_file_size(input_file), seekable->original_size);
+    }
+    seekable_close(seekable);
+    return result;
+}
+
+/*
+* Function: decompress_range
+* --------------------------
+*  Decodes a range of the original data of a seekable file into the output file.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*  offset: Offset in the original data
+*  length: Number of bytes (clamped to the end of the data)
+*  verify: Check the checksums of the decoded segments (1), Don't check (0)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_range(FILE* input_file, FILE* output_file, uint64_t offset, uint64_t length, int verify) {
+    SeekableFile* seekable = seekable_open(input_file);
+    if (seekable == NULL || !seekable_set_verify(seekable, verify)) {
+        seekable_close(seekable);
+        return 0;
+    }
+    unsigned char* buffer = malloc(seekable->segment_size);
+    if (buffer == NULL) {
+        err("decompress_range", "Unable to allocate memory for buffer!");
+        seekable_close(seekable);
+        return 0;
+    }
+    int result = 1;
+    while (length > 0) {
+        size_t chunk = length < seekable->segment_size ? length : seekable->segment_size;
+        ssize_t read_bytes = huff_read_range(seekable, offset, chunk, buffer);
+        if (read_bytes <= 0) {
+            result = read_bytes == 0;
+            break;
+        }
+        if (fwrite(buffer, sizeof(unsigned char), read_bytes, output_file) < (size_t) read_bytes) {
+            err("decompress_range", "Unable to write to the output file!");
+            result = 0;
+            break;
+        }
+        offset += read_bytes;
+        length -= read_bytes;
+    }
+    free(buffer);
+    seekable_close(seekable);
+    return result;
+}
+
+/*
+* Function: copy_range
+* --------------------
+*  Copies bytes of the input file to the current position of the output file.
+*
+*  input_file: Pointer to the input_file
+*  offset: Offset of the first byte in the input file
+*  length: Number of bytes
+*  output_file: Pointer to the output_file
+*  buffer: Copy buffer (SEEKABLE_MERGE_COPY_SIZE bytes)
+*
+*  returns: If failed (0), On success (1)
+*/
+static int copy_range(FILE* input_file, uint64_t offset, uint64_t length, FILE* output_file, unsigned char* buffer) {
+    while (length > 0) {
+        size_t size = length < SEEKABLE_MERGE_COPY_SIZE ? length : SEEKABLE_MERGE_COPY_SIZE;
+        if (read_at(input_file, buffer, size, offset) == 0
+            || fwrite(buffer, sizeof(unsigned char), size, output_file) < size) {
+            return 0;
+        }
+        offset += size;
+        length -= size;
+    }
+    return 1;
+}
+
+/*
+* Function: merge_shards
+* ----------------------
+*  Joins seekable files into one without decoding them: the segments are
+*  copied and the seek tables are combined with shifted offsets. If every
+*  shard has the same table it is stored once, otherwise the output keeps
+*  the table of every shard (SEEKABLE_FLAG_TABLES). The shards must be
+*  ranges of the same input, in order and without gaps or overlaps; every
+*  shard but the last must end at a segment boundary and all must have the
+*  same segment size and checksum flag. If they cover the whole input the
+*  output is a plain seekable file, otherwise it is a shard again.
+*
+*  shard_files: Pointers to the shards, in the order of their data
+*  shard_count: Number of shards
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int merge_shards(FILE** shard_files, size_t shard_count, FILE* output_file) {
+    if (shard_files == NULL || shard_count == 0 || output_file == NULL) {
+        err("merge_shards", "Input/output file is NULL!");
+        return 0;
+    }
+    SeekableFile** shards = calloc(shard_count, sizeof(SeekableFile*));
+    unsigned char* buffer = malloc(SEEKABLE_MERGE_COPY_SIZE);
+    if (shards == NULL || buffer == NULL) {
+        err("merge_shards", "Unable to allocate memory for the shards!");
+        free(shards);
+        free(buffer);
+        return 0;
+    }
+    clock_t start_time = clock();
+
+    // The first pass checks the shards and compares their tables
+    size_t first_table[FREQUENCY_TABLE_SIZE];
+    size_t frequency_table[FREQUENCY_TABLE_SIZE];
+    size_t first_shard = shard_count; // First shard with data
+    int shared_table = 1; // Every shard has the same single table
+    uint64_t original_size = 0;
+    uint64_t segment_count = 0;
+    uint64_t table_count = 0;
+    int result = 1;
+    for (size_t i = 0; i < shard_count && result; i++) {
+        SeekableFile* shard = shards[i] = seekable_open(shard_files[i]);
+        if (shard == NULL) {
+            result = 0;
+            break;
+        }
+        if (shard->segment_size != shards[0]->segment_size
+            || (shard->flags & SEEKABLE_FLAG_CHECKSUM) != (shards[0]->flags & SEEKABLE_FLAG_CHECKSUM)) {
+            err("merge_shards", "Shards must have the same segment size and checksum flag!");
+            result = 0;
+            break;
+        }
+        if (shard->source_size != shards[0]->source_size) {
+            err("merge_shards", "Shards must be parts of the same input!");
+            result = 0;
+            break;
+        }
+        // Every shard starts where the previous one ends
+        uint64_t expected_start = shards[0]->shard_start + original_size;
+        if (shard->shard_start != expected_start) {
+            fprintf(stderr, "\n[ERROR]: merge_shards() {} -> Shard %zu starts at %" PRIu64 " instead of %" PRIu64 " (%s)!\n", i + 1,
+                    shard->shard_start, expected_start,
+                    shard->shard_start > expected_start ? "missing data before it" : "overlapping or out of order");
+            result = 0;
+            break;
+        }
+        if (shard->original_size == 0) {
+            continue;
+        }
+        // The segment count of the output is only valid if no shard but the last is cut short
+        if (original_size % shard->segment_size != 0) {
+            err("merge_shards", "Only the last shard can end inside a segment!");
+            result = 0;
+            break;
+        }
+        if (shard->flags & SEEKABLE_FLAG_TABLES) {
+            shared_table = 0;
+        } else {
+            result = fseeko(shard_files[i], shard->tables[0].offset, SEEK_SET) == 0
+                     && read_frequency_table(shard_files[i], frequency_table) != 0;
+            if (first_shard == shard_count) {
+                memcpy(first_table, frequency_table, sizeof(first_table));
+            } else if (memcmp(first_table, frequency_table, sizeof(first_table)) != 0) {
+                shared_table = 0;
+            }
+        }
+        if (first_shard == shard_count) {
+            first_shard = i;
+        }
+        original_size += shard->original_size;
+        segment_count += shard->segment_count;
+        table_count += shard->table_count;
+    }
+    if (result && segment_count > UINT32_MAX) {
+        err("merge_shards", "Too many segments!");
+        result = 0;
+    }
+    SyncPoint* sync_points = result ? malloc((segment_count + 1) * sizeof(SyncPoint)) : NULL;
+    uint64_t* table_offsets = result ? malloc((table_count + 1) * sizeof(uint64_t)) : NULL;
+    if (result && (sync_points == NULL || table_offsets == NULL)) {
+        err("merge_shards", "Unable to allocate memory for the seek table!");
+        result = 0;
+    }
+
+    // Header (Read the readme file for more information about the seekable file structure)
+    int flags = (shards[0] != NULL ? shards[0]->flags & SEEKABLE_FLAG_CHECKSUM : 0) | (shared_table ? 0 : SEEKABLE_FLAG_TABLES);
+    if (result && (shards[0]->shard_start != 0 || original_size != shards[0]->source_size)) {
+        flags |= SEEKABLE_FLAG_SHARD;
+    }
+    result = result && write_seekable_header(output_file, flags, original_size, shards[0]->segment_size,
+                                             shards[0]->shard_start, shards[0]->source_size);
+    // A shared table is copied once from the first shard
+    if (result && shared_table && first_shard < shard_count) {
+        SeekableFile* shard = shards[first_shard];
+        result = copy_range(shard_files[first_shard], shard->tables[0].offset,
+                            shard->sync_points[0].compressed_offset - shard->tables[0].offset, output_file, buffer);
+    }
+
+    // Shards are copied whole from the end of their header (with their tables) unless the table is shared
+    uint32_t checksum = 0;
+    uint64_t segment_base = 0;
+    uint64_t table_base = 0;
+    uint64_t uncompressed_base = 0;
+    for (size_t i = 0; i < shard_count && result; i++) {
+        SeekableFile* shard = shards[i];
+        if (shard->original_size == 0) {
+            continue;
+        }
+        uint64_t header_size = SEEKABLE_HEADER_SIZE + (shard->flags & SEEKABLE_FLAG_SHARD ? SEEKABLE_SHARD_SIZE : 0);
+        uint64_t data_start = shared_table ? shard->sync_points[0].compressed_offset : header_size;
+        uint64_t shift = ftello(output_file) - data_start;
+        result = copy_range(shard_files[i], data_start, shard->data_end - data_start, output_file, buffer);
+        for (uint32_t j = 0; j < shard->segment_count && result; j++) {
+            SyncPoint* sync_point = &sync_points[segment_base + j];
+            *sync_point = shard->sync_points[j];
+            sync_point->compressed_offset += shift;
+            sync_point->uncompressed_offset += uncompressed_base;
+            sync_point->table = shared_table ? 0 : sync_point->table + table_base;
+        }
+        for (uint32_t j = 0; j < shard->table_count && !shared_table; j++) {
+            table_offsets[table_base + j] = shard->tables[j].offset + shift;
+        }
+        checksum = crc32c_combine(checksum, shard->checksum, shard->original_size);
+        segment_base += shard->segment_count;
+        table_base += shard->table_count;
+        uncompressed_base += shard->original_size;
+        print_log("\rMerging: %zu/%zu shards...", i + 1, shard_count);
+    }
+
+    result = result && write_seek_table(output_file, sync_points, segment_count, table_offsets,
+                                        table_count, flags, checksum);
+    if (result) {
+        clock_t end_time = clock();
+        double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+        print_log("\rFinished merging (%f s): %zu shards -> %" PRIu64 " bytes (%u segments, %s)\n", time_spent,
+                  shard_count, original_size, (unsigned) segment_count, shared_table ? "shared table" : "table per shard");
+    }
+
+    for (size_t i = 0; i < shard_count; i++) {
+        seekable_close(shards[i]);
+    }
+    free(shards);
+    free(sync_points);
+    free(table_offsets);
+    free(buffer);
+    return result;
+}
@@ -0,0 +1,195 @@
+#include "../include/constants.h"
+#include "../include/estimate.h"
+#include "../include/huffman.h"
+#include "../include/magic.h"
+#include "../include/stored.h"
+#include "../include/utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+* Function: is_stored
+* -------------------
+*  Checks if the file starts with the stored container's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_stored(FILE* file) {
+    return has_magic(file, stored_magic, sizeof(stored_magic));
+}
+
+/*
+* Function: probe_incompressible
+* ------------------------------
+*  Estimates the entropy of the input from its first bytes and a few evenly
+*  spaced blocks (STORED_PROBE_SIZE bytes in total), without counting the
+*  whole file. The file position is not changed.
+*
+*  input_file: Pointer to the input_file
+*
+*  returns: (1) if the sample has more than STORED_MIN_BITS_PER_BYTE bits of entropy per byte, otherwise (0)
+*/
+int probe_incompressible(FILE* input_file) {
+    size_t frequency_table[FREQUENCY_TABLE_SIZE] = {0};
+    off_t position = ftello(input_file);
+    ssize_t result = sample_frequencies(input_file, frequency_table, STORED_PROBE_SIZE);
+    fseeko(input_file, position, SEEK_SET);
+    if (result <= 0) {
+        return 0;
+    }
+    size_t sample_size = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        sample_size += frequency_table[i];
+    }
+    return estimate_entropy(frequency_table) > STORED_MIN_BITS_PER_BYTE * sample_size;
+}
+
+/*
+* Function: write_stored_header
+* -----------------------------
+*  Stores the header of a stored container (the data follows it).
+*
+*  size: Number of stored bytes
+*  header: Output buffer (At least STORED_HEADER_SIZE bytes)
+*
+*  returns: Number of bytes stored
+*/
+size_t write_stored_header(uint64_t size, unsigned char* header) {
+    memcpy(header, stored_magic, sizeof(stored_magic));
+    header[sizeof(stored_magic)] = STORED_VERSION << 4;
+    for (int i = 0; i < 8; i++) {
+        header[sizeof(stored_magic) + 1 + i] = (unsigned char) (size >> (8 * i));
+    }
+    return STORED_HEADER_SIZE;
+}
+
+/*
+* Function: read_stored_header
+* ----------------------------
+*  Reads a stored header written by write_stored_header from a buffer.
+*
+*  header: Stored header (followed by the data)
+*  size: Number of bytes in the buffer
+*  original_size: Pointer to store the number of stored bytes
+*
+*  returns: If failed (0), On success (1)
+*/
+int read_stored_header(const unsigned char* header, size_t size, uint64_t* original_size) {
+    if (size < STORED_HEADER_SIZE || memcmp(header, stored_magic, sizeof(stored_magic)) != 0) {
+        err("read_stored_header", "File is corrupted!");
+        return 0;
+    }
+    if ((header[sizeof(stored_magic)] >> 4) != STORED_VERSION) {
+        err("read_stored_header", "Unsupported stored container version!");
+        return 0;
+    }
+    *original_size = 0;
+    for (int i = 0; i < 8; i++) {
+        *original_size |= (uint64_t) header[sizeof(stored_magic) + 1 + i] << (8 * i);
+    }
+    return 1;
+}
+
+/*
+* Function: compress_stored
+* -------------------------
+*  Copies the input file into a stored container, without any coding.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_stored(FILE* input_file, FILE* output_file) {
+    if (input_file == NULL || output_file == NULL) {
+        err("compress_stored", "Input/output file is NULL!");
+        return 0;
+    }
+    unsigned char header[STORED_HEADER_SIZE];
+    uint64_t input_size = get_file_size(input_file);
+    if (fwrite(header, sizeof(unsigned char), write_stored_header(input_size, header), output_file) < sizeof(header)) {
+        err("compress_stored", "Unable to write the header!");
+        return 0;
+    }
+
+    unsigned char* buffer = malloc(STORED_COPY_SIZE);
+    if (buffer == NULL) {
+        err("compress_stored", "Unable to allocate memory for the buffer!");
+        return 0;
+    }
+    fseeko(input_file, 0, SEEK_SET);
+    uint64_t copied = 0;
+    size_t read_bytes = 0;
+    int result = 1;
+    while (result && (read_bytes = fread(buffer, sizeof(unsigned char), STORED_COPY_SIZE, input_file)) != 0) {
+        result = fwrite(buffer, sizeof(unsigned char), read_bytes, output_file) == read_bytes;
+        copied += read_bytes;
+    }
+    free(buffer);
+    if (result == 0 || ferror(input_file)) {
+        err("compress_stored", "Unable to copy the input file!");
+        return 0;
+    }
+    if (copied != input_size) {
+        err("compress_stored", "Input file changed while compressing!");
+        return 0;
+    }
+    return 1;
+}
+
+/*
+* Function: decompress_stored
+* ---------------------------
+*  Copies the data of a stored container to the output.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only reads the data)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_stored(FILE* input_file, FILE* output_file) {
+    if (input_file == NULL) {
+        err("decompress_stored", "Input file is NULL!");
+        return 0;
+    }
+    unsigned char header[sizeof(stored_magic) + 1];
+    uint64_t original_size = 0;
+    fseeko(input_file, 0, SEEK_SET);
+    if (fread(header, sizeof(unsigned char), sizeof(header), input_file) < sizeof(header)
+        || memcmp(header, stored_magic, sizeof(stored_magic)) != 0
+        || read_uint(input_file, &original_size, 8) == 0) {
+        err("decompress_stored", "File is corrupted!");
+        return 0;
+    }
+    if ((header[sizeof(stored_magic)] >> 4) != STORED_VERSION) {
+        err("decompress_stored", "Unsupported stored container version!");
+        return 0;
+    }
+
+    unsigned char* buffer = malloc(STORED_COPY_SIZE);
+    if (buffer == NULL) {
+        err("decompress_stored", "Unable to allocate memory for the buffer!");
+        return 0;
+    }
+    uint64_t remaining = original_size;
+    int result = 1;
+    while (result && remaining > 0) {
+        size_t size = remaining < STORED_COPY_SIZE ? remaining : STORED_COPY_SIZE;
+        if (fread(buffer, sizeof(unsigned char), size, input_file) < size) {
+            err("decompress_stored", "Data is truncated!");
+            result = 0;
+        } else if (output_file != NULL && fwrite(buffer, sizeof(unsigned char), size, output_file) < size) {
+            err("decompress_stored", "Unable to write the output file!");
+            result = 0;
+        }
+        remaining -= size;
+    }
+    free(buffer);
+    return result;
+}
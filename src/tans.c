@@ -0,0 +1,552 @@
+#include "../include/compact.h"
+#include "../include/constants.h"
+#include "../include/magic.h"
+#include "../include/tans.h"
+#include "../include/utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint16_t new_state; // Next state before the bits are added
+    uint8_t symbol;
+    uint8_t bit_count;
+} TansDecodeEntry;
+
+typedef struct {
+    int table_log;
+    uint16_t normalized[FREQUENCY_TABLE_SIZE];
+    uint16_t offsets[FREQUENCY_TABLE_SIZE]; // First slot of every symbol in encode_states
+    uint8_t max_bits[FREQUENCY_TABLE_SIZE]; // Bits flushed from a state of the symbol (or one less)
+    uint16_t* encode_states; // Encoder state after every (symbol, reduced state)
+    TansDecodeEntry* decode_table; // Indexed by the decoder state
+} TansTable;
+
+/*
+* Function: is_tans
+* -----------------
+*  Checks if the file starts with the tANS header's marker.
+*  The file position is not changed.
+*
+*  file: Pointer to the compressed file
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int is_tans(FILE* file) {
+    return has_magic(file, tans_magic, sizeof(tans_magic));
+}
+
+/*
+* Function: highest_bit
+* ---------------------
+*  Returns floor(log2(value)) of a non-zero value.
+*/
+static int highest_bit(uint32_t value) {
+    return 31 - __builtin_clz(value);
+}
+
+/*
+* Function: log2_fixed
+* --------------------
+*  Returns log2(value) in 1/256 bits of a non-zero value.
+*/
+static uint32_t log2_fixed(uint32_t value) {
+    int integer = highest_bit(value);
+    // The fraction bits come from squaring the mantissa (16.16 fixed point)
+    uint64_t mantissa = ((uint64_t) value << 16) >> integer;
+    uint32_t result = (uint32_t) integer << 8;
+    for (int bit = 7; bit >= 0; bit--) {
+        mantissa = (mantissa * mantissa) >> 16;
+        if (mantissa >= (2u << 16)) {
+            mantissa >>= 1;
+            result |= 1u << bit;
+        }
+    }
+    return result;
+}
+
+/*
+* Function: normalize_frequencies
+* -------------------------------
+*  Scales the frequencies to sum to 2^table_log, keeping every present
+*  symbol at least 1.
+*
+*  frequency_table: Pointer to the frequency table
+*  normalized: Normalized frequency of every symbol (0 for missing symbols)
+*  table_log: Log2 of the table size
+*
+*  returns: If there are less than 2 or too many symbols (0), On success (1)
+*/
+int normalize_frequencies(size_t* frequency_table, uint16_t* normalized, int table_log) {
+    uint32_t table_size = 1u << table_log;
+    size_t total = 0;
+    uint32_t symbol_count = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        total += frequency_table[i];
+        symbol_count += frequency_table[i] > 0;
+    }
+    memset(normalized, 0, FREQUENCY_TABLE_SIZE * sizeof(uint16_t));
+    if (symbol_count < 2 || symbol_count > table_size) {
+        return 0;
+    }
+
+    uint32_t sum = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (frequency_table[i] > 0) {
+            uint64_t scaled = ((uint64_t) frequency_table[i] * table_size + total / 2) / total;
+            normalized[i] = scaled == 0 ? 1 : scaled;
+            sum += normalized[i];
+        }
+    }
+    // The rounding error is moved to the most frequent symbols, where a slot costs the least
+    while (sum != table_size) {
+        int largest = -1;
+        for (int i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+            if (normalized[i] > (sum > table_size ? 1 : 0) && (largest == -1 || normalized[i] > normalized[largest])) {
+                largest = i;
+            }
+        }
+        if (sum > table_size) {
+            normalized[largest]--;
+            sum--;
+        } else {
+            normalized[largest]++;
+            sum++;
+        }
+    }
+    return 1;
+}
+
+/*
+* Function: tans_data_bits
+* ------------------------
+*  Estimates the bits of the encoded blocks: a symbol costs
+*  table_log - log2(normalized frequency) bits, and every block stores its
+*  size, the final state and the end mark.
+*
+*  frequency_table: Pointer to the frequency table
+*  normalized: Normalized frequency of every symbol
+*
+*  returns: Estimated number of bits
+*/
+static size_t tans_data_bits(size_t* frequency_table, const uint16_t* normalized) {
+    size_t input_size = 0;
+    size_t tans_cost = 0; // In 1/256 bits
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        if (frequency_table[i] > 0) {
+            input_size += frequency_table[i];
+            tans_cost += frequency_table[i] * ((TANS_TABLE_LOG << 8) - log2_fixed(normalized[i]));
+        }
+    }
+    size_t block_count = (input_size + TANS_BLOCK_SIZE - 1) / (TANS_BLOCK_SIZE);
+    return tans_cost / 256 + block_count * (32 + 2 * TANS_TABLE_LOG + 8);
+}
+
+/*
+* Function: prefer_tans
+* ---------------------
+*  Estimates the size of the tANS encoded data from the normalized
+*  frequencies and compares it with the huffman encoded data. tANS spends
+*  fractional bits per symbol, which wins on skewed histograms.
+*
+*  frequency_table: Pointer to the frequency table
+*  code_table: Pointer to the code table of the frequency table
+*
+*  returns: (1) if tANS is at least TANS_MIN_GAIN_PERCENT smaller, otherwise (0)
+*/
+int prefer_tans(size_t* frequency_table, Code* code_table) {
+    uint16_t normalized[FREQUENCY_TABLE_SIZE];
+    if (normalize_frequencies(frequency_table, normalized, TANS_TABLE_LOG) == 0) {
+        return 0;
+    }
+    size_t huffman_bits = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        huffman_bits += frequency_table[i] * code_table[i].length;
+    }
+    size_t tans_bits = tans_data_bits(frequency_table, normalized);
+    return tans_bits * 100 <= huffman_bits * (100 - TANS_MIN_GAIN_PERCENT);
+}
+
+/*
+* Function: estimate_tans_size
+* ----------------------------
+*  Estimates the size of the file compress_tans writes, from the header and
+*  the cost of every symbol under the normalized frequencies. The encoded
+*  data depends on the states, so it can be off by a few bytes per block.
+*
+*  frequency_table: Pointer to the frequency table (counted or sampled)
+*  input_size: Size of the input (the data bits of a sample are scaled to it)
+*
+*  returns: Estimated size in bytes, 0 if tANS can't encode the histogram
+*/
+size_t estimate_tans_size(size_t* frequency_table, uint64_t input_size) {
+    uint16_t normalized[FREQUENCY_TABLE_SIZE];
+    if (normalize_frequencies(frequency_table, normalized, TANS_TABLE_LOG) == 0) {
+        return 0;
+    }
+    uint8_t present[FREQUENCY_TABLE_SIZE];
+    unsigned char symbol_set[COMPACT_BITMAP_SIZE];
+    unsigned char flags = 0;
+    // Magic, flags, table log and the original size
+    size_t header_size = sizeof(tans_magic) + 2 + 8;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        present[i] = normalized[i] > 0;
+        // LEB128 stores 7 bits per byte
+        for (uint32_t value = normalized[i] - 1; present[i]; value >>= 7) {
+            header_size++;
+            if (value < 0x80) {
+                break;
+            }
+        }
+    }
+    header_size += write_symbol_set(present, symbol_set, &flags);
+    uint64_t counted_size = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        counted_size += frequency_table[i];
+    }
+    uint64_t data_bits = tans_data_bits(frequency_table, normalized);
+    if (counted_size != input_size && counted_size > 0) {
+        data_bits = (uint64_t) ((double) data_bits * input_size / counted_size);
+    }
+    return header_size + (data_bits + 7) / 8;
+}
+
+/*
+* Function: free_tans_table
+* -------------------------
+*  Frees the tables.
+*
+*  table: Pointer to the TansTable object
+*/
+static void free_tans_table(TansTable* table) {
+    if (table == NULL) {
+        return;
+    }
+    free(table->encode_states);
+    free(table->decode_table);
+    free(table);
+}
+
+/*
+* Function: create_tans_table
+* ---------------------------
+*  Spreads the symbols over the states and builds the encoder and decoder
+*  tables of the normalized frequencies.
+*
+*  normalized: Normalized frequencies (sum to 2^table_log)
+*  table_log: Log2 of the table size
+*
+*  returns: A pointer to the TansTable object. If failed, returns NULL.
+*/
+static TansTable* create_tans_table(const uint16_t* normalized, int table_log) {
+    uint32_t table_size = 1u << table_log;
+    TansTable* table = calloc(1, sizeof(TansTable));
+    unsigned char* spread = malloc(table_size);
+    if (table == NULL || spread == NULL
+        || (table->encode_states = malloc(table_size * sizeof(uint16_t))) == NULL
+        || (table->decode_table = malloc(table_size * sizeof(TansDecodeEntry))) == NULL) {
+        err("create_tans_table", "Unable to allocate memory for the tables!");
+        free(spread);
+        free_tans_table(table);
+        return NULL;
+    }
+    table->table_log = table_log;
+    memcpy(table->normalized, normalized, sizeof(table->normalized));
+
+    // The step is odd, so it visits every state once; the states of a symbol end up spread out
+    uint32_t step = (table_size >> 1) + (table_size >> 3) + 3;
+    uint32_t position = 0;
+    uint32_t next[FREQUENCY_TABLE_SIZE];
+    uint32_t offset = 0;
+    for (int symbol = 0; symbol < FREQUENCY_TABLE_SIZE; symbol++) {
+        for (uint32_t i = 0; i < normalized[symbol]; i++) {
+            spread[position] = (unsigned char) symbol;
+            position = (position + step) & (table_size - 1);
+        }
+        table->offsets[symbol] = offset;
+        offset += normalized[symbol];
+        next[symbol] = normalized[symbol];
+        table->max_bits[symbol] = normalized[symbol] > 0 ? table_log - highest_bit(normalized[symbol]) : 0;
+    }
+
+    // Decoder state u of symbol s is reached from the reduced state x in [f, 2f)
+    for (uint32_t state = 0; state < table_size; state++) {
+        unsigned char symbol = spread[state];
+        uint32_t reduced = next[symbol]++;
+        int bit_count = table_log - highest_bit(reduced);
+        table->decode_table[state].symbol = symbol;
+        table->decode_table[state].bit_count = bit_count;
+        table->decode_table[state].new_state = (reduced << bit_count) - table_size;
+        table->encode_states[table->offsets[symbol] + reduced - normalized[symbol]] = state + table_size;
+    }
+    free(spread);
+    return table;
+}
+
+/*
+* Function: encode_block
+* ----------------------
+*  Encodes a block backwards, so the decoder reads the bits back to front
+*  and outputs the symbols in order. The final state and an end mark bit
+*  are stored last.
+*
+*  table: Pointer to the TansTable object
+*  input: Symbols of the block
+*  size: Number of symbols
+*  output: Output buffer (size * table_log / 8 + 8 bytes)
+*
+*  returns: Number of bytes stored
+*/
+static size_t encode_block(const TansTable* table, const unsigned char* input, size_t size, unsigned char* output) {
+    uint32_t table_size = 1u << table->table_log;
+    uint32_t state = table_size;
+    uint64_t accumulator = 0;
+    int accumulator_bits = 0;
+    size_t output_size = 0;
+    for (size_t i = size; i-- > 0;) {
+        unsigned char symbol = input[i];
+        uint32_t frequency = table->normalized[symbol];
+        // Flush bits until the state is reduced to [frequency, 2 * frequency)
+        int bit_count = table->max_bits[symbol];
+        if ((state >> bit_count) < frequency) {
+            bit_count--;
+        }
+        accumulator |= (uint64_t) (state & ((1u << bit_count) - 1)) << accumulator_bits;
+        accumulator_bits += bit_count;
+        state = table->encode_states[table->offsets[symbol] + (state >> bit_count) - frequency];
+        while (accumulator_bits >= 8) {
+            output[output_size++] = (unsigned char) accumulator;
+            accumulator >>= 8;
+            accumulator_bits -= 8;
+        }
+    }
+    accumulator |= (uint64_t) ((state - table_size) | table_size) << accumulator_bits;
+    accumulator_bits += table->table_log + 1;
+    while (accumulator_bits > 0) {
+        output[output_size++] = (unsigned char) accumulator;
+        accumulator >>= 8;
+        accumulator_bits -= 8;
+    }
+    return output_size;
+}
+
+/*
+* Function: read_bits_at
+* ----------------------
+*  Returns count bits (at most 24) of data starting at bit position, low
+*  bits first. 3 bytes after the position must be readable.
+*/
+static uint32_t read_bits_at(const unsigned char* data, size_t position, int count) {
+    const unsigned char* bytes = data + position / 8;
+    uint32_t window = bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+    return (window >> (position % 8)) & ((1u << count) - 1);
+}
+
+/*
+* Function: decode_block
+* ----------------------
+*  Decodes a block stored by encode_block.
+*
+*  table: Pointer to the TansTable object
+*  data: Encoded block (followed by 4 readable bytes)
+*  data_size: Size of the encoded block
+*  output: Output buffer
+*  size: Number of symbols
+*
+*  returns: If the block is corrupted (0), On success (1)
+*/
+static int decode_block(const TansTable* table, const unsigned char* data, size_t data_size, unsigned char* output,
+                        size_t size) {
+    if (data_size == 0 || data[data_size - 1] == 0) {
+        return 0;
+    }
+    size_t position = (data_size - 1) * 8 + highest_bit(data[data_size - 1]);
+    if (position < (size_t) table->table_log) {
+        return 0;
+    }
+    position -= table->table_log;
+    uint32_t state = read_bits_at(data, position, table->table_log);
+    for (size_t i = 0; i < size; i++) {
+        const TansDecodeEntry* entry = &table->decode_table[state];
+        output[i] = entry->symbol;
+        if (entry->bit_count > position) {
+            return 0;
+        }
+        position -= entry->bit_count;
+        state = entry->new_state + read_bits_at(data, position, entry->bit_count);
+    }
+    // The encoder started from the first state
+    return position == 0 && state == 0;
+}
+
+/*
+* Function: compress_tans
+* -----------------------
+*  Compresses the input file with table-based asymmetric numeral systems
+*  in independent blocks of TANS_BLOCK_SIZE bytes.
+*
+*  context: Pointer to the context (frequency_table counted or sampled by the
+*           caller, every byte of the input must have a frequency)
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file
+*
+*  returns: If failed (0), On success (1)
+*/
+int compress_tans(HuffContext* context, FILE* input_file, FILE* output_file) {
+    if (context == NULL || input_file == NULL || output_file == NULL) {
+        err("compress_tans", "Input/output file is NULL!");
+        return 0;
+    }
+    uint16_t normalized[FREQUENCY_TABLE_SIZE];
+    if (normalize_frequencies(context->frequency_table, normalized, TANS_TABLE_LOG) == 0) {
+        err("compress_tans", "At least 2 symbols are needed!");
+        return 0;
+    }
+    // A sampled table doesn't sum to the input size
+    uint64_t input_size = get_file_size(input_file);
+    uint8_t present[FREQUENCY_TABLE_SIZE];
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        present[i] = normalized[i] > 0;
+    }
+
+    unsigned char header[sizeof(tans_magic) + 2 + COMPACT_BITMAP_SIZE];
+    size_t header_size = 0;
+    memcpy(header, tans_magic, sizeof(tans_magic));
+    header_size += sizeof(tans_magic);
+    unsigned char* flags = &header[header_size++];
+    *flags = TANS_VERSION << 4;
+    header[header_size++] = TANS_TABLE_LOG;
+    header_size += write_symbol_set(present, header + header_size, flags);
+    int result = fwrite(header, sizeof(unsigned char), header_size, output_file) == header_size
+                 && write_uint(output_file, input_size, 8);
+    for (size_t i = 0; result && i < FREQUENCY_TABLE_SIZE; i++) {
+        if (present[i]) {
+            result = write_varint(output_file, normalized[i] - 1);
+        }
+    }
+    if (result == 0) {
+        err("compress_tans", "Unable to write the header!");
+        return 0;
+    }
+
+    TansTable* table = create_tans_table(normalized, TANS_TABLE_LOG);
+    unsigned char* input = malloc(TANS_BLOCK_SIZE);
+    unsigned char* output = malloc(TANS_BLOCK_SIZE / 8 * TANS_TABLE_LOG + 8);
+    if (table == NULL || input == NULL || output == NULL) {
+        err("compress_tans", "Unable to allocate memory for the blocks!");
+        result = 0;
+    }
+    fseeko(input_file, 0, SEEK_SET);
+    uint64_t remaining = input_size;
+    while (result && remaining > 0) {
+        size_t block_size = remaining < TANS_BLOCK_SIZE ? remaining : TANS_BLOCK_SIZE;
+        if (fread(input, sizeof(unsigned char), block_size, input_file) < block_size) {
+            err("compress_tans", "Input file changed while compressing!");
+            result = 0;
+            break;
+        }
+        size_t output_size = encode_block(table, input, block_size, output);
+        if (write_uint(output_file, output_size, 4) == 0
+            || fwrite(output, sizeof(unsigned char), output_size, output_file) < output_size) {
+            err("compress_tans", "Unable to write the output file!");
+            result = 0;
+        }
+        remaining -= block_size;
+    }
+    free(output);
+    free(input);
+    free_tans_table(table);
+    return result;
+}
+
+/*
+* Function: decompress_tans
+* -------------------------
+*  Decompresses a file with the tANS header.
+*
+*  input_file: Pointer to the input_file
+*  output_file: Pointer to the output_file (NULL only decodes)
+*
+*  returns: If failed (0), On success (1)
+*/
+int decompress_tans(FILE* input_file, FILE* output_file) {
+    if (input_file == NULL) {
+        err("decompress_tans", "Input file is NULL!");
+        return 0;
+    }
+    unsigned char header[sizeof(tans_magic) + 2];
+    fseeko(input_file, 0, SEEK_SET);
+    if (fread(header, sizeof(unsigned char), sizeof(header), input_file) < sizeof(header)
+        || memcmp(header, tans_magic, sizeof(tans_magic)) != 0) {
+        err("decompress_tans", "File is corrupted!");
+        return 0;
+    }
+    unsigned char flags = header[sizeof(tans_magic)];
+    int table_log = header[sizeof(tans_magic) + 1];
+    if ((flags >> 4) != TANS_VERSION || table_log < 5 || table_log > 15) {
+        err("decompress_tans", "Unsupported tANS header!");
+        return 0;
+    }
+    uint8_t present[FREQUENCY_TABLE_SIZE];
+    uint64_t input_size = 0;
+    if (read_symbol_set(input_file, flags, present) < 2 || read_uint(input_file, &input_size, 8) == 0) {
+        err("decompress_tans", "Header is corrupted!");
+        return 0;
+    }
+    uint16_t normalized[FREQUENCY_TABLE_SIZE] = {0};
+    uint32_t sum = 0;
+    for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; i++) {
+        uint64_t value = 0;
+        if (present[i] && (read_varint(input_file, &value) == 0 || value >= (1u << table_log))) {
+            err("decompress_tans", "Header is corrupted!");
+            return 0;
+        }
+        normalized[i] = present[i] ? value + 1 : 0;
+        sum += normalized[i];
+    }
+    if (sum != (1u << table_log)) {
+        err("decompress_tans", "Header is corrupted!");
+        return 0;
+    }
+
+    TansTable* table = create_tans_table(normalized, table_log);
+    size_t max_block_size = TANS_BLOCK_SIZE / 8 * table_log + 8;
+    unsigned char* data = malloc(max_block_size + 4);
+    unsigned char* output = malloc(TANS_BLOCK_SIZE);
+    int result = table != NULL && data != NULL && output != NULL;
+    if (result == 0) {
+        err("decompress_tans", "Unable to allocate memory for the blocks!");
+    }
+    uint64_t remaining = input_size;
+    while (result && remaining > 0) {
+        size_t block_size = remaining < TANS_BLOCK_SIZE ? remaining : TANS_BLOCK_SIZE;
+        uint64_t data_size = 0;
+        if (read_uint(input_file, &data_size, 4) == 0 || data_size > max_block_size
+            || fread(data, sizeof(unsigned char), data_size, input_file) < data_size) {
+            err("decompress_tans", "Encoded data is truncated!");
+            result = 0;
+            break;
+        }
+        memset(data + data_size, 0, 4);
+        if (decode_block(table, data, data_size, output, block_size) == 0) {
+            err("decompress_tans", "Encoded data is corrupted!");
+            result = 0;
+            break;
+        }
+        if (output_file != NULL && fwrite(output, sizeof(unsigned char), block_size, output_file) < block_size) {
+            err("decompress_tans", "Unable to write the output file!");
+            result = 0;
+        }
+        remaining -= block_size;
+    }
+    if (result && fgetc(input_file) != EOF) {
+        err("decompress_tans", "Encoded data is corrupted!");
+        result = 0;
+    }
+    free(output);
+    free(data);
+    free_tans_table(table);
+    return result;
+}
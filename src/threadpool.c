@@ -0,0 +1,294 @@
+#include "../include/threadpool.h"
+#include "../include/utils.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    ThreadPool* pool;
+    size_t index;
+} WorkerArgs;
+
+/*
+* Function: deque_push
+* --------------------
+*  Adds a task at the bottom of the deque, growing it if needed.
+*
+*  deque: Pointer to the deque
+*  task: Task to add
+*
+*  returns: If failed (0), On success (1)
+*/
+static int deque_push(TaskDeque* deque, Task task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom == deque->capacity) {
+        // Move the remaining tasks to the front before growing
+        size_t count = deque->bottom - deque->top;
+        size_t new_capacity = count * 2 >= deque->capacity ? deque->capacity * 2 : deque->capacity;
+        Task* tasks = new_capacity == deque->capacity ? deque->tasks : malloc(new_capacity * sizeof(Task));
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            return 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            tasks[i] = deque->tasks[deque->top + i];
+        }
+        if (tasks != deque->tasks) {
+            free(deque->tasks);
+        }
+        deque->tasks = tasks;
+        deque->capacity = new_capacity;
+        deque->top = 0;
+        deque->bottom = count;
+    }
+    deque->tasks[deque->bottom++] = task;
+    pthread_mutex_unlock(&deque->lock);
+    return 1;
+}
+
+/*
+* Function: deque_take
+* --------------------
+*  Removes a task from the deque.
+*
+*  deque: Pointer to the deque
+*  task: Pointer to store the task
+*  steal: Take from the top (1), from the bottom (0)
+*
+*  returns: If the deque is empty (0), On success (1)
+*/
+static int deque_take(TaskDeque* deque, Task* task, int steal) {
+    int result = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        *task = steal ? deque->tasks[deque->top++] : deque->tasks[--deque->bottom];
+        result = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return result;
+}
+
+/*
+* Function: find_task
+* -------------------
+*  Takes a task from the worker's own deque, or steals one from another worker.
+*
+*  pool: Pointer to the pool
+*  index: Index of the worker
+*  task: Pointer to store the task
+*
+*  returns: If no task was found (0), On success (1)
+*/
+static int find_task(ThreadPool* pool, size_t index, Task* task) {
+    if (deque_take(&pool->deques[index], task, 0)) {
+        return 1;
+    }
+    for (size_t i = 1; i < pool->worker_count; i++) {
+        if (deque_take(&pool->deques[(index + i) % pool->worker_count], task, 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+* Function: worker_thread
+* -----------------------
+*  Runs tasks until the pool is stopped and no task is left.
+*/
+static void* worker_thread(void* arg) {
+    WorkerArgs* worker = arg;
+    ThreadPool* pool = worker->pool;
+    size_t index = worker->index;
+    free(worker);
+
+    void* context = pool->create_context != NULL ? pool->create_context() : NULL;
+    while (1) {
+        Task task;
+        if (find_task(pool, index, &task)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            task.function(context, task.arg);
+            if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_broadcast(&pool->done_cond);
+                pthread_mutex_unlock(&pool->lock);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->stop) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        int stop = pool->stop && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) {
+            break;
+        }
+    }
+    if (pool->free_context != NULL) {
+        pool->free_context(context);
+    }
+    return NULL;
+}
+
+/*
+* Function: pool_create
+* ---------------------
+*  Starts a pool of worker threads. Every worker owns a context that is
+*  passed to all the tasks it runs, so buffers can be reused between tasks.
+*
+*  worker_count: Number of threads (0 uses the number of online CPUs)
+*  create_context: Function creating a worker context (Can be NULL)
+*  free_context: Function freeing a worker context (Can be NULL)
+*
+*  returns: Pointer to the pool. If failed, returns NULL.
+*/
+ThreadPool* pool_create(size_t worker_count, void* (*create_context)(void), void (*free_context)(void* context)) {
+    if (worker_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = cpus > 0 ? (size_t) cpus : 1;
+    }
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+    if (pool == NULL) {
+        err("pool_create", "Unable to allocate memory for the thread pool!");
+        return NULL;
+    }
+    pool->deques = calloc(worker_count, sizeof(TaskDeque));
+    pool->threads = calloc(worker_count, sizeof(pthread_t));
+    if (pool->deques == NULL || pool->threads == NULL) {
+        err("pool_create", "Unable to allocate memory for the thread pool!");
+        free(pool->deques);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    pool->create_context = create_context;
+    pool->free_context = free_context;
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pool->worker_count = worker_count;
+    // Every lock is initialized first, pool_free destroys all of them
+    for (size_t i = 0; i < worker_count; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+    for (size_t i = 0; i < worker_count; i++) {
+        pool->deques[i].capacity = 16;
+        pool->deques[i].tasks = malloc(pool->deques[i].capacity * sizeof(Task));
+        if (pool->deques[i].tasks == NULL) {
+            err("pool_create", "Unable to allocate memory for the task queues!");
+            pool_free(pool);
+            return NULL;
+        }
+    }
+
+    // Tasks left on the deque of a worker that failed to start are stolen by the others
+    for (size_t i = 0; i < worker_count; i++) {
+        WorkerArgs* worker = malloc(sizeof(WorkerArgs));
+        if (worker == NULL) {
+            break;
+        }
+        worker->pool = pool;
+        worker->index = i;
+        if (pthread_create(&pool->threads[pool->thread_count], NULL, worker_thread, worker) != 0) {
+            free(worker);
+            break;
+        }
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        err("pool_create", "Unable to start the worker threads!");
+        pool_free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/*
+* Function: pool_submit
+* ---------------------
+*  Queues a task on one of the workers.
+*
+*  pool: Pointer to the pool
+*  function: Task function, called with the worker's context and arg
+*  arg: Task argument
+*
+*  returns: If failed (0), On success (1)
+*/
+int pool_submit(ThreadPool* pool, void (*function)(void* context, void* arg), void* arg) {
+    if (pool == NULL || function == NULL) {
+        return 0;
+    }
+    Task task = {function, arg};
+    size_t index = pool->next_deque;
+    pool->next_deque = (pool->next_deque + 1) % pool->worker_count;
+
+    // Counted before the push, a worker may take the task and decrement queued right after it
+    atomic_fetch_add(&pool->pending, 1);
+    atomic_fetch_add(&pool->queued, 1);
+    if (deque_push(&pool->deques[index], task) == 0) {
+        atomic_fetch_sub(&pool->queued, 1);
+        atomic_fetch_sub(&pool->pending, 1);
+        err("pool_submit", "Unable to queue the task!");
+        return 0;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+/*
+* Function: pool_wait
+* -------------------
+*  Waits until every submitted task has finished.
+*
+*  pool: Pointer to the pool
+*/
+void pool_wait(ThreadPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&pool->pending) > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+* Function: pool_free
+* -------------------
+*  Stops the workers (after the queued tasks) and frees the pool.
+*
+*  pool: Pointer to the pool
+*/
+void pool_free(ThreadPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (size_t i = 0; i < pool->worker_count; i++) {
+        free(pool->deques[i].tasks);
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
@@ -1,8 +1,15 @@
+#include "../include/magic.h"
 #include "../include/utils.h"
 
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+static int log_mode = 1;
 
 /*
 * Function err
@@ -16,6 +23,35 @@ void err(const char* func_name, const char* message) {
     fprintf(stderr, "\n[ERROR]: %s() {} -> %s\n", func_name, message);
 }
 
+/*
+* Function set_log_mode
+* ---------------------
+*  Enables or disables the progress logs (e.g. when many files are
+*  processed at the same time).
+*
+*  enabled: Print logs (1), Quiet (0)
+*/
+void set_log_mode(int enabled) {
+    log_mode = enabled;
+}
+
+/*
+* Function print_log
+* ------------------
+*  Prints a progress message to stdout if logs are enabled
+*
+*  format: printf format string
+*/
+void print_log(const char* format, ...) {
+    if (!log_mode) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
 /*
 * Function open_file
 * ------------------
@@ -130,17 +166,162 @@ int extract_filename_format(const char *filepath, char **filename, char **filefo
 /*
 * Function: get_file_size
 * -----------------------
-*  Returns the size of the file
+*  Returns the size of the file (64-bit offsets, also with a 32-bit long)
 *
 *  file: Pointer to the file
 *
 *  returns: file size
 */
-size_t get_file_size(FILE* file) {
-    size_t current_pos = ftell(file);
-    fseek(file, 0, SEEK_END);
-    size_t end = ftell(file); 
-    fseek(file, current_pos, SEEK_SET);
+uint64_t get_file_size(FILE* file) {
+    off_t current_pos = ftello(file);
+    fseeko(file, 0, SEEK_END);
+    off_t end = ftello(file);
+    fseeko(file, current_pos, SEEK_SET);
     return end;
 }
 
+/*
+* Function: has_magic
+* -------------------
+*  Checks if the file starts with the magic bytes (see magic.h).
+*  The file position is not changed.
+*
+*  file: Pointer to the file
+*  magic: Magic bytes
+*  size: Number of magic bytes
+*
+*  returns: (1) if it does, otherwise (0)
+*/
+int has_magic(FILE* file, const unsigned char* magic, size_t size) {
+    unsigned char header[MAGIC_MAX_SIZE];
+    if (size > sizeof(header)) {
+        return 0;
+    }
+    off_t position = ftello(file);
+    int result = fseeko(file, 0, SEEK_SET) == 0
+                 && fread(header, sizeof(unsigned char), size, file) == size
+                 && memcmp(header, magic, size) == 0;
+    fseeko(file, position, SEEK_SET);
+    return result;
+}
+
+/*
+* Function: read_at
+* -----------------
+*  Reads size bytes at an absolute offset with pread, without moving the
+*  file position or using the stdio buffer.
+*
+*  file: Pointer to the file
+*  buffer: Buffer of at least size bytes
+*  size: Number of bytes to read
+*  offset: Offset of the first byte
+*
+*  returns: If the file ends first or reading fails (0), On success (1)
+*/
+int read_at(FILE* file, void* buffer, size_t size, uint64_t offset) {
+    int fd = fileno(file);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t read_bytes = pread(fd, (unsigned char*) buffer + done, size - done, offset + done);
+        if (read_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read_bytes <= 0) {
+            return 0;
+        }
+        done += read_bytes;
+    }
+    return 1;
+}
+
+/*
+* Function: write_uint
+* --------------------
+*  Writes an unsigned integer in little-endian byte order
+*
+*  file: Pointer to the file
+*  value: Value to write
+*  bytes: Number of bytes (1-8)
+*
+*  returns: If failed (0), On success (1)
+*/
+int write_uint(FILE* file, uint64_t value, int bytes) {
+    unsigned char buffer[8];
+    for (int i = 0; i < bytes; i++) {
+        buffer[i] = (unsigned char) (value >> (8 * i));
+    }
+    return fwrite(buffer, sizeof(unsigned char), bytes, file) == (size_t) bytes;
+}
+
+/*
+* Function: read_uint
+* -------------------
+*  Reads an unsigned integer stored by write_uint
+*
+*  file: Pointer to the file
+*  value: Pointer to store the value
+*  bytes: Number of bytes (1-8)
+*
+*  returns: If failed (0), On success (1)
+*/
+int read_uint(FILE* file, uint64_t* value, int bytes) {
+    unsigned char buffer[8];
+    if (fread(buffer, sizeof(unsigned char), bytes, file) < (size_t) bytes) {
+        return 0;
+    }
+    *value = 0;
+    for (int i = 0; i < bytes; i++) {
+        *value |= (uint64_t) buffer[i] << (8 * i);
+    }
+    return 1;
+}
+
+/*
+* Function: write_varint
+* ----------------------
+*  Writes an unsigned integer as a LEB128 varint (7 bits per byte, low
+*  bits first, the high bit marks that more bytes follow)
+*
+*  file: Pointer to the file
+*  value: Value to write
+*
+*  returns: If failed (0), On success (1)
+*/
+int write_varint(FILE* file, uint64_t value) {
+    unsigned char buffer[10];
+    size_t size = 0;
+    do {
+        buffer[size] = value & 0x7F;
+        value >>= 7;
+        if (value != 0) {
+            buffer[size] |= 0x80;
+        }
+        size++;
+    } while (value != 0);
+    return fwrite(buffer, sizeof(unsigned char), size, file) == size;
+}
+
+/*
+* Function: read_varint
+* ---------------------
+*  Reads an unsigned integer stored by write_varint
+*
+*  file: Pointer to the file
+*  value: Pointer to store the value
+*
+*  returns: If failed (0), On success (1)
+*/
+int read_varint(FILE* file, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF) {
+            return 0;
+        }
+        *value |= (uint64_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
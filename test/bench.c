@@ -0,0 +1,284 @@
+#include "../include/adaptive.h"
+#include "../include/batch.h"
+#include "../include/compact.h"
+#include "../include/compressor.h"
+#include "../include/decodetable.h"
+#include "../include/dictionary.h"
+#include "../include/utils.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_INPUT_SIZE (8 * 1024 * 1024)
+#define BENCH_ROUNDS 3
+#define BENCH_MESSAGE_COUNT (BENCH_INPUT_SIZE / BENCH_MESSAGE_SIZE)
+#define BENCH_MESSAGE_SIZE 128
+
+// Function to fill a file with symbols whose probabilities fall by the given ratio
+FILE* create_skewed_input(double ratio) {
+    FILE* file = tmpfile();
+    if (file == NULL) {
+        perror("Failed to create the input file");
+        return NULL;
+    }
+    double weights[256];
+    double total = 0;
+    for (int i = 0; i < 256; i++) {
+        weights[i] = pow(ratio, i);
+        total += weights[i];
+    }
+    srand(42);
+    for (size_t i = 0; i < BENCH_INPUT_SIZE; i++) {
+        double value = (double) rand() / RAND_MAX * total;
+        int symbol = 0;
+        while (symbol < 255 && value > weights[symbol]) {
+            value -= weights[symbol++];
+        }
+        fputc(symbol, file);
+    }
+    fflush(file);
+    rewind(file);
+    return file;
+}
+
+// Decoder configurations to compare
+typedef struct {
+    const char* name;
+    int mode;
+    int portable;
+} BenchDecoder;
+
+// Function to return the best decoding time of a few rounds
+double time_decode(HuffContext* context, FILE* compressed, const BenchDecoder* decoder) {
+    set_decode_table_mode(decoder->mode);
+    set_decode_table_portable(decoder->portable);
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        rewind(compressed);
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (decompress_with_context(context, compressed, NULL) == 0) {
+            fprintf(stderr, "Decoding failed\n");
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        if (round == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// Coders compared with the static (two-pass) compressor
+typedef int (*BenchCoder)(HuffContext* context, FILE* input_file, FILE* output_file);
+
+int static_compress(HuffContext* context, FILE* input_file, FILE* output_file) {
+    return compress_with_context(context, input_file, output_file);
+}
+
+int adaptive_compress(HuffContext* context, FILE* input_file, FILE* output_file) {
+    (void) context;
+    return compress_adaptive(input_file, output_file);
+}
+
+int adaptive_decompress(HuffContext* context, FILE* input_file, FILE* output_file) {
+    (void) context;
+    (void) output_file;
+    return decompress_adaptive(input_file, NULL);
+}
+
+// Function to return the best time of a few rounds of a coder (the output is rewritten every round)
+double time_coder(HuffContext* context, FILE* input, FILE* output, BenchCoder coder) {
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        rewind(input);
+        if (output != NULL) {
+            rewind(output);
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (coder(context, input, output) == 0) {
+            fprintf(stderr, "Coding failed\n");
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        if (round == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    if (output != NULL) {
+        fflush(output);
+    }
+    return best;
+}
+
+// Function to compare the one-pass adaptive stream with the static compressor
+int bench_adaptive(HuffContext* context, const double* ratios, size_t ratio_count) {
+    printf("\nAdaptive (one pass, no table) against static (two passes)\n");
+    printf("%-8s %-10s %8s   %-10s %8s %8s   (MB/s)\n", "Ratio", "Static", "encode", "Adaptive", "encode", "decode");
+    for (size_t i = 0; i < ratio_count; i++) {
+        FILE* input = create_skewed_input(ratios[i]);
+        FILE* static_output = tmpfile();
+        FILE* adaptive_output = tmpfile();
+        if (input == NULL || static_output == NULL || adaptive_output == NULL) {
+            return 0;
+        }
+        double static_seconds = time_coder(context, input, static_output, static_compress);
+        double adaptive_seconds = time_coder(context, input, adaptive_output, adaptive_compress);
+        double decode_seconds = time_coder(context, adaptive_output, NULL, adaptive_decompress);
+        if (static_seconds < 0 || adaptive_seconds < 0 || decode_seconds < 0) {
+            return 0;
+        }
+        double megabytes = BENCH_INPUT_SIZE / (1024.0 * 1024);
+        printf("%-8.2f %-10.2f %8.1f   %-10.2f %8.1f %8.1f\n", ratios[i],
+               ftell(static_output) * 8.0 / BENCH_INPUT_SIZE, megabytes / static_seconds,
+               ftell(adaptive_output) * 8.0 / BENCH_INPUT_SIZE, megabytes / adaptive_seconds, megabytes / decode_seconds);
+        fclose(input);
+        fclose(static_output);
+        fclose(adaptive_output);
+    }
+    return 1;
+}
+
+// Function to compare compressing small messages one by one with the batch API
+int bench_batch(HuffContext* context) {
+    // Messages of one event stream share their symbol statistics
+    FILE* source = create_skewed_input(0.9);
+    unsigned char* data = malloc(BENCH_INPUT_SIZE);
+    BatchInput* inputs = malloc(BENCH_MESSAGE_COUNT * sizeof(BatchInput));
+    BatchOutput* outputs = malloc(BENCH_MESSAGE_COUNT * sizeof(BatchOutput));
+    FILE* message = tmpfile();
+    FILE* output = tmpfile();
+    if (source == NULL || data == NULL || inputs == NULL || outputs == NULL || message == NULL || output == NULL
+        || fread(data, 1, BENCH_INPUT_SIZE, source) < BENCH_INPUT_SIZE) {
+        return 0;
+    }
+    for (size_t i = 0; i < BENCH_MESSAGE_COUNT; i++) {
+        inputs[i].data = data + i * BENCH_MESSAGE_SIZE;
+        inputs[i].size = BENCH_MESSAGE_SIZE;
+    }
+    printf("\nBatch of %d messages of %d bytes\n", BENCH_MESSAGE_COUNT, BENCH_MESSAGE_SIZE);
+    printf("%-16s %12s %12s\n", "Mode", "Msgs/s", "Bytes/msg");
+
+    // One compress call per message, through a file like the command line
+    struct timespec start, end;
+    size_t output_bytes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < BENCH_MESSAGE_COUNT / 10; i++) {
+        rewind(message);
+        rewind(output);
+        if (fwrite(inputs[i].data, 1, inputs[i].size, message) < inputs[i].size || fflush(message) != 0
+            || ftruncate(fileno(message), inputs[i].size) != 0 || ftruncate(fileno(output), 0) != 0) {
+            return 0;
+        }
+        rewind(message);
+        if (compress_with_context(context, message, output) == 0) {
+            return 0;
+        }
+        fflush(output);
+        output_bytes += get_file_size(output);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%-16s %12.0f %12.1f\n", "compress", BENCH_MESSAGE_COUNT / 10 / seconds,
+           (double) output_bytes / (BENCH_MESSAGE_COUNT / 10));
+
+    const char* names[] = {"batch", "batch shared", "batch shared 4T"};
+    for (int mode = 0; mode < 3; mode++) {
+        Dictionary* dictionary = NULL;
+        double best = 0;
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            free_dictionary(dictionary);
+            dictionary = NULL;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            unsigned char* buffer = huff_compress_batch(inputs, BENCH_MESSAGE_COUNT, outputs, mode == 2 ? 4 : 1,
+                                                        mode > 0 ? &dictionary : NULL);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            if (buffer == NULL) {
+                return 0;
+            }
+            free(buffer);
+            seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+            if (round == 0 || seconds < best) {
+                best = seconds;
+            }
+        }
+        output_bytes = 0;
+        for (size_t i = 0; i < BENCH_MESSAGE_COUNT; i++) {
+            output_bytes += outputs[i].size;
+        }
+        printf("%-16s %12.0f %12.1f\n", names[mode], BENCH_MESSAGE_COUNT / best, (double) output_bytes / BENCH_MESSAGE_COUNT);
+        free_dictionary(dictionary);
+    }
+    fclose(source);
+    fclose(message);
+    fclose(output);
+    free(outputs);
+    free(inputs);
+    free(data);
+    return 1;
+}
+
+int main() {
+    const double ratios[] = {0.1, 0.3, 0.5, 0.7, 0.9, 0.97, 1.0};
+    const BenchDecoder decoders[] = {
+        {"tree", DECODE_TABLE_TREE, 1},
+        {"single", DECODE_TABLE_SINGLE, 1},
+        {"single*", DECODE_TABLE_SINGLE, 0},
+        {"multi", DECODE_TABLE_MULTI, 1},
+        {"multi*", DECODE_TABLE_MULTI, 0},
+        {"auto*", DECODE_TABLE_AUTO, 0},
+    };
+    size_t decoder_count = sizeof(decoders) / sizeof(decoders[0]);
+    set_log_mode(0);
+
+    HuffContext* context = create_context();
+    if (context == NULL) {
+        return 1;
+    }
+    printf("Decoders marked with * use the %s lookup loops\n", decode_table_backend());
+    printf("%-8s %-10s", "Ratio", "Bits/byte");
+    for (size_t i = 0; i < decoder_count; i++) {
+        printf(" %8s", decoders[i].name);
+    }
+    printf("   (MB/s)\n");
+
+    for (size_t i = 0; i < sizeof(ratios) / sizeof(ratios[0]); i++) {
+        FILE* input = create_skewed_input(ratios[i]);
+        FILE* compressed = tmpfile();
+        // The compact header always stores huffman codes (compress() may pick tANS or packing)
+        if (input == NULL || compressed == NULL || compress_compact(context, input, compressed) == 0) {
+            fprintf(stderr, "Compression failed\n");
+            return 1;
+        }
+        fflush(compressed);
+        long compressed_size = ftell(compressed);
+        printf("%-8.2f %-10.2f", ratios[i], compressed_size * 8.0 / BENCH_INPUT_SIZE);
+        for (size_t j = 0; j < decoder_count; j++) {
+            double seconds = time_decode(context, compressed, &decoders[j]);
+            if (seconds < 0) {
+                return 1;
+            }
+            printf(" %8.1f", BENCH_INPUT_SIZE / seconds / (1024 * 1024));
+        }
+        printf("\n");
+        fclose(input);
+        fclose(compressed);
+    }
+    if (bench_adaptive(context, ratios, sizeof(ratios) / sizeof(ratios[0])) == 0) {
+        fprintf(stderr, "Adaptive benchmark failed\n");
+        return 1;
+    }
+    if (bench_batch(context) == 0) {
+        fprintf(stderr, "Batch benchmark failed\n");
+        return 1;
+    }
+    free_context(context);
+    return 0;
+}
@@ -1,14 +1,30 @@
+#define _FILE_OFFSET_BITS 64
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "../include/batch.h"
+#include "../include/dictionary.h"
+#include "../include/magic.h"
+
 #define MAX_PATH 256
 #define TEST_FILES_DIR "./test/test_files"
 #define TEST_RESULTS_DIR "./test/test_results"
+#define TEST_FIXTURES_DIR "./test/fixtures"
+#define SPARSE_FILE_SIZE (4ULL << 40) // 4 TiB, only the written blocks take space
+#define SPARSE_BLOCK_SIZE (64 * 1024) // Default segment size of shards
+#define INPUTS_DIR TEST_RESULTS_DIR "/inputs"
+#define GENERATED_INPUT_SIZE (3 * 1024 * 1024 + 12345) // Several -j chunks, not a multiple of them
+#define BATCH_MESSAGES 3000 // More than one chunk, so the messages run on the thread pool
+
+// Number of failed checks, main returns 1 if any
+int failures = 0;
 
 // Function to create a directory if it doesn't exist
 int create_directory(const char *path) {
@@ -32,6 +48,16 @@ int run_command(const char *cmd) {
     return 0;
 }
 
+// Function to print the result of a check
+void report(int passed, const char *message) {
+    if (passed) {
+        printf("--- [PASSED] - %s\n", message);
+    } else {
+        printf("--- [FAILED] - %s\n", message);
+        failures++;
+    }
+}
+
 // Function to compare two files for equality
 int compare_files(const char *file1, const char *file2) {
     FILE *f1 = fopen(file1, "rb");
@@ -59,7 +85,801 @@ int compare_files(const char *file1, const char *file2) {
     return equal;
 }
 
-int main() {
+// Function to decode the .huf files made by earlier versions (<name>.huf decodes to <name>)
+int test_fixtures(void) {
+    DIR *dir = opendir(TEST_FIXTURES_DIR);
+    if (!dir) {
+        perror("Failed to open fixtures directory");
+        return -1;
+    }
+    char results_dir[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/fixtures", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        closedir(dir);
+        return -1;
+    }
+    printf("\n--------------------------|FIXTURES|--------------------------\n");
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length <= 4 || strcmp(entry->d_name + length - 4, ".huf") != 0) {
+            continue;
+        }
+        char compressed_path[MAX_PATH];
+        char original_path[MAX_PATH];
+        char decompressed_path[MAX_PATH];
+        char cmd[MAX_PATH * 3];
+        snprintf(compressed_path, MAX_PATH, "%s/%s", TEST_FIXTURES_DIR, entry->d_name);
+        snprintf(original_path, MAX_PATH, "%s/%.*s", TEST_FIXTURES_DIR, (int) (length - 4), entry->d_name);
+        snprintf(decompressed_path, MAX_PATH, "%s/%.*s", results_dir, (int) (length - 4), entry->d_name);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s -o %s > /dev/null", compressed_path, decompressed_path);
+        printf("[FIXTURE]: Decompressing %s\n", entry->d_name);
+        report(run_command(cmd) == 0 && compare_files(original_path, decompressed_path) == 1,
+               "Fixture decodes to its original");
+    }
+    closedir(dir);
+    return 0;
+}
+
+// Function to compress a file in shards by separate processes and merge them
+int test_shards(void) {
+    const char *input_path = TEST_FILES_DIR "/pic-256.bmp";
+    char results_dir[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/shards", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n--------------------------|SHARDS|--------------------------\n");
+    char cmd[MAX_PATH * 8];
+    char merged_path[MAX_PATH];
+    char decompressed_path[MAX_PATH];
+    snprintf(merged_path, MAX_PATH, "%s/merged.huf", results_dir);
+    snprintf(decompressed_path, MAX_PATH, "%s/pic-256.bmp", results_dir);
+
+    // Three 64 KiB shards (16 KiB segments), compressed at the same time
+    printf("[SHARDS]: Compressing %s in 3 processes\n", input_path);
+    snprintf(cmd, sizeof(cmd),
+             "pids=; for range in 0:65536 65536:131072 131072:; do"
+             " ./bin/huffman -c %s --shard $range -s 16 -k -o %s/shard-${range%%%%:*}.huf > /dev/null & pids=\"$pids $!\"; done;"
+             " status=0; for pid in $pids; do wait $pid || status=1; done; exit $status",
+             input_path, results_dir);
+    report(run_command(cmd) == 0, "Shards compressed");
+
+    printf("[SHARDS]: Merging the shards\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman merge -o %s %s/shard-0.huf %s/shard-65536.huf %s/shard-131072.huf > /dev/null",
+             merged_path, results_dir, results_dir, results_dir);
+    int merged = run_command(cmd) == 0;
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s -V -o %s > /dev/null", merged_path, decompressed_path);
+    report(merged && run_command(cmd) == 0 && compare_files(input_path, decompressed_path) == 1,
+           "Merged shards decode to the original");
+
+    // Misordered and incomplete merges must fail
+    printf("[SHARDS]: Merging misordered shards\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman merge -o %s %s/shard-65536.huf %s/shard-0.huf %s/shard-131072.huf > /dev/null 2>&1",
+             merged_path, results_dir, results_dir, results_dir);
+    report(system(cmd) != 0, "Misordered shards are rejected");
+    printf("[SHARDS]: Merging shards with a gap\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman merge -o %s %s/shard-0.huf %s/shard-131072.huf > /dev/null 2>&1",
+             merged_path, results_dir, results_dir);
+    report(system(cmd) != 0, "Shards with a gap are rejected");
+    return 0;
+}
+
+// Function to decode the same files with the BMI2 and the portable lookup loops
+int test_decoders(void) {
+    const char *names[] = {"pic-256.bmp", "pic-1024.bmp"};
+    char results_dir[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/decoders", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n--------------------------|DECODERS|--------------------------\n");
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        char input_path[MAX_PATH];
+        char compressed_path[MAX_PATH];
+        char default_path[MAX_PATH];
+        char portable_path[MAX_PATH];
+        char cmd[MAX_PATH * 3];
+        snprintf(input_path, MAX_PATH, "%s/%s", TEST_FILES_DIR, names[i]);
+        snprintf(compressed_path, MAX_PATH, "%s/%s.huf", results_dir, names[i]);
+        snprintf(default_path, MAX_PATH, "%s/%s", results_dir, names[i]);
+        snprintf(portable_path, MAX_PATH, "%s/%s.portable", results_dir, names[i]);
+
+        // Seekable segments always use huffman codes and the lookup tables
+        printf("[DECODERS]: Compressing %s\n", names[i]);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s -s 16 -o %s > /dev/null", input_path, compressed_path);
+        int result = run_command(cmd) == 0;
+        printf("[DECODERS]: Decompressing %s.huf with both lookup loops\n", names[i]);
+        snprintf(cmd, sizeof(cmd), "HUFFMAN_PORTABLE_DECODE=0 ./bin/huffman -d %s -o %s > /dev/null", compressed_path,
+                 default_path);
+        result = result && run_command(cmd) == 0;
+        snprintf(cmd, sizeof(cmd), "HUFFMAN_PORTABLE_DECODE=1 ./bin/huffman -d %s -o %s > /dev/null", compressed_path,
+                 portable_path);
+        result = result && run_command(cmd) == 0;
+        report(result && compare_files(default_path, portable_path) == 1 && compare_files(input_path, default_path) == 1,
+               "Both lookup loops decode to the original");
+    }
+    return 0;
+}
+
+// Function to compress a batch of messages and decompress every message in memory
+// (kinds counts the compact, shared table and stored outputs)
+int round_trip_batch(const BatchInput *inputs, size_t count, Dictionary **dictionary, size_t *kinds) {
+    BatchOutput *outputs = malloc(count * sizeof(BatchOutput));
+    unsigned char *buffer = outputs ? huff_compress_batch(inputs, count, outputs, 0, dictionary) : NULL;
+    int equal = buffer != NULL;
+    for (size_t i = 0; equal && i < count; i++) {
+        const unsigned char *data = outputs[i].data;
+        kinds[0] += memcmp(data, compact_magic, sizeof(compact_magic)) == 0;
+        kinds[1] += memcmp(data, dictionary_stream_magic, sizeof(dictionary_stream_magic)) == 0;
+        kinds[2] += memcmp(data, stored_magic, sizeof(stored_magic)) == 0;
+        size_t size = 0;
+        unsigned char *message = huff_decompress_message(data, outputs[i].size, dictionary ? *dictionary : NULL, &size);
+        equal = message != NULL && size == inputs[i].size && (size == 0 || memcmp(message, inputs[i].data, size) == 0);
+        if (!equal) {
+            printf("\t[DIFF] message %zu (%zu bytes)\n", i, inputs[i].size);
+        }
+        free(message);
+    }
+    free(buffer);
+    free(outputs);
+    return equal;
+}
+
+// Function to round trip empty, random, repeated and text messages with own and shared tables
+int test_batch(void) {
+    static const char *words[] = {"huffman ", "batch ", "message ", "table ", "shared ", "code "};
+    BatchInput *inputs = malloc(BATCH_MESSAGES * sizeof(BatchInput));
+    unsigned char *data = malloc(BATCH_MESSAGES * 512);
+    if (inputs == NULL || data == NULL) {
+        free(inputs);
+        free(data);
+        return -1;
+    }
+    srand(46);
+    for (size_t i = 0; i < BATCH_MESSAGES; i++) {
+        unsigned char *message = data + i * 512;
+        size_t size = 0;
+        switch (i % 4) {
+            case 0: // Empty
+                break;
+            case 1: // Random, stored
+                size = 64 + rand() % 448;
+                for (size_t j = 0; j < size; j++) message[j] = rand() & 0xFF;
+                break;
+            case 2: // One symbol
+                size = 1 + rand() % 511;
+                memset(message, 'x', size);
+                break;
+            default: // Text
+                while (size < 448) {
+                    const char *word = words[rand() % 6];
+                    memcpy(message + size, word, strlen(word));
+                    size += strlen(word);
+                }
+        }
+        inputs[i].data = message;
+        inputs[i].size = size;
+    }
+
+    printf("\n---------------------------|BATCH|----------------------------\n");
+    size_t own[3] = {0}, built[3] = {0}, given[3] = {0};
+    Dictionary *dictionary = NULL;
+    printf("[BATCH]: Own tables\n");
+    report(round_trip_batch(inputs, BATCH_MESSAGES, NULL, own) && own[0] > 0 && own[1] == 0 && own[2] > 0,
+           "Own table and stored messages decompress to the originals");
+    printf("[BATCH]: Shared table built from the batch\n");
+    report(round_trip_batch(inputs, BATCH_MESSAGES, &dictionary, built) && dictionary != NULL && built[0] == 0
+               && built[1] > 0 && built[2] > 0,
+           "Shared table and stored messages decompress to the originals");
+    printf("[BATCH]: Shared table given\n");
+    report(dictionary != NULL && round_trip_batch(inputs, BATCH_MESSAGES, &dictionary, given) && given[1] == built[1],
+           "Messages of a given table decompress to the originals");
+    if (dictionary != NULL) {
+        size_t size = 0;
+        unsigned char *message = NULL;
+        BatchOutput output;
+        unsigned char *buffer = huff_compress_batch(&inputs[3], 1, &output, 1, &dictionary);
+        if (buffer != NULL) {
+            message = huff_decompress_message(output.data, output.size, NULL, &size);
+        }
+        report(buffer != NULL && message == NULL, "Shared table message without its table is rejected");
+        free(message);
+        free(buffer);
+    }
+
+    free_dictionary(dictionary);
+    free(data);
+    free(inputs);
+    return 0;
+}
+
+// Function to check that --estimate predicts the size and format of the files -c writes
+int test_estimate(void) {
+    char results_dir[MAX_PATH];
+    char random_path[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/estimate", TEST_RESULTS_DIR);
+    snprintf(random_path, MAX_PATH, "%s/random.bin", results_dir);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n--------------------------|ESTIMATE|--------------------------\n");
+
+    // Random bytes are stored, the probe runs after the estimate has counted the file
+    FILE *random_file = fopen(random_path, "wb");
+    if (random_file == NULL) {
+        return -1;
+    }
+    srand(45);
+    for (int i = 0; i < 100000; i++) {
+        fputc(rand() & 0xFF, random_file);
+    }
+    fclose(random_file);
+
+    const char *inputs[] = {random_path, TEST_FILES_DIR "/pic-64.bmp"};
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        char compressed_path[MAX_PATH];
+        char cmd[MAX_PATH * 4];
+        snprintf(compressed_path, MAX_PATH, "%s/estimate-%zu.huf", results_dir, i);
+        printf("[ESTIMATE]: Estimating %s\n", inputs[i]);
+        snprintf(cmd, sizeof(cmd),
+                 "./bin/huffman -c %s -o %s > /dev/null && test \"$(./bin/huffman -c %s --estimate | awk '/^Output/ {print $2}')\" "
+                 "= \"$(stat -c %%s %s)\"", inputs[i], compressed_path, inputs[i], compressed_path);
+        report(run_command(cmd) == 0, "Estimated size matches the compressed file");
+    }
+
+    // The bit counts of a sample are scaled to the input size
+    char cmd[MAX_PATH * 2];
+    printf("[ESTIMATE]: Estimating %s/pic-1024.bmp from a sample\n", TEST_FILES_DIR);
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s/pic-1024.bmp --estimate --fast-stats=256"
+             " | grep -q '^Huffman .*, estimated)$'", TEST_FILES_DIR);
+    report(run_command(cmd) == 0, "Sampled sizes are marked as estimated");
+    return 0;
+}
+
+// Inputs of the mode tests: generated files first, then files of test_files
+const char *input_names[] = {"text", "skewed", "dna", "random", "tiny", "empty", "dyadic", "pic-64.bmp",
+                             "pic-256.bmp", "pic-1024.bmp"};
+#define GENERATED_INPUTS 7
+#define INPUT_COUNT (sizeof(input_names) / sizeof(input_names[0]))
+
+// Function to get the path of an input of the mode tests
+void input_path(size_t index, char *path) {
+    snprintf(path, MAX_PATH, "%s/%s", index < GENERATED_INPUTS ? INPUTS_DIR : TEST_FILES_DIR, input_names[index]);
+}
+
+// Function to write the generated inputs (text, skewed, DNA, random bytes, a few bytes, an empty file and
+// probabilities of powers of 2, where tANS and packing don't pay off and the huffman stream is written)
+int create_inputs(void) {
+    static const char *words[] = {"the ", "huffman ", "code ", "of ", "a ", "symbol ", "is ", "shorter\n"};
+    if (create_directory(INPUTS_DIR) != 0) {
+        return -1;
+    }
+    srand(38);
+    for (size_t i = 0; i < GENERATED_INPUTS; i++) {
+        char path[MAX_PATH];
+        input_path(i, path);
+        FILE *file = fopen(path, "wb");
+        if (file == NULL) {
+            perror("Failed to create an input");
+            return -1;
+        }
+        size_t size = i == 4 ? 5 : i == 5 ? 0 : GENERATED_INPUT_SIZE;
+        const char *word = "";
+        for (size_t written = 0; written < size; written++) {
+            switch (i) {
+                case 0: // Text
+                    if (*word == '\0') {
+                        word = words[rand() % 8];
+                    }
+                    fputc(*word++, file);
+                    break;
+                case 1: { // Skewed, every symbol half as likely as the previous one
+                    int symbol = 0;
+                    while (symbol < 40 && rand() % 2 == 0) symbol++;
+                    fputc('a' + symbol, file);
+                    break;
+                }
+                case 2: // DNA
+                    fputc("ACGT"[rand() % 4], file);
+                    break;
+                case 3: // Random bytes
+                    fputc(rand() & 0xFF, file);
+                    break;
+                case 4: // A few bytes
+                    fputc("hello"[written], file);
+                    break;
+                default: // 16 symbols of 5 bit codes and 32 of 6 bits
+                    fputc(rand() % 2 ? 'A' + rand() % 16 : 'a' + rand() % 32, file);
+            }
+        }
+        fclose(file);
+    }
+    return 0;
+}
+
+// Function to check that -c -j writes the same file as -c and that -d -j decodes it
+int test_parallel(void) {
+    char results_dir[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/parallel", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0 || create_inputs() != 0) {
+        return -1;
+    }
+    printf("\n-------------------------|PARALLEL|-------------------------\n");
+    for (size_t i = 0; i < INPUT_COUNT; i++) {
+        char path[MAX_PATH];
+        char serial_path[MAX_PATH];
+        char parallel_path[MAX_PATH];
+        char decompressed_path[MAX_PATH];
+        char cmd[MAX_PATH * 3];
+        input_path(i, path);
+        snprintf(serial_path, MAX_PATH, "%s/%s.huf", results_dir, input_names[i]);
+        snprintf(parallel_path, MAX_PATH, "%s/%s.j4.huf", results_dir, input_names[i]);
+        snprintf(decompressed_path, MAX_PATH, "%s/%s", results_dir, input_names[i]);
+
+        printf("[PARALLEL]: Compressing %s with and without -j 4\n", input_names[i]);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s -o %s > /dev/null", path, serial_path);
+        int result = run_command(cmd) == 0;
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s -j 4 -o %s > /dev/null", path, parallel_path);
+        result = result && run_command(cmd) == 0;
+        report(result && compare_files(serial_path, parallel_path) == 1, "-j 4 writes the same file as -c");
+
+        // Single stream files are split at guessed code boundaries, the others fall back to -d
+        printf("[PARALLEL]: Decompressing %s.huf with -j 4\n", input_names[i]);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s -j 4 -o %s > /dev/null", serial_path, decompressed_path);
+        report(result && run_command(cmd) == 0 && compare_files(path, decompressed_path) == 1,
+               "-d -j 4 decodes to the original");
+    }
+    return 0;
+}
+
+// Function to check that -p writes the same file as -c and decodes it
+int test_pipelined(void) {
+    char results_dir[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/pipelined", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n------------------------|PIPELINED|-------------------------\n");
+    for (size_t i = 0; i < INPUT_COUNT; i++) {
+        char path[MAX_PATH];
+        char serial_path[MAX_PATH];
+        char pipelined_path[MAX_PATH];
+        char decompressed_path[MAX_PATH];
+        char cmd[MAX_PATH * 3];
+        input_path(i, path);
+        snprintf(serial_path, MAX_PATH, "%s/%s.huf", results_dir, input_names[i]);
+        snprintf(pipelined_path, MAX_PATH, "%s/%s.p.huf", results_dir, input_names[i]);
+        snprintf(decompressed_path, MAX_PATH, "%s/%s", results_dir, input_names[i]);
+
+        printf("[PIPELINED]: Compressing %s with and without -p\n", input_names[i]);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s -o %s > /dev/null", path, serial_path);
+        int result = run_command(cmd) == 0;
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s -p -o %s > /dev/null", path, pipelined_path);
+        result = result && run_command(cmd) == 0;
+        report(result && compare_files(serial_path, pipelined_path) == 1, "-p writes the same file as -c");
+
+        printf("[PIPELINED]: Decompressing %s.huf with -p\n", input_names[i]);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s -p -o %s > /dev/null", pipelined_path, decompressed_path);
+        report(result && run_command(cmd) == 0 && compare_files(path, decompressed_path) == 1,
+               "-d -p decodes to the original");
+    }
+    return 0;
+}
+
+// Function to check that a file starts with the given magic bytes
+int has_file_magic(const char *path, const unsigned char *magic, size_t size) {
+    unsigned char bytes[MAGIC_MAX_SIZE];
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    int result = fread(bytes, 1, size, file) == size && memcmp(bytes, magic, size) == 0;
+    fclose(file);
+    return result;
+}
+
+// Function to compress an input with the given options and to check the format and the decoded file
+int round_trip_format(size_t index, const char *options, const char *results_dir, const unsigned char *magic,
+                      size_t magic_size) {
+    char path[MAX_PATH];
+    char compressed_path[MAX_PATH];
+    char decompressed_path[MAX_PATH];
+    char cmd[MAX_PATH * 3];
+    input_path(index, path);
+    snprintf(compressed_path, MAX_PATH, "%s/%s.huf", results_dir, input_names[index]);
+    snprintf(decompressed_path, MAX_PATH, "%s/%s", results_dir, input_names[index]);
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s %s -o %s > /dev/null", path, options, compressed_path);
+    if (run_command(cmd) != 0 || !has_file_magic(compressed_path, magic, magic_size)) {
+        return 0;
+    }
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s -o %s > /dev/null", compressed_path, decompressed_path);
+    return run_command(cmd) == 0 && compare_files(path, decompressed_path) == 1;
+}
+
+// Function to check that text, skewed and image inputs are written with tANS and decode to the originals
+int test_tans(void) {
+    const size_t indexes[] = {0, 1, 8, 9};
+    char results_dir[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/tans", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n---------------------------|TANS|----------------------------\n");
+    for (size_t i = 0; i < sizeof(indexes) / sizeof(indexes[0]); i++) {
+        printf("[TANS]: Compressing %s\n", input_names[indexes[i]]);
+        report(round_trip_format(indexes[i], "", results_dir, tans_magic, sizeof(tans_magic)),
+               "tANS file decodes to the original");
+    }
+    char cmd[MAX_PATH * 3];
+    printf("[TANS]: Decompressing a truncated file\n");
+    snprintf(cmd, sizeof(cmd), "head -c -100 %s/text.huf > %s/truncated.huf && ./bin/huffman -d %s/truncated.huf"
+             " -o %s/truncated > /dev/null 2>&1", results_dir, results_dir, results_dir, results_dir);
+    report(system(cmd) != 0, "Truncated tANS file is rejected");
+    return 0;
+}
+
+// Function to check that DNA is packed into 2 bit indexes and decodes to the original
+int test_packed(void) {
+    char results_dir[MAX_PATH];
+    char compressed_path[MAX_PATH];
+    struct stat st;
+    snprintf(results_dir, MAX_PATH, "%s/packed", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n--------------------------|PACKED|---------------------------\n");
+    printf("[PACKED]: Compressing %s\n", input_names[2]);
+    int result = round_trip_format(2, "", results_dir, packed_magic, sizeof(packed_magic));
+    report(result, "Packed file decodes to the original");
+    snprintf(compressed_path, MAX_PATH, "%s/%s.huf", results_dir, input_names[2]);
+    report(result && stat(compressed_path, &st) == 0 && st.st_size <= GENERATED_INPUT_SIZE / 4 + 64,
+           "Packed file takes 2 bits per symbol");
+    return 0;
+}
+
+// Function to round trip inputs through -A, from files and through pipes
+int test_adaptive(void) {
+    const size_t indexes[] = {0, 1, 3, 4, 5};
+    char results_dir[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/adaptive", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n-------------------------|ADAPTIVE|--------------------------\n");
+    for (size_t i = 0; i < sizeof(indexes) / sizeof(indexes[0]); i++) {
+        char path[MAX_PATH];
+        char piped_path[MAX_PATH];
+        char decompressed_path[MAX_PATH];
+        char cmd[MAX_PATH * 4];
+        input_path(indexes[i], path);
+        snprintf(piped_path, MAX_PATH, "%s/%s.pipe.huf", results_dir, input_names[indexes[i]]);
+        snprintf(decompressed_path, MAX_PATH, "%s/%s.pipe", results_dir, input_names[indexes[i]]);
+
+        printf("[ADAPTIVE]: Compressing %s with -A\n", input_names[indexes[i]]);
+        report(round_trip_format(indexes[i], "-A", results_dir, adaptive_magic, sizeof(adaptive_magic)),
+               "Adaptive file is detected by -d and decodes to the original");
+
+        // Pipes can't be rewound, so both directions run in one pass
+        printf("[ADAPTIVE]: Compressing and decompressing %s through pipes\n", input_names[indexes[i]]);
+        snprintf(cmd, sizeof(cmd), "cat %s | ./bin/huffman -A -c /dev/stdin -o %s > /dev/null"
+                 " && cat %s | ./bin/huffman -A -d /dev/stdin -o %s > /dev/null",
+                 path, piped_path, piped_path, decompressed_path);
+        report(run_command(cmd) == 0 && compare_files(path, decompressed_path) == 1,
+               "Piped adaptive stream decodes to the original");
+    }
+    return 0;
+}
+
+// Function to check that -t passes files of every format, fails damaged ones and writes nothing
+int test_test_mode(void) {
+    char results_dir[MAX_PATH];
+    char cmd[MAX_PATH * 8];
+    snprintf(results_dir, MAX_PATH, "%s/test-mode", TEST_RESULTS_DIR);
+    printf("\n-------------------------|TEST MODE|-------------------------\n");
+    // tANS, packed, huffman stream, adaptive and seekable with checksums
+    snprintf(cmd, sizeof(cmd), "rm -rf %s && mkdir -p %s"
+             " && ./bin/huffman -c %s/text -o %s/tans.huf > /dev/null"
+             " && ./bin/huffman -c %s/dna -o %s/packed.huf > /dev/null"
+             " && ./bin/huffman -c %s/dyadic -o %s/stream.huf > /dev/null"
+             " && ./bin/huffman -c %s/text -A -o %s/adaptive.huf > /dev/null"
+             " && ./bin/huffman -c %s/text -k -s 64 -o %s/checked.huf > /dev/null",
+             results_dir, results_dir, INPUTS_DIR, results_dir, INPUTS_DIR, results_dir, INPUTS_DIR, results_dir,
+             INPUTS_DIR, results_dir, INPUTS_DIR, results_dir);
+    int compressed = run_command(cmd) == 0;
+
+    printf("[TEST MODE]: Testing every format\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -t %s/tans.huf %s/packed.huf %s/stream.huf %s/adaptive.huf"
+             " %s/checked.huf > /dev/null && test \"$(ls %s | wc -l)\" -eq 5",
+             results_dir, results_dir, results_dir, results_dir, results_dir, results_dir);
+    report(compressed && run_command(cmd) == 0, "Every file passes and nothing is written");
+
+    printf("[TEST MODE]: Testing a truncated and a corrupted file\n");
+    snprintf(cmd, sizeof(cmd), "head -c -100 %s/tans.huf > %s/truncated.huf"
+             " && ./bin/huffman -t %s/truncated.huf > /dev/null 2>&1", results_dir, results_dir, results_dir);
+    report(compressed && system(cmd) != 0, "Truncated file fails");
+    // One byte in the middle of a segment, only its checksum catches it
+    snprintf(cmd, sizeof(cmd), "cp %s/checked.huf %s/corrupted.huf"
+             " && printf '\\125' | dd of=%s/corrupted.huf bs=1 seek=200000 conv=notrunc 2> /dev/null"
+             " && ./bin/huffman -t %s/corrupted.huf > /dev/null 2>&1", results_dir, results_dir, results_dir,
+             results_dir);
+    report(compressed && system(cmd) != 0, "Segment with a wrong checksum fails");
+    return 0;
+}
+
+// Function to train a table on slices of the text and to round trip small files with it by path and by ID
+int test_trained(void) {
+    char results_dir[MAX_PATH];
+    char cmd[MAX_PATH * 8];
+    snprintf(results_dir, MAX_PATH, "%s/trained", TEST_RESULTS_DIR);
+    printf("\n--------------------------|TRAINED|--------------------------\n");
+    snprintf(cmd, sizeof(cmd), "rm -rf %s && mkdir -p %s/samples && for i in 0 1 2 3 4 5 6 7; do"
+             " tail -c +$((i * 2000 + 1)) %s/text | head -c 2000 > %s/samples/$i.txt; done"
+             " && tail -c 300 %s/text > %s/small.txt && head -c 500 %s/random > %s/random",
+             results_dir, results_dir, INPUTS_DIR, results_dir, INPUTS_DIR, results_dir, INPUTS_DIR, results_dir);
+    int created = run_command(cmd) == 0;
+
+    // Without -o the table is saved as <id>.hft in $HUFFMAN_TABLES
+    printf("[TRAINED]: Training a table\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman train -o %s/table.hft %s/samples > /dev/null"
+             " && HUFFMAN_TABLES=%s ./bin/huffman train %s/samples > /dev/null"
+             " && cmp -s %s/table.hft %s/$(ls %s | grep -v table.hft | grep '.hft$')",
+             results_dir, results_dir, results_dir, results_dir, results_dir, results_dir, results_dir);
+    int trained = created && run_command(cmd) == 0;
+    report(trained, "Table saved by path and by ID are the same");
+
+    printf("[TRAINED]: Compressing small.txt with and without -T\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s/small.txt -T %s/table.hft -o %s/small.huf > /dev/null"
+             " && ./bin/huffman -c %s/small.txt -o %s/small.own.huf > /dev/null"
+             " && test $(stat -c %%s %s/small.huf) -lt $(stat -c %%s %s/small.own.huf)",
+             results_dir, results_dir, results_dir, results_dir, results_dir, results_dir, results_dir);
+    int result = trained && run_command(cmd) == 0;
+    char compressed_path[MAX_PATH];
+    snprintf(compressed_path, MAX_PATH, "%s/small.huf", results_dir);
+    report(result && has_file_magic(compressed_path, dictionary_stream_magic, sizeof(dictionary_stream_magic)),
+           "Trained table file is smaller than one with its own table");
+
+    printf("[TRAINED]: Decompressing small.huf with -T and by the ID in $HUFFMAN_TABLES\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s/small.huf -T %s/table.hft -o %s/small.T > /dev/null"
+             " && HUFFMAN_TABLES=%s ./bin/huffman -d %s/small.huf -o %s/small.id > /dev/null"
+             " && cmp -s %s/small.txt %s/small.T && cmp -s %s/small.txt %s/small.id",
+             results_dir, results_dir, results_dir, results_dir, results_dir, results_dir, results_dir,
+             results_dir, results_dir, results_dir);
+    report(result && run_command(cmd) == 0, "Both decode to the original");
+
+    // Bytes missing from the samples still have codes
+    printf("[TRAINED]: Round tripping random bytes with -T\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s/random -T %s/table.hft -o %s/random.huf > /dev/null"
+             " && ./bin/huffman -d %s/random.huf -T %s/table.hft -o %s/random.out > /dev/null"
+             " && cmp -s %s/random %s/random.out",
+             results_dir, results_dir, results_dir, results_dir, results_dir, results_dir, results_dir,
+             results_dir);
+    report(trained && run_command(cmd) == 0, "Symbols missing from the samples decode to the original");
+
+    printf("[TRAINED]: Decompressing small.huf without its table\n");
+    snprintf(cmd, sizeof(cmd), "HUFFMAN_TABLES=%s/samples ./bin/huffman -d %s/small.huf -o %s/small.none"
+             " > /dev/null 2>&1", results_dir, results_dir, results_dir);
+    report(result && system(cmd) != 0, "File of a missing table is rejected");
+    return 0;
+}
+
+// Function to check that -V fails on a damaged segment and on files without checksums, in every decode path
+int test_verify(void) {
+    char results_dir[MAX_PATH];
+    char cmd[MAX_PATH * 6];
+    snprintf(results_dir, MAX_PATH, "%s/verify", TEST_RESULTS_DIR);
+    printf("\n--------------------------|VERIFY|---------------------------\n");
+    snprintf(cmd, sizeof(cmd), "rm -rf %s && mkdir -p %s"
+             " && ./bin/huffman -c %s/text -k -s 64 -o %s/checked.huf > /dev/null"
+             " && ./bin/huffman -c %s/text -s 64 -o %s/unchecked.huf > /dev/null"
+             " && cp %s/checked.huf %s/corrupted.huf"
+             " && printf '\\125' | dd of=%s/corrupted.huf bs=1 seek=200000 conv=notrunc 2> /dev/null",
+             results_dir, results_dir, INPUTS_DIR, results_dir, INPUTS_DIR, results_dir, results_dir, results_dir,
+             results_dir);
+    int compressed = run_command(cmd) == 0;
+
+    printf("[VERIFY]: Decompressing with and without -V\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s/checked.huf -V -o %s/checked > /dev/null"
+             " && ./bin/huffman -d %s/corrupted.huf -o %s/corrupted > /dev/null"
+             " && cmp -s %s/text %s/checked", results_dir, results_dir, results_dir, results_dir, INPUTS_DIR,
+             results_dir);
+    report(compressed && run_command(cmd) == 0, "Intact file passes -V, damaged one decodes without it");
+    const char *options[] = {"", "-p", "-j 4", "-r 400000:1000"};
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+        printf("[VERIFY]: Decompressing corrupted.huf with -V %s\n", options[i]);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s/corrupted.huf -V %s -o %s/corrupted > /dev/null 2>&1",
+                 results_dir, options[i], results_dir);
+        report(compressed && system(cmd) != 0, "Segment with a wrong checksum fails");
+    }
+    printf("[VERIFY]: Decompressing files without checksums with -V\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s/unchecked.huf -V -o %s/unchecked > /dev/null 2>&1",
+             results_dir, results_dir);
+    report(compressed && system(cmd) != 0, "File without checksums fails");
+    // Batch workers take -V per file
+    snprintf(cmd, sizeof(cmd), "! ./bin/huffman -d %s/checked.huf %s/unchecked.huf -V > /dev/null 2>&1"
+             " && ./bin/huffman -d %s/checked.huf %s/unchecked.huf > /dev/null 2>&1", results_dir, results_dir,
+             results_dir, results_dir);
+    report(compressed && run_command(cmd) == 0, "Batch fails with -V only");
+    return 0;
+}
+
+// Function to pack small files (one shared table) and a large one, and to extract all of them or one
+int test_archive(void) {
+    char results_dir[MAX_PATH];
+    char cmd[MAX_PATH * 6];
+    snprintf(results_dir, MAX_PATH, "%s/archive", TEST_RESULTS_DIR);
+    printf("\n--------------------------|ARCHIVE|--------------------------\n");
+    snprintf(cmd, sizeof(cmd),
+             "rm -rf %s && mkdir -p %s/members/small && head -c 3000 %s/text > %s/members/small/1.txt"
+             " && head -c 6000 %s/dna > %s/members/small/2.txt && cp %s/pic-256.bmp %s/members/",
+             results_dir, results_dir, INPUTS_DIR, results_dir, INPUTS_DIR, results_dir, TEST_FILES_DIR, results_dir);
+    if (run_command(cmd) != 0) {
+        return -1;
+    }
+
+    printf("[ARCHIVE]: Packing %s/members\n", results_dir);
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -a %s/members.hfa %s/members > /dev/null", results_dir, results_dir);
+    int packed = run_command(cmd) == 0;
+    report(packed, "Archive created");
+    // Consecutive small files are one group with one table
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -l %s/members.hfa | awk '/\\/small\\// {print $3}' | uniq | wc -l | grep -qx 1",
+             results_dir);
+    report(packed && run_command(cmd) == 0, "Small members share a table");
+
+    printf("[ARCHIVE]: Extracting every member\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -x %s/members.hfa -o %s/all > /dev/null && diff -r %s/members %s/all/%s/members",
+             results_dir, results_dir, results_dir, results_dir, results_dir + 2);
+    report(packed && run_command(cmd) == 0, "Extracted members match the originals");
+
+    printf("[ARCHIVE]: Extracting one member of the shared group\n");
+    snprintf(cmd, sizeof(cmd),
+             "./bin/huffman -x %s/members.hfa -o %s/one %s/members/small/2.txt > /dev/null"
+             " && cmp %s/members/small/2.txt %s/one/%s/members/small/2.txt && test \"$(find %s/one -type f | wc -l)\" -eq 1",
+             results_dir, results_dir, results_dir + 2, results_dir, results_dir, results_dir + 2, results_dir);
+    report(packed && run_command(cmd) == 0, "Only the given member is extracted");
+    return 0;
+}
+
+// Function to compress lines as records and decode the file and single records
+int test_records(void) {
+    char results_dir[MAX_PATH];
+    char cmd[MAX_PATH * 6];
+    snprintf(results_dir, MAX_PATH, "%s/records", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n--------------------------|RECORDS|--------------------------\n");
+    snprintf(cmd, sizeof(cmd), "head -c 100000 %s/text > %s/lines.txt", INPUTS_DIR, results_dir);
+    if (run_command(cmd) != 0) {
+        return -1;
+    }
+
+    printf("[RECORDS]: Compressing %s/lines.txt as records\n", results_dir);
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s/lines.txt --records -o %s/lines.huf > /dev/null"
+             " && ./bin/huffman -d %s/lines.huf -o %s/lines.out > /dev/null && cmp %s/lines.txt %s/lines.out",
+             results_dir, results_dir, results_dir, results_dir, results_dir, results_dir);
+    int compressed = run_command(cmd) == 0;
+    report(compressed, "Record file decodes to the original");
+
+    // Record N is line N + 1, without its newline
+    int records[] = {0, 1, 500, 1000};
+    for (size_t i = 0; i < sizeof(records) / sizeof(records[0]); i++) {
+        printf("[RECORDS]: Decompressing record %d\n", records[i]);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s/lines.huf --record %d -o %s/record > /dev/null"
+                 " && sed -n '%dp' %s/lines.txt | head -c -1 | cmp - %s/record",
+                 results_dir, records[i], results_dir, records[i] + 1, results_dir, results_dir);
+        report(compressed && run_command(cmd) == 0, "Record matches its line");
+    }
+    return 0;
+}
+
+// Function to compare the matches of grep on record and seekable files with grep on the original
+int test_grep(void) {
+    char results_dir[MAX_PATH];
+    char cmd[MAX_PATH * 6];
+    snprintf(results_dir, MAX_PATH, "%s/grep", TEST_RESULTS_DIR);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n---------------------------|GREP|----------------------------\n");
+    // 4 KiB segments, so some matches cross into the next segment
+    snprintf(cmd, sizeof(cmd), "head -c 100000 %s/text > %s/lines.txt"
+             " && ./bin/huffman -c %s/lines.txt --records -o %s/records.huf > /dev/null"
+             " && ./bin/huffman -c %s/lines.txt -s 4 -o %s/seekable.huf > /dev/null",
+             INPUTS_DIR, results_dir, results_dir, results_dir, results_dir, results_dir);
+    int compressed = run_command(cmd) == 0;
+
+    const char *patterns[] = {"huffman code", "shorter", "symbol is a"};
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        printf("[GREP]: Searching '%s'\n", patterns[i]);
+        // Record files print the matching records, seekable files the offset of every match
+        snprintf(cmd, sizeof(cmd), "test \"$(./bin/huffman grep '%s' %s/records.huf 2> /dev/null | wc -l)\""
+                 " -eq \"$(grep -c '%s' %s/lines.txt)\"", patterns[i], results_dir, patterns[i], results_dir);
+        report(compressed && run_command(cmd) == 0, "Matching records equal grep -c");
+        snprintf(cmd, sizeof(cmd), "test \"$(./bin/huffman grep '%s' %s/seekable.huf 2> /dev/null | wc -l)\""
+                 " -eq \"$(grep -o '%s' %s/lines.txt | wc -l)\"", patterns[i], results_dir, patterns[i], results_dir);
+        report(compressed && run_command(cmd) == 0, "Matches in the seekable file equal grep -o");
+    }
+    printf("[GREP]: Searching a missing pattern\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman grep 'no such line' %s/records.huf > /dev/null 2>&1", results_dir);
+    report(compressed && system(cmd) != 0, "No match exits with a failure status");
+    return 0;
+}
+
+// Function to write the block of text of an offset of the sparse file at a position of a file
+int write_block(int fd, unsigned long long offset, unsigned long long position) {
+    char block[SPARSE_BLOCK_SIZE];
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] = "the quick brown fox jumps over the lazy dog\n"[(i + offset / SPARSE_BLOCK_SIZE) % 44];
+    }
+    return pwrite(fd, block, sizeof(block), position) == (ssize_t) sizeof(block) ? 0 : -1;
+}
+
+// Function to compress parts of a sparse multi-TB file (run with --sparse, needs a filesystem with sparse files)
+int test_sparse(void) {
+    char results_dir[MAX_PATH];
+    char sparse_path[MAX_PATH];
+    snprintf(results_dir, MAX_PATH, "%s/sparse", TEST_RESULTS_DIR);
+    snprintf(sparse_path, MAX_PATH, "%s/sparse.bin", results_dir);
+    if (create_directory(results_dir) != 0) {
+        return -1;
+    }
+    printf("\n--------------------------|SPARSE|--------------------------\n");
+
+    // Data blocks at 3 TiB and at the end, zeros in between
+    unsigned long long offsets[] = {3ULL << 40, SPARSE_FILE_SIZE - SPARSE_BLOCK_SIZE};
+    int fd = open(sparse_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    int created = fd != -1 && ftruncate(fd, SPARSE_FILE_SIZE) == 0 && write_block(fd, offsets[0], offsets[0]) == 0
+                  && write_block(fd, offsets[1], offsets[1]) == 0;
+    if (fd != -1) {
+        close(fd);
+    }
+    printf("[SPARSE]: Creating a %llu byte sparse file\n", SPARSE_FILE_SIZE);
+    report(created, "Sparse file created");
+
+    // Only the sample is read
+    char cmd[MAX_PATH * 4];
+    printf("[SPARSE]: Estimating from a sample\n");
+    snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s --fast-stats --estimate | grep -q '^Input *%llu$'", sparse_path,
+             SPARSE_FILE_SIZE);
+    report(created && run_command(cmd) == 0, "Estimate reports the 64-bit size");
+
+    // Shards are read and written at offsets past 4 GiB
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        char shard_path[MAX_PATH];
+        char decompressed_path[MAX_PATH];
+        char expected_path[MAX_PATH];
+        snprintf(shard_path, MAX_PATH, "%s/shard-%zu.huf", results_dir, i);
+        snprintf(decompressed_path, MAX_PATH, "%s/shard-%zu", results_dir, i);
+        snprintf(expected_path, MAX_PATH, "%s/expected-%zu", results_dir, i);
+        fd = open(expected_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        int result = fd != -1 && write_block(fd, offsets[i], 0) == 0;
+        if (fd != -1) {
+            close(fd);
+        }
+        printf("[SPARSE]: Compressing the block at %llu\n", offsets[i]);
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -c %s --shard %llu:%llu -o %s > /dev/null", sparse_path, offsets[i],
+                 offsets[i] + SPARSE_BLOCK_SIZE, shard_path);
+        result = result && created && run_command(cmd) == 0;
+        snprintf(cmd, sizeof(cmd), "./bin/huffman -d %s -o %s > /dev/null", shard_path, decompressed_path);
+        result = result && run_command(cmd) == 0;
+        report(result && compare_files(expected_path, decompressed_path) == 1, "Block past 4 GiB decodes to the original");
+    }
+    remove(sparse_path);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // Only the sparse file test
+    if (argc > 1 && strcmp(argv[1], "--sparse") == 0) {
+        if (run_command("make all") != 0 || create_directory(TEST_RESULTS_DIR) != 0 || test_sparse() != 0) {
+            return 1;
+        }
+        printf("\n-------------------------------------------------------------\n");
+        printf("Testing complete (%d failed).\n", failures);
+        return failures != 0;
+    }
+
     // Compile the main program
     if (run_command("make all") != 0) {
         fprintf(stderr, "Compilation failed\n");
@@ -128,17 +948,19 @@ int main() {
 
         // Verify decompressed file matches original
         printf("[TEST %d/3]: Verifying %s\n", test_number, entry->d_name);
-        if (compare_files(input_path, decompressed_path)) {
-            printf("--- [PASSED] - Decompressed file matches original\n");
-        } else {
-            printf("--- [FAILED] - Decompressed file differs from original\n");
-        }
+        report(compare_files(input_path, decompressed_path) == 1, "Decompressed file matches original");
 
         test_number++;
     }
-    printf("\n-------------------------------------------------------------\n");
-
     closedir(dir);
-    printf("Testing complete.\n");
-    return 0;
+
+    if (test_fixtures() != 0 || test_shards() != 0 || test_decoders() != 0 || test_batch() != 0 || test_estimate() != 0
+        || test_parallel() != 0 || test_pipelined() != 0 || test_tans() != 0 || test_packed() != 0
+        || test_adaptive() != 0 || test_test_mode() != 0 || test_trained() != 0 || test_verify() != 0 || test_archive() != 0
+        || test_records() != 0 || test_grep() != 0) {
+        return 1;
+    }
+    printf("\n-------------------------------------------------------------\n");
+    printf("Testing complete (%d failed).\n", failures);
+    return failures != 0;
 }